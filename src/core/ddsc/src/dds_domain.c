@@ -14,12 +14,14 @@
 #include "dds/ddsrt/process.h"
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/static_assert.h"
 #include "dds__init.h"
 #include "dds/ddsc/dds_rhc.h"
 #include "dds__domain.h"
 #include "dds__builtin.h"
 #include "dds__whc_builtintopic.h"
 #include "dds__entity.h"
+#include "dds__statistics.h"
 #include "dds/ddsi/ddsi_iid.h"
 #include "dds/ddsi/ddsi_tkmap.h"
 #include "dds/ddsi/ddsi_serdata.h"
@@ -28,6 +30,7 @@
 #include "dds/ddsi/q_config.h"
 #include "dds/ddsi/q_gc.h"
 #include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/ddsi_statistics.h"
 
 #ifdef DDS_HAS_SHM
 #include "shm__monitor.h"
@@ -35,14 +38,72 @@
 
 static dds_return_t dds_domain_free (dds_entity *vdomain);
 
+#define DQUEUE_SHARD_KV(shard) \
+  { "dqueue" #shard "_depth", DDS_STAT_KIND_UINT32 }, \
+  { "dqueue" #shard "_max_depth", DDS_STAT_KIND_UINT32 }, \
+  { "dqueue" #shard "_latency_lt1us", DDS_STAT_KIND_UINT32 }, \
+  { "dqueue" #shard "_latency_lt4us", DDS_STAT_KIND_UINT32 }, \
+  { "dqueue" #shard "_latency_lt16us", DDS_STAT_KIND_UINT32 }, \
+  { "dqueue" #shard "_latency_lt64us", DDS_STAT_KIND_UINT32 }, \
+  { "dqueue" #shard "_latency_lt256us", DDS_STAT_KIND_UINT32 }, \
+  { "dqueue" #shard "_latency_lt1ms", DDS_STAT_KIND_UINT32 }, \
+  { "dqueue" #shard "_latency_lt4ms", DDS_STAT_KIND_UINT32 }, \
+  { "dqueue" #shard "_latency_lt16ms", DDS_STAT_KIND_UINT32 }, \
+  { "dqueue" #shard "_latency_lt64ms", DDS_STAT_KIND_UINT32 }, \
+  { "dqueue" #shard "_latency_ge64ms", DDS_STAT_KIND_UINT32 }
+
+/* The delivery queues for application data (Internal/DeliveryQueueShards):
+   the number in use, followed by the statistics of the maximum number of
+   them, where those of unused shards remain 0.  The latency histograms
+   (from reception to the start of delivery) are only filled if
+   Internal/ReceiveLatencyStatistics is set */
+static const struct dds_stat_keyvalue_descriptor dds_domain_statistics_kv[] = {
+  { "dqueue_shards", DDS_STAT_KIND_UINT32 },
+  DQUEUE_SHARD_KV (0), DQUEUE_SHARD_KV (1), DQUEUE_SHARD_KV (2), DQUEUE_SHARD_KV (3),
+  DQUEUE_SHARD_KV (4), DQUEUE_SHARD_KV (5), DQUEUE_SHARD_KV (6), DQUEUE_SHARD_KV (7),
+  DQUEUE_SHARD_KV (8), DQUEUE_SHARD_KV (9), DQUEUE_SHARD_KV (10), DQUEUE_SHARD_KV (11),
+  DQUEUE_SHARD_KV (12), DQUEUE_SHARD_KV (13), DQUEUE_SHARD_KV (14), DQUEUE_SHARD_KV (15)
+};
+#define DQUEUE_SHARD_NKV (2 + DDSI_LATENCY_NBUCKETS)
+DDSRT_STATIC_ASSERT (sizeof (dds_domain_statistics_kv) / sizeof (dds_domain_statistics_kv[0]) == 1 + DDSI_MAX_DQUEUE_SHARDS * DQUEUE_SHARD_NKV);
+
+#undef DQUEUE_SHARD_KV
+
+static const struct dds_stat_descriptor dds_domain_statistics_desc = {
+  .count = sizeof (dds_domain_statistics_kv) / sizeof (dds_domain_statistics_kv[0]),
+  .kv = dds_domain_statistics_kv
+};
+
+static struct dds_statistics *dds_domain_create_statistics (const struct dds_entity *entity)
+{
+  return dds_alloc_statistics (entity, &dds_domain_statistics_desc);
+}
+
+static void dds_domain_refresh_statistics (const struct dds_entity *entity, struct dds_statistics *stat)
+{
+  const struct dds_domain *dom = (const struct dds_domain *) entity;
+  const uint32_t nshards = ddsi_get_dqueue_shard_count (&dom->gv);
+  stat->kv[0].u.u32 = nshards;
+  for (uint32_t i = 0; i < nshards; i++)
+  {
+    struct dds_stat_keyvalue * const kv = &stat->kv[1 + i * DQUEUE_SHARD_NKV];
+    uint32_t latency[DDSI_LATENCY_NBUCKETS];
+    ddsi_get_dqueue_shard_stats (&dom->gv, i, &kv[0].u.u32, &kv[1].u.u32, latency);
+    for (uint32_t j = 0; j < DDSI_LATENCY_NBUCKETS; j++)
+      kv[2 + j].u.u32 = latency[j];
+  }
+}
+
+#undef DQUEUE_SHARD_NKV
+
 const struct dds_entity_deriver dds_entity_deriver_domain = {
   .interrupt = dds_entity_deriver_dummy_interrupt,
   .close = dds_entity_deriver_dummy_close,
   .delete = dds_domain_free,
   .set_qos = dds_entity_deriver_dummy_set_qos,
   .validate_status = dds_entity_deriver_dummy_validate_status,
-  .create_statistics = dds_entity_deriver_dummy_create_statistics,
-  .refresh_statistics = dds_entity_deriver_dummy_refresh_statistics
+  .create_statistics = dds_domain_create_statistics,
+  .refresh_statistics = dds_domain_refresh_statistics
 };
 
 static int dds_domain_compare (const void *va, const void *vb)
@@ -412,9 +412,28 @@ void dds_reader_status_cb (void *ventity, const status_cb_data_t *data)
   ddsrt_mutex_unlock (&rd->m_entity.m_observers_lock);
 }
 
+#define LATENCY_HIST_KV(stage) \
+  { "latency_" stage "_lt1us", DDS_STAT_KIND_UINT32 }, \
+  { "latency_" stage "_lt4us", DDS_STAT_KIND_UINT32 }, \
+  { "latency_" stage "_lt16us", DDS_STAT_KIND_UINT32 }, \
+  { "latency_" stage "_lt64us", DDS_STAT_KIND_UINT32 }, \
+  { "latency_" stage "_lt256us", DDS_STAT_KIND_UINT32 }, \
+  { "latency_" stage "_lt1ms", DDS_STAT_KIND_UINT32 }, \
+  { "latency_" stage "_lt4ms", DDS_STAT_KIND_UINT32 }, \
+  { "latency_" stage "_lt16ms", DDS_STAT_KIND_UINT32 }, \
+  { "latency_" stage "_lt64ms", DDS_STAT_KIND_UINT32 }, \
+  { "latency_" stage "_ge64ms", DDS_STAT_KIND_UINT32 }
+
+/* The latency histograms are only filled if Internal/ReceiveLatencyStatistics is set */
 static const struct dds_stat_keyvalue_descriptor dds_reader_statistics_kv[] = {
-  { "discarded_bytes", DDS_STAT_KIND_UINT64 }
+  { "discarded_bytes", DDS_STAT_KIND_UINT64 },
+  LATENCY_HIST_KV ("kernel_to_recv"),
+  LATENCY_HIST_KV ("recv_to_dqueue"),
+  LATENCY_HIST_KV ("dqueue_to_rhc")
 };
+DDSRT_STATIC_ASSERT (sizeof (dds_reader_statistics_kv) / sizeof (dds_reader_statistics_kv[0]) == 1 + DDSI_LATENCY_NSTAGES * DDSI_LATENCY_NBUCKETS);
+
+#undef LATENCY_HIST_KV
 
 static const struct dds_stat_descriptor dds_reader_statistics_desc = {
   .count = sizeof (dds_reader_statistics_kv) / sizeof (dds_reader_statistics_kv[0]),
@@ -430,7 +449,13 @@ static void dds_reader_refresh_statistics (const struct dds_entity *entity, stru
 {
   const struct dds_reader *rd = (const struct dds_reader *) entity;
   if (rd->m_rd)
+  {
+    uint32_t latency[DDSI_LATENCY_NSTAGES * DDSI_LATENCY_NBUCKETS];
     ddsi_get_reader_stats (rd->m_rd, &stat->kv[0].u.u64);
+    ddsi_get_reader_latency_stats (rd->m_rd, latency);
+    for (size_t i = 0; i < sizeof (latency) / sizeof (latency[0]); i++)
+      stat->kv[1 + i].u.u32 = latency[i];
+  }
 }
 
 const struct dds_entity_deriver dds_entity_deriver_reader = {
@@ -16,6 +16,7 @@
 
 extern inline dds_return_t dds_rhc_associate (struct dds_rhc *rhc, struct dds_reader *reader, const struct ddsi_sertype *type, struct ddsi_tkmap *tkmap);
 extern inline bool dds_rhc_store (struct dds_rhc * __restrict rhc, const struct ddsi_writer_info * __restrict pwr_info, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk);
+extern inline uint32_t dds_rhc_store_many (struct dds_rhc * __restrict rhc, uint32_t n, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * const * __restrict samples, struct ddsi_tkmap_instance * const * __restrict tks);
 extern inline void dds_rhc_unregister_wr (struct dds_rhc * __restrict rhc, const struct ddsi_writer_info * __restrict pwr_info);
 extern inline void dds_rhc_relinquish_ownership (struct dds_rhc * __restrict rhc, const uint64_t wr_iid);
 extern inline void dds_rhc_set_qos (struct dds_rhc *rhc, const struct dds_qos *qos);
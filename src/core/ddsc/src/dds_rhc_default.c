@@ -1551,13 +1551,13 @@ static void update_viewstate_and_disposedness (struct dds_rhc_default * __restri
 }
 
 /*
-  dds_rhc_store: DDSI up call into read cache to store new sample. Returns whether sample
-  delivered (true unless a reliable sample rejected).
+  dds_rhc_store_locked: stores a sample with the lock held.  Sets *nda_out if the data
+  available listener needs to be invoked and fills in cb_data if a reader status listener
+  needs to be invoked, both of which must be done after releasing the lock.
 */
 
-static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk)
+static rhc_store_result_t dds_rhc_default_store_locked (struct dds_rhc_default * __restrict rhc, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk, status_cb_data_t * __restrict cb_data, bool * __restrict nda_out)
 {
-  struct dds_rhc_default * const __restrict rhc = (struct dds_rhc_default * __restrict) rhc_common;
   const uint64_t wr_iid = wrinfo->iid;
   const uint32_t statusinfo = sample->statusinfo;
   const bool has_data = (sample->kind == SDK_DATA);
@@ -1568,7 +1568,6 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
   struct trigger_info_post post;
   struct trigger_info_qcond trig_qc;
   rhc_store_result_t stored;
-  status_cb_data_t cb_data;   /* Callback data for reader status callback */
   bool notify_data_available;
 
   TRACE ("rhc_store %"PRIx64",%"PRIx64" si %"PRIx32" has_data %d:", tk->m_iid, wr_iid, statusinfo, has_data);
@@ -1578,18 +1577,15 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
        register, which we do implicitly. (Currently DDSI2 won't allow
        it through anyway.) */
     TRACE (" ignore explicit register\n");
-    return true;
+    return RHC_FILTERED;
   }
 
   notify_data_available = false;
   dummy_instance.iid = tk->m_iid;
   stored = RHC_FILTERED;
-  cb_data.raw_status_id = -1;
 
   init_trigger_info_qcond (&trig_qc);
 
-  ddsrt_mutex_lock (&rhc->lock);
-
   inst = ddsrt_hh_lookup (rhc->instances, &dummy_instance);
   if (inst == NULL)
   {
@@ -1605,7 +1601,7 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
     else
     {
       TRACE (" new instance\n");
-      stored = rhc_store_new_instance (&inst, rhc, wrinfo, sample, tk, has_data, &cb_data, &trig_qc, &notify_data_available);
+      stored = rhc_store_new_instance (&inst, rhc, wrinfo, sample, tk, has_data, cb_data, &trig_qc, &notify_data_available);
       if (stored != RHC_STORED)
         goto error_or_nochange;
 
@@ -1638,10 +1634,10 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
     }
 
     /* notify sample lost */
-    cb_data.raw_status_id = (int) DDS_SAMPLE_LOST_STATUS_ID;
-    cb_data.extra = 0;
-    cb_data.handle = 0;
-    cb_data.add = true;
+    cb_data->raw_status_id = (int) DDS_SAMPLE_LOST_STATUS_ID;
+    cb_data->extra = 0;
+    cb_data->handle = 0;
+    cb_data->add = true;
   }
   else
   {
@@ -1676,7 +1672,7 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
       if (has_data)
       {
         TRACE (" add_sample");
-        if (!add_sample (rhc, inst, wrinfo, sample, &cb_data, &trig_qc, &notify_data_available))
+        if (!add_sample (rhc, inst, wrinfo, sample, cb_data, &trig_qc, &notify_data_available))
         {
           TRACE ("(reject)\n");
           stored = RHC_REJECTED;
@@ -1744,6 +1740,26 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
   postprocess_instance_update (rhc, &inst, &pre, &post, &trig_qc);
 
 error_or_nochange:
+  if (notify_data_available)
+    *nda_out = true;
+  return stored;
+}
+
+/*
+  dds_rhc_store: DDSI up call into read cache to store new sample. Returns whether sample
+  delivered (true unless a reliable sample rejected).
+*/
+
+static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk)
+{
+  struct dds_rhc_default * const __restrict rhc = (struct dds_rhc_default * __restrict) rhc_common;
+  status_cb_data_t cb_data;   /* Callback data for reader status callback */
+  bool notify_data_available = false;
+  rhc_store_result_t stored;
+
+  cb_data.raw_status_id = -1;
+  ddsrt_mutex_lock (&rhc->lock);
+  stored = dds_rhc_default_store_locked (rhc, wrinfo, sample, tk, &cb_data, &notify_data_available);
   ddsrt_mutex_unlock (&rhc->lock);
 
   if (rhc->reader)
@@ -1756,6 +1772,47 @@ error_or_nochange:
   return !(rhc->reliable && stored == RHC_REJECTED);
 }
 
+/*
+  dds_rhc_store_many: stores a batch of samples from a single writer under a single
+  acquisition of the lock.  Condition triggering is already done on transitions only, so
+  the gain is mostly in the lock and in invoking the data available listener once per
+  batch rather than once per sample.
+*/
+
+static uint32_t dds_rhc_default_store_many (struct ddsi_rhc * __restrict rhc_common, uint32_t n, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * const * __restrict samples, struct ddsi_tkmap_instance * const * __restrict tks)
+{
+  struct dds_rhc_default * const __restrict rhc = (struct dds_rhc_default * __restrict) rhc_common;
+  bool notify_data_available = false;
+  uint32_t i;
+
+  ddsrt_mutex_lock (&rhc->lock);
+  for (i = 0; i < n; i++)
+  {
+    status_cb_data_t cb_data;
+    rhc_store_result_t stored;
+    cb_data.raw_status_id = -1;
+    stored = dds_rhc_default_store_locked (rhc, &wrinfo[i], samples[i], tks[i], &cb_data, &notify_data_available);
+    if (cb_data.raw_status_id >= 0 && rhc->reader)
+    {
+      /* Status listeners can't be invoked while holding the lock; a pending
+         data available notification goes first to retain the order */
+      ddsrt_mutex_unlock (&rhc->lock);
+      if (notify_data_available)
+        dds_reader_data_available_cb (rhc->reader);
+      notify_data_available = false;
+      dds_reader_status_cb (&rhc->reader->m_entity, &cb_data);
+      ddsrt_mutex_lock (&rhc->lock);
+    }
+    if (rhc->reliable && stored == RHC_REJECTED)
+      break;
+  }
+  ddsrt_mutex_unlock (&rhc->lock);
+
+  if (rhc->reader && notify_data_available)
+    dds_reader_data_available_cb (rhc->reader);
+  return i;
+}
+
 static void dds_rhc_default_unregister_wr (struct ddsi_rhc * __restrict rhc_common, const struct ddsi_writer_info * __restrict wrinfo)
 {
   /* Only to be called when writer with ID WR_IID has died.
@@ -2899,7 +2956,8 @@ static const struct dds_rhc_ops dds_rhc_default_ops = {
     .unregister_wr = dds_rhc_default_unregister_wr,
     .relinquish_ownership = dds_rhc_default_relinquish_ownership,
     .set_qos = dds_rhc_default_set_qos,
-    .free = dds_rhc_default_free
+    .free = dds_rhc_default_free,
+    .store_many = dds_rhc_default_store_many
   },
   .read = dds_rhc_default_read,
   .take = dds_rhc_default_take,
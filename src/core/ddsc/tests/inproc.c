@@ -0,0 +1,196 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <string.h>
+
+#include "dds/dds.h"
+#include "dds/ddsrt/environ.h"
+#include "dds/ddsrt/heap.h"
+#include "test_common.h"
+
+/* Two domains with different ids mapped onto the same DDSI domain, talking
+   to each other over the in-process transport, so that everything from
+   discovery to retransmits runs without touching a socket */
+#ifdef DDS_HAS_SHM
+#define DDS_CONFIG_INPROC "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}<General><Transport>inproc</Transport></General><Discovery><ExternalDomainId>0</ExternalDomainId></Discovery><Domain id=\"any\"><SharedMemory><Enable>false</Enable></SharedMemory></Domain>"
+#else
+#define DDS_CONFIG_INPROC "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}<General><Transport>inproc</Transport></General><Discovery><ExternalDomainId>0</ExternalDomainId></Discovery>"
+#endif
+
+#define DDS_DOMAINID_PUB 0
+#define DDS_DOMAINID_SUB 1
+
+static dds_entity_t g_pub_domain = 0;
+static dds_entity_t g_sub_domain = 0;
+static dds_entity_t g_pub_participant = 0;
+static dds_entity_t g_sub_participant = 0;
+
+static void inproc_init (void)
+{
+  char *conf_pub = ddsrt_expand_envvars (DDS_CONFIG_INPROC, DDS_DOMAINID_PUB);
+  char *conf_sub = ddsrt_expand_envvars (DDS_CONFIG_INPROC, DDS_DOMAINID_SUB);
+  g_pub_domain = dds_create_domain (DDS_DOMAINID_PUB, conf_pub);
+  CU_ASSERT_FATAL (g_pub_domain > 0);
+  g_sub_domain = dds_create_domain (DDS_DOMAINID_SUB, conf_sub);
+  CU_ASSERT_FATAL (g_sub_domain > 0);
+  ddsrt_free (conf_pub);
+  ddsrt_free (conf_sub);
+
+  g_pub_participant = dds_create_participant (DDS_DOMAINID_PUB, NULL, NULL);
+  CU_ASSERT_FATAL (g_pub_participant > 0);
+  g_sub_participant = dds_create_participant (DDS_DOMAINID_SUB, NULL, NULL);
+  CU_ASSERT_FATAL (g_sub_participant > 0);
+}
+
+static void inproc_fini (void)
+{
+  dds_delete (g_sub_domain);
+  dds_delete (g_pub_domain);
+}
+
+static void create_pair (const dds_topic_descriptor_t *desc, const char *prefix, const dds_qos_t *qos, dds_entity_t *wr, dds_entity_t *rd)
+{
+  char topicname[100];
+  create_unique_topic_name (prefix, topicname, sizeof (topicname));
+  const dds_entity_t pub_tp = dds_create_topic (g_pub_participant, desc, topicname, qos, NULL);
+  CU_ASSERT_FATAL (pub_tp > 0);
+  const dds_entity_t sub_tp = dds_create_topic (g_sub_participant, desc, topicname, qos, NULL);
+  CU_ASSERT_FATAL (sub_tp > 0);
+  *wr = dds_create_writer (g_pub_participant, pub_tp, qos, NULL);
+  CU_ASSERT_FATAL (*wr > 0);
+  *rd = dds_create_reader (g_sub_participant, sub_tp, qos, NULL);
+  CU_ASSERT_FATAL (*rd > 0);
+  sync_reader_writer (g_sub_participant, *rd, g_pub_participant, *wr);
+}
+
+CU_Test (ddsc_inproc, reliable, .init = inproc_init, .fini = inproc_fini)
+{
+  /* more samples than fit in a ring, so some only make it through
+     retransmits */
+  const int32_t nkeys = 10, nsamples = 2000;
+  dds_entity_t wr, rd;
+  dds_return_t rc;
+
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  create_pair (&Space_Type1_desc, "ddsc_inproc_reliable", qos, &wr, &rd);
+  dds_delete_qos (qos);
+
+  for (int32_t i = 0; i < nsamples; i++)
+  {
+    Space_Type1 s = { .long_1 = i % nkeys, .long_2 = i, .long_3 = 0 };
+    rc = dds_write (wr, &s);
+    CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  }
+  rc = dds_wait_for_acks (wr, DDS_SECS (10));
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+
+  int32_t next[10];
+  for (int32_t k = 0; k < nkeys; k++)
+    next[k] = k;
+  int32_t count = 0;
+  const dds_time_t tend = dds_time () + DDS_SECS (10);
+  while (count < nsamples && dds_time () < tend)
+  {
+    Space_Type1 s;
+    void *raw = &s;
+    dds_sample_info_t si;
+    if ((rc = dds_take (rd, &raw, &si, 1, 1)) == 0)
+    {
+      dds_sleepfor (DDS_MSECS (10));
+      continue;
+    }
+    CU_ASSERT_FATAL (rc == 1);
+    CU_ASSERT_FATAL (si.valid_data);
+    CU_ASSERT_FATAL (s.long_1 >= 0 && s.long_1 < nkeys);
+    CU_ASSERT_EQUAL_FATAL (s.long_2, next[s.long_1]);
+    next[s.long_1] += nkeys;
+    count++;
+  }
+  CU_ASSERT_EQUAL (count, nsamples);
+}
+
+CU_Test (ddsc_inproc, fragmented, .init = inproc_init, .fini = inproc_fini)
+{
+  const uint32_t size = 200000, nsamples = 5;
+  dds_entity_t wr, rd;
+  dds_return_t rc;
+
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  create_pair (&RoundTripModule_DataType_desc, "ddsc_inproc_fragmented", qos, &wr, &rd);
+  dds_delete_qos (qos);
+
+  RoundTripModule_DataType s;
+  s.payload._length = s.payload._maximum = size;
+  s.payload._buffer = ddsrt_malloc (size);
+  s.payload._release = false;
+  for (uint32_t i = 0; i < nsamples; i++)
+  {
+    for (uint32_t j = 0; j < size; j++)
+      s.payload._buffer[j] = (uint8_t) (i + j * 7);
+    rc = dds_write (wr, &s);
+    CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  }
+  ddsrt_free (s.payload._buffer);
+  rc = dds_wait_for_acks (wr, DDS_SECS (10));
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+
+  uint32_t count = 0;
+  const dds_time_t tend = dds_time () + DDS_SECS (10);
+  while (count < nsamples && dds_time () < tend)
+  {
+    void *raw = NULL;
+    dds_sample_info_t si;
+    if ((rc = dds_take (rd, &raw, &si, 1, 1)) == 0)
+    {
+      dds_sleepfor (DDS_MSECS (10));
+      continue;
+    }
+    CU_ASSERT_FATAL (rc == 1);
+    CU_ASSERT_FATAL (si.valid_data);
+    const RoundTripModule_DataType *r = raw;
+    CU_ASSERT_EQUAL_FATAL (r->payload._length, size);
+    uint32_t j;
+    for (j = 0; j < size; j++)
+      if (r->payload._buffer[j] != (uint8_t) (count + j * 7))
+        break;
+    CU_ASSERT_EQUAL (j, size);
+    rc = dds_return_loan (rd, &raw, 1);
+    CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+    count++;
+  }
+  CU_ASSERT_EQUAL (count, nsamples);
+}
+
+CU_Test (ddsc_inproc, unmatch, .init = inproc_init, .fini = inproc_fini)
+{
+  dds_entity_t wr, rd;
+  dds_return_t rc;
+
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  create_pair (&Space_Type1_desc, "ddsc_inproc_unmatch", qos, &wr, &rd);
+  dds_delete_qos (qos);
+
+  /* deleting the remote participant must be noticed through discovery over
+     the inproc transport */
+  rc = dds_delete (g_sub_participant);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  dds_publication_matched_status_t pm;
+  const dds_time_t tend = dds_time () + DDS_SECS (5);
+  while ((rc = dds_get_publication_matched_status (wr, &pm)) == DDS_RETCODE_OK && pm.current_count != 0 && dds_time () < tend)
+    dds_sleepfor (DDS_MSECS (10));
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  CU_ASSERT_EQUAL (pm.current_count, 0);
+}
@@ -330,17 +330,20 @@ CU_Test (ddsc_listener, matched)
   // - first: durability service history depth 1: 2nd write of 2 pushes
   //   the 1st write of it out of the history and only 2 samples arrive
   // - second: d.s. keep-all: both writes are kept and 3 samples arrive
+  // samples that become deliverable together are signalled with a single
+  // data_available, so how many invocations it takes for 2 and 3 depends on
+  // timing: wait for the samples instead
   dotest ("sm da r(d=tl) pm w'(d=tl,h=1,ds=0/1) ; ?sm r ?pm w' ;"
           " wr w' 1 ; ?da r read{(1,0,0)} r ;"
           " deaf P' ; ?pm(1,0,0,-1,r) w' ; wr w' 2 wr w' 2 ;"
           " hearing P' ; ?pm(2,1,1,1,r) w' ; wr w' 3 ;"
-          " ?da(2) r read{s(1,0,0),f(2,0,0),f(3,0,0)} r ;"
+          " ?read{s(1,0,0),f(2,0,0),f(3,0,0)} r ?da r ;"
           " -w' ?sm r ?da r read(3,3) r");
   dotest ("sm da r(d=tl) pm w'(d=tl,h=1,ds=0/all) ; ?sm r ?pm w' ;"
           " wr w' 1 ; ?da r read{(1,0,0)} r ;"
           " deaf P' ; ?pm(1,0,0,-1,r) w' ; wr w' 2 wr w' 2 ;"
           " hearing P' ; ?pm(2,1,1,1,r) w' ; wr w' 3 ;"
-          " ?da(3) r read{s(1,0,0),f(2,0,0),f(2,0,0),f(3,0,0)} r ;"
+          " ?read{s(1,0,0),f(2,0,0),f(2,0,0),f(3,0,0)} r ?da r ;"
           " -w' ?sm r ?da r read(4,3) r");
 }
 
@@ -265,10 +265,10 @@ static void waitfor_or_reset_fastpath (dds_entity_t rdhandle, bool fastpath, siz
     struct proxy_writer * const pwr = entidx_lookup_proxy_writer_guid (rd->e.gv->entity_index, &cursor);
     ddsrt_mutex_lock (&pwr->rdary.rdary_lock);
     if (!fastpath)
-      pwr->rdary.fastpath_ok = false;
+      ddsrt_atomic_st32 (&pwr->rdary.fastpath_ok, 0);
     else
     {
-      while (!pwr->rdary.fastpath_ok)
+      while (!ddsrt_atomic_ld32 (&pwr->rdary.fastpath_ok))
       {
         ddsrt_mutex_unlock (&pwr->rdary.rdary_lock);
         dds_sleepfor (DDS_MSECS (10));
@@ -288,10 +288,10 @@ static void waitfor_or_reset_fastpath (dds_entity_t rdhandle, bool fastpath, siz
     struct writer * const wr = entidx_lookup_writer_guid (rd->e.gv->entity_index, &cursor);
     ddsrt_mutex_lock (&wr->rdary.rdary_lock);
     if (!fastpath)
-      wr->rdary.fastpath_ok = fastpath;
+      ddsrt_atomic_st32 (&wr->rdary.fastpath_ok, fastpath);
     else
     {
-      while (!wr->rdary.fastpath_ok)
+      while (!ddsrt_atomic_ld32 (&wr->rdary.fastpath_ok))
       {
         ddsrt_mutex_unlock (&wr->rdary.rdary_lock);
         dds_sleepfor (DDS_MSECS (10));
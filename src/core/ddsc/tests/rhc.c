@@ -0,0 +1,164 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <string.h>
+
+#include "dds/dds.h"
+#include "dds/ddsi/ddsi_iid.h"
+#include "dds/ddsi/ddsi_serdata.h"
+#include "dds/ddsi/ddsi_tkmap.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/q_thread.h"
+#include "dds/ddsc/dds_rhc.h"
+#include "dds__types.h"
+#include "dds__entity.h"
+
+#include "test_common.h"
+
+#define NSAMPLES 5
+
+static dds_entity_t g_participant = 0;
+static dds_entity_t g_topic = 0;
+
+/* Listener invocations in order: 'D' for data available, 'R' for sample
+   rejected.  The samples are stored by the test itself, so the listeners
+   are invoked synchronously on the test thread. */
+static char g_events[4 * NSAMPLES + 1];
+static size_t g_nevents;
+
+static void record_event (char ev)
+{
+  if (g_nevents < sizeof (g_events) - 1)
+    g_events[g_nevents++] = ev;
+}
+
+static void on_data_available (dds_entity_t reader, void *arg)
+{
+  (void) reader; (void) arg;
+  record_event ('D');
+}
+
+static void on_sample_rejected (dds_entity_t reader, const dds_sample_rejected_status_t status, void *arg)
+{
+  (void) reader; (void) status; (void) arg;
+  record_event ('R');
+}
+
+static void rhc_init (void)
+{
+  char name[100];
+  g_participant = dds_create_participant (DDS_DOMAIN_DEFAULT, NULL, NULL);
+  CU_ASSERT_FATAL (g_participant > 0);
+  g_topic = dds_create_topic (g_participant, &Space_Type1_desc, create_unique_topic_name ("ddsc_rhc", name, sizeof (name)), NULL, NULL);
+  CU_ASSERT_FATAL (g_topic > 0);
+  memset (g_events, 0, sizeof (g_events));
+  g_nevents = 0;
+}
+
+static void rhc_fini (void)
+{
+  dds_delete (g_participant);
+}
+
+static dds_entity_t create_reader (dds_reliability_kind_t reliability, int32_t max_samples)
+{
+  dds_qos_t *qos = dds_create_qos ();
+  dds_listener_t *list = dds_create_listener (NULL);
+  dds_qset_reliability (qos, reliability, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  dds_qset_resource_limits (qos, max_samples, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED);
+  dds_lset_data_available (list, on_data_available);
+  dds_lset_sample_rejected (list, on_sample_rejected);
+  const dds_entity_t rd = dds_create_reader (g_participant, g_topic, qos, list);
+  CU_ASSERT_FATAL (rd > 0);
+  dds_delete_listener (list);
+  dds_delete_qos (qos);
+  return rd;
+}
+
+/* Stores NSAMPLES samples with keys 0 .. NSAMPLES-1 from a single (fake)
+   writer in one call to store_many, returning what store_many returns */
+static uint32_t store_many (dds_entity_t reader)
+{
+  struct dds_entity *x;
+  struct ddsi_writer_info wrinfo[NSAMPLES];
+  struct ddsi_serdata *samples[NSAMPLES];
+  struct ddsi_tkmap_instance *tks[NSAMPLES];
+  uint32_t n;
+
+  dds_return_t rc = dds_entity_pin (reader, &x);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  CU_ASSERT_FATAL (dds_entity_kind (x) == DDS_KIND_READER);
+  struct dds_reader * const rd = (struct dds_reader *) x;
+  struct ddsi_domaingv * const gv = &x->m_domain->gv;
+
+  memset (wrinfo, 0, sizeof (wrinfo));
+  const uint64_t wr_iid = ddsi_iid_gen ();
+  thread_state_awake (lookup_thread_state (), gv);
+  for (int32_t i = 0; i < NSAMPLES; i++)
+  {
+    const Space_Type1 s = { i, 0, 0 };
+    wrinfo[i].iid = wr_iid;
+#ifdef DDS_HAS_LIFESPAN
+    wrinfo[i].lifespan_exp = DDSRT_MTIME_NEVER;
+#endif
+    samples[i] = ddsi_serdata_from_sample (rd->m_topic->m_stype, SDK_DATA, &s);
+    CU_ASSERT_FATAL (samples[i] != NULL);
+    samples[i]->timestamp.v = dds_time ();
+    tks[i] = ddsi_tkmap_lookup_instance_ref (gv->m_tkmap, samples[i]);
+  }
+  n = dds_rhc_store_many (rd->m_rhc, NSAMPLES, wrinfo, samples, tks);
+  for (int32_t i = 0; i < NSAMPLES; i++)
+  {
+    ddsi_tkmap_instance_unref (gv->m_tkmap, tks[i]);
+    ddsi_serdata_unref (samples[i]);
+  }
+  thread_state_asleep (lookup_thread_state ());
+  dds_entity_unpin (x);
+  return n;
+}
+
+static int32_t take_all (dds_entity_t reader)
+{
+  Space_Type1 data[2 * NSAMPLES];
+  void *raw[2 * NSAMPLES];
+  dds_sample_info_t si[2 * NSAMPLES];
+  for (size_t i = 0; i < sizeof (raw) / sizeof (raw[0]); i++)
+    raw[i] = &data[i];
+  return dds_take (reader, raw, si, 2 * NSAMPLES, 2 * NSAMPLES);
+}
+
+CU_Test (ddsc_rhc, store_many_data_available_once, .init = rhc_init, .fini = rhc_fini)
+{
+  const dds_entity_t rd = create_reader (DDS_RELIABILITY_RELIABLE, DDS_LENGTH_UNLIMITED);
+  CU_ASSERT_EQUAL (store_many (rd), NSAMPLES);
+  CU_ASSERT_STRING_EQUAL (g_events, "D");
+  CU_ASSERT_EQUAL (take_all (rd), NSAMPLES);
+}
+
+CU_Test (ddsc_rhc, store_many_reliable_reject, .init = rhc_init, .fini = rhc_fini)
+{
+  /* the third sample is rejected: the pending data available goes out
+     before the sample rejected status, and nothing after it is stored */
+  const dds_entity_t rd = create_reader (DDS_RELIABILITY_RELIABLE, 2);
+  CU_ASSERT_EQUAL (store_many (rd), 2);
+  CU_ASSERT_STRING_EQUAL (g_events, "DR");
+  CU_ASSERT_EQUAL (take_all (rd), 2);
+}
+
+CU_Test (ddsc_rhc, store_many_best_effort_reject, .init = rhc_init, .fini = rhc_fini)
+{
+  /* best-effort samples are simply dropped, each with its own status */
+  const dds_entity_t rd = create_reader (DDS_RELIABILITY_BEST_EFFORT, 2);
+  CU_ASSERT_EQUAL (store_many (rd), NSAMPLES);
+  CU_ASSERT_STRING_EQUAL (g_events, "DRRR");
+  CU_ASSERT_EQUAL (take_all (rd), 2);
+}
@@ -1213,7 +1213,27 @@ static bool doreadlike_matchstep (const dds_sample_info_t *si, const Space_Type1
   }
 }
 
-static void doreadlike (struct oneliner_ctx *ctx, const char *name, dds_return_t (*fn) (dds_entity_t, void **buf, dds_sample_info_t *, size_t, uint32_t))
+static void doreadlike_waitfor (struct oneliner_ctx *ctx, const char *name, int ent, uint32_t nexp)
+{
+  // a read condition for any state tracks the number of samples in the
+  // reader without affecting their state
+  dds_return_t ret;
+  dds_entity_t rdcond;
+  struct dds_entity *x;
+  printf ("entity %"PRId32": wait for %"PRIu32" samples\n", ctx->es[ent], nexp);
+  if ((rdcond = dds_create_readcondition (ctx->es[ent], DDS_ANY_STATE)) < 0)
+    error_dds (ctx, rdcond, "%s: failed to create read condition on %"PRId32, name, ctx->es[ent]);
+  if ((ret = dds_entity_pin (rdcond, &x)) < 0)
+    error_dds (ctx, ret, "%s: pin read condition failed %"PRId32, name, rdcond);
+  const dds_time_t tend = dds_time () + DDS_SECS (5);
+  while (ddsrt_atomic_ld32 (&x->m_status.m_trigger) < nexp && dds_time () < tend)
+    dds_sleepfor (DDS_MSECS (10));
+  dds_entity_unpin (x);
+  if ((ret = dds_delete (rdcond)) < 0)
+    error_dds (ctx, ret, "%s: failed to delete read condition %"PRId32, name, rdcond);
+}
+
+static void doreadlike (struct oneliner_ctx *ctx, const char *name, dds_return_t (*fn) (dds_entity_t, void **buf, dds_sample_info_t *, size_t, uint32_t), bool wait)
 {
 #define MAXN 10
   struct doreadlike_sample exp[MAXN];
@@ -1252,6 +1272,16 @@ static void doreadlike (struct oneliner_ctx *ctx, const char *name, dds_return_t
   }
   if ((ent = parse_entity1 (&ctx->l, NULL)) < 0)
     error (ctx, "%s: entity required", name);
+  if (wait)
+  {
+    // a mismatch is detected by the read itself
+    if (exp_nvalid >= 0)
+      doreadlike_waitfor (ctx, name, ent, (uint32_t) (exp_nvalid + exp_ninvalid));
+    else if (!ellipsis)
+      doreadlike_waitfor (ctx, name, ent, (uint32_t) nexp);
+    else
+      error (ctx, "%s: waiting requires the number of samples", name);
+  }
 
   for (int i = 0; i < nexp; i++)
   {
@@ -1319,8 +1349,8 @@ static void doreadlike (struct oneliner_ctx *ctx, const char *name, dds_return_t
 #undef MAXN
 }
 
-static void dotake (struct oneliner_ctx *ctx) { doreadlike (ctx, "take", dds_take); }
-static void doread (struct oneliner_ctx *ctx) { doreadlike (ctx, "read", dds_read); }
+static void dotake (struct oneliner_ctx *ctx) { doreadlike (ctx, "take", dds_take, false); }
+static void doread (struct oneliner_ctx *ctx) { doreadlike (ctx, "read", dds_read, false); }
 
 static void dowritelike (struct oneliner_ctx *ctx, const char *name, bool fail, dds_return_t (*fn) (dds_entity_t wr, const void *sample, dds_time_t ts))
 {
@@ -1637,6 +1667,14 @@ static void dowait (struct oneliner_ctx *ctx)
     nexttok (&ctx->l, NULL);
     dowaitforack (ctx);
   }
+  else if (peektok (&ctx->l, &tokval) == TOK_NAME && (strcmp (tokval.n, "read") == 0 || strcmp (tokval.n, "take") == 0))
+  {
+    nexttok (&ctx->l, NULL);
+    if (strcmp (tokval.n, "read") == 0)
+      doreadlike (ctx, "read", dds_read, true);
+    else
+      doreadlike (ctx, "take", dds_take, true);
+  }
   else
   {
     const bool expectclear = nexttok_if (&ctx->l, '!');
@@ -1952,7 +1990,7 @@ int test_oneliner_fini (struct oneliner_ctx *ctx)
           const char *inp_orig = ctx->l.inp;
           entname_t n;
           ctx->l.inp = getentname (&n, 9*i + j);
-          doreadlike (ctx, "read", dds_read);
+          doreadlike (ctx, "read", dds_read, false);
           ctx->l.inp = inp_orig;
         }
       }
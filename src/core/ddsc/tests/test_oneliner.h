@@ -106,6 +106,10 @@
  *
  *                       If the expected set ends up with "..." there may be other samples
  *                       in the result as well.
+ *               | ?READ-LIKE(A,B) ENTITY-NAME
+ *               | ?READ-LIKE{[S1[,S2[,S3...]]} ENTITY-NAME
+ *                       Waits (for at most 5s) until the reader holds as many samples as
+ *                       are expected, then reads/takes like the regular forms.
  *
  *               | ?LISTENER[(ARGS)] ENTITY-NAME
  *
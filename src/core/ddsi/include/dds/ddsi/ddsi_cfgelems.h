@@ -143,8 +143,11 @@ static struct cfgelem general_cfgelems[] = {
     FUNCTIONS(0, uf_transport_selector, 0, pf_transport_selector),
     DESCRIPTION(
       "<p>This element allows selecting the transport to be used (udp, udp6, "
-      "tcp, tcp6, raweth)</p>"),
-    VALUES("default","udp","udp6","tcp","tcp6","raweth")),
+      "tcp, tcp6, raweth, shmring, inproc). The shmring transport uses rings "
+      "in shared memory and only reaches processes of the same user on the "
+      "same host, the inproc transport only reaches domains in the same "
+      "process and is meant for benchmarking the protocol stack.</p>"),
+    VALUES("default","udp","udp6","tcp","tcp6","raweth","shmring","inproc")),
   BOOL("EnableMulticastLoopback", NULL, 1, "true",
     MEMBER(enableMulticastLoopback),
     FUNCTIONS(0, uf_boolean, 0, pf_boolean),
@@ -730,12 +733,20 @@ static struct cfgelem thread_properties_cfgattrs[] = {
       "<li><i>recv</i>: "
       "receive thread, taking data from the network and running the protocol "
       "state machine;</li>\n"
+      "<li><i>recvMC</i>, <i>recvUC</i>, <i>recvUC1</i> ... <i>recvUC7</i>: "
+      "receive threads for multicast and (sharded) unicast data when "
+      "Internal/MultipleReceiveThreads is enabled;</li>\n"
       "<li><i>dq.builtins</i>: "
       "delivery thread for DDSI-builtin data, primarily for discovery;</li>\n"
+      "<li><i>dq.user</i>, <i>dq.user1</i> ... <i>dq.user15</i>: "
+      "delivery threads for application data, more than one if "
+      "Internal/DeliveryQueueShards is set;</li>\n"
       "<li><i>lease</i>: "
       "DDSI liveliness monitoring;</li>\n"
       "<li><i>tev</i>: "
       "general timed-event handling, retransmits and discovery;</li>\n"
+      "<li><i>tcpsend</i>: "
+      "writes queued data on TCP connections if TCP/SendQueueSize is set;</li>\n"
       "<li><i>fsm</i>: "
       "finite state machine thread for handling security handshake;</li>\n"
       "<li><i>xmit.CHAN</i>: "
@@ -763,6 +774,15 @@ static struct cfgelem thread_properties_cfgelems[] = {
       "default value <i>default</i> leaves the stack size at the operating "
       "system default.</p>"),
     UNIT("memsize")),
+  STRING("Affinity", NULL, 1, "default",
+    MEMBEROF(ddsi_config_thread_properties_listelem, affinity),
+    FUNCTIONS(0, uf_cpu_set, ff_cpu_set, pf_cpu_set),
+    DESCRIPTION(
+      "<p>This element restricts the thread to the listed CPUs, as a "
+      "comma-separated list of CPU numbers and ranges of CPU numbers (e.g., "
+      "<i>0,2-3</i>). The default value <i>default</i> allows it to run on "
+      "any CPU. It is currently only supported on Linux and Windows (where "
+      "only the first 64 CPUs can be used).</p>")),
   END_MARKER
 };
 
@@ -1022,6 +1042,18 @@ static struct cfgelem internal_cfgelems[] = {
       "expressed in samples. Once a delivery queue is full, incoming samples "
       "destined for that queue are dropped until space becomes available "
       "again.</p>")),
+  INT("DeliveryQueueShards", NULL, 1, "1",
+    MEMBER(delivery_queue_shards),
+    FUNCTIONS(0, uf_dqueue_shards, 0, pf_int),
+    DESCRIPTION(
+      "<p>This element sets the number of delivery queues, each with its own "
+      "thread, for application data that is not delivered synchronously. "
+      "Remote writers are assigned to a queue based on their GUID, so that "
+      "the data of any one writer is still delivered in order, while the "
+      "data of different writers can be delivered in parallel. Each queue "
+      "can hold up to Internal/DeliveryQueueMaxSamples samples. A value of 1 "
+      "disables sharding.</p>"),
+    RANGE("1;16")),
   INT("PrimaryReorderMaxSamples", NULL, 1, "128",
     MEMBER(primary_reorder_maxsamples),
     FUNCTIONS(0, uf_uint, 0, pf_uint),
@@ -1053,6 +1085,32 @@ static struct cfgelem internal_cfgelems[] = {
       "defragmented simultaneously for a reliable writer. This has to be "
       "large enough to handle retransmissions of historical data in addition "
       "to new samples.</p>")),
+  STRING("DefragContiguousThreshold", NULL, 1, "0 B",
+    MEMBER(defrag_contig_threshold),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element sets the size from which samples are reassembled "
+      "into a contiguous buffer allocated upon reception of the first "
+      "fragment, rather than by chaining the received fragments. This "
+      "allows the data to be stored in the reader history cache without "
+      "copying it once more, but the full size of the sample is allocated "
+      "even if only a single fragment ever arrives. The default of 0 B "
+      "disables it.</p>"),
+    UNIT("memsize")),
+  STRING("DefragContiguousMaxSize", NULL, 1, "16 MiB",
+    MEMBER(defrag_contig_max_size),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element sets the size above which samples are never "
+      "reassembled into a contiguous buffer, regardless of "
+      "Internal/DefragContiguousThreshold. The size of a sample is taken "
+      "from its first fragment, so this bounds the memory a remote writer "
+      "can have allocated by sending a single fragment of each of "
+      "Internal/DefragReliableMaxSamples (or "
+      "Internal/DefragUnreliableMaxSamples) samples. Larger samples are "
+      "reassembled by chaining the received fragments. Internal/MaxSampleSize "
+      "applies as well.</p>"),
+    UNIT("memsize")),
   ENUM("BuiltinEndpointSet", NULL, 1, "writers",
     MEMBER(besmode),
     FUNCTIONS(0, uf_besmode, 0, pf_besmode),
@@ -1108,6 +1166,21 @@ static struct cfgelem internal_cfgelems[] = {
       "asynchronously through delivery queues. This reduces latency at the "
       "expense of aggregate bandwidth.</p>"),
     UNIT("duration_inf")),
+  STRING("SynchronousDeliveryCostBound", NULL, 1, "inf",
+    MEMBER(synchronous_delivery_cost_bound),
+    FUNCTIONS(0, uf_duration_inf, 0, pf_duration),
+    DESCRIPTION(
+      "<p>This element enables switching between synchronous and asynchronous "
+      "delivery at runtime for writers that qualify for synchronous delivery "
+      "according to SynchronousDeliveryPriorityThreshold and "
+      "SynchronousDeliveryLatencyBound. Delivery of a writer's data moves to "
+      "a delivery queue when the average time it takes to store a sample in "
+      "the readers' history caches (including invoking listeners) exceeds "
+      "this element's value, or when delivering takes more than half the time "
+      "of the \"recv\" thread. It moves back once the average cost is below "
+      "half this value and delivering takes less than a quarter of the time. "
+      "The default, \"inf\", disables this.</p>"),
+    UNIT("duration_inf")),
   INT("MaxParticipants", NULL, 1, "0",
     MEMBER(max_participants),
     FUNCTIONS(0, uf_natint, 0, pf_int),
@@ -1402,6 +1475,169 @@ static struct cfgelem internal_cfgelems[] = {
     "transport (e.g., UDP) and ManySocketsMode not set to single (the "
     "default).</p>"),
     VALUES("false","true","default")),
+  INT("ReceiveBatchSize", NULL, 1, "1",
+    MEMBER(recv_batch_size),
+    FUNCTIONS(0, uf_recv_batch_size, 0, pf_int),
+    DESCRIPTION(
+      "<p>This element sets the maximum number of datagrams a receive thread "
+      "reads from a socket in a single system call, for transports that "
+      "support it (currently UDP on Linux, using recvmmsg). Each datagram in "
+      "a batch is received in a receive buffer of its own, so the memory "
+      "reserved for receive buffers grows proportionally. A value of 1 "
+      "disables batching.</p>"),
+    RANGE("1;64")),
+  BOOL("SendSegmentationOffload", NULL, 1, "false",
+    MEMBER(send_gso),
+    FUNCTIONS(0, uf_boolean, 0, pf_boolean),
+    DESCRIPTION(
+      "<p>This element enables the use of generic segmentation offload for "
+      "transmitting runs of equal-sized packets (such as the fragments of a "
+      "large sample) to the same destination in a single system call. It is "
+      "currently only supported for UDP on Linux and silently falls back to "
+      "sending each packet individually if the kernel does not support it. "
+      "It is only effective if the packets fit in the path MTU, i.e., if "
+      "General/MaxMessageSize is below the MTU.</p>")),
+  STRING("SendZeroCopyThreshold", NULL, 1, "0 B",
+    MEMBER(send_zerocopy_threshold),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element sets the minimum size of a packet for it to be sent "
+      "without the kernel copying the data (MSG_ZEROCOPY), the sample data "
+      "is then kept until the kernel reports completion of the transmission, "
+      "which sending the last packet of a write waits for. "
+      "It is currently only supported for UDP on Linux, only applies to "
+      "packets with a single destination address and silently falls back to "
+      "copying if the kernel does not support it. Avoiding the copy only "
+      "pays off for large packets (typically above 10kB), which requires "
+      "raising General/MaxMessageSize and General/FragmentSize for large "
+      "samples. A value of 0 disables it.</p>"),
+    UNIT("memsize")),
+  BOOL("ReceiveOffload", NULL, 1, "false",
+    MEMBER(recv_gro),
+    FUNCTIONS(0, uf_boolean, 0, pf_boolean),
+    DESCRIPTION(
+      "<p>This element allows the kernel to coalesce runs of equal-sized "
+      "datagrams from the same source (such as the fragments of a large "
+      "sample) into a single one, which is then split into the original "
+      "messages by Cyclone. This reduces the number of system calls and the "
+      "number of receive buffers used. It is currently only supported for "
+      "UDP on Linux, and requires Sizing/ReceiveBufferChunkSize to be at "
+      "least 64kB.</p>")),
+  STRING("ReceiveBusyPoll", NULL, 1, "0 s",
+    MEMBER(recv_busy_poll),
+    FUNCTIONS(0, uf_duration_us_1s, 0, pf_duration),
+    DESCRIPTION(
+      "<p>This element sets how long a receive thread keeps checking for "
+      "incoming data without blocking before it goes to sleep waiting for "
+      "data. This reduces latency by avoiding the wake-up of the thread, at "
+      "the cost of a fully loaded CPU while data is arriving within this "
+      "interval. It is best combined with pinning the receive threads to "
+      "dedicated CPUs using Threads/Thread/Affinity: on a CPU shared with the "
+      "application, polling takes CPU time from the threads that produce the "
+      "data and so increases latency. A value of 0 disables busy "
+      "polling.</p>"),
+    UNIT("duration")),
+  BOOL("SocketBusyPoll", NULL, 1, "false",
+    MEMBER(socket_busy_poll),
+    FUNCTIONS(0, uf_boolean, 0, pf_boolean),
+    DESCRIPTION(
+      "<p>This element enables busy polling of the network device queue by "
+      "the kernel (SO_BUSY_POLL) on the receive sockets, using "
+      "Internal/ReceiveBusyPoll as the polling interval. It is currently only "
+      "supported for UDP on Linux, and it may require additional privileges "
+      "(CAP_NET_ADMIN), failure to enable it is only logged.</p>")),
+  BOOL("ReceiveLatencyStatistics", NULL, 1, "false",
+    MEMBER(recv_latency_stats),
+    FUNCTIONS(0, uf_boolean, 0, pf_boolean),
+    DESCRIPTION(
+      "<p>This element enables collecting per-reader histograms of the "
+      "latency of samples received from the network, broken down into the "
+      "time from the kernel receiving the packet to the receive thread "
+      "processing it, from there to the start of the delivery to the "
+      "readers, and from there to the sample being stored in the reader "
+      "history cache. They are available through the reader statistics "
+      "(dds_create_statistics). The first requires kernel receive "
+      "timestamps, which are currently only supported for UDP on Linux.</p>")),
+  STRING("ShmRingSize", NULL, 1, "8 MiB",
+    MEMBER(shmring_size),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element sets the size of the ring of each receiving "
+      "connection when using the shmring or inproc transports. Each slot holds "
+      "one message of up to 64kB, the number of slots is the largest power of "
+      "two that fits, with a minimum of 2. Like with a full UDP receive buffer, "
+      "messages arriving while the ring is full are dropped.</p>"),
+    UNIT("memsize")),
+  STRING("RawEthRingSize", NULL, 1, "2 MiB",
+    MEMBER(raweth_ring_size),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element sets the size of the memory-mapped ring shared with "
+      "the kernel that each receiving connection of the raweth transport "
+      "reads frames from, which avoids a system call per frame. With 0 B, "
+      "or if the ring can't be set up, frames are read using recvmsg "
+      "instead.</p>"),
+    UNIT("memsize")),
+  INT("ReceiveShards", NULL, 1, "1",
+    MEMBER(recv_shards),
+    FUNCTIONS(0, uf_recv_shards, 0, pf_int),
+    DESCRIPTION(
+      "<p>This element sets the number of sockets sharing the unicast data "
+      "port, each with its own receive thread and receive buffers, so that "
+      "incoming unicast data can be processed on multiple cores. Which socket "
+      "receives a message is determined by Internal/ReceiveShardSteering. It "
+      "is currently only supported for UDP on Linux (using SO_REUSEPORT), "
+      "and only takes effect if ManySocketsMode is \"single\" and "
+      "Internal/MultipleReceiveThreads is enabled. A value of 1 disables "
+      "sharding. Without a participant index (see "
+      "Discovery/ParticipantIndex), the data normally shares the discovery "
+      "socket; with sharding a separate data socket is created on a random "
+      "port and the shards are bound to that port. If the conditions are "
+      "not met, a warning is logged and a single socket is used.</p>"),
+    RANGE("1;8")),
+  ENUM("ReceiveShardSteering", NULL, 1, "participant",
+    MEMBER(recv_shard_steering),
+    FUNCTIONS(0, uf_recv_shard_steering, 0, pf_recv_shard_steering),
+    DESCRIPTION(
+      "<p>This element determines how the kernel distributes messages over "
+      "the sockets configured with Internal/ReceiveShards:</p>\n"
+      "<ul><li><i>participant</i>: by the GUID prefix in the RTPS header, so "
+      "that all data from a remote participant is handled by the same thread "
+      "and arrives in the order it was sent;</li>\n"
+      "<li><i>cpu</i>: by the CPU on which the kernel processes the packet, "
+      "which avoids cross-core traffic if the network interface distributes "
+      "the load over multiple queues, but messages from a single source may "
+      "be processed out of order if its traffic moves to another CPU, in "
+      "which case late best-effort data is dropped.</li></ul>"),
+    VALUES("participant","cpu")),
+  ENUM("IoUring", NULL, 1, "false",
+    MEMBER(io_uring),
+    FUNCTIONS(0, uf_io_uring, 0, pf_io_uring),
+    DESCRIPTION(
+      "<p>This element enables the use of io_uring for UDP on Linux, falling "
+      "back to regular socket calls if the kernel does not support it:</p>\n"
+      "<ul><li><i>false</i>: do not use io_uring;</li>\n"
+      "<li><i>true</i>: packets are copied into buffers owned by the ring "
+      "and sent asynchronously, without blocking the sending thread unless "
+      "all Internal/IoUringSendSlots are in use; receive threads dedicated "
+      "to a single socket receive directly into the receive buffers using "
+      "multishot receive, with Internal/ReceiveBatchSize buffers "
+      "outstanding;</li>\n"
+      "<li><i>sqpoll</i>: as <i>true</i>, but with a kernel thread polling "
+      "for packets to be sent, which removes the system calls from the send "
+      "path at the cost of a busy-polling thread per transmit socket.</li>"
+      "</ul>\n"
+      "<p>Sending via io_uring replaces the use of sendmmsg and segmentation "
+      "offload.</p>"),
+    VALUES("false","true","sqpoll")),
+  INT("IoUringSendSlots", NULL, 1, "64",
+    MEMBER(io_uring_send_slots),
+    FUNCTIONS(0, uf_io_uring_send_slots, 0, pf_int),
+    DESCRIPTION(
+      "<p>This element sets the number of packets that can be queued for "
+      "sending in an io_uring (see Internal/IoUring), each reserving "
+      "memory of the maximum message size.</p>"),
+    RANGE("1;4096")),
   GROUP("ControlTopic", control_topic_cfgelems, control_topic_cfgattrs, 1,
     NOMEMBER,
     NOFUNCTIONS,
@@ -1556,6 +1792,19 @@ static struct cfgelem tcp_cfgelems[] = {
       "<p>This element specifies the timeout for blocking TCP write "
       "operations. If this timeout expires then the connection is closed.</p>"),
     UNIT("duration")),
+  STRING("SendQueueSize", NULL, 1, "0 B",
+    MEMBER(tcp_send_queue_size),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element specifies the maximum amount of data queued for "
+      "transmission on a single TCP connection. If non-zero, data that can't "
+      "be written immediately because the socket is full is queued and "
+      "written by a separate <i>tcpsend</i> thread, so that a slow peer no "
+      "longer holds up the sending thread. When the queue is full, data of "
+      "best-effort writers is dropped and data of reliable writers waits for "
+      "space for at most WriteTimeout. If 0, all writes block until "
+      "completed. Ignored when SSL is enabled.</p>"),
+    UNIT("memsize")),
   BOOL("AlwaysUsePeeraddrForUnicast", NULL, 1, "false",
     MEMBER(tcp_use_peeraddr_for_unicast),
     FUNCTIONS(0, uf_boolean, 0, pf_boolean),
@@ -139,12 +139,18 @@ struct ddsi_config_maybe_uint32 {
   uint32_t value;
 };
 
+struct ddsi_config_cpu_set {
+  uint32_t n; /* 0: no restriction */
+  uint32_t *cpus;
+};
+
 struct ddsi_config_thread_properties_listelem {
   struct ddsi_config_thread_properties_listelem *next;
   char *name;
   ddsrt_sched_t sched_class;
   struct ddsi_config_maybe_int32 schedule_priority;
   struct ddsi_config_maybe_uint32 stack_size;
+  struct ddsi_config_cpu_set affinity;
 };
 
 struct ddsi_config_peer_listelem
@@ -177,7 +183,9 @@ enum ddsi_transport_selector {
   DDSI_TRANS_UDP6,
   DDSI_TRANS_TCP,
   DDSI_TRANS_TCP6,
-  DDSI_TRANS_RAWETH
+  DDSI_TRANS_RAWETH,
+  DDSI_TRANS_SHMRING,
+  DDSI_TRANS_INPROC
 };
 
 enum ddsi_many_sockets_mode {
@@ -186,6 +194,17 @@ enum ddsi_many_sockets_mode {
   DDSI_MSM_MANY_UNICAST
 };
 
+enum ddsi_recv_shard_steering {
+  DDSI_RSS_PARTICIPANT,
+  DDSI_RSS_CPU
+};
+
+enum ddsi_io_uring_mode {
+  DDSI_IOURING_FALSE,
+  DDSI_IOURING_TRUE,
+  DDSI_IOURING_SQPOLL
+};
+
 #ifdef DDS_HAS_SECURITY
 struct ddsi_plugin_library_properties {
   char *library_path;
@@ -235,6 +254,13 @@ struct ddsi_config_ssl_min_version {
 #define DDSI_XCHECK_RHC 2u
 #define DDSI_XCHECK_XEV 4u
 
+/* Upper bound for Internal/ReceiveBatchSize */
+#define DDSI_MAX_RECV_BATCH_SIZE 64
+
+/* Upper bound for Internal/ReceiveShards */
+#define DDSI_MAX_RECV_SHARDS 8
+#define DDSI_MAX_DQUEUE_SHARDS 16
+
 struct ddsi_config
 {
   int valid;
@@ -280,11 +306,25 @@ struct ddsi_config
   int prioritize_retransmit;
   enum ddsi_boolean_default multiple_recv_threads;
   unsigned recv_thread_stop_maxretries;
+  int recv_batch_size;
+  int send_gso;
+  int recv_gro;
+  int recv_shards;
+  enum ddsi_recv_shard_steering recv_shard_steering;
+  enum ddsi_io_uring_mode io_uring;
+  int io_uring_send_slots;
+  uint32_t send_zerocopy_threshold;
+  int64_t recv_busy_poll;
+  int socket_busy_poll;
+  int recv_latency_stats;
+  uint32_t shmring_size;
+  uint32_t raweth_ring_size;
 
   unsigned primary_reorder_maxsamples;
   unsigned secondary_reorder_maxsamples;
 
   unsigned delivery_queue_maxsamples;
+  int delivery_queue_shards;
 
   uint16_t fragment_size;
   uint32_t max_msg_size;
@@ -304,6 +344,7 @@ struct ddsi_config
   int tcp_port;
   int64_t tcp_read_timeout;
   int64_t tcp_write_timeout;
+  uint32_t tcp_send_queue_size;
   int tcp_use_peeraddr_for_unicast;
 
 #ifdef DDS_HAS_SSL
@@ -342,6 +383,7 @@ struct ddsi_config
   int unicast_response_to_spdp_messages;
   int synchronous_delivery_priority_threshold;
   int64_t synchronous_delivery_latency_bound;
+  int64_t synchronous_delivery_cost_bound;
 
   /* Write cache */
 
@@ -353,6 +395,8 @@ struct ddsi_config
 
   unsigned defrag_unreliable_maxsamples;
   unsigned defrag_reliable_maxsamples;
+  uint32_t defrag_contig_threshold;
+  uint32_t defrag_contig_max_size;
   unsigned accelerate_rexmit_block_size;
   int64_t responsiveness_timeout;
   uint32_t max_participants;
@@ -44,17 +44,34 @@ typedef struct reader * (*deliver_locally_next_reader_t) (struct entity_index *e
     - anything else: error to be returned from deliver_locally_xxx */
 typedef dds_return_t (*deliver_locally_on_failure_fastpath_t) (struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, void *vsourceinfo);
 
+/** optional, called after the sample has been stored in the history cache of rd */
+typedef void (*deliver_locally_delivered_t) (struct reader *rd, void *vsourceinfo);
+
 struct deliver_locally_ops {
   deliver_locally_makesample_t makesample;
   deliver_locally_first_reader_t first_reader;
   deliver_locally_next_reader_t next_reader;
   deliver_locally_on_failure_fastpath_t on_failure_fastpath;
+  deliver_locally_delivered_t delivered;
 };
 
 dds_return_t deliver_locally_one (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, const ddsi_guid_t *rdguid, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo);
 
 dds_return_t deliver_locally_allinsync (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo);
 
+/** Maximum number of samples that can be passed to deliver_locally_allinsync_many */
+#define DELIVER_LOCALLY_MAX_BATCH 64
+
+/** Delivers n samples from the same source, in order, to all in-sync readers, using
+    the history caches' batch interface on the fast path.  wrinfo[k] and vsourceinfo[k]
+    describe the k-th sample.
+
+    On the fast path, a reliable reader that rejects a sample gets the remaining samples
+    retried for as long as on_failure_fastpath returns OK or TRY_AGAIN and it is still
+    part of the fast path, rather than restarting the delivery of the sample to all
+    readers as deliver_locally_allinsync does on TRY_AGAIN. */
+dds_return_t deliver_locally_allinsync_many (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, uint32_t n, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void * const *vsourceinfo);
+
 #if defined (__cplusplus)
 }
 #endif
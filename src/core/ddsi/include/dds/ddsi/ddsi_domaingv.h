@@ -72,11 +72,18 @@ enum recv_thread_mode {
 struct recv_thread_arg {
   enum recv_thread_mode mode;
   struct nn_rbufpool *rbpool;
+  /* Batched reads use one pool per datagram in the batch, so that each
+     pool only ever has one uncommitted message: rbpools[0] = rbpool */
+  uint32_t nrbpools;
+  struct nn_rbufpool **rbpools;
   struct ddsi_domaingv *gv;
   union {
     struct {
       const ddsi_locator_t *loc;
       struct ddsi_tran_conn *conn;
+      /* index of conn in a shared port (see data_conn_uc_shards), sent
+         along when triggering the thread so it reaches the right socket */
+      uint32_t shard;
     } single;
     struct {
       os_sockWaitset ws;
@@ -124,6 +131,12 @@ struct ddsi_domaingv {
   struct ddsi_tran_conn * disc_conn_uc;
   struct ddsi_tran_conn * data_conn_uc;
 
+  /* Additional sockets sharing the port of data_conn_uc if
+     Internal/ReceiveShards > 1, each served by a receive thread of its
+     own. data_conn_uc is shard 0. */
+  uint32_t n_data_conn_uc_shards;
+  struct ddsi_tran_conn * data_conn_uc_shards[DDSI_MAX_RECV_SHARDS - 1];
+
   /* Connection used for all output (for connectionless transports), this
      used to simply be data_conn_uc, but:
 
@@ -219,7 +232,7 @@ struct ddsi_domaingv {
      trigger socket.) Receive buffer pool is per receive thread,
      it is only a global variable because it needs to be freed way later
      than the receive thread itself terminates */
-#define MAX_RECV_THREADS 3
+#define MAX_RECV_THREADS (3 + DDSI_MAX_RECV_SHARDS - 1)
   uint32_t n_recv_threads;
   struct recv_thread {
     const char *name;
@@ -282,8 +295,10 @@ struct ddsi_domaingv {
   uint32_t networkQueueId;
   struct thread_state1 *channel_reader_ts;
 
-  /* Application data gets its own delivery queue */
-  struct nn_dqueue *user_dqueue;
+  /* Application data gets its own delivery queues, remote writers are
+     hashed onto them */
+  uint32_t n_user_dqueues;
+  struct nn_dqueue *user_dqueues[DDSI_MAX_DQUEUE_SHARDS];
 #endif
 
   /* Transmit side: pools for the serializer & transmit messages and a
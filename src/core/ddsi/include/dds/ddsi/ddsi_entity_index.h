@@ -87,6 +87,7 @@ void entidx_remove_proxy_reader_guid (struct entity_index *ei, struct proxy_read
 
 DDS_EXPORT void *entidx_lookup_guid_untyped (const struct entity_index *ei, const struct ddsi_guid *guid) ddsrt_nonnull_all;
 DDS_EXPORT void *entidx_lookup_guid (const struct entity_index *ei, const struct ddsi_guid *guid, enum entity_kind kind) ddsrt_nonnull_all;
+DDS_EXPORT void entidx_prefetch_guid (const struct entity_index *ei, const struct ddsi_guid *guid) ddsrt_nonnull_all;
 
 DDS_EXPORT struct participant *entidx_lookup_participant_guid (const struct entity_index *ei, const struct ddsi_guid *guid) ddsrt_nonnull_all;
 DDS_EXPORT struct proxy_participant *entidx_lookup_proxy_participant_guid (const struct entity_index *ei, const struct ddsi_guid *guid) ddsrt_nonnull_all;
@@ -46,6 +46,13 @@ struct ddsi_writer_info
 
 typedef void (*ddsi_rhc_free_t) (struct ddsi_rhc *rhc);
 typedef bool (*ddsi_rhc_store_t) (struct ddsi_rhc * __restrict rhc, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk);
+/* Stores samples[0..n-1] as if by calling store for each of them in turn, but
+   holding the lock once and invoking the data available listener at most once
+   (status listeners are still invoked for each sample that needs it).  Returns
+   the number of samples processed, which is less than n only if the sample
+   following them was rejected (i.e., when store would have returned false).
+   Optional: if it is a null pointer, store is called for each sample. */
+typedef uint32_t (*ddsi_rhc_store_many_t) (struct ddsi_rhc * __restrict rhc, uint32_t n, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * const * __restrict samples, struct ddsi_tkmap_instance * const * __restrict tks);
 typedef void (*ddsi_rhc_unregister_wr_t) (struct ddsi_rhc * __restrict rhc, const struct ddsi_writer_info * __restrict wrinfo);
 typedef void (*ddsi_rhc_relinquish_ownership_t) (struct ddsi_rhc * __restrict rhc, const uint64_t wr_iid);
 typedef void (*ddsi_rhc_set_qos_t) (struct ddsi_rhc *rhc, const struct dds_qos *qos);
@@ -56,6 +63,9 @@ struct ddsi_rhc_ops {
   ddsi_rhc_relinquish_ownership_t relinquish_ownership;
   ddsi_rhc_set_qos_t set_qos;
   ddsi_rhc_free_t free;
+  /* last, so that existing implementations leave it null even when
+     initialising positionally */
+  ddsi_rhc_store_many_t store_many;
 };
 
 struct ddsi_rhc {
@@ -65,6 +75,14 @@ struct ddsi_rhc {
 DDS_EXPORT inline bool ddsi_rhc_store (struct ddsi_rhc * __restrict rhc, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk) {
   return rhc->ops->store (rhc, wrinfo, sample, tk);
 }
+DDS_EXPORT inline uint32_t ddsi_rhc_store_many (struct ddsi_rhc * __restrict rhc, uint32_t n, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * const * __restrict samples, struct ddsi_tkmap_instance * const * __restrict tks) {
+  uint32_t i;
+  if (rhc->ops->store_many)
+    return rhc->ops->store_many (rhc, n, wrinfo, samples, tks);
+  for (i = 0; i < n && rhc->ops->store (rhc, &wrinfo[i], samples[i], tks[i]); i++)
+    ;
+  return i;
+}
 DDS_EXPORT inline void ddsi_rhc_unregister_wr (struct ddsi_rhc * __restrict rhc, const struct ddsi_writer_info * __restrict wrinfo) {
   rhc->ops->unregister_wr (rhc, wrinfo);
 }
@@ -21,6 +21,8 @@
 
 #include "dds/dds.h"
 
+struct nn_rdata;
+
 #if defined (__cplusplus)
 extern "C" {
 #endif
@@ -68,6 +70,7 @@ typedef struct dds_keyhash {
   DDSI_SERDATA_DEFAULT_DEBUG_FIELDS   \
   dds_keyhash_t keyhash;              \
   struct serdatapool *serpool;        \
+  const struct nn_rdata *contig; /* reassembly buffer holding it */ \
   struct ddsi_serdata_default *next /* in pool->freelist */
 #define DDSI_SERDATA_DEFAULT_POSTPAD  \
   struct CDRHeader hdr;               \
@@ -13,6 +13,7 @@
 #define _DDSI_STATISTICS_H_
 
 #include <stdint.h>
+#include "dds/ddsrt/atomics.h"
 
 #if defined (__cplusplus)
 extern "C" {
@@ -20,10 +21,48 @@ extern "C" {
 
 struct reader;
 struct writer;
+struct ddsi_domaingv;
+
+/* Stages in the reception of a sample from a remote writer: from the kernel
+   receiving the packet to the receive thread processing it (requires
+   kernel timestamps, else not counted), from there to the delivery thread
+   (or the receive thread for synchronous delivery) picking it up, and from
+   there to it being stored in the reader history cache */
+enum ddsi_latency_stage {
+  DDSI_LATENCY_KERNEL_TO_RECV,
+  DDSI_LATENCY_RECV_TO_DQUEUE,
+  DDSI_LATENCY_DQUEUE_TO_RHC
+};
+#define DDSI_LATENCY_NSTAGES 3
+
+/* Histogram buckets: < 1us, < 4us, < 16us, ..., < 64ms, >= 64ms */
+#define DDSI_LATENCY_NBUCKETS 10
+
+struct ddsi_latency_stats {
+  ddsrt_atomic_uint32_t hist[DDSI_LATENCY_NSTAGES][DDSI_LATENCY_NBUCKETS];
+};
+
+uint32_t ddsi_latency_bucket (int64_t latency);
+void ddsi_latency_stats_init (struct ddsi_latency_stats *st);
+void ddsi_latency_stats_add (struct ddsi_latency_stats *st, enum ddsi_latency_stage stage, int64_t latency);
 
 void ddsi_get_writer_stats (struct writer *wr, uint64_t * __restrict rexmit_bytes, uint32_t * __restrict throttle_count, uint64_t * __restrict time_throttled, uint64_t * __restrict time_retransmit);
 void ddsi_get_reader_stats (struct reader *rd, uint64_t * __restrict discarded_bytes);
 
+/* Copies the latency histograms of the reader, stage-major, into counts,
+   which must have room for DDSI_LATENCY_NSTAGES * DDSI_LATENCY_NBUCKETS */
+void ddsi_get_reader_latency_stats (struct reader *rd, uint32_t * __restrict counts);
+
+/* Number of delivery queues for application data (Internal/DeliveryQueueShards) */
+uint32_t ddsi_get_dqueue_shard_count (const struct ddsi_domaingv *gv);
+
+/* Current and maximum number of queued samples for delivery queue shard
+   "shard", and the histogram of the latency from reception to the start
+   of delivery of the samples that went through it (only filled if
+   Internal/ReceiveLatencyStatistics is set), in the buckets used for the
+   reader latency statistics */
+void ddsi_get_dqueue_shard_stats (const struct ddsi_domaingv *gv, uint32_t shard, uint32_t * __restrict depth, uint32_t * __restrict max_depth, uint32_t * __restrict latency);
+
 #if defined (__cplusplus)
 }
 #endif
@@ -16,6 +16,7 @@
 
 #include "dds/ddsrt/ifaddrs.h"
 #include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/time.h"
 #include "dds/ddsi/ddsi_locator.h"
 #include "dds/ddsi/ddsi_config.h"
 
@@ -34,6 +35,7 @@ struct ddsi_domaingv;
 /* Flags */
 
 #define DDSI_TRAN_ON_CONNECT 0x0001
+#define DDSI_TRAN_BEST_EFFORT 0x0002 /* may be dropped if the transport is congested */
 
 /* Core types */
 
@@ -43,10 +45,43 @@ typedef struct ddsi_tran_listener * ddsi_tran_listener_t;
 typedef struct ddsi_tran_factory * ddsi_tran_factory_t;
 typedef struct ddsi_tran_qos ddsi_tran_qos_t;
 
+/* One element of a batched read: buf/len describe the buffer on input, on
+   return len is the size of the message received in it and srcloc its
+   source address.  If the transport coalesced multiple messages from the
+   same source, segsize is the size of each (except the last, which may be
+   shorter), otherwise it is 0.  For ddsi_conn_read_posted, everything is
+   output and id identifies the posted buffer, buf points to the message
+   somewhere in that buffer. */
+struct ddsi_tran_readbuf {
+  unsigned char *buf;
+  size_t len;
+  size_t segsize;
+  ddsi_locator_t srcloc;
+  uint32_t id;
+  ddsrt_wctime_t timestamp; /* kernel receive time, 0 if not available */
+};
+
+/* Maximum number of destinations in a single call to ddsi_conn_write_multi */
+#define DDSI_TRAN_MAX_WRITE_MULTI 64
+
+/* Limits on the number of segments and the total size of a single call to
+   ddsi_conn_write_gso */
+#define DDSI_TRAN_MAX_GSO_SEGMENTS 64
+#define DDSI_TRAN_MAX_GSO_BYTES 65507
+
 /* Function pointer types */
 
 typedef ssize_t (*ddsi_tran_read_fn_t) (ddsi_tran_conn_t, unsigned char *, size_t, bool, ddsi_locator_t *);
+typedef int (*ddsi_tran_read_multi_fn_t) (ddsi_tran_conn_t, size_t, struct ddsi_tran_readbuf *);
+typedef bool (*ddsi_tran_read_pending_fn_t) (ddsi_tran_conn_t);
+typedef dds_return_t (*ddsi_tran_post_readbuf_fn_t) (ddsi_tran_conn_t, uint32_t, unsigned char *, size_t);
+typedef int (*ddsi_tran_read_posted_fn_t) (ddsi_tran_conn_t, size_t, struct ddsi_tran_readbuf *);
+typedef void (*ddsi_tran_cancel_posted_fn_t) (ddsi_tran_conn_t);
 typedef ssize_t (*ddsi_tran_write_fn_t) (ddsi_tran_conn_t, const ddsi_locator_t *, size_t, const ddsrt_iovec_t *, uint32_t);
+typedef ssize_t (*ddsi_tran_write_gso_fn_t) (ddsi_tran_conn_t, const ddsi_locator_t *, size_t, const ddsrt_iovec_t *, uint32_t, uint32_t);
+typedef ssize_t (*ddsi_tran_write_zerocopy_fn_t) (ddsi_tran_conn_t, const ddsi_locator_t *, size_t, const ddsrt_iovec_t *, uint32_t, uint32_t *);
+typedef bool (*ddsi_tran_zerocopy_done_fn_t) (ddsi_tran_conn_t, uint32_t, bool);
+typedef int (*ddsi_tran_write_multi_fn_t) (ddsi_tran_conn_t, size_t, const ddsi_locator_t *, size_t, const ddsrt_iovec_t *, uint32_t);
 typedef int (*ddsi_tran_locator_fn_t) (ddsi_tran_factory_t, ddsi_tran_base_t, ddsi_locator_t *);
 typedef bool (*ddsi_tran_supports_fn_t) (const struct ddsi_tran_factory *, int32_t);
 typedef ddsrt_socket_t (*ddsi_tran_handle_fn_t) (ddsi_tran_base_t);
@@ -113,7 +148,16 @@ struct ddsi_tran_conn
   /* Functions */
 
   ddsi_tran_read_fn_t m_read_fn;
+  ddsi_tran_read_multi_fn_t m_read_multi_fn; /* optional: batched read of datagrams, NULL if not supported */
+  ddsi_tran_read_pending_fn_t m_read_pending_fn; /* optional: data buffered in the transport, NULL if it never buffers */
+  ddsi_tran_post_readbuf_fn_t m_post_readbuf_fn; /* optional: receive into buffers handed over in advance, NULL if not supported */
+  ddsi_tran_read_posted_fn_t m_read_posted_fn; /* required iff m_post_readbuf_fn set */
+  ddsi_tran_cancel_posted_fn_t m_cancel_posted_fn; /* required iff m_post_readbuf_fn set */
   ddsi_tran_write_fn_t m_write_fn;
+  ddsi_tran_write_multi_fn_t m_write_multi_fn; /* optional: same message to multiple destinations, NULL if not supported */
+  ddsi_tran_write_gso_fn_t m_write_gso_fn; /* optional: equal-sized segments in one call, NULL if not supported */
+  ddsi_tran_write_zerocopy_fn_t m_write_zerocopy_fn; /* optional: send without copying the data, NULL if not supported */
+  ddsi_tran_zerocopy_done_fn_t m_zerocopy_done_fn; /* required iff m_write_zerocopy_fn set */
   ddsi_tran_peer_locator_fn_t m_peer_locator_fn;
   ddsi_tran_disable_multiplexing_fn_t m_disable_multiplexing_fn;
   ddsi_tran_locator_fn_t m_locator_fn;
@@ -224,6 +268,7 @@ struct ddsi_tran_qos
   enum ddsi_tran_qos_purpose m_purpose;
   int m_diffserv;
   struct nn_interface *m_interface; // only for purpose = XMIT
+  uint32_t m_shards; // only for purpose = RECV_UC: > 1 to share the port between that many conns
 };
 
 void ddsi_tran_factories_fini (struct ddsi_domaingv *gv);
@@ -276,9 +321,77 @@ inline int ddsi_conn_locator (ddsi_tran_conn_t conn, ddsi_locator_t * loc) {
 inline ssize_t ddsi_conn_write (ddsi_tran_conn_t conn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags) {
   return conn->m_closed ? -1 : (conn->m_write_fn) (conn, dst, niov, iov, flags);
 }
+inline bool ddsi_conn_supports_write_multi (const struct ddsi_tran_conn *conn) {
+  return conn->m_write_multi_fn != 0;
+}
+/* Sends the message to all ndst (<= DDSI_TRAN_MAX_WRITE_MULTI) destinations,
+   returns the number of destinations it was sent to successfully */
+inline int ddsi_conn_write_multi (ddsi_tran_conn_t conn, size_t ndst, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags) {
+  return conn->m_closed ? -1 : conn->m_write_multi_fn (conn, ndst, dst, niov, iov, flags);
+}
+inline bool ddsi_conn_supports_write_gso (const struct ddsi_tran_conn *conn) {
+  return conn->m_write_gso_fn != 0;
+}
+/* Sends the data as a sequence of messages of segsize bytes (the last one may
+   be shorter), returns -1 on failure, in which case none were sent */
+inline ssize_t ddsi_conn_write_gso (ddsi_tran_conn_t conn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t segsize, uint32_t flags) {
+  return conn->m_closed ? -1 : conn->m_write_gso_fn (conn, dst, niov, iov, segsize, flags);
+}
+inline bool ddsi_conn_supports_write_zerocopy (const struct ddsi_tran_conn *conn) {
+  return conn->m_write_zerocopy_fn != 0;
+}
+/* Sends the message without copying the data into the kernel, which means
+   the data must remain untouched until ddsi_conn_zerocopy_done returns true
+   for the sequence number stored in *seq.  Returns -1 if it was not sent,
+   in which case the caller should fall back to ddsi_conn_write. */
+inline ssize_t ddsi_conn_write_zerocopy (ddsi_tran_conn_t conn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags, uint32_t *seq) {
+  return conn->m_closed ? -1 : conn->m_write_zerocopy_fn (conn, dst, niov, iov, flags, seq);
+}
+/* Processes pending completion notifications and returns whether the zero-
+   copy send with sequence number seq has completed, if wait is set it blocks
+   until it has */
+inline bool ddsi_conn_zerocopy_done (ddsi_tran_conn_t conn, uint32_t seq, bool wait) {
+  return conn->m_zerocopy_done_fn (conn, seq, wait);
+}
 inline ssize_t ddsi_conn_read (ddsi_tran_conn_t conn, unsigned char * buf, size_t len, bool allow_spurious, ddsi_locator_t *srcloc) {
   return conn->m_closed ? -1 : conn->m_read_fn (conn, buf, len, allow_spurious, srcloc);
 }
+/* Whether the transport has already read data from the socket that has not
+   yet been returned by ddsi_conn_read, so that waiting for the socket to
+   become readable before reading the next message is wrong */
+inline bool ddsi_conn_read_pending (ddsi_tran_conn_t conn) {
+  return !conn->m_closed && conn->m_read_pending_fn && conn->m_read_pending_fn (conn);
+}
+inline bool ddsi_conn_supports_read_multi (const struct ddsi_tran_conn *conn) {
+  return conn->m_read_multi_fn != 0;
+}
+inline int ddsi_conn_read_multi (ddsi_tran_conn_t conn, size_t nbufs, struct ddsi_tran_readbuf *bufs) {
+  return conn->m_closed ? -1 : conn->m_read_multi_fn (conn, nbufs, bufs);
+}
+
+/* Reception into posted buffers, for transports that have the kernel
+   receive directly into buffers handed over in advance (e.g., io_uring):
+   - ddsi_conn_post_readbuf hands buffer [buf, buf+len) to the transport
+     under the given id, it remains owned by the transport until it is
+     returned by ddsi_conn_read_posted or ddsi_conn_cancel_posted is called;
+   - ddsi_conn_read_posted blocks until at least one message has been
+     received and returns up to nbufs of them (-1 on failure, in which case
+     the caller should cancel and fall back to ddsi_conn_read);
+   - ddsi_conn_cancel_posted returns ownership of all posted buffers, after
+     which the conn can no longer be used for posted reads.
+   These are only meant to be used by a single thread. */
+inline bool ddsi_conn_supports_posted_read (const struct ddsi_tran_conn *conn) {
+  return conn->m_post_readbuf_fn != 0;
+}
+inline dds_return_t ddsi_conn_post_readbuf (ddsi_tran_conn_t conn, uint32_t id, unsigned char *buf, size_t len) {
+  return conn->m_closed ? DDS_RETCODE_ERROR : conn->m_post_readbuf_fn (conn, id, buf, len);
+}
+inline int ddsi_conn_read_posted (ddsi_tran_conn_t conn, size_t nbufs, struct ddsi_tran_readbuf *bufs) {
+  return conn->m_closed ? -1 : conn->m_read_posted_fn (conn, nbufs, bufs);
+}
+inline void ddsi_conn_cancel_posted (ddsi_tran_conn_t conn) {
+  conn->m_cancel_posted_fn (conn);
+}
 bool ddsi_conn_peer_locator (ddsi_tran_conn_t conn, ddsi_locator_t * loc);
 void ddsi_conn_disable_multiplexing (ddsi_tran_conn_t conn);
 void ddsi_conn_add_ref (ddsi_tran_conn_t conn);
@@ -57,6 +57,115 @@ inline void nn_bitset_one (uint32_t numbits, uint32_t *bits)
   }
 }
 
+inline uint32_t nn_bitset_popcount32 (uint32_t x)
+{
+  x = x - ((x >> 1) & UINT32_C(0x55555555));
+  x = (x & UINT32_C(0x33333333)) + ((x >> 2) & UINT32_C(0x33333333));
+  x = (x + (x >> 4)) & UINT32_C(0x0f0f0f0f);
+  return (x * UINT32_C(0x01010101)) >> 24;
+}
+
+inline uint32_t nn_bitset_clz32 (uint32_t x)
+{
+  /* x must be non-zero */
+  assert (x != 0);
+#if defined __GNUC__
+  return (uint32_t) __builtin_clz (x);
+#else
+  uint32_t n = 0;
+  while (!(x & UINT32_C(0x80000000)))
+  {
+    x <<= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+inline uint32_t nn_bitset_ctz32 (uint32_t x)
+{
+  /* x must be non-zero */
+  assert (x != 0);
+#if defined __GNUC__
+  return (uint32_t) __builtin_ctz (x);
+#else
+  uint32_t n = 0;
+  while (!(x & 1))
+  {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+/* Sets bits [min,maxp1) a word at a time, returns the number of bits that
+   weren't set yet */
+inline uint32_t nn_bitset_set_range (UNUSED_ARG_NDEBUG (uint32_t numbits), uint32_t *bits, uint32_t min, uint32_t maxp1)
+{
+  uint32_t n = 0;
+  assert (min <= maxp1 && maxp1 <= numbits);
+  while (min < maxp1)
+  {
+    const uint32_t k = min / 32;
+    const uint32_t hi = (maxp1 - 32 * k >= 32) ? 32 : maxp1 - 32 * k;
+    const uint32_t mask = (~UINT32_C(0) >> (min % 32)) & ((hi == 32) ? ~UINT32_C(0) : ~(~UINT32_C(0) >> hi));
+    n += nn_bitset_popcount32 (mask & ~bits[k]);
+    bits[k] |= mask;
+    min = 32 * k + hi;
+  }
+  return n;
+}
+
+/* Returns the index of the first clear bit >= idx, or numbits if there is none */
+inline uint32_t nn_bitset_find_clear (uint32_t numbits, const uint32_t *bits, uint32_t idx)
+{
+  while (idx < numbits)
+  {
+    const uint32_t k = idx / 32;
+    const uint32_t w = ~bits[k] & (~UINT32_C(0) >> (idx % 32));
+    if (w)
+    {
+      const uint32_t r = 32 * k + nn_bitset_clz32 (w);
+      return (r < numbits) ? r : numbits;
+    }
+    idx = 32 * (k + 1);
+  }
+  return numbits;
+}
+
+/* Returns the index of the last clear bit <= idx, or UINT32_MAX if there is
+   none; idx must be < numbits */
+inline uint32_t nn_bitset_rfind_clear (UNUSED_ARG_NDEBUG (uint32_t numbits), const uint32_t *bits, uint32_t idx)
+{
+  assert (idx < numbits);
+  uint32_t k = idx / 32;
+  uint32_t w = ~bits[k] & (~UINT32_C(0) << (31 - (idx % 32)));
+  while (w == 0)
+  {
+    if (k == 0)
+      return UINT32_MAX;
+    w = ~bits[--k];
+  }
+  return 32 * k + 31 - nn_bitset_ctz32 (w);
+}
+
+/* Returns the 32 bits starting at idx, the first one in the most
+   significant bit, with bits beyond numbits read as 0 */
+inline uint32_t nn_bitset_get32 (uint32_t numbits, const uint32_t *bits, uint32_t idx)
+{
+  const uint32_t k = idx / 32, sh = idx % 32, nwords = (numbits + 31) / 32;
+  uint32_t w;
+  if (idx >= numbits)
+    return 0;
+  w = bits[k] << sh;
+  if (sh > 0 && k + 1 < nwords)
+    w |= bits[k + 1] >> (32 - sh);
+  if (numbits - idx < 32)
+    w &= ~(~UINT32_C(0) >> (numbits - idx));
+  return w;
+}
+
 #if defined (__cplusplus)
 }
 #endif
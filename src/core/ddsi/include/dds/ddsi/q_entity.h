@@ -32,6 +32,7 @@
 #include "dds/ddsi/ddsi_typelookup.h"
 #include "dds/ddsi/ddsi_tran.h"
 #include "dds/ddsi/ddsi_list_genptr.h"
+#include "dds/ddsi/ddsi_statistics.h"
 
 #if defined (__cplusplus)
 extern "C" {
@@ -221,18 +222,32 @@ struct entity_common {
   ddsrt_mutex_t qos_lock;
 };
 
+/* The array of readers is never modified once published: a change
+   replaces it with a new one and frees the old one via the garbage
+   collector, so that delivery (which always happens while awake) needs no
+   lock.  Readers removed from it are not freed until the garbage
+   collector has seen all threads make progress. */
 struct local_reader_ary {
-  ddsrt_mutex_t rdary_lock;
+  ddsrt_mutex_t rdary_lock; /* serialises updates */
   unsigned valid: 1; /* always true until (proxy-)writer is being deleted; !valid => !fastpath_ok */
-  unsigned fastpath_ok: 1; /* if not ok, fall back to using GUIDs (gives access to the reader-writer match data for handling readers that bumped into resource limits, hence can flip-flop, unlike "valid") */
+  ddsrt_atomic_uint32_t fastpath_ok; /* if not ok, fall back to using GUIDs (gives access to the reader-writer match data for handling readers that bumped into resource limits, hence can flip-flop, unlike "valid") */
   uint32_t n_readers;
-  struct reader **rdary; /* for efficient delivery, null-pointer terminated, grouped by topic */
+  ddsrt_atomic_voidp_t rdary; /* struct reader **: for efficient delivery, null-pointer terminated, grouped by topic */
 };
 
 struct avail_entityid_set {
   struct inverse_uint32_set x;
 };
 
+/* Delivery cost measurements for proxy writers that switch between synchronous
+   and asynchronous delivery at runtime, see Internal/SynchronousDeliveryCostBound */
+struct pwr_delivery_stats {
+  int64_t avg_cost; /* moving average of the time it takes to deliver a sample (ns) */
+  int64_t busy; /* time spent delivering in the current interval (ns) */
+  ddsrt_mtime_t tstart; /* start of the current interval */
+  uint32_t utilisation; /* percentage of the last completed interval spent delivering */
+};
+
 struct participant
 {
   struct entity_common e;
@@ -406,6 +421,7 @@ struct reader
   ddsrt_avl_tree_t local_writers; /* all matching LOCAL writers, see struct rd_wr_match */
   ddsi2direct_directread_cb_t ddsi2direct_cb;
   void *ddsi2direct_cbarg;
+  struct ddsi_latency_stats latency_stats; /* only updated if Internal/ReceiveLatencyStatistics is set */
 #ifdef DDS_HAS_SECURITY
   struct reader_sec_attributes *sec_attr;
 #endif
@@ -533,6 +549,8 @@ struct proxy_writer {
   ddsi2direct_directread_cb_t ddsi2direct_cb;
   void *ddsi2direct_cbarg;
   struct lease *lease;
+  bool adaptive_delivery; /* iff true, deliver_synchronously gets switched based on delivery_stats; constant */
+  struct pwr_delivery_stats delivery_stats; /* only updated if adaptive_delivery, protected by e.lock */
 };
 
 
@@ -45,6 +45,12 @@ struct nn_sequence_number_set;
 
 typedef int (*nn_dqueue_handler_t) (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const struct ddsi_guid *rdguid, void *qarg);
 
+/* Optional handler for a chain of consecutive samples and gaps not directed at a specific
+   reader, the chain is terminated by a null pointer; the elements remain valid until it
+   returns */
+struct nn_rsample_chain_elem;
+typedef void (*nn_dqueue_batch_handler_t) (const struct nn_rsample_chain_elem *first, void *qarg);
+
 struct nn_rmsg_chunk {
   struct nn_rbuf *rbuf;
   struct nn_rmsg_chunk *next;
@@ -136,6 +142,7 @@ struct nn_rsample_info {
   uint32_t fragsize;
   ddsrt_wctime_t timestamp;
   ddsrt_wctime_t reception_timestamp; /* OpenSplice extension -- but we get it essentially for free, so why not? */
+  ddsrt_wctime_t kernel_timestamp; /* time the kernel received the packet, 0 if unknown */
   unsigned statusinfo: 2;       /* just the two defined bits from the status info */
   unsigned bswap: 1;            /* so we can extract well formatted writer info quicker */
   unsigned complex_qos: 1;      /* includes QoS other than keyhash, 2-bit statusinfo, PT writer info */
@@ -216,9 +223,19 @@ struct ddsrt_log_cfg;
 struct nn_fragment_number_set_header;
 struct nn_sequence_number_set_header;
 
+struct nn_rbufpool_stats {
+  uint32_t rbuf_size;
+  uint32_t nrbufs;      /* allocated rbufs, including current and spare ones */
+  uint32_t nrbufs_peak;
+  uint32_t nspare;      /* empty rbufs kept for reuse */
+  uint32_t npinned;     /* old rbufs kept alive by messages still referenced */
+  uint64_t nrecycled;   /* number of times a spare rbuf was reused */
+};
+
 struct nn_rbufpool *nn_rbufpool_new (const struct ddsrt_log_cfg *logcfg, uint32_t rbuf_size, uint32_t max_rmsg_size);
 void nn_rbufpool_setowner (struct nn_rbufpool *rbp, ddsrt_thread_t tid);
 void nn_rbufpool_free (struct nn_rbufpool *rbp);
+void nn_rbufpool_get_stats (const struct nn_rbufpool *rbp, struct nn_rbufpool_stats *st);
 
 struct nn_rmsg *nn_rmsg_new (struct nn_rbufpool *rbufpool);
 void nn_rmsg_setsize (struct nn_rmsg *rmsg, uint32_t size);
@@ -231,7 +248,24 @@ struct nn_rdata *nn_rdata_newgap (struct nn_rmsg *rmsg);
 void nn_fragchain_adjust_refcount (struct nn_rdata *frag, int adjust);
 void nn_fragchain_unref (struct nn_rdata *frag);
 
-struct nn_defrag *nn_defrag_new (const struct ddsrt_log_cfg *logcfg, enum nn_defrag_drop_mode drop_mode, uint32_t max_samples);
+/* A sample of at least contig_threshold and at most contig_max bytes (see
+   nn_defrag_new) is reassembled into a contiguous buffer allocated when its first fragment
+   arrives, and its fragment chain then consists of the rdata of the first
+   fragment (for the submessage header and inline QoS) followed by an
+   rdata covering the entire payload in that buffer.
+
+   That payload is positioned such that the data following the 4-byte CDR
+   header is 8-byte aligned, and NN_RDATA_CONTIG_HEADROOM bytes of unused
+   memory precede it.  A single user of the sample may claim the headroom,
+   e.g., to construct a serdata in place instead of copying the payload.
+   The claim adds a reference to the buffer, to be released using
+   nn_rdata_contig_release.  The payload must not be modified, as it
+   continues to be used by everyone else. */
+#define NN_RDATA_CONTIG_HEADROOM 252u
+const struct nn_rdata *nn_fragchain_claim_contig (const struct nn_rdata *fragchain);
+void nn_rdata_contig_release (const struct nn_rdata *rdata);
+
+struct nn_defrag *nn_defrag_new (const struct ddsrt_log_cfg *logcfg, enum nn_defrag_drop_mode drop_mode, uint32_t max_samples, uint32_t contig_threshold, uint32_t contig_max);
 void nn_defrag_free (struct nn_defrag *defrag);
 struct nn_rsample *nn_defrag_rsample (struct nn_defrag *defrag, struct nn_rdata *rdata, const struct nn_rsample_info *sampleinfo);
 void nn_defrag_notegap (struct nn_defrag *defrag, seqno_t min, seqno_t maxp1);
@@ -258,7 +292,7 @@ unsigned nn_reorder_nackmap (const struct nn_reorder *reorder, seqno_t base, seq
 seqno_t nn_reorder_next_seq (const struct nn_reorder *reorder);
 void nn_reorder_set_next_seq (struct nn_reorder *reorder, seqno_t seq);
 
-struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *gv, uint32_t max_samples, nn_dqueue_handler_t handler, void *arg);
+struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *gv, uint32_t max_samples, nn_dqueue_handler_t handler, nn_dqueue_batch_handler_t batch_handler, void *arg);
 void nn_dqueue_free (struct nn_dqueue *q);
 bool nn_dqueue_enqueue_deferred_wakeup (struct nn_dqueue *q, struct nn_rsample_chain *sc, nn_reorder_result_t rres);
 void dd_dqueue_enqueue_trigger (struct nn_dqueue *q);
@@ -267,6 +301,7 @@ void nn_dqueue_enqueue1 (struct nn_dqueue *q, const ddsi_guid_t *rdguid, struct
 void nn_dqueue_enqueue_callback (struct nn_dqueue *q, nn_dqueue_callback_t cb, void *arg);
 int  nn_dqueue_is_full (struct nn_dqueue *q);
 void nn_dqueue_wait_until_empty_if_full (struct nn_dqueue *q);
+void nn_dqueue_get_stats (struct nn_dqueue *q, uint32_t *depth, uint32_t *max_depth, uint32_t *latency);
 
 void nn_defrag_stats (struct nn_defrag *defrag, uint64_t *discarded_bytes);
 void nn_reorder_stats (struct nn_reorder *reorder, uint64_t *discarded_bytes);
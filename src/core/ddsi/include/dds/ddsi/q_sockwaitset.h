@@ -86,6 +86,12 @@ void os_sockWaitsetPurge (os_sockWaitset ws, unsigned index);
 */
 os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws);
 
+/*
+  Same as os_sockWaitsetWait, but without blocking: returns NULL if none of
+  the connections has data to read.
+*/
+os_sockWaitsetCtx os_sockWaitsetPoll (os_sockWaitset ws);
+
 /*
   Returns the index of the next triggered connection in the
   waitset contect ctx, or -1 if the set of available events has been
@@ -167,6 +167,9 @@ int nn_xmsg_addpar_sentinel_ifparam (struct nn_xmsg *m);
 struct nn_xpack * nn_xpack_new (struct ddsi_domaingv *gv, uint32_t bw_limit, bool async_mode);
 void nn_xpack_free (struct nn_xpack *xp);
 void nn_xpack_send (struct nn_xpack *xp, bool immediately /* unused */);
+/* Sends the packets staged for segmentation offload, but not the one being
+   built: those only go out with the packet following them */
+void nn_xpack_send_staged (struct nn_xpack *xp);
 int nn_xpack_addmsg (struct nn_xpack *xp, struct nn_xmsg *m, const uint32_t flags);
 int64_t nn_xpack_maxdelay (const struct nn_xpack *xp);
 unsigned nn_xpack_packetid (const struct nn_xpack *xp);
@@ -24,6 +24,7 @@
 #include "dds/ddsi/ddsi_entity_index.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/q_entity.h"
+#include "dds/ddsi/q_thread.h"
 
 #define TYPE_SAMPLE_CACHE_SIZE 4
 
@@ -147,7 +148,8 @@ dds_return_t deliver_locally_one (struct ddsi_domaingv *gv, struct entity_common
     /* FIXME: why look up rd,pwr again? Their states remains valid while the thread stays
        "awake" (although a delete can be initiated), and blocking like this is a stopgap
        anyway -- quite possibly to abort once either is deleted */
-    while (!ddsi_rhc_store (rd->rhc, wrinfo, payload, tk))
+    bool stored;
+    while (!(stored = ddsi_rhc_store (rd->rhc, wrinfo, payload, tk)))
     {
       if (source_entity_locked)
         ddsrt_mutex_unlock (&source_entity->lock);
@@ -161,6 +163,8 @@ dds_return_t deliver_locally_one (struct ddsi_domaingv *gv, struct entity_common
         break;
       }
     }
+    if (stored && ops->delivered)
+      ops->delivered (rd, vsourceinfo);
     free_sample_after_store (gv, payload, tk);
   }
   return DDS_RETCODE_OK;
@@ -198,7 +202,8 @@ static dds_return_t deliver_locally_slowpath (struct ddsi_domaingv *gv, struct e
     if (payload)
     {
       EETRACE (source_entity, " "PGUIDFMT, PGUID (rd->e.guid));
-      (void) ddsi_rhc_store (rd->rhc, wrinfo, payload, tk);
+      if (ddsi_rhc_store (rd->rhc, wrinfo, payload, tk) && ops->delivered)
+        ops->delivered (rd, vsourceinfo);
     }
     rd = ops->next_reader (gv->entity_index, &it);
   }
@@ -209,9 +214,8 @@ static dds_return_t deliver_locally_slowpath (struct ddsi_domaingv *gv, struct e
   return DDS_RETCODE_OK;
 }
 
-static dds_return_t deliver_locally_fastpath (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo)
+static dds_return_t deliver_locally_fastpath (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, struct reader * const * const rdary, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo)
 {
-  struct reader ** const rdary = fastpath_rdary->rdary;
   uint32_t i = 0;
   while (rdary[i])
   {
@@ -236,6 +240,8 @@ static dds_return_t deliver_locally_fastpath (struct ddsi_domaingv *gv, struct e
             return rc;
           }
         }
+        if (ops->delivered)
+          ops->delivered (rdary[i], vsourceinfo);
       } while (rdary[++i] && rdary[i]->type == type);
       free_sample_after_store (gv, payload, tk);
     }
@@ -248,22 +254,123 @@ dds_return_t deliver_locally_allinsync (struct ddsi_domaingv *gv, struct entity_
   dds_return_t rc;
   /* FIXME: Retry loop for re-delivery of rejected reliable samples is a bad hack
      should instead throttle back the writer by skipping acknowledgement and retry */
+  assert (thread_is_awake ());
   do {
-    ddsrt_mutex_lock (&fastpath_rdary->rdary_lock);
-    if (fastpath_rdary->fastpath_ok)
+    /* The reader array is replaced rather than modified, and neither it nor
+       the readers in it are freed before this thread has made progress.
+       Loading fastpath_ok after the array guarantees it is false if the
+       array contains a reader that is not yet in sync. */
+    struct reader * const * const rdary = ddsrt_atomic_ldvoidp (&fastpath_rdary->rdary);
+    ddsrt_atomic_fence_acq ();
+    if (ddsrt_atomic_ld32 (&fastpath_rdary->fastpath_ok))
     {
       EETRACE (source_entity, " => EVERYONE\n");
-      if (fastpath_rdary->rdary[0])
-        rc = deliver_locally_fastpath (gv, source_entity, source_entity_locked, fastpath_rdary, wrinfo, ops, vsourceinfo);
+      if (rdary[0])
+        rc = deliver_locally_fastpath (gv, source_entity, source_entity_locked, fastpath_rdary, rdary, wrinfo, ops, vsourceinfo);
       else
         rc = DDS_RETCODE_OK;
-      ddsrt_mutex_unlock (&fastpath_rdary->rdary_lock);
     }
     else
     {
-      ddsrt_mutex_unlock (&fastpath_rdary->rdary_lock);
       rc = deliver_locally_slowpath (gv, source_entity, source_entity_locked, wrinfo, ops, vsourceinfo);
     }
   } while (rc == DDS_RETCODE_TRY_AGAIN);
   return rc;
 }
+
+static bool fastpath_still_has_reader (struct local_reader_ary *fastpath_rdary, struct reader * const * const rdary, const struct reader *rd)
+{
+  struct reader * const * const cur = ddsrt_atomic_ldvoidp (&fastpath_rdary->rdary);
+  ddsrt_atomic_fence_acq ();
+  if (!ddsrt_atomic_ld32 (&fastpath_rdary->fastpath_ok))
+    return false;
+  else if (cur == rdary)
+    return true;
+  for (uint32_t i = 0; cur[i]; i++)
+    if (cur[i] == rd)
+      return true;
+  return false;
+}
+
+static dds_return_t deliver_locally_fastpath_many (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, struct reader * const * const rdary, uint32_t n, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void * const *vsourceinfo)
+{
+  struct ddsi_serdata *payload[DELIVER_LOCALLY_MAX_BATCH];
+  struct ddsi_tkmap_instance *tk[DELIVER_LOCALLY_MAX_BATCH];
+  struct ddsi_writer_info wrinfo1[DELIVER_LOCALLY_MAX_BATCH];
+  uint32_t srcidx[DELIVER_LOCALLY_MAX_BATCH];
+  uint32_t i = 0;
+  while (rdary[i])
+  {
+    struct ddsi_sertype const * const type = rdary[i]->type;
+    uint32_t m = 0;
+    /* samples that fail to convert (malformed payloads) are skipped for all
+       readers of this type, the others get packed into the arrays */
+    for (uint32_t k = 0; k < n; k++)
+    {
+      if ((payload[m] = ops->makesample (&tk[m], gv, type, vsourceinfo[k])) != NULL)
+      {
+        wrinfo1[m] = wrinfo[k];
+        srcidx[m] = k;
+        m++;
+      }
+    }
+    do {
+      struct reader * const rd = rdary[i];
+      uint32_t j = 0;
+      while (j < m)
+      {
+        const uint32_t nstored = ddsi_rhc_store_many (rd->rhc, m - j, wrinfo1 + j, payload + j, tk + j);
+        if (ops->delivered)
+          for (uint32_t k = j; k < j + nstored; k++)
+            ops->delivered (rd, vsourceinfo[srcidx[k]]);
+        if ((j += nstored) < m)
+        {
+          dds_return_t rc;
+          if ((rc = ops->on_failure_fastpath (source_entity, source_entity_locked, fastpath_rdary, vsourceinfo[srcidx[j]])) == DDS_RETCODE_TRY_AGAIN)
+          {
+            /* Restarting the operation, like the single-sample version does,
+               would deliver the samples preceding the rejected one again;
+               instead, keep trying as long as the reader is still in the
+               fast path and otherwise drop it like the slow path does */
+            if (!fastpath_still_has_reader (fastpath_rdary, rdary, rd))
+              j++;
+          }
+          else if (rc != DDS_RETCODE_OK)
+          {
+            for (uint32_t k = 0; k < m; k++)
+              free_sample_after_store (gv, payload[k], tk[k]);
+            return rc;
+          }
+        }
+      }
+    } while (rdary[++i] && rdary[i]->type == type);
+    for (uint32_t k = 0; k < m; k++)
+      free_sample_after_store (gv, payload[k], tk[k]);
+  }
+  return DDS_RETCODE_OK;
+}
+
+dds_return_t deliver_locally_allinsync_many (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, uint32_t n, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void * const *vsourceinfo)
+{
+  assert (thread_is_awake ());
+  assert (n <= DELIVER_LOCALLY_MAX_BATCH);
+  struct reader * const * const rdary = ddsrt_atomic_ldvoidp (&fastpath_rdary->rdary);
+  ddsrt_atomic_fence_acq ();
+  if (ddsrt_atomic_ld32 (&fastpath_rdary->fastpath_ok))
+  {
+    EETRACE (source_entity, " => EVERYONE (%"PRIu32" samples)\n", n);
+    if (rdary[0] == NULL)
+      return DDS_RETCODE_OK;
+    return deliver_locally_fastpath_many (gv, source_entity, source_entity_locked, fastpath_rdary, rdary, n, wrinfo, ops, vsourceinfo);
+  }
+  else
+  {
+    for (uint32_t k = 0; k < n; k++)
+    {
+      dds_return_t rc;
+      if ((rc = deliver_locally_allinsync (gv, source_entity, source_entity_locked, fastpath_rdary, &wrinfo[k], ops, vsourceinfo[k])) != DDS_RETCODE_OK)
+        return rc;
+    }
+    return DDS_RETCODE_OK;
+  }
+}
@@ -296,6 +296,13 @@ void *entidx_lookup_guid_untyped (const struct entity_index *ei, const struct dd
   return ddsrt_chh_lookup (ei->guid_hash, &e);
 }
 
+void entidx_prefetch_guid (const struct entity_index *ei, const struct ddsi_guid *guid)
+{
+  struct entity_common e;
+  e.guid = *guid;
+  ddsrt_chh_prefetch (ei->guid_hash, &e);
+}
+
 static void *entidx_lookup_guid_int (const struct entity_index *ei, const struct ddsi_guid *guid, enum entity_kind kind)
 {
   struct entity_common *res;
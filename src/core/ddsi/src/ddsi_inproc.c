@@ -0,0 +1,535 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include "dds/ddsi/ddsi_tran.h"
+#include "dds/ddsi/ddsi_inproc.h"
+#include "dds/ddsi/q_config.h"
+#include "dds/ddsi/q_log.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/cdtors.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/sync.h"
+#include "ddsi_msgring.h"
+
+#if DDSI_HAVE_MSGRING
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <netinet/in.h>
+
+/* In-process transport: domain instances in the same process exchange RTPS
+   messages through message rings (see ddsi_msgring.h) in ordinary memory,
+   looked up by port in a registry shared by all of them.  Nothing but the
+   wake-up of an idle receive thread involves the kernel, which makes it
+   suitable for measuring the cost of the protocol stack itself.
+
+   Rings are reference counted so that writers can copy messages into them
+   without holding the registry lock.  Multicast is emulated by writing to
+   every ring joined to the port while holding the lock, which is only meant
+   for discovery.  The doorbell is a pipe because the receive threads wait
+   in a socket waitset. */
+
+#define DDSI_INPROC_SLOT_SIZE 65536u
+#define DDSI_INPROC_FIRST_DYNAMIC_PORT 49152u
+
+struct ddsi_inproc_ring {
+  uint32_t port;
+  ddsrt_atomic_uint32_t refc;
+  int rfd, wfd;
+  struct ddsi_inproc_ring *next; /* multicast members */
+  struct ddsi_msgring_ref ring;
+};
+
+struct ddsi_inproc_registry {
+  ddsrt_mutex_t lock;
+  uint32_t refc; /* protected by singleton mutex */
+  struct ddsrt_hh *uc;
+  struct ddsi_inproc_ring *mc;
+};
+
+static struct ddsi_inproc_registry *registry;
+
+typedef struct ddsi_inproc_conn {
+  struct ddsi_tran_conn m_base;
+  struct ddsi_inproc_ring *m_ring; /* NULL for transmit-only connections */
+  uint32_t m_head;
+  bool m_blocking;
+} *ddsi_inproc_conn_t;
+
+typedef struct ddsi_inproc_tran_factory {
+  struct ddsi_tran_factory m_base;
+  uint32_t m_nslots;
+  struct ddsi_inproc_registry *m_registry;
+} *ddsi_inproc_tran_factory_t;
+
+static uint32_t ddsi_inproc_ring_hash (const void *va)
+{
+  const struct ddsi_inproc_ring *a = va;
+  return a->port * UINT32_C (2654435761);
+}
+
+static int ddsi_inproc_ring_equal (const void *va, const void *vb)
+{
+  const struct ddsi_inproc_ring *a = va;
+  const struct ddsi_inproc_ring *b = vb;
+  return a->port == b->port;
+}
+
+static struct ddsi_inproc_registry *ddsi_inproc_registry_ref (void)
+{
+  struct ddsi_inproc_registry *reg;
+  ddsrt_mutex_lock (ddsrt_get_singleton_mutex ());
+  if (registry == NULL)
+  {
+    registry = ddsrt_malloc (sizeof (*registry));
+    ddsrt_mutex_init (&registry->lock);
+    registry->refc = 0;
+    registry->uc = ddsrt_hh_new (1, ddsi_inproc_ring_hash, ddsi_inproc_ring_equal);
+    registry->mc = NULL;
+  }
+  registry->refc++;
+  reg = registry;
+  ddsrt_mutex_unlock (ddsrt_get_singleton_mutex ());
+  return reg;
+}
+
+static void ddsi_inproc_registry_unref (struct ddsi_inproc_registry *reg)
+{
+  ddsrt_mutex_lock (ddsrt_get_singleton_mutex ());
+  assert (reg == registry && reg->refc > 0);
+  if (--reg->refc == 0)
+  {
+    /* all connections are gone with the domains */
+    assert (reg->mc == NULL);
+    ddsrt_hh_free (reg->uc);
+    ddsrt_mutex_destroy (&reg->lock);
+    ddsrt_free (reg);
+    registry = NULL;
+  }
+  ddsrt_mutex_unlock (ddsrt_get_singleton_mutex ());
+}
+
+static void ddsi_inproc_ring_unref (struct ddsi_inproc_ring *r)
+{
+  if (ddsrt_atomic_dec32_nv (&r->refc) == 0)
+  {
+    close (r->rfd);
+    close (r->wfd);
+    ddsrt_free (r->ring.ring);
+    ddsrt_free (r);
+  }
+}
+
+static int ddsi_inproc_set_flags (int fd)
+{
+  int flags;
+  if ((flags = fcntl (fd, F_GETFL)) < 0 || fcntl (fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    return -1;
+  if ((flags = fcntl (fd, F_GETFD)) < 0 || fcntl (fd, F_SETFD, flags | FD_CLOEXEC) < 0)
+    return -1;
+  return 0;
+}
+
+static struct ddsi_inproc_ring *ddsi_inproc_ring_new (uint32_t nslots, uint32_t port)
+{
+  struct ddsi_inproc_ring *r;
+  int fds[2];
+  if (pipe (fds) < 0)
+    return NULL;
+  if (ddsi_inproc_set_flags (fds[0]) < 0 || ddsi_inproc_set_flags (fds[1]) < 0)
+  {
+    close (fds[0]);
+    close (fds[1]);
+    return NULL;
+  }
+  r = ddsrt_malloc (sizeof (*r));
+  r->port = port;
+  ddsrt_atomic_st32 (&r->refc, 1);
+  r->rfd = fds[0];
+  r->wfd = fds[1];
+  r->next = NULL;
+  ddsi_msgring_init (&r->ring, ddsrt_malloc (ddsi_msgring_size (nslots, DDSI_INPROC_SLOT_SIZE)), nslots, DDSI_INPROC_SLOT_SIZE);
+  return r;
+}
+
+static bool ddsi_inproc_is_broadcast (const ddsi_locator_t *loc)
+{
+  for (size_t i = 0; i < sizeof (loc->address); i++)
+    if (loc->address[i] != 0xff)
+      return false;
+  return true;
+}
+
+static void ddsi_inproc_set_locator (ddsi_locator_t *loc, uint32_t port)
+{
+  loc->kind = NN_LOCATOR_KIND_INPROC;
+  loc->port = port;
+  memset (loc->address, 0, sizeof (loc->address));
+}
+
+static ssize_t ddsi_inproc_conn_write (ddsi_tran_conn_t conn_cmn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
+{
+  ddsi_inproc_tran_factory_t fact = (ddsi_inproc_tran_factory_t) conn_cmn->m_factory;
+  struct ddsi_inproc_registry * const reg = fact->m_registry;
+  const uint32_t srcport = conn_cmn->m_base.m_port;
+  struct ddsi_inproc_ring template = { .port = dst->port }, *r;
+  size_t len = 0;
+  (void) flags;
+  for (size_t i = 0; i < niov; i++)
+    len += iov[i].iov_len;
+
+  /* Like UDP, a message that can't be delivered is silently dropped */
+  ddsrt_mutex_lock (&reg->lock);
+  if (ddsi_inproc_is_broadcast (dst))
+  {
+    for (r = reg->mc; r; r = r->next)
+      if (r->port == dst->port)
+        (void) ddsi_msgring_push (&r->ring, r->wfd, srcport, niov, iov, len);
+    ddsrt_mutex_unlock (&reg->lock);
+  }
+  else if ((r = ddsrt_hh_lookup (reg->uc, &template)) == NULL)
+  {
+    ddsrt_mutex_unlock (&reg->lock);
+  }
+  else
+  {
+    ddsrt_atomic_inc32 (&r->refc);
+    ddsrt_mutex_unlock (&reg->lock);
+    (void) ddsi_msgring_push (&r->ring, r->wfd, srcport, niov, iov, len);
+    ddsi_inproc_ring_unref (r);
+  }
+  return (ssize_t) len;
+}
+
+static ssize_t ddsi_inproc_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char *buf, size_t len, bool allow_spurious, ddsi_locator_t *srcloc)
+{
+  ddsi_inproc_conn_t conn = (ddsi_inproc_conn_t) conn_cmn;
+  uint32_t srcport;
+  ssize_t n;
+  (void) allow_spurious;
+  assert (conn->m_ring != NULL);
+  if ((n = ddsi_msgring_read (&conn->m_ring->ring, &conn->m_head, conn->m_ring->rfd, conn->m_blocking, buf, len, &srcport)) > 0 && srcloc)
+    ddsi_inproc_set_locator (srcloc, srcport);
+  return n;
+}
+
+static bool ddsi_inproc_conn_read_pending (ddsi_tran_conn_t conn_cmn)
+{
+  ddsi_inproc_conn_t conn = (ddsi_inproc_conn_t) conn_cmn;
+  return ddsi_msgring_pending (&conn->m_ring->ring, conn->m_head);
+}
+
+static void ddsi_inproc_disable_multiplexing (ddsi_tran_conn_t conn_cmn)
+{
+  ddsi_inproc_conn_t conn = (ddsi_inproc_conn_t) conn_cmn;
+  conn->m_blocking = true;
+}
+
+static ddsrt_socket_t ddsi_inproc_conn_handle (ddsi_tran_base_t base)
+{
+  ddsi_inproc_conn_t conn = (ddsi_inproc_conn_t) base;
+  return (conn->m_ring != NULL) ? conn->m_ring->rfd : DDSRT_INVALID_SOCKET;
+}
+
+static bool ddsi_inproc_supports (const struct ddsi_tran_factory *fact, int32_t kind)
+{
+  (void) fact;
+  return (kind == NN_LOCATOR_KIND_INPROC);
+}
+
+static int ddsi_inproc_conn_locator (ddsi_tran_factory_t fact, ddsi_tran_base_t base, ddsi_locator_t *loc)
+{
+  (void) fact;
+  ddsi_inproc_set_locator (loc, base->m_port);
+  return 0;
+}
+
+static dds_return_t ddsi_inproc_register_uc (ddsi_inproc_tran_factory_t fact, struct ddsi_inproc_ring *r)
+{
+  struct ddsi_inproc_registry * const reg = fact->m_registry;
+  dds_return_t rc = DDS_RETCODE_OK;
+  ddsrt_mutex_lock (&reg->lock);
+  if (r->port != 0)
+  {
+    if (!ddsrt_hh_add (reg->uc, r))
+      rc = DDS_RETCODE_PRECONDITION_NOT_MET;
+  }
+  else
+  {
+    rc = DDS_RETCODE_PRECONDITION_NOT_MET;
+    for (uint32_t port = DDSI_INPROC_FIRST_DYNAMIC_PORT; port <= 65535 && rc != DDS_RETCODE_OK; port++)
+    {
+      r->port = port;
+      if (ddsrt_hh_add (reg->uc, r))
+        rc = DDS_RETCODE_OK;
+    }
+  }
+  ddsrt_mutex_unlock (&reg->lock);
+  return rc;
+}
+
+static dds_return_t ddsi_inproc_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_factory_t fact_cmn, uint32_t port, const struct ddsi_tran_qos *qos)
+{
+  ddsi_inproc_tran_factory_t fact = (ddsi_inproc_tran_factory_t) fact_cmn;
+  struct ddsi_domaingv const * const gv = fact_cmn->gv;
+  struct nn_interface const * const intf = qos->m_interface ? qos->m_interface : &gv->interfaces[0];
+  const bool mcast = (qos->m_purpose == DDSI_TRAN_QOS_RECV_MC);
+  struct ddsi_inproc_ring *r = NULL;
+
+  if (qos->m_purpose != DDSI_TRAN_QOS_XMIT)
+  {
+    if ((r = ddsi_inproc_ring_new (fact->m_nslots, port)) == NULL)
+    {
+      GVERROR ("ddsi_inproc_create_conn: can't create pipe: %s\n", strerror (errno));
+      return DDS_RETCODE_ERROR;
+    }
+    if (mcast)
+    {
+      ddsrt_mutex_lock (&fact->m_registry->lock);
+      r->next = fact->m_registry->mc;
+      fact->m_registry->mc = r;
+      ddsrt_mutex_unlock (&fact->m_registry->lock);
+    }
+    else if (ddsi_inproc_register_uc (fact, r) != DDS_RETCODE_OK)
+    {
+      ddsi_inproc_ring_unref (r);
+      return DDS_RETCODE_PRECONDITION_NOT_MET;
+    }
+    port = r->port;
+  }
+
+  ddsi_inproc_conn_t conn = ddsrt_malloc (sizeof (*conn));
+  memset (conn, 0, sizeof (*conn));
+  conn->m_ring = r;
+  ddsi_factory_conn_init (fact_cmn, intf, &conn->m_base);
+  conn->m_base.m_base.m_port = port;
+  conn->m_base.m_base.m_trantype = DDSI_TRAN_CONN;
+  conn->m_base.m_base.m_multicast = mcast;
+  conn->m_base.m_base.m_handle_fn = ddsi_inproc_conn_handle;
+  conn->m_base.m_locator_fn = ddsi_inproc_conn_locator;
+  conn->m_base.m_read_fn = ddsi_inproc_conn_read;
+  conn->m_base.m_write_fn = ddsi_inproc_conn_write;
+  conn->m_base.m_disable_multiplexing_fn = ddsi_inproc_disable_multiplexing;
+  if (conn->m_ring)
+    conn->m_base.m_read_pending_fn = ddsi_inproc_conn_read_pending;
+
+  GVTRACE ("ddsi_inproc_create_conn %s port %"PRIu32"\n", mcast ? "multicast" : "unicast", port);
+  *conn_out = &conn->m_base;
+  return DDS_RETCODE_OK;
+}
+
+static void ddsi_inproc_release_conn (ddsi_tran_conn_t conn_cmn)
+{
+  ddsi_inproc_conn_t conn = (ddsi_inproc_conn_t) conn_cmn;
+  ddsi_inproc_tran_factory_t fact = (ddsi_inproc_tran_factory_t) conn_cmn->m_factory;
+  DDS_CTRACE (&conn_cmn->m_base.gv->logconfig, "ddsi_inproc_release_conn %s port %"PRIu32"\n",
+              conn_cmn->m_base.m_multicast ? "multicast" : "unicast", conn_cmn->m_base.m_port);
+  if (conn->m_ring)
+  {
+    struct ddsi_inproc_ring *r = conn->m_ring, **pr;
+    ddsrt_mutex_lock (&fact->m_registry->lock);
+    if (!conn_cmn->m_base.m_multicast)
+      ddsrt_hh_remove (fact->m_registry->uc, r);
+    else
+    {
+      for (pr = &fact->m_registry->mc; *pr != r; pr = &(*pr)->next)
+        assert (*pr != NULL);
+      *pr = r->next;
+    }
+    ddsrt_mutex_unlock (&fact->m_registry->lock);
+    ddsi_inproc_ring_unref (r);
+  }
+  ddsrt_free (conn);
+}
+
+static int ddsi_inproc_join_mc (ddsi_tran_conn_t conn, const ddsi_locator_t *srcloc, const ddsi_locator_t *mcloc, const struct nn_interface *interf)
+{
+  /* the ring of a multicast connection is the membership */
+  (void) conn; (void) srcloc; (void) mcloc; (void) interf;
+  return 0;
+}
+
+static int ddsi_inproc_leave_mc (ddsi_tran_conn_t conn, const ddsi_locator_t *srcloc, const ddsi_locator_t *mcloc, const struct nn_interface *interf)
+{
+  (void) conn; (void) srcloc; (void) mcloc; (void) interf;
+  return 0;
+}
+
+static int ddsi_inproc_is_loopbackaddr (const struct ddsi_tran_factory *tran, const ddsi_locator_t *loc)
+{
+  (void) tran;
+  (void) loc;
+  return 0;
+}
+
+static int ddsi_inproc_is_mcaddr (const struct ddsi_tran_factory *tran, const ddsi_locator_t *loc)
+{
+  (void) tran;
+  assert (loc->kind == NN_LOCATOR_KIND_INPROC);
+  return ddsi_inproc_is_broadcast (loc);
+}
+
+static int ddsi_inproc_is_ssm_mcaddr (const struct ddsi_tran_factory *tran, const ddsi_locator_t *loc)
+{
+  (void) tran;
+  (void) loc;
+  return 0;
+}
+
+static enum ddsi_nearby_address_result ddsi_inproc_is_nearby_address (const ddsi_locator_t *loc, size_t ninterf, const struct nn_interface interf[], size_t *interf_idx)
+{
+  (void) loc;
+  (void) interf;
+  *interf_idx = 0;
+  return (ninterf > 0) ? DNAR_LOCAL : DNAR_DISTANT;
+}
+
+static char *ddsi_inproc_to_string (char *dst, size_t sizeof_dst, const ddsi_locator_t *loc, ddsi_tran_conn_t conn, int with_port)
+{
+  int pos;
+  (void) conn;
+  pos = snprintf (dst, sizeof_dst, "%s", ddsi_inproc_is_broadcast (loc) ? "all" : "local");
+  if (with_port && pos >= 0 && (size_t) pos < sizeof_dst)
+    (void) snprintf (dst + pos, sizeof_dst - (size_t) pos, ":%"PRIu32, loc->port);
+  return dst;
+}
+
+static enum ddsi_locator_from_string_result ddsi_inproc_address_from_string (const struct ddsi_tran_factory *tran, ddsi_locator_t *loc, const char *str)
+{
+  const char *sep = strrchr (str, ':');
+  const size_t addrlen = sep ? (size_t) (sep - str) : strlen (str);
+  uint32_t port = NN_LOCATOR_PORT_INVALID;
+  (void) tran;
+  if (sep)
+  {
+    unsigned long p;
+    char *end;
+    p = strtoul (sep + 1, &end, 10);
+    if (*(sep + 1) == 0 || *end != 0 || p == 0 || p > 65535)
+      return AFSR_INVALID;
+    port = (uint32_t) p;
+  }
+  if (addrlen == 3 && strncmp (str, "all", 3) == 0)
+  {
+    loc->kind = NN_LOCATOR_KIND_INPROC;
+    loc->port = port;
+    memset (loc->address, 0xff, sizeof (loc->address));
+  }
+  else if ((addrlen == 5 && strncmp (str, "local", 5) == 0) || (addrlen == 9 && strncmp (str, "localhost", 9) == 0))
+  {
+    ddsi_inproc_set_locator (loc, port);
+  }
+  else
+  {
+    return AFSR_INVALID;
+  }
+  return AFSR_OK;
+}
+
+static int ddsi_inproc_enumerate_interfaces (ddsi_tran_factory_t fact, enum ddsi_transport_selector transport_selector, ddsrt_ifaddrs_t **ifs)
+{
+  /* There is only the process itself, presented as an interface with a
+     dummy address that ddsi_inproc_locator_from_sockaddr maps to the local
+     address */
+  struct sockaddr_in *addr = ddsrt_malloc (sizeof (*addr));
+  ddsrt_ifaddrs_t *ifa = ddsrt_malloc (sizeof (*ifa));
+  (void) fact;
+  (void) transport_selector;
+  memset (addr, 0, sizeof (*addr));
+  addr->sin_family = AF_INET;
+  addr->sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  memset (ifa, 0, sizeof (*ifa));
+  ifa->name = ddsrt_strdup ("inproc");
+  ifa->flags = IFF_UP | IFF_MULTICAST;
+  ifa->type = DDSRT_IFTYPE_UNKNOWN;
+  ifa->addr = (struct sockaddr *) addr;
+  *ifs = ifa;
+  return 0;
+}
+
+static int ddsi_inproc_is_valid_port (const struct ddsi_tran_factory *fact, uint32_t port)
+{
+  /* 0 means a dynamically allocated port, like for UDP */
+  (void) fact;
+  return (port <= 65535);
+}
+
+static uint32_t ddsi_inproc_receive_buffer_size (const struct ddsi_tran_factory *fact)
+{
+  (void) fact;
+  return 0;
+}
+
+static int ddsi_inproc_locator_from_sockaddr (const struct ddsi_tran_factory *tran, ddsi_locator_t *loc, const struct sockaddr *sockaddr)
+{
+  (void) tran;
+  if (sockaddr->sa_family != AF_INET)
+    return -1;
+  ddsi_inproc_set_locator (loc, NN_LOCATOR_PORT_INVALID);
+  return 0;
+}
+
+static void ddsi_inproc_deinit (ddsi_tran_factory_t fact_cmn)
+{
+  ddsi_inproc_tran_factory_t fact = (ddsi_inproc_tran_factory_t) fact_cmn;
+  DDS_CLOG (DDS_LC_CONFIG, &fact_cmn->gv->logconfig, "inproc de-initialized\n");
+  ddsi_inproc_registry_unref (fact->m_registry);
+  ddsrt_free (fact);
+}
+
+int ddsi_inproc_init (struct ddsi_domaingv *gv)
+{
+  struct ddsi_inproc_tran_factory *fact = ddsrt_malloc (sizeof (*fact));
+  memset (fact, 0, sizeof (*fact));
+  fact->m_nslots = ddsi_msgring_nslots (gv->config.shmring_size, DDSI_INPROC_SLOT_SIZE);
+  fact->m_registry = ddsi_inproc_registry_ref ();
+  fact->m_base.gv = gv;
+  fact->m_base.m_free_fn = ddsi_inproc_deinit;
+  fact->m_base.m_typename = "inproc";
+  fact->m_base.m_default_spdp_address = "inproc/all";
+  fact->m_base.m_connless = 1;
+  fact->m_base.m_enable_spdp = 1;
+  fact->m_base.m_supports_fn = ddsi_inproc_supports;
+  fact->m_base.m_create_conn_fn = ddsi_inproc_create_conn;
+  fact->m_base.m_release_conn_fn = ddsi_inproc_release_conn;
+  fact->m_base.m_join_mc_fn = ddsi_inproc_join_mc;
+  fact->m_base.m_leave_mc_fn = ddsi_inproc_leave_mc;
+  fact->m_base.m_is_loopbackaddr_fn = ddsi_inproc_is_loopbackaddr;
+  fact->m_base.m_is_mcaddr_fn = ddsi_inproc_is_mcaddr;
+  fact->m_base.m_is_ssm_mcaddr_fn = ddsi_inproc_is_ssm_mcaddr;
+  fact->m_base.m_is_nearby_address_fn = ddsi_inproc_is_nearby_address;
+  fact->m_base.m_locator_from_string_fn = ddsi_inproc_address_from_string;
+  fact->m_base.m_locator_to_string_fn = ddsi_inproc_to_string;
+  fact->m_base.m_enumerate_interfaces_fn = ddsi_inproc_enumerate_interfaces;
+  fact->m_base.m_is_valid_port_fn = ddsi_inproc_is_valid_port;
+  fact->m_base.m_receive_buffer_size_fn = ddsi_inproc_receive_buffer_size;
+  fact->m_base.m_locator_from_sockaddr_fn = ddsi_inproc_locator_from_sockaddr;
+  ddsi_factory_add (gv, &fact->m_base);
+  GVLOG (DDS_LC_CONFIG, "inproc initialized: %"PRIu32" slots of %u bytes per ring\n", fact->m_nslots, DDSI_INPROC_SLOT_SIZE);
+  return 0;
+}
+
+#else
+
+int ddsi_inproc_init (struct ddsi_domaingv *gv)
+{
+  GVERROR ("inproc transport is not supported on this platform\n");
+  return -1;
+}
+
+#endif /* DDSI_HAVE_MSGRING */
@@ -0,0 +1,183 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include "ddsi_msgring.h"
+
+#if DDSI_HAVE_MSGRING
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+
+struct ddsi_msgring_slot {
+  ddsrt_atomic_uint32_t seq; /* pos: free for producer, pos+1: filled */
+  uint32_t len;
+  uint32_t srcport;
+  uint32_t pad;
+  unsigned char data[];
+};
+
+static struct ddsi_msgring_slot *ddsi_msgring_slot (const struct ddsi_msgring_ref *ref, uint32_t pos)
+{
+  return (struct ddsi_msgring_slot *) ((char *) ref->ring + sizeof (*ref->ring) + (size_t) (pos & (ref->nslots - 1)) * ref->slot_size);
+}
+
+size_t ddsi_msgring_size (uint32_t nslots, uint32_t slot_size)
+{
+  return sizeof (struct ddsi_msgring) + (size_t) nslots * slot_size;
+}
+
+uint32_t ddsi_msgring_nslots (size_t size, uint32_t slot_size)
+{
+  uint32_t nslots = 2;
+  while (nslots < (UINT32_C (1) << 31) && (size_t) (nslots << 1) <= size / slot_size)
+    nslots <<= 1;
+  return nslots;
+}
+
+static bool ddsi_msgring_valid_geometry (uint32_t nslots, uint32_t slot_size)
+{
+  return (nslots > 0 && (nslots & (nslots - 1)) == 0 &&
+          slot_size > sizeof (struct ddsi_msgring_slot) && (slot_size % sizeof (uint32_t)) == 0);
+}
+
+void ddsi_msgring_init (struct ddsi_msgring_ref *ref, struct ddsi_msgring *ring, uint32_t nslots, uint32_t slot_size)
+{
+  assert (ddsi_msgring_valid_geometry (nslots, slot_size));
+  ring->nslots = nslots;
+  ring->slot_size = slot_size;
+  ddsrt_atomic_st32 (&ring->armed, 1); /* nothing read yet */
+  ddsrt_atomic_st32 (&ring->tail, 0);
+  ref->ring = ring;
+  ref->nslots = nslots;
+  ref->slot_size = slot_size;
+  for (uint32_t i = 0; i < nslots; i++)
+    ddsrt_atomic_st32 (&ddsi_msgring_slot (ref, i)->seq, i);
+}
+
+bool ddsi_msgring_attach (struct ddsi_msgring_ref *ref, struct ddsi_msgring *ring, size_t size)
+{
+  /* read each once: the values checked must be the values used */
+  const uint32_t nslots = ((volatile struct ddsi_msgring *) ring)->nslots;
+  const uint32_t slot_size = ((volatile struct ddsi_msgring *) ring)->slot_size;
+  if (!ddsi_msgring_valid_geometry (nslots, slot_size))
+    return false;
+  if (size < sizeof (*ring) || (size - sizeof (*ring)) / slot_size < nslots)
+    return false;
+  ref->ring = ring;
+  ref->nslots = nslots;
+  ref->slot_size = slot_size;
+  return true;
+}
+
+size_t ddsi_msgring_maxlen (const struct ddsi_msgring_ref *ref)
+{
+  return ref->slot_size - sizeof (struct ddsi_msgring_slot);
+}
+
+bool ddsi_msgring_push (const struct ddsi_msgring_ref *ref, int wakefd, uint32_t srcport, size_t niov, const ddsrt_iovec_t *iov, size_t len)
+{
+  struct ddsi_msgring * const ring = ref->ring;
+  struct ddsi_msgring_slot *slot;
+  uint32_t pos;
+  if (len > ddsi_msgring_maxlen (ref))
+    return false;
+  pos = ddsrt_atomic_ld32 (&ring->tail);
+  while (1)
+  {
+    slot = ddsi_msgring_slot (ref, pos);
+    const int32_t diff = (int32_t) (ddsrt_atomic_ld32 (&slot->seq) - pos);
+    if (diff < 0)
+      return false;
+    else if (diff == 0 && ddsrt_atomic_cas32 (&ring->tail, pos, pos + 1))
+      break;
+    pos = ddsrt_atomic_ld32 (&ring->tail);
+  }
+  size_t off = 0;
+  for (size_t i = 0; i < niov; i++)
+  {
+    memcpy (slot->data + off, iov[i].iov_base, iov[i].iov_len);
+    off += iov[i].iov_len;
+  }
+  slot->len = (uint32_t) len;
+  slot->srcport = srcport;
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&slot->seq, pos + 1);
+
+  /* the store of the sequence number must be visible before checking whether
+     the consumer went to sleep, which it does after arming and checking the
+     sequence number of the slot */
+  ddsrt_atomic_fence ();
+  if (ddsrt_atomic_ld32 (&ring->armed) && ddsrt_atomic_cas32 (&ring->armed, 1, 0))
+  {
+    /* failure means the pipe is full, so the consumer will wake up anyway */
+    const char c = 0;
+    const ssize_t r = write (wakefd, &c, 1);
+    (void) r;
+  }
+  return true;
+}
+
+ssize_t ddsi_msgring_read (const struct ddsi_msgring_ref *ref, uint32_t *head, int waitfd, bool blocking, unsigned char *buf, size_t len, uint32_t *srcport)
+{
+  struct ddsi_msgring * const ring = ref->ring;
+  while (1)
+  {
+    struct ddsi_msgring_slot * const slot = ddsi_msgring_slot (ref, *head);
+    if (ddsrt_atomic_ld32 (&slot->seq) == *head + 1)
+    {
+      ddsrt_atomic_fence_acq ();
+      /* the length is read once, a producer may still be scribbling over it */
+      const uint32_t msglen = ((volatile struct ddsi_msgring_slot *) slot)->len;
+      const bool valid = (msglen <= ddsi_msgring_maxlen (ref));
+      const size_t n = (msglen < len) ? msglen : len;
+      if (valid)
+      {
+        memcpy (buf, slot->data, n);
+        *srcport = slot->srcport;
+      }
+      ddsrt_atomic_fence_rel ();
+      ddsrt_atomic_st32 (&slot->seq, *head + ref->nslots);
+      (*head)++;
+      if (valid)
+        return (ssize_t) n;
+    }
+    else if (!ddsrt_atomic_ld32 (&ring->armed))
+    {
+      /* bytes on the fd are from earlier wake-ups, there is no need to keep
+         them once the ring is found empty */
+      char tmp[64];
+      while (read (waitfd, tmp, sizeof (tmp)) > 0)
+        ;
+      ddsrt_atomic_st32 (&ring->armed, 1);
+      ddsrt_atomic_fence ();
+    }
+    else if (blocking)
+    {
+      struct pollfd pfd = { .fd = waitfd, .events = POLLIN, .revents = 0 };
+      if (poll (&pfd, 1, -1) < 0 && errno != EINTR)
+        return -1;
+    }
+    else
+    {
+      return 0;
+    }
+  }
+}
+
+bool ddsi_msgring_pending (const struct ddsi_msgring_ref *ref, uint32_t head)
+{
+  return ddsrt_atomic_ld32 (&ddsi_msgring_slot (ref, head)->seq) == head + 1;
+}
+
+#endif /* DDSI_HAVE_MSGRING */
@@ -0,0 +1,106 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef DDSI_MSGRING_H
+#define DDSI_MSGRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/sockets.h"
+
+/* Message ring shared by the shmring and inproc transports: a bounded
+   multi-producer, single-consumer queue of fixed-size slots, each holding a
+   single message, that contains no pointers and so can be placed in memory
+   shared between processes.  Each slot carries a sequence number telling
+   whether it is free for the producer that claimed its position or filled
+   for the consumer.
+
+   Waiting for messages is done using a file descriptor that the consumer
+   can put in a socket waitset: once the consumer finds the ring empty, it
+   "arms" the ring and the first producer to add a message after that
+   writes a byte to it.  As long as the consumer keeps up, there are no
+   system calls at all.
+
+   Nothing in a ring in shared memory can be trusted, so both sides address
+   it through a ddsi_msgring_ref holding private copies of its geometry, and
+   the consumer checks the length of every message against the slot size. */
+#if !defined _WIN32 && !LWIP_SOCKET
+#define DDSI_HAVE_MSGRING 1
+#else
+#define DDSI_HAVE_MSGRING 0
+#endif
+
+#if DDSI_HAVE_MSGRING
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+#define DDSI_MSGRING_CACHELINE 64u
+
+struct ddsi_msgring {
+  uint32_t nslots; /* power of 2 */
+  uint32_t slot_size;
+  ddsrt_atomic_uint32_t armed; /* consumer waits for a byte on the fd */
+  unsigned char pad[DDSI_MSGRING_CACHELINE - 3 * sizeof (uint32_t)];
+  ddsrt_atomic_uint32_t tail; /* next position to be claimed by a producer */
+  unsigned char pad1[DDSI_MSGRING_CACHELINE - sizeof (uint32_t)];
+  /* slots follow */
+};
+
+/* Private view of a ring: the geometry is copied when the ring is created
+   or attached to, because another process may modify the header at any
+   time */
+struct ddsi_msgring_ref {
+  struct ddsi_msgring *ring;
+  uint32_t nslots;
+  uint32_t slot_size;
+};
+
+/* Size of a ring of nslots slots of slot_size bytes, including the header */
+size_t ddsi_msgring_size (uint32_t nslots, uint32_t slot_size);
+
+/* Largest power-of-2 number of slots, but at least 2, fitting in size,
+   ignoring the header */
+uint32_t ddsi_msgring_nslots (size_t size, uint32_t slot_size);
+
+void ddsi_msgring_init (struct ddsi_msgring_ref *ref, struct ddsi_msgring *ring, uint32_t nslots, uint32_t slot_size);
+
+/* Sets ref to address an initialised ring of size bytes (including the
+   header), returns false if the geometry in the header is invalid or doesn't
+   fit in that size */
+bool ddsi_msgring_attach (struct ddsi_msgring_ref *ref, struct ddsi_msgring *ring, size_t size);
+
+/* Largest message that fits in a slot */
+size_t ddsi_msgring_maxlen (const struct ddsi_msgring_ref *ref);
+
+/* Appends a message to the ring and, if the consumer is waiting, writes a
+   byte to wakefd.  Returns false if the message doesn't fit in a slot or the
+   ring is full. */
+bool ddsi_msgring_push (const struct ddsi_msgring_ref *ref, int wakefd, uint32_t srcport, size_t niov, const ddsrt_iovec_t *iov, size_t len);
+
+/* Takes the message at *head (the consumer's private position) from the
+   ring, truncated to len bytes.  Messages claiming to be longer than a slot
+   are dropped.  If the ring is empty, it arms the ring and, if blocking,
+   waits for a byte on waitfd, else returns 0.  Returns -1 on error. */
+ssize_t ddsi_msgring_read (const struct ddsi_msgring_ref *ref, uint32_t *head, int waitfd, bool blocking, unsigned char *buf, size_t len, uint32_t *srcport);
+
+bool ddsi_msgring_pending (const struct ddsi_msgring_ref *ref, uint32_t head);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* DDSI_HAVE_MSGRING */
+
+#endif /* DDSI_MSGRING_H */
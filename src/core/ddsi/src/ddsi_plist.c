@@ -2565,6 +2565,28 @@ static enum do_locator_result do_locator (nn_locators_t *ls, uint64_t present, u
           return DOLOC_INVALID;
       }
       break;
+    case NN_LOCATOR_KIND_SHMRING:
+      if (!vendor_is_eclipse (dd->vendorid))
+        return DOLOC_IGNORED;
+      else
+      {
+        if (!ddsi_is_valid_port (fact, loc.port))
+          return DOLOC_INVALID;
+        if (!locator_address_prefix_zero (&loc, 12) && !ddsi_is_mcaddr (gv, &loc))
+          return DOLOC_INVALID;
+      }
+      break;
+    case NN_LOCATOR_KIND_INPROC:
+      if (!vendor_is_eclipse (dd->vendorid))
+        return DOLOC_IGNORED;
+      else
+      {
+        if (!ddsi_is_valid_port (fact, loc.port))
+          return DOLOC_INVALID;
+        if (!locator_address_zero (&loc) && !ddsi_is_mcaddr (gv, &loc))
+          return DOLOC_INVALID;
+      }
+      break;
     default:
       return DOLOC_IGNORED;
   }
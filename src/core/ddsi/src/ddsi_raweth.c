@@ -21,20 +21,45 @@
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/log.h"
 #include "dds/ddsrt/sockets.h"
+#include "dds/ddsrt/string.h"
 
 #if defined(__linux) && !LWIP_SOCKET
 #include <linux/if_packet.h>
+#include <net/if.h>
 #include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <ifaddrs.h>
 #include <string.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+/* Receiving connections by default use a PACKET_RX_RING shared with the
+   kernel: the kernel copies each frame into the next slot and flips its
+   status, and reading is then a matter of checking the status of the slot
+   at the head, copying the frame out and handing the slot back.  There is
+   only a system call when the ring has been drained and the receive thread
+   has to wait, and unlike a TPACKET_V3 ring of blocks, a TPACKET_V2 ring of
+   frames wakes up the receiver on every frame. */
+#define DDSI_RAWETH_TPACKET_ALIGN(x) (((x) + (size_t) TPACKET_ALIGNMENT - 1) & ~((size_t) TPACKET_ALIGNMENT - 1))
+
+struct ddsi_raweth_ring {
+  unsigned char *base;
+  size_t size;
+  uint32_t frame_size;
+  uint32_t nframes;
+  uint32_t head;
+};
 
 typedef struct ddsi_raweth_conn {
   struct ddsi_tran_conn m_base;
   ddsrt_socket_t m_sock;
   int m_ifindex;
+  bool m_blocking;
+  struct ddsi_raweth_ring m_ring; /* base == NULL if not using a ring */
 } *ddsi_raweth_conn_t;
 
 static char *ddsi_raweth_to_string (char *dst, size_t sizeof_dst, const ddsi_locator_t *loc, ddsi_tran_conn_t conn, int with_port)
@@ -51,6 +76,67 @@ static char *ddsi_raweth_to_string (char *dst, size_t sizeof_dst, const ddsi_loc
   return dst;
 }
 
+static struct tpacket2_hdr *ddsi_raweth_ring_frame (const struct ddsi_raweth_ring *ring)
+{
+  return (struct tpacket2_hdr *) (ring->base + (size_t) ring->head * ring->frame_size);
+}
+
+static bool ddsi_raweth_ring_ready (const struct ddsi_raweth_ring *ring)
+{
+  const volatile struct tpacket2_hdr *hdr = ddsi_raweth_ring_frame (ring);
+  return (hdr->tp_status & TP_STATUS_USER) != 0;
+}
+
+static ssize_t ddsi_raweth_conn_read_ring (ddsi_raweth_conn_t uc, unsigned char *buf, size_t len, ddsi_locator_t *srcloc)
+{
+  struct ddsi_raweth_ring * const ring = &uc->m_ring;
+  while (!ddsi_raweth_ring_ready (ring))
+  {
+    struct pollfd pfd = { .fd = uc->m_sock, .events = POLLIN, .revents = 0 };
+    if (!uc->m_blocking)
+      return 0;
+    if (poll (&pfd, 1, -1) < 0 && errno != EINTR)
+      return -1;
+  }
+  ddsrt_atomic_fence_acq ();
+
+  struct tpacket2_hdr * const hdr = ddsi_raweth_ring_frame (ring);
+  const struct sockaddr_ll *src = (const struct sockaddr_ll *) ((unsigned char *) hdr + DDSI_RAWETH_TPACKET_ALIGN (sizeof (*hdr)));
+  const size_t n = (hdr->tp_snaplen < len) ? hdr->tp_snaplen : len;
+  memcpy (buf, (unsigned char *) hdr + hdr->tp_net, n);
+  if (srcloc)
+  {
+    srcloc->kind = NN_LOCATOR_KIND_RAWETH;
+    srcloc->port = ntohs (src->sll_protocol);
+    memset(srcloc->address, 0, 10);
+    memcpy(srcloc->address + 10, src->sll_addr, 6);
+  }
+  if (hdr->tp_len > n)
+  {
+    char addrbuf[DDSI_LOCSTRLEN];
+    (void) snprintf(addrbuf, sizeof(addrbuf), "[%02x:%02x:%02x:%02x:%02x:%02x]:%u",
+                    src->sll_addr[0], src->sll_addr[1], src->sll_addr[2],
+                    src->sll_addr[3], src->sll_addr[4], src->sll_addr[5], ntohs(src->sll_protocol));
+    DDS_CWARNING(&uc->m_base.m_base.gv->logconfig, "%s => %u truncated to %u\n", addrbuf, (unsigned) hdr->tp_len, (unsigned) n);
+  }
+
+  /* copy must be complete before the kernel may reuse the frame */
+  ddsrt_atomic_fence_rel ();
+  ((volatile struct tpacket2_hdr *) hdr)->tp_status = TP_STATUS_KERNEL;
+  ring->head = (ring->head + 1 == ring->nframes) ? 0 : ring->head + 1;
+  return (ssize_t) n;
+}
+
+static bool ddsi_raweth_conn_read_pending (ddsi_tran_conn_t conn)
+{
+  return ddsi_raweth_ring_ready (&((ddsi_raweth_conn_t) conn)->m_ring);
+}
+
+static void ddsi_raweth_disable_multiplexing (ddsi_tran_conn_t conn)
+{
+  ((ddsi_raweth_conn_t) conn)->m_blocking = true;
+}
+
 static ssize_t ddsi_raweth_conn_read (ddsi_tran_conn_t conn, unsigned char * buf, size_t len, bool allow_spurious, ddsi_locator_t *srcloc)
 {
   dds_return_t rc;
@@ -61,6 +147,9 @@ static ssize_t ddsi_raweth_conn_read (ddsi_tran_conn_t conn, unsigned char * buf
   socklen_t srclen = (socklen_t) sizeof (src);
   (void) allow_spurious;
 
+  if (((ddsi_raweth_conn_t) conn)->m_ring.base)
+    return ddsi_raweth_conn_read_ring ((ddsi_raweth_conn_t) conn, buf, len, srcloc);
+
   msg_iov.iov_base = (void*) buf;
   msg_iov.iov_len = len;
 
@@ -174,6 +263,49 @@ static int ddsi_raweth_conn_locator (ddsi_tran_factory_t fact, ddsi_tran_base_t
   return ret;
 }
 
+static bool ddsi_raweth_setup_ring (struct ddsi_raweth_ring *ring, ddsrt_socket_t sock, const struct nn_interface *intf, const struct ddsi_domaingv *gv)
+{
+  const long pagesize = sysconf (_SC_PAGESIZE);
+  const int version = TPACKET_V2;
+  struct tpacket_req req;
+  struct ifreq ifr;
+  uint32_t block_size;
+
+  /* a frame holds the header, the source address and a full MTU-sized
+     frame, without the Ethernet header for a SOCK_DGRAM socket */
+  memset (&ifr, 0, sizeof (ifr));
+  (void) ddsrt_strlcpy (ifr.ifr_name, intf->name, sizeof (ifr.ifr_name));
+  if (ioctl (sock, SIOCGIFMTU, &ifr) < 0)
+    return false;
+  const size_t overhead = DDSI_RAWETH_TPACKET_ALIGN (DDSI_RAWETH_TPACKET_ALIGN (sizeof (struct tpacket2_hdr)) + sizeof (struct sockaddr_ll) + 16);
+  ring->frame_size = 2048;
+  while (ring->frame_size < overhead + (size_t) ifr.ifr_mtu && ring->frame_size < (UINT32_C (1) << 30))
+    ring->frame_size <<= 1;
+  block_size = (ring->frame_size > (uint32_t) pagesize) ? ring->frame_size : (uint32_t) pagesize;
+  if (gv->config.raweth_ring_size < block_size)
+    return false;
+
+  memset (&req, 0, sizeof (req));
+  req.tp_block_size = block_size;
+  req.tp_block_nr = gv->config.raweth_ring_size / block_size;
+  req.tp_frame_size = ring->frame_size;
+  req.tp_frame_nr = req.tp_block_nr * (block_size / ring->frame_size);
+  /* not ddsrt_setsockopt: it ignores option 5 (SO_DONTROUTE) regardless of
+     the level, and PACKET_RX_RING happens to be 5 as well */
+  if (setsockopt (sock, SOL_PACKET, PACKET_VERSION, &version, sizeof (version)) < 0 ||
+      setsockopt (sock, SOL_PACKET, PACKET_RX_RING, &req, sizeof (req)) < 0)
+    return false;
+  ring->size = (size_t) req.tp_block_nr * req.tp_block_size;
+  if ((ring->base = mmap (NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, sock, 0)) == MAP_FAILED)
+  {
+    ring->base = NULL;
+    return false;
+  }
+  ring->nframes = req.tp_frame_nr;
+  ring->head = 0;
+  return true;
+}
+
 static dds_return_t ddsi_raweth_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_factory_t fact, uint32_t port, const struct ddsi_tran_qos *qos)
 {
   ddsrt_socket_t sock;
@@ -231,7 +363,20 @@ static dds_return_t ddsi_raweth_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tr
   uc->m_base.m_write_fn = ddsi_raweth_conn_write;
   uc->m_base.m_disable_multiplexing_fn = 0;
 
-  DDS_CTRACE (&fact->gv->logconfig, "ddsi_raweth_create_conn %s socket %d port %u\n", mcast ? "multicast" : "unicast", uc->m_sock, uc->m_base.m_base.m_port);
+  /* a ring that can't be set up means falling back to recvmsg, because
+     sockets in the waitset are polled either way */
+  if (qos->m_purpose != DDSI_TRAN_QOS_XMIT && gv->config.raweth_ring_size > 0)
+  {
+    if (!ddsi_raweth_setup_ring (&uc->m_ring, sock, intf, gv))
+      DDS_CLOG (DDS_LC_CONFIG, &fact->gv->logconfig, "ddsi_raweth_create_conn %s port %u: no receive ring, using recvmsg\n", mcast ? "multicast" : "unicast", port);
+    else
+    {
+      uc->m_base.m_read_pending_fn = ddsi_raweth_conn_read_pending;
+      uc->m_base.m_disable_multiplexing_fn = ddsi_raweth_disable_multiplexing;
+    }
+  }
+
+  DDS_CTRACE (&fact->gv->logconfig, "ddsi_raweth_create_conn %s socket %d port %u%s\n", mcast ? "multicast" : "unicast", uc->m_sock, uc->m_base.m_base.m_port, uc->m_ring.base ? " ring" : "");
   *conn_out = &uc->m_base;
   return DDS_RETCODE_OK;
 }
@@ -289,6 +434,8 @@ static void ddsi_raweth_release_conn (ddsi_tran_conn_t conn)
               conn->m_base.m_multicast ? "multicast" : "unicast",
               uc->m_sock,
               uc->m_base.m_base.m_port);
+  if (uc->m_ring.base)
+    munmap (uc->m_ring.base, uc->m_ring.size);
   ddsrt_close (uc->m_sock);
   ddsrt_free (conn);
 }
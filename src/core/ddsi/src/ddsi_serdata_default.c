@@ -174,7 +174,9 @@ static void serdata_default_free(struct ddsi_serdata *dcmn)
   }
 #endif
 
-  if (d->size > MAX_SIZE_FOR_POOL || !nn_freelist_push (&d->serpool->freelist, d))
+  if (d->contig)
+    nn_rdata_contig_release (d->contig);
+  else if (d->size > MAX_SIZE_FOR_POOL || !nn_freelist_push (&d->serpool->freelist, d))
     dds_free (d);
 }
 
@@ -182,6 +184,7 @@ static void serdata_default_init(struct ddsi_serdata_default *d, const struct dd
 {
   ddsi_serdata_init (&d->c, &tp->c, kind);
   d->pos = 0;
+  d->contig = NULL;
 #ifndef NDEBUG
   d->fixed = false;
 #endif
@@ -217,10 +220,52 @@ static struct ddsi_serdata_default *serdata_default_new (const struct ddsi_serty
   return serdata_default_new_size (tp, kind, DEFAULT_NEW_SIZE);
 }
 
+DDSRT_STATIC_ASSERT (offsetof (struct ddsi_serdata_default, hdr) <= NN_RDATA_CONTIG_HEADROOM);
+
+/* Construct a serdata in the headroom of a sample reassembled by the
+   defragmenter, so that the payload need not be copied.  Only possible
+   if it is in native byte order, because the payload must not be
+   modified. */
+static struct ddsi_serdata_default *serdata_default_from_contig (const struct ddsi_sertype_default *tp, enum ddsi_serdata_kind kind, const struct nn_rdata *fragchain, size_t size)
+{
+  const struct CDRHeader *hdr = (const struct CDRHeader *) NN_RMSG_PAYLOADOFF (fragchain->rmsg, NN_RDATA_PAYLOAD_OFF (fragchain));
+  const struct nn_rdata *contig;
+  if (hdr->identifier != NATIVE_ENCODING || size < 4 || (contig = nn_fragchain_claim_contig (fragchain)) == NULL)
+    return NULL;
+
+  unsigned char *payload = NN_RMSG_PAYLOADOFF (contig->rmsg, NN_RDATA_PAYLOAD_OFF (contig));
+  struct ddsi_serdata_default *d = (struct ddsi_serdata_default *) (payload - offsetof (struct ddsi_serdata_default, hdr));
+  assert (((uintptr_t) d % 8) == 0);
+  assert (contig->maxp1 == size);
+  ddsi_serdata_init (&d->c, &tp->c, kind);
+  d->pos = d->size = (uint32_t) size - 4;
+  d->serpool = tp->serpool;
+  d->contig = contig;
+#ifndef NDEBUG
+  d->fixed = false;
+#endif
+  memset (d->keyhash.m_hash, 0, sizeof (d->keyhash.m_hash));
+  d->keyhash.m_set = 0;
+  d->keyhash.m_iskey = 0;
+  d->keyhash.m_keysize = 0;
+
+  const uint32_t pad = ddsrt_fromBE2u (d->hdr.options) & 2;
+  if (d->pos < pad || !dds_stream_normalize (d->data, d->pos - pad, false, tp, kind == SDK_KEY))
+  {
+    ddsi_serdata_unref (&d->c);
+    return NULL;
+  }
+  dds_istream_t is;
+  dds_istream_from_serdata_default (&is, d);
+  dds_stream_extract_keyhash (&is, &d->keyhash, tp, kind == SDK_KEY);
+  return d;
+}
+
 /* Construct a serdata from a fragchain received over the network */
 static struct ddsi_serdata_default *serdata_default_from_ser_common (const struct ddsi_sertype *tpcmn, enum ddsi_serdata_kind kind, const struct nn_rdata *fragchain, size_t size)
 {
   const struct ddsi_sertype_default *tp = (const struct ddsi_sertype_default *)tpcmn;
+  struct ddsi_serdata_default *d;
 
   /* FIXME: check whether this really is the correct maximum: offsets are relative
      to the CDR header, but there are also some places that use a serdata as-if it
@@ -228,8 +273,9 @@ static struct ddsi_serdata_default *serdata_default_from_ser_common (const struc
      serdata */
   if (size > UINT32_MAX - offsetof (struct ddsi_serdata_default, hdr))
     return NULL;
-  struct ddsi_serdata_default *d = serdata_default_new_size (tp, kind, (uint32_t) size);
-  if (d == NULL)
+  if (fragchain->nextfrag && (d = serdata_default_from_contig (tp, kind, fragchain, size)) != NULL)
+    return d;
+  if ((d = serdata_default_new_size (tp, kind, (uint32_t) size)) == NULL)
     return NULL;
 
   uint32_t off = 4; /* must skip the CDR header */
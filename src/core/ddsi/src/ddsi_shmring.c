@@ -0,0 +1,806 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include "dds/ddsi/ddsi_tran.h"
+#include "dds/ddsi/ddsi_shmring.h"
+#include "dds/ddsi/q_config.h"
+#include "dds/ddsi/q_log.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/mh3.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/time.h"
+#include "ddsi_msgring.h"
+
+#if defined(__linux) && !LWIP_SOCKET
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/* Same-host transport over shared memory: every receiving connection owns a
+   message ring (see ddsi_msgring.h) in a file in /dev/shm (i.e., a POSIX
+   shared memory object) named after its port, into which any process on the
+   host can write RTPS messages exactly as it would send UDP datagrams to that
+   port.
+
+   A receive thread can't wait on a futex in a socket waitset, and an eventfd
+   can't be shared with unrelated processes without passing file descriptors
+   around, so the consumer instead has a named pipe next to the ring that it
+   uses as its socket handle and that producers use to wake it up.
+
+   The files are only accessible to the user that created them, and the
+   contents of a ring mapped from another process are never trusted: the
+   geometry is validated and copied when mapping it, and the length of each
+   message is checked when reading it.
+
+   Multicast is emulated by a multicast receive connection creating a ring
+   with a name unique to it, and writing to a multicast locator writing to
+   every ring joined to the port.  The rings joined to a port are found by
+   scanning the directory, which is done at most once per
+   DDSI_SHMRING_GROUP_RESCAN_INTERVAL, so a new member may miss the first
+   few messages.  That is only suitable for discovery.
+
+   A ring whose owner disappeared without cleaning up is recognised by its
+   process id and removed when the port is reused.  A producer crashing
+   between claiming and filling a slot stalls the ring. */
+
+#define DDSI_SHMRING_DIR "/dev/shm"
+#define DDSI_SHMRING_PREFIX "cdds-shmring-"
+#define DDSI_SHMRING_MAGIC 0x53484d52u /* "SHMR" */
+#define DDSI_SHMRING_SLOT_SIZE 65536u
+#define DDSI_SHMRING_FIRST_DYNAMIC_PORT 49152u
+#define DDSI_SHMRING_NUM_DYNAMIC_PORTS 16384u
+#define DDSI_SHMRING_MODE 0600
+#define DDSI_SHMRING_GROUP_RESCAN_INTERVAL DDS_SECS (1)
+
+struct ddsi_shmring_hdr {
+  ddsrt_atomic_uint32_t magic; /* set once the ring is initialised */
+  int32_t pid;
+  ddsrt_atomic_uint32_t closed;
+  unsigned char pad[DDSI_MSGRING_CACHELINE - 3 * sizeof (uint32_t)];
+  struct ddsi_msgring ring;
+};
+
+/* A ring mapped for writing to it, kept in the factory for as long as the
+   consumer exists, or until the factory is freed if another thread may still
+   be using it */
+struct ddsi_shmring_peer {
+  uint32_t port;
+  struct ddsi_shmring_hdr *hdr;
+  size_t size;
+  struct ddsi_msgring_ref ring;
+  int dbfd;
+  struct ddsi_shmring_peer *next;
+  char name[64];
+};
+
+/* Rings joined to a multicast port, protected by the factory lock */
+struct ddsi_shmring_group {
+  uint32_t port;
+  ddsrt_mtime_t tnext_scan;
+  struct ddsi_shmring_peer *members;
+};
+
+typedef struct ddsi_shmring_conn {
+  struct ddsi_tran_conn m_base;
+  struct ddsi_shmring_hdr *m_hdr; /* NULL for transmit-only connections */
+  size_t m_size;
+  struct ddsi_msgring_ref m_ring;
+  uint32_t m_head;
+  int m_dbfd;
+  bool m_blocking;
+  char *m_name;
+} *ddsi_shmring_conn_t;
+
+typedef struct ddsi_shmring_tran_factory {
+  struct ddsi_tran_factory m_base;
+  uint32_t m_hostid;
+  uint32_t m_nslots;
+  ddsrt_atomic_uint32_t m_mc_serial;
+  ddsrt_mutex_t m_lock;
+  struct ddsrt_hh *m_peers;
+  struct ddsrt_hh *m_groups;
+  struct ddsi_shmring_peer *m_retired;
+} *ddsi_shmring_tran_factory_t;
+
+static uint32_t ddsi_shmring_peer_hash (const void *va)
+{
+  const struct ddsi_shmring_peer *a = va;
+  return a->port * UINT32_C (2654435761);
+}
+
+static int ddsi_shmring_peer_equal (const void *va, const void *vb)
+{
+  const struct ddsi_shmring_peer *a = va;
+  const struct ddsi_shmring_peer *b = vb;
+  return a->port == b->port;
+}
+
+static void ddsi_shmring_paths (char *path, size_t sizeof_path, char *dbpath, size_t sizeof_dbpath, const char *name)
+{
+  (void) snprintf (path, sizeof_path, "%s/%s%s", DDSI_SHMRING_DIR, DDSI_SHMRING_PREFIX, name);
+  (void) snprintf (dbpath, sizeof_dbpath, "%s/%s%s.db", DDSI_SHMRING_DIR, DDSI_SHMRING_PREFIX, name);
+}
+
+static bool ddsi_shmring_owner_alive (const struct ddsi_shmring_hdr *hdr)
+{
+  return kill ((pid_t) hdr->pid, 0) == 0 || errno == EPERM;
+}
+
+static bool ddsi_shmring_map (struct ddsi_shmring_peer *peer, const char *name)
+{
+  char path[128], dbpath[128];
+  struct stat st;
+  int fd;
+  ddsi_shmring_paths (path, sizeof (path), dbpath, sizeof (dbpath), name);
+  if ((fd = open (path, O_RDWR | O_CLOEXEC)) < 0)
+    return false;
+  if (fstat (fd, &st) < 0 || (size_t) st.st_size < sizeof (*peer->hdr))
+    goto err_fd;
+  peer->size = (size_t) st.st_size;
+  if ((peer->hdr = mmap (NULL, peer->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    goto err_fd;
+  close (fd);
+  /* the header is only valid once the owner completed initialising it */
+  if (ddsrt_atomic_ld32 (&peer->hdr->magic) != DDSI_SHMRING_MAGIC)
+    goto err_map;
+  ddsrt_atomic_fence_acq ();
+  if (ddsrt_atomic_ld32 (&peer->hdr->closed) ||
+      !ddsi_msgring_attach (&peer->ring, &peer->hdr->ring, peer->size - offsetof (struct ddsi_shmring_hdr, ring)))
+    goto err_map;
+  if ((peer->dbfd = open (dbpath, O_WRONLY | O_NONBLOCK | O_CLOEXEC)) < 0)
+    goto err_map;
+  (void) ddsrt_strlcpy (peer->name, name, sizeof (peer->name));
+  return true;
+
+err_map:
+  munmap (peer->hdr, peer->size);
+  return false;
+err_fd:
+  close (fd);
+  return false;
+}
+
+static void ddsi_shmring_unmap (struct ddsi_shmring_peer *peer)
+{
+  close (peer->dbfd);
+  munmap (peer->hdr, peer->size);
+}
+
+static struct ddsi_shmring_peer *ddsi_shmring_lookup_peer (ddsi_shmring_tran_factory_t fact, uint32_t port)
+{
+  struct ddsi_shmring_peer template = { .port = port }, *peer;
+  ddsrt_mutex_lock (&fact->m_lock);
+  if ((peer = ddsrt_hh_lookup (fact->m_peers, &template)) != NULL && ddsrt_atomic_ld32 (&peer->hdr->closed))
+  {
+    /* other threads may be writing into it, so it can't be unmapped yet */
+    ddsrt_hh_remove (fact->m_peers, peer);
+    peer->next = fact->m_retired;
+    fact->m_retired = peer;
+    peer = NULL;
+  }
+  if (peer == NULL)
+  {
+    char name[16];
+    (void) snprintf (name, sizeof (name), "u%"PRIu32, port);
+    peer = ddsrt_malloc (sizeof (*peer));
+    peer->port = port;
+    if (!ddsi_shmring_map (peer, name))
+    {
+      ddsrt_free (peer);
+      peer = NULL;
+    }
+    else
+    {
+      ddsrt_hh_add (fact->m_peers, peer);
+    }
+  }
+  ddsrt_mutex_unlock (&fact->m_lock);
+  return peer;
+}
+
+static void ddsi_shmring_remove_files (const char *path, const char *dbpath)
+{
+  (void) unlink (path);
+  (void) unlink (dbpath);
+}
+
+static uint32_t ddsi_shmring_group_hash (const void *va)
+{
+  const struct ddsi_shmring_group *a = va;
+  return a->port * UINT32_C (2654435761);
+}
+
+static int ddsi_shmring_group_equal (const void *va, const void *vb)
+{
+  const struct ddsi_shmring_group *a = va;
+  const struct ddsi_shmring_group *b = vb;
+  return a->port == b->port;
+}
+
+static bool ddsi_shmring_group_has_member (const struct ddsi_shmring_group *group, const char *name)
+{
+  for (const struct ddsi_shmring_peer *m = group->members; m; m = m->next)
+    if (strcmp (m->name, name) == 0)
+      return true;
+  return false;
+}
+
+static void ddsi_shmring_group_scan (struct ddsi_shmring_group *group)
+{
+  char prefix[32];
+  struct dirent *ent;
+  DIR *dir;
+  if ((dir = opendir (DDSI_SHMRING_DIR)) == NULL)
+    return;
+  const int prefixlen = snprintf (prefix, sizeof (prefix), "%sm%"PRIu32"-", DDSI_SHMRING_PREFIX, group->port);
+  while ((ent = readdir (dir)) != NULL)
+  {
+    const char *name = ent->d_name + strlen (DDSI_SHMRING_PREFIX);
+    const size_t n = strlen (ent->d_name);
+    struct ddsi_shmring_peer *peer;
+    if (strncmp (ent->d_name, prefix, (size_t) prefixlen) != 0 || (n > 3 && strcmp (ent->d_name + n - 3, ".db") == 0))
+      continue;
+    if (ddsi_shmring_group_has_member (group, name))
+      continue;
+    peer = ddsrt_malloc (sizeof (*peer));
+    peer->port = group->port;
+    if (!ddsi_shmring_map (peer, name))
+      ddsrt_free (peer);
+    else if (!ddsi_shmring_owner_alive (peer->hdr))
+    {
+      char path[128], dbpath[128];
+      ddsi_shmring_paths (path, sizeof (path), dbpath, sizeof (dbpath), name);
+      ddsi_shmring_remove_files (path, dbpath);
+      ddsi_shmring_unmap (peer);
+      ddsrt_free (peer);
+    }
+    else
+    {
+      peer->next = group->members;
+      group->members = peer;
+    }
+  }
+  closedir (dir);
+}
+
+static void ddsi_shmring_write_group (ddsi_shmring_tran_factory_t fact, uint32_t port, uint32_t srcport, size_t niov, const ddsrt_iovec_t *iov, size_t len)
+{
+  struct ddsi_shmring_group template = { .port = port }, *group;
+  const ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+  ddsrt_mutex_lock (&fact->m_lock);
+  if ((group = ddsrt_hh_lookup (fact->m_groups, &template)) == NULL)
+  {
+    group = ddsrt_malloc (sizeof (*group));
+    group->port = port;
+    group->tnext_scan = tnow;
+    group->members = NULL;
+    ddsrt_hh_add (fact->m_groups, group);
+  }
+  if (tnow.v >= group->tnext_scan.v)
+  {
+    ddsi_shmring_group_scan (group);
+    group->tnext_scan = ddsrt_mtime_add_duration (tnow, DDSI_SHMRING_GROUP_RESCAN_INTERVAL);
+  }
+  /* members are only used with the lock held, so they can be unmapped
+     immediately once they turn out to be gone */
+  struct ddsi_shmring_peer **pm = &group->members, *m;
+  while ((m = *pm) != NULL)
+  {
+    if (!ddsrt_atomic_ld32 (&m->hdr->closed) &&
+        (ddsi_msgring_push (&m->ring, m->dbfd, srcport, niov, iov, len) || ddsi_shmring_owner_alive (m->hdr)))
+      pm = &m->next;
+    else
+    {
+      *pm = m->next;
+      ddsi_shmring_unmap (m);
+      ddsrt_free (m);
+    }
+  }
+  ddsrt_mutex_unlock (&fact->m_lock);
+}
+
+static bool ddsi_shmring_is_broadcast (const ddsi_locator_t *loc)
+{
+  for (size_t i = 0; i < sizeof (loc->address); i++)
+    if (loc->address[i] != 0xff)
+      return false;
+  return true;
+}
+
+static uint32_t ddsi_shmring_hostid (const ddsi_locator_t *loc)
+{
+  return ((uint32_t) loc->address[12] << 24) | ((uint32_t) loc->address[13] << 16) | ((uint32_t) loc->address[14] << 8) | loc->address[15];
+}
+
+static void ddsi_shmring_set_locator (const struct ddsi_shmring_tran_factory *fact, ddsi_locator_t *loc, uint32_t port)
+{
+  loc->kind = NN_LOCATOR_KIND_SHMRING;
+  loc->port = port;
+  memset (loc->address, 0, sizeof (loc->address));
+  loc->address[12] = (unsigned char) (fact->m_hostid >> 24);
+  loc->address[13] = (unsigned char) (fact->m_hostid >> 16);
+  loc->address[14] = (unsigned char) (fact->m_hostid >> 8);
+  loc->address[15] = (unsigned char) fact->m_hostid;
+}
+
+static ssize_t ddsi_shmring_conn_write (ddsi_tran_conn_t conn_cmn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
+{
+  ddsi_shmring_tran_factory_t fact = (ddsi_shmring_tran_factory_t) conn_cmn->m_factory;
+  struct ddsi_shmring_peer *peer;
+  size_t len = 0;
+  (void) flags;
+  for (size_t i = 0; i < niov; i++)
+    len += iov[i].iov_len;
+
+  /* Like UDP, a message that can't be delivered is silently dropped */
+  if (ddsi_shmring_is_broadcast (dst))
+    ddsi_shmring_write_group (fact, dst->port, conn_cmn->m_base.m_port, niov, iov, len);
+  else if (ddsi_shmring_hostid (dst) == fact->m_hostid && (peer = ddsi_shmring_lookup_peer (fact, dst->port)) != NULL)
+  {
+    if (!ddsi_msgring_push (&peer->ring, peer->dbfd, conn_cmn->m_base.m_port, niov, iov, len) && !ddsi_shmring_owner_alive (peer->hdr))
+      ddsrt_atomic_st32 (&peer->hdr->closed, 1);
+  }
+  return (ssize_t) len;
+}
+
+static ssize_t ddsi_shmring_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char *buf, size_t len, bool allow_spurious, ddsi_locator_t *srcloc)
+{
+  ddsi_shmring_conn_t conn = (ddsi_shmring_conn_t) conn_cmn;
+  uint32_t srcport;
+  ssize_t n;
+  (void) allow_spurious;
+  assert (conn->m_hdr != NULL);
+  if ((n = ddsi_msgring_read (&conn->m_ring, &conn->m_head, conn->m_dbfd, conn->m_blocking, buf, len, &srcport)) > 0 && srcloc)
+    ddsi_shmring_set_locator ((ddsi_shmring_tran_factory_t) conn_cmn->m_factory, srcloc, srcport);
+  return n;
+}
+
+static bool ddsi_shmring_conn_read_pending (ddsi_tran_conn_t conn_cmn)
+{
+  ddsi_shmring_conn_t conn = (ddsi_shmring_conn_t) conn_cmn;
+  return ddsi_msgring_pending (&conn->m_ring, conn->m_head);
+}
+
+static void ddsi_shmring_disable_multiplexing (ddsi_tran_conn_t conn_cmn)
+{
+  ddsi_shmring_conn_t conn = (ddsi_shmring_conn_t) conn_cmn;
+  conn->m_blocking = true;
+}
+
+static ddsrt_socket_t ddsi_shmring_conn_handle (ddsi_tran_base_t base)
+{
+  ddsi_shmring_conn_t conn = (ddsi_shmring_conn_t) base;
+  return (conn->m_hdr != NULL) ? conn->m_dbfd : DDSRT_INVALID_SOCKET;
+}
+
+static bool ddsi_shmring_supports (const struct ddsi_tran_factory *fact, int32_t kind)
+{
+  (void) fact;
+  return (kind == NN_LOCATOR_KIND_SHMRING);
+}
+
+static int ddsi_shmring_conn_locator (ddsi_tran_factory_t fact, ddsi_tran_base_t base, ddsi_locator_t *loc)
+{
+  ddsi_shmring_set_locator ((ddsi_shmring_tran_factory_t) fact, loc, base->m_port);
+  return 0;
+}
+
+static bool ddsi_shmring_remove_if_stale (const char *path, const char *dbpath)
+{
+  struct ddsi_shmring_hdr *hdr;
+  struct stat st;
+  bool stale = false;
+  int fd;
+  if ((fd = open (path, O_RDONLY | O_CLOEXEC)) < 0)
+    return (errno == ENOENT);
+  if (fstat (fd, &st) == 0 && (size_t) st.st_size >= sizeof (*hdr) &&
+      (hdr = mmap (NULL, sizeof (*hdr), PROT_READ, MAP_SHARED, fd, 0)) != MAP_FAILED)
+  {
+    /* a ring that is still being initialised is as good as in use */
+    stale = (ddsrt_atomic_ld32 (&hdr->magic) == DDSI_SHMRING_MAGIC && !ddsi_shmring_owner_alive (hdr));
+    munmap (hdr, sizeof (*hdr));
+  }
+  close (fd);
+  if (stale)
+    ddsi_shmring_remove_files (path, dbpath);
+  return stale;
+}
+
+static dds_return_t ddsi_shmring_create_ring (ddsi_shmring_tran_factory_t fact, ddsi_shmring_conn_t conn, const char *name)
+{
+  struct ddsi_domaingv const * const gv = fact->m_base.gv;
+  char path[128], dbpath[128];
+  int fd, err;
+  ddsi_shmring_paths (path, sizeof (path), dbpath, sizeof (dbpath), name);
+  while ((fd = open (path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, DDSI_SHMRING_MODE)) < 0)
+  {
+    if (errno != EEXIST)
+    {
+      GVERROR ("ddsi_shmring_create_conn: can't create %s: %s\n", path, strerror (errno));
+      return DDS_RETCODE_ERROR;
+    }
+    else if (!ddsi_shmring_remove_if_stale (path, dbpath))
+    {
+      return DDS_RETCODE_PRECONDITION_NOT_MET;
+    }
+  }
+
+  conn->m_size = offsetof (struct ddsi_shmring_hdr, ring) + ddsi_msgring_size (fact->m_nslots, DDSI_SHMRING_SLOT_SIZE);
+  if (ftruncate (fd, (off_t) conn->m_size) < 0)
+    goto err_file;
+  if ((conn->m_hdr = mmap (NULL, conn->m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    goto err_file;
+  (void) unlink (dbpath);
+  if (mkfifo (dbpath, DDSI_SHMRING_MODE) < 0)
+    goto err_map;
+  if ((conn->m_dbfd = open (dbpath, O_RDWR | O_NONBLOCK | O_CLOEXEC)) < 0)
+    goto err_fifo;
+  close (fd);
+
+  struct ddsi_shmring_hdr * const hdr = conn->m_hdr;
+  hdr->pid = (int32_t) getpid ();
+  ddsrt_atomic_st32 (&hdr->closed, 0);
+  ddsi_msgring_init (&conn->m_ring, &hdr->ring, fact->m_nslots, DDSI_SHMRING_SLOT_SIZE);
+  conn->m_head = 0;
+  conn->m_name = ddsrt_strdup (name);
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&hdr->magic, DDSI_SHMRING_MAGIC);
+  return DDS_RETCODE_OK;
+
+err_fifo:
+  err = errno;
+  (void) unlink (dbpath);
+  errno = err;
+err_map:
+  err = errno;
+  munmap (conn->m_hdr, conn->m_size);
+  conn->m_hdr = NULL;
+  errno = err;
+err_file:
+  GVERROR ("ddsi_shmring_create_conn: can't initialise %s: %s\n", path, strerror (errno));
+  close (fd);
+  (void) unlink (path);
+  return DDS_RETCODE_ERROR;
+}
+
+static dds_return_t ddsi_shmring_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_factory_t fact_cmn, uint32_t port, const struct ddsi_tran_qos *qos)
+{
+  ddsi_shmring_tran_factory_t fact = (ddsi_shmring_tran_factory_t) fact_cmn;
+  struct ddsi_domaingv const * const gv = fact_cmn->gv;
+  struct nn_interface const * const intf = qos->m_interface ? qos->m_interface : &gv->interfaces[0];
+  const bool mcast = (qos->m_purpose == DDSI_TRAN_QOS_RECV_MC);
+  dds_return_t rc = DDS_RETCODE_OK;
+  char name[64];
+
+  ddsi_shmring_conn_t conn = ddsrt_malloc (sizeof (*conn));
+  memset (conn, 0, sizeof (*conn));
+  conn->m_dbfd = -1;
+  switch (qos->m_purpose)
+  {
+    case DDSI_TRAN_QOS_XMIT:
+      break;
+    case DDSI_TRAN_QOS_RECV_MC:
+      (void) snprintf (name, sizeof (name), "m%"PRIu32"-%d-%"PRIu32, port, (int) getpid (), ddsrt_atomic_inc32_nv (&fact->m_mc_serial));
+      rc = ddsi_shmring_create_ring (fact, conn, name);
+      break;
+    case DDSI_TRAN_QOS_RECV_UC:
+      if (port != 0)
+      {
+        (void) snprintf (name, sizeof (name), "u%"PRIu32, port);
+        rc = ddsi_shmring_create_ring (fact, conn, name);
+      }
+      else
+      {
+        /* start at a different point in the range for each process, so that
+           processes don't all probe the same ports */
+        const uint32_t start = (uint32_t) getpid () * 16;
+        rc = DDS_RETCODE_PRECONDITION_NOT_MET;
+        for (uint32_t i = 0; i < DDSI_SHMRING_NUM_DYNAMIC_PORTS && rc == DDS_RETCODE_PRECONDITION_NOT_MET; i++)
+        {
+          port = DDSI_SHMRING_FIRST_DYNAMIC_PORT + (start + i) % DDSI_SHMRING_NUM_DYNAMIC_PORTS;
+          (void) snprintf (name, sizeof (name), "u%"PRIu32, port);
+          rc = ddsi_shmring_create_ring (fact, conn, name);
+        }
+      }
+      break;
+  }
+  if (rc != DDS_RETCODE_OK)
+  {
+    ddsrt_free (conn);
+    return rc;
+  }
+
+  ddsi_factory_conn_init (fact_cmn, intf, &conn->m_base);
+  conn->m_base.m_base.m_port = port;
+  conn->m_base.m_base.m_trantype = DDSI_TRAN_CONN;
+  conn->m_base.m_base.m_multicast = mcast;
+  conn->m_base.m_base.m_handle_fn = ddsi_shmring_conn_handle;
+  conn->m_base.m_locator_fn = ddsi_shmring_conn_locator;
+  conn->m_base.m_read_fn = ddsi_shmring_conn_read;
+  conn->m_base.m_write_fn = ddsi_shmring_conn_write;
+  conn->m_base.m_disable_multiplexing_fn = ddsi_shmring_disable_multiplexing;
+  if (conn->m_hdr)
+    conn->m_base.m_read_pending_fn = ddsi_shmring_conn_read_pending;
+
+  GVTRACE ("ddsi_shmring_create_conn %s port %"PRIu32"%s%s\n", mcast ? "multicast" : "unicast", port, conn->m_name ? " ring " : "", conn->m_name ? conn->m_name : "");
+  *conn_out = &conn->m_base;
+  return DDS_RETCODE_OK;
+}
+
+static void ddsi_shmring_release_conn (ddsi_tran_conn_t conn_cmn)
+{
+  ddsi_shmring_conn_t conn = (ddsi_shmring_conn_t) conn_cmn;
+  DDS_CTRACE (&conn_cmn->m_base.gv->logconfig, "ddsi_shmring_release_conn %s port %"PRIu32"\n",
+              conn_cmn->m_base.m_multicast ? "multicast" : "unicast", conn_cmn->m_base.m_port);
+  if (conn->m_hdr)
+  {
+    char path[128], dbpath[128];
+    /* unlinking first means a new owner can't be affected by the flag */
+    ddsi_shmring_paths (path, sizeof (path), dbpath, sizeof (dbpath), conn->m_name);
+    ddsi_shmring_remove_files (path, dbpath);
+    ddsrt_atomic_st32 (&conn->m_hdr->closed, 1);
+    close (conn->m_dbfd);
+    munmap (conn->m_hdr, conn->m_size);
+    ddsrt_free (conn->m_name);
+  }
+  ddsrt_free (conn);
+}
+
+static int ddsi_shmring_join_mc (ddsi_tran_conn_t conn, const ddsi_locator_t *srcloc, const ddsi_locator_t *mcloc, const struct nn_interface *interf)
+{
+  /* the ring of a multicast connection is the membership */
+  (void) conn; (void) srcloc; (void) mcloc; (void) interf;
+  return 0;
+}
+
+static int ddsi_shmring_leave_mc (ddsi_tran_conn_t conn, const ddsi_locator_t *srcloc, const ddsi_locator_t *mcloc, const struct nn_interface *interf)
+{
+  (void) conn; (void) srcloc; (void) mcloc; (void) interf;
+  return 0;
+}
+
+static int ddsi_shmring_is_loopbackaddr (const struct ddsi_tran_factory *tran, const ddsi_locator_t *loc)
+{
+  (void) tran;
+  (void) loc;
+  return 0;
+}
+
+static int ddsi_shmring_is_mcaddr (const struct ddsi_tran_factory *tran, const ddsi_locator_t *loc)
+{
+  (void) tran;
+  assert (loc->kind == NN_LOCATOR_KIND_SHMRING);
+  return ddsi_shmring_is_broadcast (loc);
+}
+
+static int ddsi_shmring_is_ssm_mcaddr (const struct ddsi_tran_factory *tran, const ddsi_locator_t *loc)
+{
+  (void) tran;
+  (void) loc;
+  return 0;
+}
+
+static enum ddsi_nearby_address_result ddsi_shmring_is_nearby_address (const ddsi_locator_t *loc, size_t ninterf, const struct nn_interface interf[], size_t *interf_idx)
+{
+  *interf_idx = 0;
+  if (ninterf > 0 && memcmp (loc->address, interf[0].loc.address, sizeof (loc->address)) == 0)
+    return DNAR_LOCAL;
+  return DNAR_DISTANT;
+}
+
+static char *ddsi_shmring_to_string (char *dst, size_t sizeof_dst, const ddsi_locator_t *loc, ddsi_tran_conn_t conn, int with_port)
+{
+  int pos;
+  (void) conn;
+  if (ddsi_shmring_is_broadcast (loc))
+    pos = snprintf (dst, sizeof_dst, "all");
+  else
+    pos = snprintf (dst, sizeof_dst, "%08"PRIx32, ddsi_shmring_hostid (loc));
+  if (with_port && pos >= 0 && (size_t) pos < sizeof_dst)
+    (void) snprintf (dst + pos, sizeof_dst - (size_t) pos, ":%"PRIu32, loc->port);
+  return dst;
+}
+
+static enum ddsi_locator_from_string_result ddsi_shmring_address_from_string (const struct ddsi_tran_factory *tran, ddsi_locator_t *loc, const char *str)
+{
+  const struct ddsi_shmring_tran_factory *fact = (const struct ddsi_shmring_tran_factory *) tran;
+  const char *sep = strrchr (str, ':');
+  const size_t addrlen = sep ? (size_t) (sep - str) : strlen (str);
+  uint32_t port = NN_LOCATOR_PORT_INVALID;
+  if (sep)
+  {
+    unsigned long p;
+    char *end;
+    p = strtoul (sep + 1, &end, 10);
+    if (*(sep + 1) == 0 || *end != 0 || p == 0 || p > 65535)
+      return AFSR_INVALID;
+    port = (uint32_t) p;
+  }
+  if (addrlen == 3 && strncmp (str, "all", 3) == 0)
+  {
+    loc->kind = NN_LOCATOR_KIND_SHMRING;
+    loc->port = port;
+    memset (loc->address, 0xff, sizeof (loc->address));
+  }
+  else if (addrlen == 9 && strncmp (str, "localhost", 9) == 0)
+  {
+    ddsi_shmring_set_locator (fact, loc, port);
+  }
+  else
+  {
+    unsigned hostid;
+    int n;
+    if (addrlen != 8 || sscanf (str, "%8x%n", &hostid, &n) != 1 || n != 8)
+      return AFSR_INVALID;
+    ddsi_shmring_set_locator (fact, loc, port);
+    loc->address[12] = (unsigned char) (hostid >> 24);
+    loc->address[13] = (unsigned char) (hostid >> 16);
+    loc->address[14] = (unsigned char) (hostid >> 8);
+    loc->address[15] = (unsigned char) hostid;
+  }
+  return AFSR_OK;
+}
+
+static int ddsi_shmring_enumerate_interfaces (ddsi_tran_factory_t fact, enum ddsi_transport_selector transport_selector, ddsrt_ifaddrs_t **ifs)
+{
+  /* There is only the host itself, presented as an interface with a dummy
+     address that ddsi_shmring_locator_from_sockaddr maps to the host id */
+  struct sockaddr_in *addr = ddsrt_malloc (sizeof (*addr));
+  ddsrt_ifaddrs_t *ifa = ddsrt_malloc (sizeof (*ifa));
+  (void) fact;
+  (void) transport_selector;
+  memset (addr, 0, sizeof (*addr));
+  addr->sin_family = AF_INET;
+  addr->sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  memset (ifa, 0, sizeof (*ifa));
+  ifa->name = ddsrt_strdup ("shmring");
+  ifa->flags = IFF_UP | IFF_MULTICAST;
+  ifa->type = DDSRT_IFTYPE_UNKNOWN;
+  ifa->addr = (struct sockaddr *) addr;
+  *ifs = ifa;
+  return 0;
+}
+
+static int ddsi_shmring_is_valid_port (const struct ddsi_tran_factory *fact, uint32_t port)
+{
+  /* 0 means a dynamically allocated port, like for UDP */
+  (void) fact;
+  return (port <= 65535);
+}
+
+static uint32_t ddsi_shmring_receive_buffer_size (const struct ddsi_tran_factory *fact)
+{
+  (void) fact;
+  return 0;
+}
+
+static int ddsi_shmring_locator_from_sockaddr (const struct ddsi_tran_factory *tran, ddsi_locator_t *loc, const struct sockaddr *sockaddr)
+{
+  if (sockaddr->sa_family != AF_INET)
+    return -1;
+  ddsi_shmring_set_locator ((const struct ddsi_shmring_tran_factory *) tran, loc, NN_LOCATOR_PORT_INVALID);
+  return 0;
+}
+
+static void ddsi_shmring_free_peer (void *vpeer, void *varg)
+{
+  struct ddsi_shmring_peer *peer = vpeer;
+  (void) varg;
+  ddsi_shmring_unmap (peer);
+  ddsrt_free (peer);
+}
+
+static void ddsi_shmring_free_group (void *vgroup, void *varg)
+{
+  struct ddsi_shmring_group *group = vgroup;
+  struct ddsi_shmring_peer *peer;
+  (void) varg;
+  while ((peer = group->members) != NULL)
+  {
+    group->members = peer->next;
+    ddsi_shmring_free_peer (peer, NULL);
+  }
+  ddsrt_free (group);
+}
+
+static void ddsi_shmring_deinit (ddsi_tran_factory_t fact_cmn)
+{
+  ddsi_shmring_tran_factory_t fact = (ddsi_shmring_tran_factory_t) fact_cmn;
+  struct ddsi_shmring_peer *peer;
+  DDS_CLOG (DDS_LC_CONFIG, &fact_cmn->gv->logconfig, "shmring de-initialized\n");
+  ddsrt_hh_enum (fact->m_peers, ddsi_shmring_free_peer, NULL);
+  ddsrt_hh_free (fact->m_peers);
+  ddsrt_hh_enum (fact->m_groups, ddsi_shmring_free_group, NULL);
+  ddsrt_hh_free (fact->m_groups);
+  while ((peer = fact->m_retired) != NULL)
+  {
+    fact->m_retired = peer->next;
+    ddsi_shmring_free_peer (peer, NULL);
+  }
+  ddsrt_mutex_destroy (&fact->m_lock);
+  ddsrt_free (fact);
+}
+
+static uint32_t ddsi_shmring_own_hostid (void)
+{
+  /* The boot id distinguishes hosts (and reboots), gethostid is a fallback
+     that is often derived from the IP address */
+  char buf[64];
+  size_t n = 0;
+  FILE *fp;
+  if ((fp = fopen ("/proc/sys/kernel/random/boot_id", "r")) != NULL)
+  {
+    n = fread (buf, 1, sizeof (buf), fp);
+    fclose (fp);
+  }
+  return (n > 0) ? ddsrt_mh3 (buf, n, 0) : (uint32_t) gethostid ();
+}
+
+int ddsi_shmring_init (struct ddsi_domaingv *gv)
+{
+  struct ddsi_shmring_tran_factory *fact = ddsrt_malloc (sizeof (*fact));
+  memset (fact, 0, sizeof (*fact));
+  fact->m_hostid = ddsi_shmring_own_hostid ();
+  fact->m_nslots = ddsi_msgring_nslots (gv->config.shmring_size, DDSI_SHMRING_SLOT_SIZE);
+  ddsrt_atomic_st32 (&fact->m_mc_serial, 0);
+  ddsrt_mutex_init (&fact->m_lock);
+  fact->m_peers = ddsrt_hh_new (1, ddsi_shmring_peer_hash, ddsi_shmring_peer_equal);
+  fact->m_groups = ddsrt_hh_new (1, ddsi_shmring_group_hash, ddsi_shmring_group_equal);
+  fact->m_retired = NULL;
+  fact->m_base.gv = gv;
+  fact->m_base.m_free_fn = ddsi_shmring_deinit;
+  fact->m_base.m_typename = "shmring";
+  fact->m_base.m_default_spdp_address = "shmring/all";
+  fact->m_base.m_connless = 1;
+  fact->m_base.m_enable_spdp = 1;
+  fact->m_base.m_supports_fn = ddsi_shmring_supports;
+  fact->m_base.m_create_conn_fn = ddsi_shmring_create_conn;
+  fact->m_base.m_release_conn_fn = ddsi_shmring_release_conn;
+  fact->m_base.m_join_mc_fn = ddsi_shmring_join_mc;
+  fact->m_base.m_leave_mc_fn = ddsi_shmring_leave_mc;
+  fact->m_base.m_is_loopbackaddr_fn = ddsi_shmring_is_loopbackaddr;
+  fact->m_base.m_is_mcaddr_fn = ddsi_shmring_is_mcaddr;
+  fact->m_base.m_is_ssm_mcaddr_fn = ddsi_shmring_is_ssm_mcaddr;
+  fact->m_base.m_is_nearby_address_fn = ddsi_shmring_is_nearby_address;
+  fact->m_base.m_locator_from_string_fn = ddsi_shmring_address_from_string;
+  fact->m_base.m_locator_to_string_fn = ddsi_shmring_to_string;
+  fact->m_base.m_enumerate_interfaces_fn = ddsi_shmring_enumerate_interfaces;
+  fact->m_base.m_is_valid_port_fn = ddsi_shmring_is_valid_port;
+  fact->m_base.m_receive_buffer_size_fn = ddsi_shmring_receive_buffer_size;
+  fact->m_base.m_locator_from_sockaddr_fn = ddsi_shmring_locator_from_sockaddr;
+  ddsi_factory_add (gv, &fact->m_base);
+  GVLOG (DDS_LC_CONFIG, "shmring initialized: host id %08"PRIx32", %"PRIu32" slots of %u bytes per ring\n", fact->m_hostid, fact->m_nslots, DDSI_SHMRING_SLOT_SIZE);
+  return 0;
+}
+
+#else
+
+int ddsi_shmring_init (struct ddsi_domaingv *gv)
+{
+  GVERROR ("shmring transport is not supported on this platform\n");
+  return -1;
+}
+
+#endif /* defined __linux */
@@ -11,12 +11,64 @@
  */
 #include <string.h>
 #include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/time.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_entity_index.h"
 #include "dds/ddsi/ddsi_statistics.h"
 #include "dds/ddsi/q_entity.h"
 #include "dds/ddsi/q_radmin.h"
 
+void ddsi_latency_stats_init (struct ddsi_latency_stats *st)
+{
+  for (int i = 0; i < DDSI_LATENCY_NSTAGES; i++)
+    for (int j = 0; j < DDSI_LATENCY_NBUCKETS; j++)
+      ddsrt_atomic_st32 (&st->hist[i][j], 0);
+}
+
+uint32_t ddsi_latency_bucket (int64_t latency)
+{
+  static const int64_t limits[DDSI_LATENCY_NBUCKETS - 1] = {
+    DDS_USECS (1), DDS_USECS (4), DDS_USECS (16), DDS_USECS (64), DDS_USECS (256),
+    DDS_MSECS (1), DDS_MSECS (4), DDS_MSECS (16), DDS_MSECS (64)
+  };
+  uint32_t b = 0;
+  while (b < DDSI_LATENCY_NBUCKETS - 1 && latency >= limits[b])
+    b++;
+  return b;
+}
+
+void ddsi_latency_stats_add (struct ddsi_latency_stats *st, enum ddsi_latency_stage stage, int64_t latency)
+{
+  ddsrt_atomic_inc32 (&st->hist[stage][ddsi_latency_bucket (latency)]);
+}
+
+void ddsi_get_reader_latency_stats (struct reader *rd, uint32_t * __restrict counts)
+{
+  for (int i = 0; i < DDSI_LATENCY_NSTAGES; i++)
+    for (int j = 0; j < DDSI_LATENCY_NBUCKETS; j++)
+      counts[i * DDSI_LATENCY_NBUCKETS + j] = ddsrt_atomic_ld32 (&rd->latency_stats.hist[i][j]);
+}
+
+uint32_t ddsi_get_dqueue_shard_count (const struct ddsi_domaingv *gv)
+{
+#ifdef DDS_HAS_NETWORK_CHANNELS
+  (void) gv;
+  return 0;
+#else
+  return gv->n_user_dqueues;
+#endif
+}
+
+void ddsi_get_dqueue_shard_stats (const struct ddsi_domaingv *gv, uint32_t shard, uint32_t * __restrict depth, uint32_t * __restrict max_depth, uint32_t * __restrict latency)
+{
+  assert (shard < ddsi_get_dqueue_shard_count (gv));
+#ifdef DDS_HAS_NETWORK_CHANNELS
+  (void) gv; (void) shard; (void) depth; (void) max_depth; (void) latency;
+#else
+  nn_dqueue_get_stats (gv->user_dqueues[shard], depth, max_depth, latency);
+#endif
+}
+
 void ddsi_get_writer_stats (struct writer *wr, uint64_t * __restrict rexmit_bytes, uint32_t * __restrict throttle_count, uint64_t * __restrict time_throttled, uint64_t * __restrict time_retransmit)
 {
   ddsrt_mutex_lock (&wr->e.lock);
@@ -16,14 +16,19 @@
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/log.h"
 #include "dds/ddsrt/sockets.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/time.h"
 #include "ddsi_eth.h"
 #include "dds/ddsi/ddsi_tran.h"
 #include "dds/ddsi/ddsi_tcp.h"
 #include "dds/ddsi/ddsi_ipaddr.h"
-#include "dds/ddsrt/avl.h"
+#include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/mh3.h"
 #include "dds/ddsi/q_config.h"
 #include "dds/ddsi/q_log.h"
 #include "dds/ddsi/q_entity.h"
+#include "dds/ddsi/q_thread.h"
+#include "dds/ddsi/q_gc.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_ssl.h"
 
@@ -38,8 +43,33 @@
   is not removed from cache but simply flagged as failed (may be subsequently
   replaced). Similarly server side sockets are not closed as are also used in socket
   wait set that manages their lifecycle.
+
+  If TCP/SendQueueSize is set, whatever can't be written immediately is copied
+  into the connection's send queue and the "tcpsend" thread writes it out once
+  the socket has room again. Writers try to flush the queue before adding to it,
+  so a queue normally only builds up for a slow peer. The thread holds a
+  reference to each connection it services, m_sendq_active says whether it does.
 */
 
+/* Size of the read-ahead buffer: reads for less than this are served from it
+   and it is refilled with whatever the socket has available, larger reads
+   go directly into the caller's buffer */
+#define DDSI_TCP_READ_BUFFER_SIZE 65536
+
+/* Maximum number of queued buffers written in a single call to sendmsg */
+#define DDSI_TCP_SENDQ_MAX_IOV 64
+
+/* Bound on the time the tcpsend thread waits for sockets to become writable
+   before it looks at newly queued connections */
+#define DDSI_TCP_SENDQ_POLL_INTERVAL DDS_MSECS (10)
+
+struct ddsi_tcp_sendbuf {
+  struct ddsi_tcp_sendbuf *next;
+  size_t len;
+  size_t pos; /* number of bytes already written */
+  unsigned char data[];
+};
+
 union addr {
   struct sockaddr a;
   struct sockaddr_in a4;
@@ -57,6 +87,19 @@ typedef struct ddsi_tcp_conn {
 #ifdef DDS_HAS_SSL
   SSL * m_ssl;
 #endif
+  /* read-ahead buffer, only used by the receive thread: [m_rbuf_pos, m_rbuf_len)
+     has been read from the socket but not yet consumed; allocated on first use */
+  unsigned char *m_rbuf;
+  size_t m_rbuf_pos;
+  size_t m_rbuf_len;
+  /* send queue, protected by m_mutex */
+  struct ddsi_tcp_sendbuf *m_sendq_head;
+  struct ddsi_tcp_sendbuf *m_sendq_tail;
+  size_t m_sendq_bytes;
+  bool m_sendq_active;
+  ddsrt_mtime_t m_sendq_tprogress;
+  ddsrt_cond_t m_sendq_cond; /* signalled when queued data has been written */
+  struct ddsi_tcp_conn *m_sendq_next; /* protected by factory's m_sendq_lock */
 } *ddsi_tcp_conn_t;
 
 typedef struct ddsi_tcp_listener {
@@ -70,12 +113,19 @@ typedef struct ddsi_tcp_listener {
 struct ddsi_tran_factory_tcp {
   struct ddsi_tran_factory fact;
   int32_t m_kind;
-  ddsrt_mutex_t ddsi_tcp_cache_lock_g;
-  ddsrt_avl_tree_t ddsi_tcp_cache_g;
+  ddsrt_mutex_t ddsi_tcp_cache_lock_g; /* serializes updates of the cache, lookups are lock-free */
+  struct ddsrt_chh *ddsi_tcp_cache_g;
   struct ddsi_tcp_conn ddsi_tcp_conn_client;
 #ifdef DDS_HAS_SSL
   struct ddsi_ssl_plugins ddsi_tcp_ssl_plugin;
 #endif
+  /* tcpsend thread, NULL if writes are synchronous; m_sendq_lock protects the
+     list of connections handed over to it and m_sendq_stop */
+  struct thread_state1 *m_sendq_ts;
+  ddsrt_mutex_t m_sendq_lock;
+  ddsrt_cond_t m_sendq_cond;
+  struct ddsi_tcp_conn *m_sendq_new;
+  bool m_sendq_stop;
 };
 
 static int ddsi_tcp_cmp_conn (const struct ddsi_tcp_conn *c1, const struct ddsi_tcp_conn *c2)
@@ -89,23 +139,26 @@ static int ddsi_tcp_cmp_conn (const struct ddsi_tcp_conn *c1, const struct ddsi_
   return ddsi_ipaddr_compare (a1s, a2s);
 }
 
-static int ddsi_tcp_cmp_conn_wrap (const void *a, const void *b)
+static int ddsi_tcp_equal_conn_wrap (const void *a, const void *b)
 {
-  return ddsi_tcp_cmp_conn (a, b);
+  return ddsi_tcp_cmp_conn (a, b) == 0;
 }
 
-typedef struct ddsi_tcp_node {
-  ddsrt_avl_node_t m_avlnode;
-  ddsi_tcp_conn_t m_conn;
-} * ddsi_tcp_node_t;
-
-static const ddsrt_avl_treedef_t ddsi_tcp_treedef = DDSRT_AVL_TREEDEF_INITIALIZER_INDKEY
-(
-  offsetof (struct ddsi_tcp_node, m_avlnode),
-  offsetof (struct ddsi_tcp_node, m_conn),
-  ddsi_tcp_cmp_conn_wrap,
-  0
-);
+static uint32_t ddsi_tcp_hash_conn_wrap (const void *a)
+{
+  const struct ddsi_tcp_conn *c = a;
+  switch (c->m_peer_addr.a.sa_family)
+  {
+    case AF_INET:
+      return ddsrt_mh3 (&c->m_peer_addr.a4.sin_addr, sizeof (c->m_peer_addr.a4.sin_addr), c->m_peer_port);
+#if DDSRT_HAVE_IPV6
+    case AF_INET6:
+      return ddsrt_mh3 (&c->m_peer_addr.a6.sin6_addr, sizeof (c->m_peer_addr.a6.sin6_addr), c->m_peer_port);
+#endif
+    default:
+      return c->m_peer_port;
+  }
+}
 
 static ddsi_tcp_conn_t ddsi_tcp_new_conn (struct ddsi_tran_factory_tcp *fact, const struct nn_interface *interf, ddsrt_socket_t, bool, struct sockaddr *);
 
@@ -117,31 +170,6 @@ static char *sockaddr_to_string_with_port (char *dst, size_t sizeof_dst, const s
   return dst;
 }
 
-/* Connection cache dump routine for debugging
-
-static void ddsi_tcp_cache_dump (void)
-{
-  char buff[64];
-  ddsrt_avl_iter_t iter;
-  ddsi_tcp_node_t n;
-  unsigned i = 0;
-
-  n = ddsrt_avl_iter_first (&ddsi_tcp_treedef, &ddsi_tcp_cache_g, &iter);
-  while (n)
-  {
-    os_sockaddrAddressPortToString ((const os_sockaddr *) &n->m_conn->m_peer_addr, buff, sizeof (buff));
-    DDS_TRACE
-    (
-      DDS_LC_TCP,
-      "%s cache #%d: %s sock %d port %u peer %s\n",
-      ddsi_name, i++, n->m_conn->m_base.m_server ? "server" : "client",
-      n->m_conn->m_sock, n->m_conn->m_base.m_base.m_port, buff
-    );
-    n = ddsrt_avl_iter_next (&iter);
-  }
-}
-*/
-
 static uint16_t get_socket_port (struct ddsi_domaingv const * const gv, ddsrt_socket_t socket)
 {
   union addr addr;
@@ -241,11 +269,47 @@ fail:
   return rc;
 }
 
-static void ddsi_tcp_node_free (void * ptr)
+/* Lookups in the cache are lock-free, a thread doing a lookup is awake while
+   it does so and takes a reference before it goes to sleep again.  Removing a
+   connection from the cache and freeing old hash buckets is therefore deferred
+   via the garbage collector, unless that has already been shut down, at which
+   point only the thread tearing down the domain uses the cache. */
+
+static void ddsi_tcp_gc_conn_cb (struct gcreq *gcreq)
+{
+  ddsi_conn_free (gcreq->arg);
+  gcreq_free (gcreq);
+}
+
+static void ddsi_tcp_gc_conn (struct ddsi_domaingv *gv, ddsi_tcp_conn_t conn)
 {
-  ddsi_tcp_node_t node = (ddsi_tcp_node_t) ptr;
-  ddsi_conn_free ((ddsi_tran_conn_t) node->m_conn);
-  ddsrt_free (node);
+  if (gv->gcreq_queue == NULL)
+    ddsi_conn_free (&conn->m_base);
+  else
+  {
+    struct gcreq *gcreq = gcreq_new (gv->gcreq_queue, ddsi_tcp_gc_conn_cb);
+    gcreq->arg = conn;
+    gcreq_enqueue (gcreq);
+  }
+}
+
+static void ddsi_tcp_gc_buckets_cb (struct gcreq *gcreq)
+{
+  ddsrt_free (gcreq->arg);
+  gcreq_free (gcreq);
+}
+
+static void ddsi_tcp_gc_buckets (void *bs, void *varg)
+{
+  struct ddsi_domaingv *gv = varg;
+  if (gv->gcreq_queue == NULL)
+    ddsrt_free (bs);
+  else
+  {
+    struct gcreq *gcreq = gcreq_new (gv->gcreq_queue, ddsi_tcp_gc_buckets_cb);
+    gcreq->arg = bs;
+    gcreq_enqueue (gcreq);
+  }
 }
 
 static void ddsi_tcp_conn_connect (ddsi_tcp_conn_t conn, const ddsrt_msghdr_t * msg)
@@ -299,40 +363,26 @@ fail_w_socket:
   ddsi_tcp_sock_free (gv, sock, NULL);
 }
 
-static void ddsi_tcp_cache_add (struct ddsi_tran_factory_tcp *fact, ddsi_tcp_conn_t conn, ddsrt_avl_ipath_t * path)
+static void ddsi_tcp_cache_add (struct ddsi_tran_factory_tcp *fact, ddsi_tcp_conn_t conn)
 {
+  /* on entry: fact->ddsi_tcp_cache_lock_g held */
   struct ddsi_domaingv * const gv = fact->fact.gv;
   const char * action = "added";
-  ddsi_tcp_node_t node;
+  ddsi_tcp_conn_t old;
   char buff[DDSI_LOCSTRLEN];
 
   ddsrt_atomic_inc32 (&conn->m_base.m_count);
 
-  /* If path set, then cache does not contain connection */
-  if (path)
+  /* Replace connection in cache: the lookups that still find the old one
+     simply fail to write; in between removing and adding, lookups fall back
+     to the slow path that needs the lock */
+  if ((old = ddsrt_chh_lookup (fact->ddsi_tcp_cache_g, conn)) != NULL)
   {
-    node = ddsrt_malloc (sizeof (*node));
-    node->m_conn = conn;
-    ddsrt_avl_insert_ipath (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, node, path);
-  }
-  else
-  {
-    node = ddsrt_avl_lookup (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, conn);
-    if (node)
-    {
-      /* Replace connection in cache */
-
-      ddsi_conn_free ((ddsi_tran_conn_t) node->m_conn);
-      node->m_conn = conn;
-      action = "updated";
-    }
-    else
-    {
-      node = ddsrt_malloc (sizeof (*node));
-      node->m_conn = conn;
-      ddsrt_avl_insert (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, node);
-    }
+    (void) ddsrt_chh_remove (fact->ddsi_tcp_cache_g, old);
+    ddsi_tcp_gc_conn (gv, old);
+    action = "updated";
   }
+  (void) ddsrt_chh_add (fact->ddsi_tcp_cache_g, conn);
 
   sockaddr_to_string_with_port(buff, sizeof(buff), &conn->m_peer_addr.a);
   GVLOG (DDS_LC_TCP, "tcp cache %s %s socket %"PRIdSOCK" to %s\n", action, conn->m_base.m_server ? "server" : "client", conn->m_sock, buff);
@@ -343,32 +393,31 @@ static void ddsi_tcp_cache_remove (ddsi_tcp_conn_t conn)
   struct ddsi_tran_factory_tcp * const fact = (struct ddsi_tran_factory_tcp *) conn->m_base.m_factory;
   struct ddsi_domaingv * const gv = fact->fact.gv;
   char buff[DDSI_LOCSTRLEN];
-  ddsi_tcp_node_t node;
-  ddsrt_avl_dpath_t path;
 
   ddsrt_mutex_lock (&fact->ddsi_tcp_cache_lock_g);
-  node = ddsrt_avl_lookup_dpath (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, conn, &path);
-  if (node)
+  if (ddsrt_chh_lookup (fact->ddsi_tcp_cache_g, conn) == conn)
   {
     sockaddr_to_string_with_port(buff, sizeof(buff), &conn->m_peer_addr.a);
     GVLOG (DDS_LC_TCP, "tcp cache removed socket %"PRIdSOCK" to %s\n", conn->m_sock, buff);
-    ddsrt_avl_delete_dpath (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, node, &path);
-    ddsi_tcp_node_free (node);
+    (void) ddsrt_chh_remove (fact->ddsi_tcp_cache_g, conn);
+    ddsi_tcp_gc_conn (gv, conn);
   }
   ddsrt_mutex_unlock (&fact->ddsi_tcp_cache_lock_g);
 }
 
+static void ddsi_tcp_conn_unref (ddsi_tcp_conn_t conn);
+
 /*
   ddsi_tcp_cache_find: Find existing connection to target, or if possible
-  create new connection.
+  create new connection. Returns a new reference to the connection.
 */
 
 static ddsi_tcp_conn_t ddsi_tcp_cache_find (struct ddsi_tran_factory_tcp *fact, const ddsrt_msghdr_t * msg)
 {
-  ddsrt_avl_ipath_t path;
-  ddsi_tcp_node_t node;
+  struct ddsi_domaingv * const gv = fact->fact.gv;
+  struct thread_state1 * const ts1 = lookup_thread_state ();
   struct ddsi_tcp_conn key;
-  ddsi_tcp_conn_t ret = NULL;
+  ddsi_tcp_conn_t ret;
 
   memset (&key, 0, sizeof (key));
   key.m_peer_port = ddsrt_sockaddr_get_port (msg->msg_name);
@@ -376,27 +425,29 @@ static ddsi_tcp_conn_t ddsi_tcp_cache_find (struct ddsi_tran_factory_tcp *fact,
 
   /* Check cache for existing connection to target */
 
+  thread_state_awake (ts1, gv);
+  if ((ret = ddsrt_chh_lookup (fact->ddsi_tcp_cache_g, &key)) != NULL && !ret->m_base.m_closed)
+    ddsi_conn_add_ref (&ret->m_base);
+  else
+    ret = NULL;
+  thread_state_asleep (ts1);
+  if (ret != NULL)
+    return ret;
+
   ddsrt_mutex_lock (&fact->ddsi_tcp_cache_lock_g);
-  node = ddsrt_avl_lookup_ipath (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, &key, &path);
-  if (node)
+  if ((ret = ddsrt_chh_lookup (fact->ddsi_tcp_cache_g, &key)) != NULL && ret->m_base.m_closed)
   {
-    if (node->m_conn->m_base.m_closed)
-    {
-      ddsrt_avl_delete (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, node);
-      ddsi_tcp_node_free (node);
-    }
-    else
-    {
-      ret = node->m_conn;
-    }
+    (void) ddsrt_chh_remove (fact->ddsi_tcp_cache_g, ret);
+    ddsi_tcp_gc_conn (gv, ret);
+    ret = NULL;
   }
   if (ret == NULL)
   {
     ret = ddsi_tcp_new_conn (fact, NULL, DDSRT_INVALID_SOCKET, false, &key.m_peer_addr.a);
-    ddsi_tcp_cache_add (fact, ret, &path);
+    ddsi_tcp_cache_add (fact, ret);
   }
+  ddsi_conn_add_ref (&ret->m_base);
   ddsrt_mutex_unlock (&fact->ddsi_tcp_cache_lock_g);
-
   return ret;
 }
 
@@ -472,28 +523,47 @@ static ssize_t ddsi_tcp_conn_read (ddsi_tran_conn_t conn, unsigned char *buf, si
   }
 #endif
 
+  if (tcp->m_rbuf == NULL)
+    tcp->m_rbuf = ddsrt_malloc (DDSI_TCP_READ_BUFFER_SIZE);
+
   while (true)
   {
-    n = rd (tcp, (char *) buf + pos, len - pos, &rc);
-    if (n > 0)
+    if (tcp->m_rbuf_pos < tcp->m_rbuf_len)
     {
-      pos += (size_t) n;
-      if (pos == len)
+      const size_t avail = tcp->m_rbuf_len - tcp->m_rbuf_pos;
+      const size_t m = (len - pos < avail) ? len - pos : avail;
+      memcpy (buf + pos, tcp->m_rbuf + tcp->m_rbuf_pos, m);
+      tcp->m_rbuf_pos += m;
+      pos += m;
+    }
+    if (pos == len)
+    {
+      if (srcloc)
       {
-        if (srcloc)
-        {
-          const int32_t kind = addrfam_to_locator_kind (tcp->m_peer_addr.a.sa_family);
-          ddsi_ipaddr_to_loc(srcloc, &tcp->m_peer_addr.a, kind);
-        }
-        return (ssize_t) pos;
+        const int32_t kind = addrfam_to_locator_kind (tcp->m_peer_addr.a.sa_family);
+        ddsi_ipaddr_to_loc(srcloc, &tcp->m_peer_addr.a, kind);
       }
+      return (ssize_t) pos;
     }
-    else if (n == 0)
+
+    /* read-ahead buffer is empty at this point */
+    if (len - pos >= DDSI_TCP_READ_BUFFER_SIZE)
+    {
+      if ((n = rd (tcp, (char *) buf + pos, len - pos, &rc)) > 0)
+        pos += (size_t) n;
+    }
+    else
+    {
+      tcp->m_rbuf_pos = tcp->m_rbuf_len = 0;
+      if ((n = rd (tcp, tcp->m_rbuf, DDSI_TCP_READ_BUFFER_SIZE, &rc)) > 0)
+        tcp->m_rbuf_len = (size_t) n;
+    }
+    if (n == 0)
     {
       GVLOG (DDS_LC_TCP, "tcp read: sock %"PRIdSOCK" closed-by-peer\n", tcp->m_sock);
       break;
     }
-    else
+    else if (n < 0)
     {
       if (rc != DDS_RETCODE_INTERRUPTED)
       {
@@ -593,6 +663,184 @@ static void set_msghdr_iov (ddsrt_msghdr_t *mhdr, ddsrt_iovec_t *iov, size_t iov
   mhdr->msg_iovlen = (ddsrt_msg_iovlen_t)iovlen;
 }
 
+static int ddsi_tcp_sendflags (void)
+{
+  int sendflags = 0;
+#ifdef MSG_NOSIGNAL
+  sendflags |= MSG_NOSIGNAL;
+#endif
+  return sendflags;
+}
+
+static void ddsi_tcp_sendq_consume (ddsi_tcp_conn_t conn, size_t n)
+{
+  /* Drops the first n bytes of queued data, waking up writers waiting for
+     space if that frees any */
+  bool freed = false;
+  while (n > 0)
+  {
+    struct ddsi_tcp_sendbuf * const b = conn->m_sendq_head;
+    const size_t m = (n < b->len - b->pos) ? n : b->len - b->pos;
+    b->pos += m;
+    n -= m;
+    if (b->pos == b->len)
+    {
+      if ((conn->m_sendq_head = b->next) == NULL)
+        conn->m_sendq_tail = NULL;
+      conn->m_sendq_bytes -= b->len;
+      ddsrt_free (b);
+      freed = true;
+    }
+  }
+  if (freed)
+    ddsrt_cond_broadcast (&conn->m_sendq_cond);
+}
+
+static void ddsi_tcp_sendq_discard (ddsi_tcp_conn_t conn)
+{
+  struct ddsi_tcp_sendbuf *b;
+  while ((b = conn->m_sendq_head) != NULL)
+  {
+    conn->m_sendq_head = b->next;
+    ddsrt_free (b);
+  }
+  conn->m_sendq_tail = NULL;
+  conn->m_sendq_bytes = 0;
+  ddsrt_cond_broadcast (&conn->m_sendq_cond);
+}
+
+static dds_return_t ddsi_tcp_sendq_flush (ddsi_tcp_conn_t conn)
+{
+  /* Writes as much of the queued data as the socket accepts without
+     blocking, coalescing queued messages into a single sendmsg call;
+     returns TRY_AGAIN if the socket is full */
+  while (conn->m_sendq_head)
+  {
+    ddsrt_iovec_t iov[DDSI_TCP_SENDQ_MAX_IOV];
+    ddsrt_msghdr_t msg;
+    size_t niov = 0;
+    dds_return_t rc;
+    ssize_t n;
+    for (struct ddsi_tcp_sendbuf *b = conn->m_sendq_head; b && niov < DDSI_TCP_SENDQ_MAX_IOV; b = b->next)
+    {
+      iov[niov].iov_base = b->data + b->pos;
+      iov[niov].iov_len = (ddsrt_iov_len_t) (b->len - b->pos);
+      niov++;
+    }
+    memset (&msg, 0, sizeof (msg));
+    set_msghdr_iov (&msg, iov, niov);
+    do {
+      rc = ddsrt_sendmsg (conn->m_sock, &msg, ddsi_tcp_sendflags (), &n);
+    } while (rc == DDS_RETCODE_INTERRUPTED);
+    if (rc != DDS_RETCODE_OK)
+      return rc;
+    else if (n <= 0)
+      return DDS_RETCODE_TRY_AGAIN;
+    conn->m_sendq_tprogress = ddsrt_time_monotonic ();
+    ddsi_tcp_sendq_consume (conn, (size_t) n);
+  }
+  return DDS_RETCODE_OK;
+}
+
+static void ddsi_tcp_sendq_append (struct ddsi_tran_factory_tcp *fact, ddsi_tcp_conn_t conn, const ddsrt_msghdr_t *msg, size_t skip, size_t len)
+{
+  /* Copies the message minus the first skip bytes (already written) into the
+     send queue and hands the connection to the tcpsend thread if it isn't
+     already servicing it */
+  struct ddsi_tcp_sendbuf *b = ddsrt_malloc (sizeof (*b) + len - skip);
+  unsigned char *ptr = b->data;
+  b->next = NULL;
+  b->len = len - skip;
+  b->pos = 0;
+  for (size_t i = 0; i < (size_t) msg->msg_iovlen; i++)
+  {
+    const size_t l = msg->msg_iov[i].iov_len;
+    if (skip >= l)
+      skip -= l;
+    else
+    {
+      memcpy (ptr, (const char *) msg->msg_iov[i].iov_base + skip, l - skip);
+      ptr += l - skip;
+      skip = 0;
+    }
+  }
+  assert (ptr == b->data + b->len);
+  if (conn->m_sendq_tail)
+    conn->m_sendq_tail->next = b;
+  else
+  {
+    conn->m_sendq_head = b;
+    conn->m_sendq_tprogress = ddsrt_time_monotonic ();
+  }
+  conn->m_sendq_tail = b;
+  conn->m_sendq_bytes += b->len;
+
+  if (!conn->m_sendq_active)
+  {
+    conn->m_sendq_active = true;
+    ddsi_conn_add_ref (&conn->m_base);
+    ddsrt_mutex_lock (&fact->m_sendq_lock);
+    conn->m_sendq_next = fact->m_sendq_new;
+    fact->m_sendq_new = conn;
+    ddsrt_cond_broadcast (&fact->m_sendq_cond);
+    ddsrt_mutex_unlock (&fact->m_sendq_lock);
+  }
+}
+
+static ssize_t ddsi_tcp_conn_write_queued (struct ddsi_tran_factory_tcp *fact, ddsi_tcp_conn_t conn, const ddsrt_msghdr_t *msg, size_t len, uint32_t flags)
+{
+  /* on entry & exit: conn->m_mutex held */
+  struct ddsi_domaingv const * const gv = fact->fact.gv;
+  dds_return_t rc = DDS_RETCODE_OK;
+  ssize_t sent = 0;
+
+  if (conn->m_sendq_head && (rc = ddsi_tcp_sendq_flush (conn)) != DDS_RETCODE_OK && rc != DDS_RETCODE_TRY_AGAIN)
+    goto fail;
+  if (conn->m_sendq_head == NULL)
+  {
+    do {
+      rc = ddsrt_sendmsg (conn->m_sock, msg, ddsi_tcp_sendflags (), &sent);
+    } while (rc == DDS_RETCODE_INTERRUPTED);
+    if (rc == DDS_RETCODE_TRY_AGAIN)
+      sent = 0;
+    else if (rc != DDS_RETCODE_OK)
+      goto fail;
+    else if ((size_t) sent == len)
+      return sent;
+  }
+  else if (conn->m_sendq_bytes + len > gv->config.tcp_send_queue_size)
+  {
+    if (flags & DDSI_TRAN_BEST_EFFORT)
+    {
+      GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" send queue full, dropping %"PRIuSIZE" bytes\n", conn->m_sock, len);
+      return (ssize_t) len;
+    }
+    const int64_t tdeadline = ddsrt_time_monotonic ().v + gv->config.tcp_write_timeout;
+    while (conn->m_sendq_head && conn->m_sendq_bytes + len > gv->config.tcp_send_queue_size)
+    {
+      const int64_t tnow = ddsrt_time_monotonic ().v;
+      if (tnow >= tdeadline)
+      {
+        GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" send queue full for longer than WriteTimeout\n", conn->m_sock);
+        return -1;
+      }
+      (void) ddsrt_cond_waitfor (&conn->m_sendq_cond, &conn->m_mutex, tdeadline - tnow);
+    }
+    if (conn->m_base.m_closed)
+      return -1;
+  }
+  ddsi_tcp_sendq_append (fact, conn, msg, (size_t) sent, len);
+  return (ssize_t) len;
+
+fail:
+  if (rc == DDS_RETCODE_NO_CONNECTION || rc == DDS_RETCODE_ILLEGAL_OPERATION)
+    GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" DDS_RETCODE_NO_CONNECTION\n", conn->m_sock);
+  else if (! conn->m_base.m_closed)
+    GVWARNING ("tcp write failed on socket %"PRIdSOCK" with errno %"PRId32"\n", conn->m_sock, rc);
+  ddsi_tcp_sendq_discard (conn);
+  return -1;
+}
+
 static ssize_t ddsi_tcp_conn_write (ddsi_tran_conn_t base, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
 {
   struct ddsi_tran_factory_tcp * const fact = (struct ddsi_tran_factory_tcp *) base->m_factory;
@@ -640,6 +888,7 @@ static ssize_t ddsi_tcp_conn_write (ddsi_tran_conn_t base, const ddsi_locator_t
     if (conn->m_sock == DDSRT_INVALID_SOCKET)
     {
       ddsrt_mutex_unlock (&conn->m_mutex);
+      ddsi_tcp_conn_unref (conn);
       return -1;
     }
     connect = true;
@@ -651,11 +900,19 @@ static ssize_t ddsi_tcp_conn_write (ddsi_tran_conn_t base, const ddsi_locator_t
   {
     GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" message filtered\n", conn->m_sock);
     ddsrt_mutex_unlock (&conn->m_mutex);
+    ddsi_tcp_conn_unref (conn);
     return (ssize_t) len;
   }
 
+  if (fact->m_sendq_ts)
+  {
+    msg.msg_name = NULL;
+    msg.msg_namelen = 0;
+    ret = ddsi_tcp_conn_write_queued (fact, conn, &msg, len, flags);
+    piecewise = 0;
+  }
 #ifdef DDS_HAS_SSL
-  if (gv->config.ssl_enable)
+  else if (gv->config.ssl_enable)
   {
     /* SSL doesn't have sendmsg, ret = 0 so writing starts at first byte.
        Rumor is that it is much better to merge small writes, which do here
@@ -679,8 +936,8 @@ static ssize_t ddsi_tcp_conn_write (ddsi_tran_conn_t base, const ddsi_locator_t
     piecewise = 1;
     ret = 0;
   }
-  else
 #endif
+  else
   {
     int sendflags = 0;
     dds_return_t rc;
@@ -767,10 +1024,17 @@ static ssize_t ddsi_tcp_conn_write (ddsi_tran_conn_t base, const ddsi_locator_t
   {
     ddsi_tcp_cache_remove (conn);
   }
+  ddsi_tcp_conn_unref (conn);
 
   return ((size_t) ret == len) ? ret : -1;
 }
 
+static bool ddsi_tcp_conn_read_pending (ddsi_tran_conn_t conn)
+{
+  ddsi_tcp_conn_t tcp = (ddsi_tcp_conn_t) conn;
+  return tcp->m_rbuf_pos < tcp->m_rbuf_len;
+}
+
 static ddsrt_socket_t ddsi_tcp_conn_handle (ddsi_tran_base_t base)
 {
   return ((ddsi_tcp_conn_t) base)->m_sock;
@@ -885,7 +1149,7 @@ static ddsi_tran_conn_t ddsi_tcp_accept (ddsi_tran_listener_t listener)
     /* Add connection to cache for bi-dir */
 
     ddsrt_mutex_lock (&fact->ddsi_tcp_cache_lock_g);
-    ddsi_tcp_cache_add (fact, tcp, NULL);
+    ddsi_tcp_cache_add (fact, tcp);
     ddsrt_mutex_unlock (&fact->ddsi_tcp_cache_lock_g);
   }
   return tcp ? &tcp->m_base : NULL;
@@ -924,6 +1188,7 @@ static void ddsi_tcp_base_init (const struct ddsi_tran_factory_tcp *fact, const
   base->m_base.m_trantype = DDSI_TRAN_CONN;
   base->m_base.m_handle_fn = ddsi_tcp_conn_handle;
   base->m_read_fn = ddsi_tcp_conn_read;
+  base->m_read_pending_fn = ddsi_tcp_conn_read_pending;
   base->m_write_fn = ddsi_tcp_conn_write;
   base->m_peer_locator_fn = ddsi_tcp_conn_peer_locator;
   base->m_disable_multiplexing_fn = 0;
@@ -937,6 +1202,7 @@ static ddsi_tcp_conn_t ddsi_tcp_new_conn (struct ddsi_tran_factory_tcp *fact, co
   memset (conn, 0, sizeof (*conn));
   ddsi_tcp_base_init (fact, interf, &conn->m_base);
   ddsrt_mutex_init (&conn->m_mutex);
+  ddsrt_cond_init (&conn->m_sendq_cond);
   conn->m_sock = DDSRT_INVALID_SOCKET;
   (void)memcpy(&conn->m_peer_addr, peer, ddsrt_sockaddr_get_size(peer));
   conn->m_peer_port = ddsrt_sockaddr_get_port (peer);
@@ -1006,10 +1272,129 @@ static void ddsi_tcp_conn_delete (ddsi_tcp_conn_t conn)
   {
     ddsi_tcp_sock_free (gv, conn->m_sock, "connection");
   }
+  ddsi_tcp_sendq_discard (conn);
+  ddsrt_free (conn->m_rbuf);
+  ddsrt_cond_destroy (&conn->m_sendq_cond);
   ddsrt_mutex_destroy (&conn->m_mutex);
   ddsrt_free (conn);
 }
 
+static void ddsi_tcp_conn_unref (ddsi_tcp_conn_t conn)
+{
+  /* Drops the reference held by the tcpsend thread without closing the connection */
+  if (ddsrt_atomic_dec32_ov (&conn->m_base.m_count) == 1)
+    ddsi_tcp_conn_delete (conn);
+}
+
+static bool ddsi_tcp_sendq_service1 (struct ddsi_tran_factory_tcp *fact, ddsi_tcp_conn_t conn, ddsrt_mtime_t tnow)
+{
+  /* Returns true if the connection still has data queued, false if the
+     tcpsend thread no longer services it */
+  struct ddsi_domaingv * const gv = fact->fact.gv;
+  dds_return_t rc = DDS_RETCODE_OK;
+  bool failed = false, active;
+
+  ddsrt_mutex_lock (&conn->m_mutex);
+  if (conn->m_sendq_head && (rc = ddsi_tcp_sendq_flush (conn)) != DDS_RETCODE_OK)
+  {
+    if (rc != DDS_RETCODE_TRY_AGAIN)
+    {
+      GVLOG (DDS_LC_TCP, "tcpsend: sock %"PRIdSOCK" error %"PRId32"\n", conn->m_sock, rc);
+      failed = true;
+    }
+    else if (tnow.v - conn->m_sendq_tprogress.v > gv->config.tcp_write_timeout)
+    {
+      GVLOG (DDS_LC_TCP, "tcpsend: sock %"PRIdSOCK" no progress for longer than WriteTimeout\n", conn->m_sock);
+      failed = true;
+    }
+    if (failed)
+      ddsi_tcp_sendq_discard (conn);
+  }
+  if (!(active = (conn->m_sendq_head != NULL)))
+    conn->m_sendq_active = false;
+  ddsrt_mutex_unlock (&conn->m_mutex);
+
+  /* Shutting down the socket makes the receive thread and any subsequent
+     write remove the connection from the cache */
+  if (failed)
+    (void) shutdown (conn->m_sock, 2);
+  if (!active)
+    ddsi_tcp_conn_unref (conn);
+  return active;
+}
+
+static uint32_t ddsi_tcp_sendq_thread (void *vfact)
+{
+  struct ddsi_tran_factory_tcp * const fact = vfact;
+  ddsi_tcp_conn_t *conns = NULL;
+  size_t nconns = 0, maxconns = 0;
+
+  ddsrt_mutex_lock (&fact->m_sendq_lock);
+  while (!fact->m_sendq_stop)
+  {
+    while (fact->m_sendq_new)
+    {
+      if (nconns == maxconns)
+      {
+        maxconns = maxconns ? 2 * maxconns : 8;
+        conns = ddsrt_realloc (conns, maxconns * sizeof (*conns));
+      }
+      conns[nconns++] = fact->m_sendq_new;
+      fact->m_sendq_new = fact->m_sendq_new->m_sendq_next;
+    }
+    if (nconns == 0)
+    {
+      ddsrt_cond_wait (&fact->m_sendq_cond, &fact->m_sendq_lock);
+      continue;
+    }
+    ddsrt_mutex_unlock (&fact->m_sendq_lock);
+
+    /* Write whatever the sockets accept, then wait for any of the remaining
+       ones to become writable; connections handed over in the meantime get
+       picked up after at most DDSI_TCP_SENDQ_POLL_INTERVAL, but their writers
+       try to flush the queue as well */
+    const ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+    ddsrt_socket_t maxsock = 0;
+    fd_set wrset;
+    FD_ZERO (&wrset);
+    for (size_t i = 0; i < nconns; )
+    {
+      if (!ddsi_tcp_sendq_service1 (fact, conns[i], tnow))
+        conns[i] = conns[--nconns];
+      else
+      {
+#if LWIP_SOCKET == 1
+        DDSRT_WARNING_GNUC_OFF(sign-conversion)
+#endif
+        FD_SET (conns[i]->m_sock, &wrset);
+#if LWIP_SOCKET == 1
+        DDSRT_WARNING_GNUC_ON(sign-conversion)
+#endif
+        if (conns[i]->m_sock > maxsock)
+          maxsock = conns[i]->m_sock;
+        i++;
+      }
+    }
+    if (nconns > 0)
+    {
+      int32_t ready;
+      (void) ddsrt_select (maxsock + 1, NULL, &wrset, NULL, DDSI_TCP_SENDQ_POLL_INTERVAL, &ready);
+    }
+    ddsrt_mutex_lock (&fact->m_sendq_lock);
+  }
+  while (fact->m_sendq_new)
+  {
+    ddsi_tcp_conn_t conn = fact->m_sendq_new;
+    fact->m_sendq_new = conn->m_sendq_next;
+    ddsi_tcp_conn_unref (conn);
+  }
+  ddsrt_mutex_unlock (&fact->m_sendq_lock);
+  for (size_t i = 0; i < nconns; i++)
+    ddsi_tcp_conn_unref (conns[i]);
+  ddsrt_free (conns);
+  return 0;
+}
+
 static void ddsi_tcp_close_conn (ddsi_tran_conn_t tc)
 {
   struct ddsi_tran_factory_tcp * const fact_tcp = (struct ddsi_tran_factory_tcp *) tc->m_factory;
@@ -1102,11 +1487,28 @@ static void ddsi_tcp_release_listener (ddsi_tran_listener_t listener)
   ddsrt_free (tl);
 }
 
+static void ddsi_tcp_cache_free_conn (void *vconn, void *varg)
+{
+  (void) varg;
+  ddsi_conn_free (vconn);
+}
+
 static void ddsi_tcp_release_factory (struct ddsi_tran_factory *fact_cmn)
 {
   struct ddsi_tran_factory_tcp * const fact = (struct ddsi_tran_factory_tcp *) fact_cmn;
   struct ddsi_domaingv const * const gv = fact->fact.gv;
-  ddsrt_avl_free (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, ddsi_tcp_node_free);
+  if (fact->m_sendq_ts)
+  {
+    ddsrt_mutex_lock (&fact->m_sendq_lock);
+    fact->m_sendq_stop = true;
+    ddsrt_cond_broadcast (&fact->m_sendq_cond);
+    ddsrt_mutex_unlock (&fact->m_sendq_lock);
+    join_thread (fact->m_sendq_ts);
+  }
+  ddsrt_cond_destroy (&fact->m_sendq_cond);
+  ddsrt_mutex_destroy (&fact->m_sendq_lock);
+  ddsrt_chh_enum_unsafe (fact->ddsi_tcp_cache_g, ddsi_tcp_cache_free_conn, NULL);
+  ddsrt_chh_free (fact->ddsi_tcp_cache_g);
   ddsrt_mutex_destroy (&fact->ddsi_tcp_cache_lock_g);
 #ifdef DDS_HAS_SSL
   if (fact->ddsi_tcp_ssl_plugin.fini)
@@ -1255,8 +1657,24 @@ int ddsi_tcp_init (struct ddsi_domaingv *gv)
   }
 #endif
 
-  ddsrt_avl_init (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g);
+  fact->ddsi_tcp_cache_g = ddsrt_chh_new (32, ddsi_tcp_hash_conn_wrap, ddsi_tcp_equal_conn_wrap, ddsi_tcp_gc_buckets, gv);
   ddsrt_mutex_init (&fact->ddsi_tcp_cache_lock_g);
+  ddsrt_mutex_init (&fact->m_sendq_lock);
+  ddsrt_cond_init (&fact->m_sendq_cond);
+
+  if (gv->config.tcp_send_queue_size > 0
+#ifdef DDS_HAS_SSL
+      && !gv->config.ssl_enable
+#endif
+      )
+  {
+    if (create_thread (&fact->m_sendq_ts, gv, "tcpsend", ddsi_tcp_sendq_thread, fact) != DDS_RETCODE_OK)
+    {
+      GVERROR ("failed to create TCP send thread\n");
+      return -1;
+    }
+    GVLOG (DDS_LC_CONFIG, "tcp send queue size %"PRIu32"\n", gv->config.tcp_send_queue_size);
+  }
 
   GVLOG (DDS_LC_CONFIG, "tcp initialized\n");
   return 0;
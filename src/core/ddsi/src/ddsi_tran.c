@@ -37,7 +37,21 @@ extern inline int ddsi_listener_locator (ddsi_tran_listener_t listener, ddsi_loc
 extern inline int ddsi_listener_listen (ddsi_tran_listener_t listener);
 extern inline ddsi_tran_conn_t ddsi_listener_accept (ddsi_tran_listener_t listener);
 extern inline ssize_t ddsi_conn_read (ddsi_tran_conn_t conn, unsigned char * buf, size_t len, bool allow_spurious, ddsi_locator_t *srcloc);
+extern inline bool ddsi_conn_read_pending (ddsi_tran_conn_t conn);
+extern inline bool ddsi_conn_supports_read_multi (const struct ddsi_tran_conn *conn);
+extern inline int ddsi_conn_read_multi (ddsi_tran_conn_t conn, size_t nbufs, struct ddsi_tran_readbuf *bufs);
+extern inline bool ddsi_conn_supports_posted_read (const struct ddsi_tran_conn *conn);
+extern inline dds_return_t ddsi_conn_post_readbuf (ddsi_tran_conn_t conn, uint32_t id, unsigned char *buf, size_t len);
+extern inline int ddsi_conn_read_posted (ddsi_tran_conn_t conn, size_t nbufs, struct ddsi_tran_readbuf *bufs);
+extern inline void ddsi_conn_cancel_posted (ddsi_tran_conn_t conn);
 extern inline ssize_t ddsi_conn_write (ddsi_tran_conn_t conn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags);
+extern inline bool ddsi_conn_supports_write_gso (const struct ddsi_tran_conn *conn);
+extern inline ssize_t ddsi_conn_write_gso (ddsi_tran_conn_t conn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t segsize, uint32_t flags);
+extern inline bool ddsi_conn_supports_write_zerocopy (const struct ddsi_tran_conn *conn);
+extern inline ssize_t ddsi_conn_write_zerocopy (ddsi_tran_conn_t conn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags, uint32_t *seq);
+extern inline bool ddsi_conn_zerocopy_done (ddsi_tran_conn_t conn, uint32_t seq, bool wait);
+extern inline bool ddsi_conn_supports_write_multi (const struct ddsi_tran_conn *conn);
+extern inline int ddsi_conn_write_multi (ddsi_tran_conn_t conn, size_t ndst, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags);
 
 void ddsi_factory_add (struct ddsi_domaingv *gv, ddsi_tran_factory_t factory)
 {
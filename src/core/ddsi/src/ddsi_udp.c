@@ -11,6 +11,7 @@
  */
 #include <assert.h>
 #include <string.h>
+#include <errno.h>
 #include "dds/ddsrt/atomics.h"
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/log.h"
@@ -26,7 +27,30 @@
 #include "dds/ddsi/q_config.h"
 #include "dds/ddsi/q_log.h"
 #include "dds/ddsi/q_pcap.h"
+#include "dds/ddsi/q_protocol.h"
 #include "dds/ddsi/ddsi_domaingv.h"
+#include "ddsi_uring.h"
+
+#if DDSRT_HAVE_REUSEPORT
+#include <linux/filter.h>
+#endif
+#if DDSRT_HAVE_ZEROCOPY
+#include <poll.h>
+#endif
+
+/* Kernel receive timestamps are only retrieved with the batched and posted
+   reads, which are the ones used when collecting latency statistics */
+#if (DDSRT_HAVE_MMSG || DDSI_HAVE_IO_URING) && defined SO_TIMESTAMPNS
+#define DDSI_UDP_RXTIMESTAMP 1
+#else
+#define DDSI_UDP_RXTIMESTAMP 0
+#endif
+
+/* Room for the control messages (GRO segment size, receive timestamp) */
+#define DDSI_UDP_RECV_CTRL (DDSRT_HAVE_UDP_GSO || DDSI_UDP_RXTIMESTAMP)
+#if DDSI_UDP_RECV_CTRL
+#define DDSI_UDP_RECV_CTRL_SIZE (CMSG_SPACE (sizeof (int)) + CMSG_SPACE (sizeof (struct timespec)))
+#endif
 
 union addr {
   struct sockaddr_storage x;
@@ -44,6 +68,30 @@ typedef struct ddsi_udp_conn {
   WSAEVENT m_sockEvent;
 #endif
   int m_diffserv;
+#if DDSRT_HAVE_UDP_GSO
+  // segment size above which the kernel rejected segmentation offload
+  ddsrt_atomic_uint32_t m_gso_max_segsize;
+  // whether the kernel may coalesce received datagrams (UDP_GRO)
+  bool m_gro;
+#endif
+#if DDSI_UDP_RXTIMESTAMP
+  // whether the kernel timestamps received datagrams (SO_TIMESTAMPNS)
+  bool m_rxtstamp;
+#endif
+#if DDSI_HAVE_IO_URING
+  // io_uring for sending (transmit conns) or receiving into posted buffers
+  struct ddsi_udp_uring *m_uring;
+#endif
+#if DDSRT_HAVE_ZEROCOPY
+  // zero-copy sends: the kernel numbers them consecutively per socket, the
+  // lock serializes them so the sequence numbers are known; m_zc_done is the
+  // first one not known to have completed, bit i of m_zc_ooo set means
+  // m_zc_done + i has completed (out of order)
+  ddsrt_mutex_t m_zc_lock;
+  uint32_t m_zc_next;
+  uint32_t m_zc_done;
+  uint64_t m_zc_ooo;
+#endif
 } *ddsi_udp_conn_t;
 
 typedef struct ddsi_udp_tran_factory {
@@ -61,6 +109,29 @@ static void addr_to_loc (const struct ddsi_tran_factory *tran, ddsi_locator_t *d
   ddsi_ipaddr_to_loc (dst, &src->a, (src->a.sa_family == AF_INET) ? NN_LOCATOR_KIND_UDPv4 : NN_LOCATOR_KIND_UDPv6);
 }
 
+static void ddsi_udp_conn_note_received (ddsi_udp_conn_t conn, const union addr *src, unsigned char *buf, size_t len, size_t sz, bool trunc_flag)
+{
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  if (gv->pcap_fp)
+  {
+    union addr dest;
+    socklen_t dest_len = sizeof (dest);
+    if (ddsrt_getsockname (conn->m_sock, &dest.a, &dest_len) != DDS_RETCODE_OK)
+      memset (&dest, 0, sizeof (dest));
+    write_pcap_received (gv, ddsrt_time_wallclock (), &src->x, &dest.x, buf, sz);
+  }
+
+  /* Check for udp packet truncation */
+  if (sz > len || trunc_flag)
+  {
+    char addrbuf[DDSI_LOCSTRLEN];
+    ddsi_locator_t tmp;
+    addr_to_loc (conn->m_base.m_factory, &tmp, src);
+    ddsi_locator_to_string (addrbuf, sizeof (addrbuf), &tmp);
+    GVWARNING ("%s => %d truncated to %d\n", addrbuf, (int) sz, (int) len);
+  }
+}
+
 static ssize_t ddsi_udp_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char * buf, size_t len, bool allow_spurious, ddsi_locator_t *srcloc)
 {
   ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
@@ -96,30 +167,12 @@ static ssize_t ddsi_udp_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char * bu
   {
     if (srcloc)
       addr_to_loc (conn->m_base.m_factory, srcloc, &src);
-
-    if (gv->pcap_fp)
-    {
-      union addr dest;
-      socklen_t dest_len = sizeof (dest);
-      if (ddsrt_getsockname (conn->m_sock, &dest.a, &dest_len) != DDS_RETCODE_OK)
-        memset (&dest, 0, sizeof (dest));
-      write_pcap_received (gv, ddsrt_time_wallclock (), &src.x, &dest.x, buf, (size_t) ret);
-    }
-
-    /* Check for udp packet truncation */
 #if DDSRT_MSGHDR_FLAGS
     const bool trunc_flag = (msghdr.msg_flags & MSG_TRUNC) != 0;
 #else
     const bool trunc_flag = false;
 #endif
-    if ((size_t) ret > len || trunc_flag)
-    {
-      char addrbuf[DDSI_LOCSTRLEN];
-      ddsi_locator_t tmp;
-      addr_to_loc (conn->m_base.m_factory, &tmp, &src);
-      ddsi_locator_to_string (addrbuf, sizeof (addrbuf), &tmp);
-      GVWARNING ("%s => %d truncated to %d\n", addrbuf, (int) ret, (int) len);
-    }
+    ddsi_udp_conn_note_received (conn, &src, buf, len, (size_t) ret, trunc_flag);
   }
   else if (rc != DDS_RETCODE_BAD_PARAMETER && rc != DDS_RETCODE_NO_CONNECTION)
   {
@@ -129,12 +182,164 @@ static ssize_t ddsi_udp_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char * bu
   return ret;
 }
 
+#if DDSRT_HAVE_MMSG || DDSI_HAVE_IO_URING
+static bool ddsi_udp_wants_recv_ctrl (const ddsi_udp_conn_t conn)
+{
+#if DDSRT_HAVE_UDP_GSO && DDSI_UDP_RXTIMESTAMP
+  return conn->m_gro || conn->m_rxtstamp;
+#elif DDSRT_HAVE_UDP_GSO
+  return conn->m_gro;
+#elif DDSI_UDP_RXTIMESTAMP
+  return conn->m_rxtstamp;
+#else
+  (void) conn;
+  return false;
+#endif
+}
+
+static void ddsi_udp_parse_recv_ctrl (const ddsi_udp_conn_t conn, ddsrt_msghdr_t *mhdr, size_t len, size_t *segsize, ddsrt_wctime_t *timestamp)
+{
+  /* Size of the segments if the kernel coalesced datagrams, 0 if not;
+     kernel receive time if available, 0 if not */
+  *segsize = 0;
+  timestamp->v = 0;
+#if DDSI_UDP_RECV_CTRL
+  if (!ddsi_udp_wants_recv_ctrl (conn) || mhdr->msg_controllen == 0)
+    return;
+  for (struct cmsghdr *cmsg = CMSG_FIRSTHDR (mhdr); cmsg; cmsg = CMSG_NXTHDR (mhdr, cmsg))
+  {
+#if DDSRT_HAVE_UDP_GSO
+    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+    {
+      int gso_size;
+      memcpy (&gso_size, CMSG_DATA (cmsg), sizeof (gso_size));
+      if (gso_size > 0 && (size_t) gso_size < len)
+        *segsize = (size_t) gso_size;
+    }
+#endif
+#if DDSI_UDP_RXTIMESTAMP
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+    {
+      struct timespec ts;
+      memcpy (&ts, CMSG_DATA (cmsg), sizeof (ts));
+      timestamp->v = (int64_t) ts.tv_sec * DDS_NSECS_IN_SEC + ts.tv_nsec;
+    }
+#endif
+  }
+#else
+  (void) conn; (void) mhdr; (void) len;
+#endif
+}
+
+static void ddsi_udp_conn_note_received_segs (ddsi_udp_conn_t conn, const union addr *src, unsigned char *buf, size_t len, size_t sz, size_t segsize, bool trunc_flag)
+{
+  if (segsize == 0)
+    ddsi_udp_conn_note_received (conn, src, buf, len, sz, trunc_flag);
+  else
+  {
+    /* coalesced datagrams: note them as they were sent */
+    for (size_t off = 0; off < sz; off += segsize)
+    {
+      const size_t segsz = (sz - off < segsize) ? sz - off : segsize;
+      ddsi_udp_conn_note_received (conn, src, buf + off, len - off, segsz, trunc_flag);
+    }
+  }
+}
+#endif
+
+#if DDSRT_HAVE_MMSG
+static int ddsi_udp_conn_read_multi (ddsi_tran_conn_t conn_cmn, size_t nbufs, struct ddsi_tran_readbuf *bufs)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  ddsrt_mmsghdr_t msgs[DDSI_MAX_RECV_BATCH_SIZE];
+  ddsrt_iovec_t iovs[DDSI_MAX_RECV_BATCH_SIZE];
+  union addr srcs[DDSI_MAX_RECV_BATCH_SIZE];
+#if DDSI_UDP_RECV_CTRL
+  union {
+    char buf[DDSI_UDP_RECV_CTRL_SIZE];
+    struct cmsghdr align;
+  } ctrls[DDSI_MAX_RECV_BATCH_SIZE];
+#endif
+  dds_return_t rc;
+  int n = 0;
+
+  if (nbufs > DDSI_MAX_RECV_BATCH_SIZE)
+    nbufs = DDSI_MAX_RECV_BATCH_SIZE;
+  for (size_t i = 0; i < nbufs; i++)
+  {
+    iovs[i].iov_base = (void *) bufs[i].buf;
+    iovs[i].iov_len = (ddsrt_iov_len_t) bufs[i].len;
+    memset (&msgs[i], 0, sizeof (msgs[i]));
+    msgs[i].msg_hdr.msg_name = &srcs[i].x;
+    msgs[i].msg_hdr.msg_namelen = (socklen_t) sizeof (srcs[i]);
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+#if DDSI_UDP_RECV_CTRL
+    if (ddsi_udp_wants_recv_ctrl (conn))
+    {
+      msgs[i].msg_hdr.msg_control = ctrls[i].buf;
+      msgs[i].msg_hdr.msg_controllen = sizeof (ctrls[i].buf);
+    }
+#endif
+  }
+
+  do {
+    rc = ddsrt_recvmmsg (conn->m_sock, msgs, (unsigned) nbufs, 0, &n);
+  } while (rc == DDS_RETCODE_INTERRUPTED);
+
+  if (rc != DDS_RETCODE_OK)
+  {
+    if (rc != DDS_RETCODE_BAD_PARAMETER && rc != DDS_RETCODE_NO_CONNECTION)
+    {
+      GVERROR ("UDP recvmmsg sock %d: retcode %"PRId32"\n", (int) conn->m_sock, rc);
+      return -1;
+    }
+    return 0;
+  }
+
+  assert (n >= 0 && (size_t) n <= nbufs);
+  for (int i = 0; i < n; i++)
+  {
+    const bool trunc_flag = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+    size_t segsize;
+    ddsi_udp_parse_recv_ctrl (conn, &msgs[i].msg_hdr, msgs[i].msg_len, &segsize, &bufs[i].timestamp);
+    addr_to_loc (conn->m_base.m_factory, &bufs[i].srcloc, &srcs[i]);
+    ddsi_udp_conn_note_received_segs (conn, &srcs[i], bufs[i].buf, bufs[i].len, msgs[i].msg_len, segsize, trunc_flag);
+    bufs[i].len = msgs[i].msg_len;
+    bufs[i].segsize = segsize;
+  }
+  return n;
+}
+#endif
+
 static void set_msghdr_iov (ddsrt_msghdr_t *mhdr, const ddsrt_iovec_t *iov, size_t iovlen)
 {
   mhdr->msg_iov = (ddsrt_iovec_t *) iov;
   mhdr->msg_iovlen = (ddsrt_msg_iovlen_t) iovlen;
 }
 
+static void set_msghdr_for_write (ddsrt_msghdr_t *msg, union addr *dstaddr, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
+{
+  assert (niov <= INT_MAX);
+  ddsi_ipaddr_from_loc (&dstaddr->x, dst);
+  set_msghdr_iov (msg, iov, niov);
+  msg->msg_name = &dstaddr->x;
+  msg->msg_namelen = (socklen_t) ddsrt_sockaddr_get_size (&dstaddr->a);
+#if defined(__sun) && !defined(_XPG4_2)
+  msg->msg_accrights = NULL;
+  msg->msg_accrightslen = 0;
+#else
+  msg->msg_control = NULL;
+  msg->msg_controllen = 0;
+#endif
+#if DDSRT_MSGHDR_FLAGS
+  msg->msg_flags = (int) flags;
+#else
+  DDSRT_UNUSED_ARG (flags);
+#endif
+}
+
 static ssize_t ddsi_udp_conn_write (ddsi_tran_conn_t conn_cmn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
 {
   ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
@@ -145,23 +350,7 @@ static ssize_t ddsi_udp_conn_write (ddsi_tran_conn_t conn_cmn, const ddsi_locato
   int sendflags = 0;
   ddsrt_msghdr_t msg;
   union addr dstaddr;
-  assert (niov <= INT_MAX);
-  ddsi_ipaddr_from_loc (&dstaddr.x, dst);
-  set_msghdr_iov (&msg, iov, niov);
-  msg.msg_name = &dstaddr.x;
-  msg.msg_namelen = (socklen_t) ddsrt_sockaddr_get_size (&dstaddr.a);
-#if defined(__sun) && !defined(_XPG4_2)
-  msg.msg_accrights = NULL;
-  msg.msg_accrightslen = 0;
-#else
-  msg.msg_control = NULL;
-  msg.msg_controllen = 0;
-#endif
-#if DDSRT_MSGHDR_FLAGS
-  msg.msg_flags = (int) flags;
-#else
-  DDSRT_UNUSED_ARG (flags);
-#endif
+  set_msghdr_for_write (&msg, &dstaddr, dst, niov, iov, flags);
 #if MSG_NOSIGNAL && !LWIP_SOCKET
   sendflags |= MSG_NOSIGNAL;
 #endif
@@ -192,6 +381,746 @@ static ssize_t ddsi_udp_conn_write (ddsi_tran_conn_t conn_cmn, const ddsi_locato
   return (rc == DDS_RETCODE_OK) ? ret : -1;
 }
 
+#if DDSRT_HAVE_MMSG
+static int ddsi_udp_conn_write_multi (ddsi_tran_conn_t conn_cmn, size_t ndst, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  ddsrt_mmsghdr_t msgs[DDSI_TRAN_MAX_WRITE_MULTI];
+  union addr dstaddrs[DDSI_TRAN_MAX_WRITE_MULTI];
+  dds_return_t rc;
+  unsigned retry = 2;
+  int sendflags = 0;
+  size_t i = 0, nok = 0;
+  assert (ndst <= DDSI_TRAN_MAX_WRITE_MULTI);
+  for (size_t j = 0; j < ndst; j++)
+  {
+    set_msghdr_for_write (&msgs[j].msg_hdr, &dstaddrs[j], &dst[j], niov, iov, flags);
+    msgs[j].msg_len = 0;
+  }
+#if MSG_NOSIGNAL && !LWIP_SOCKET
+  sendflags |= MSG_NOSIGNAL;
+#endif
+  /* sendmmsg stops at the first destination that fails, report that one
+     (the way ddsi_udp_conn_write would) and continue with the next */
+  while (i < ndst)
+  {
+    int n;
+    rc = ddsrt_sendmmsg (conn->m_sock, &msgs[i], (unsigned) (ndst - i), sendflags, &n);
+    if (rc == DDS_RETCODE_OK)
+    {
+      if (gv->pcap_fp)
+      {
+        union addr sa;
+        socklen_t alen = sizeof (sa);
+        if (ddsrt_getsockname (conn->m_sock, &sa.a, &alen) != DDS_RETCODE_OK)
+          memset(&sa, 0, sizeof(sa));
+        for (int k = 0; k < n; k++)
+          write_pcap_sent (gv, ddsrt_time_wallclock (), &sa.x, &msgs[i + (size_t) k].msg_hdr, msgs[i + (size_t) k].msg_len);
+      }
+      i += (size_t) n;
+      nok += (size_t) n;
+      retry = 2;
+    }
+    else if (rc == DDS_RETCODE_INTERRUPTED || rc == DDS_RETCODE_TRY_AGAIN || (rc == DDS_RETCODE_NOT_ALLOWED && retry-- > 0))
+    {
+      continue;
+    }
+    else
+    {
+      if (rc != DDS_RETCODE_NOT_ALLOWED && rc != DDS_RETCODE_NO_CONNECTION)
+      {
+        char locbuf[DDSI_LOCSTRLEN];
+        GVERROR ("ddsi_udp_conn_write_multi to %s failed with retcode %"PRId32"\n", ddsi_locator_to_string (locbuf, sizeof (locbuf), &dst[i]), rc);
+      }
+      i++;
+      retry = 2;
+    }
+  }
+  return (int) nok;
+}
+#endif
+
+#if DDSRT_HAVE_UDP_GSO
+static ssize_t ddsi_udp_conn_write_gso (ddsi_tran_conn_t conn_cmn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t segsize, uint32_t flags)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  union {
+    char buf[CMSG_SPACE (sizeof (uint16_t))];
+    struct cmsghdr align;
+  } ctrl;
+  struct cmsghdr *cmsg;
+  const uint16_t gso_size = (uint16_t) segsize;
+  dds_return_t rc;
+  ssize_t ret = -1;
+  unsigned retry = 2;
+  int sendflags = 0;
+  ddsrt_msghdr_t msg;
+  union addr dstaddr;
+  assert (segsize > 0 && segsize <= UINT16_MAX);
+  if (segsize > ddsrt_atomic_ld32 (&conn->m_gso_max_segsize))
+    return -1;
+  set_msghdr_for_write (&msg, &dstaddr, dst, niov, iov, flags);
+  memset (&ctrl, 0, sizeof (ctrl));
+  msg.msg_control = ctrl.buf;
+  msg.msg_controllen = sizeof (ctrl.buf);
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_UDP;
+  cmsg->cmsg_type = UDP_SEGMENT;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (gso_size));
+  memcpy (CMSG_DATA (cmsg), &gso_size, sizeof (gso_size));
+#if MSG_NOSIGNAL && !LWIP_SOCKET
+  sendflags |= MSG_NOSIGNAL;
+#endif
+  do {
+    rc = ddsrt_sendmsg (conn->m_sock, &msg, sendflags, &ret);
+  } while (rc == DDS_RETCODE_INTERRUPTED || rc == DDS_RETCODE_TRY_AGAIN || (rc == DDS_RETCODE_NOT_ALLOWED && retry-- > 0));
+  if (rc == DDS_RETCODE_BAD_PARAMETER)
+  {
+    /* EINVAL: segment doesn't fit in the path MTU, so don't bother trying this
+       (or anything larger) again, the caller falls back to regular writes */
+    uint32_t old;
+    do {
+      old = ddsrt_atomic_ld32 (&conn->m_gso_max_segsize);
+      if (segsize > old)
+        break;
+    } while (!ddsrt_atomic_cas32 (&conn->m_gso_max_segsize, old, segsize - 1));
+    GVTRACE ("ddsi_udp_conn_write_gso: segment size %"PRIu32" rejected\n", segsize);
+  }
+  else if (rc == DDS_RETCODE_OK && gv->pcap_fp)
+  {
+    /* each segment goes out as a packet of its own */
+    union addr sa;
+    socklen_t alen = sizeof (sa);
+    const size_t len = iov[0].iov_len;
+    size_t off = 0;
+    assert (niov == 1);
+    if (ddsrt_getsockname (conn->m_sock, &sa.a, &alen) != DDS_RETCODE_OK)
+      memset(&sa, 0, sizeof(sa));
+    while (off < len)
+    {
+      const size_t seglen = (len - off < segsize) ? len - off : segsize;
+      ddsrt_iovec_t segiov = { .iov_base = (char *) iov[0].iov_base + off, .iov_len = (ddsrt_iov_len_t) seglen };
+      ddsrt_msghdr_t segmsg = msg;
+      set_msghdr_iov (&segmsg, &segiov, 1);
+      write_pcap_sent (gv, ddsrt_time_wallclock (), &sa.x, &segmsg, seglen);
+      off += seglen;
+    }
+  }
+  else if (rc != DDS_RETCODE_OK && rc != DDS_RETCODE_NOT_ALLOWED && rc != DDS_RETCODE_NO_CONNECTION)
+  {
+    GVTRACE ("ddsi_udp_conn_write_gso failed with retcode %"PRId32"\n", rc);
+  }
+  return (rc == DDS_RETCODE_OK) ? ret : -1;
+}
+
+static void ddsi_udp_init_gro (ddsi_udp_conn_t conn, const struct ddsi_domaingv *gv)
+{
+  /* Coalesced datagrams can only be split again if the size of the segments
+     is known, which requires reading them with ddsi_udp_conn_read_multi and
+     receive buffers that can hold the largest possible coalesced datagram
+     (else the kernel truncates and the remaining datagrams are lost) */
+  int one = 1;
+  if (gv->config.rmsg_chunk_size < 65536)
+  {
+    GVLOG (DDS_LC_CONFIG, "ddsi_udp_create_conn: UDP receive offload requires Sizing/ReceiveBufferChunkSize >= 64kB\n");
+    return;
+  }
+  if (ddsrt_setsockopt (conn->m_sock, SOL_UDP, UDP_GRO, &one, sizeof (one)) != DDS_RETCODE_OK)
+  {
+    GVLOG (DDS_LC_CONFIG, "ddsi_udp_create_conn: UDP receive offload not supported\n");
+    return;
+  }
+  conn->m_gro = true;
+}
+
+static void ddsi_udp_init_gso (ddsi_udp_conn_t conn, const struct ddsi_domaingv *gv)
+{
+  /* Probe for kernel support by setting the socket default segment size to 0
+     (i.e., no segmentation unless requested per call) */
+  int zero = 0;
+  if (ddsrt_setsockopt (conn->m_sock, SOL_UDP, UDP_SEGMENT, &zero, sizeof (zero)) != DDS_RETCODE_OK)
+  {
+    GVLOG (DDS_LC_CONFIG, "ddsi_udp_create_conn: UDP segmentation offload not supported\n");
+    return;
+  }
+  ddsrt_atomic_st32 (&conn->m_gso_max_segsize, UINT16_MAX);
+  conn->m_base.m_write_gso_fn = ddsi_udp_conn_write_gso;
+}
+#endif
+
+#if DDSRT_HAVE_ZEROCOPY
+/* Maximum number of zero-copy sends in flight on a socket, bounded by the
+   size of the bitmap for tracking out-of-order completions */
+#define DDSI_UDP_MAX_ZEROCOPY_INFLIGHT 64
+
+static void ddsi_udp_zerocopy_completed (ddsi_udp_conn_t conn, uint32_t lo, uint32_t hi)
+{
+  for (uint32_t seq = lo; seq != hi + 1; seq++)
+  {
+    const uint32_t d = seq - conn->m_zc_done;
+    if (d < DDSI_UDP_MAX_ZEROCOPY_INFLIGHT)
+      conn->m_zc_ooo |= (uint64_t) 1 << d;
+  }
+  while (conn->m_zc_ooo & 1)
+  {
+    conn->m_zc_ooo >>= 1;
+    conn->m_zc_done++;
+  }
+}
+
+static void ddsi_udp_zerocopy_reap (ddsi_udp_conn_t conn)
+{
+  /* Completion notifications are queued on the socket error queue as
+     ranges of sequence numbers, consecutive ones get merged by the kernel */
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE (sizeof (struct sock_extended_err) + sizeof (union addr))];
+  } ctrl;
+  ddsrt_msghdr_t msg;
+  ssize_t ret;
+  for (;;)
+  {
+    memset (&msg, 0, sizeof (msg));
+    msg.msg_control = ctrl.buf;
+    msg.msg_controllen = sizeof (ctrl.buf);
+    if (ddsrt_recvmsg (conn->m_sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT, &ret) != DDS_RETCODE_OK)
+      break;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg); cmsg != NULL; cmsg = CMSG_NXTHDR (&msg, cmsg))
+    {
+      if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+            (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)))
+        continue;
+      struct sock_extended_err serr;
+      memcpy (&serr, CMSG_DATA (cmsg), sizeof (serr));
+      if (serr.ee_errno == 0 && serr.ee_origin == SO_EE_ORIGIN_ZEROCOPY)
+        ddsi_udp_zerocopy_completed (conn, serr.ee_info, serr.ee_data);
+    }
+  }
+}
+
+static ssize_t ddsi_udp_conn_write_zerocopy (ddsi_tran_conn_t conn_cmn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags, uint32_t *seq)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  dds_return_t rc;
+  ssize_t ret = -1;
+  ddsrt_msghdr_t msg;
+  union addr dstaddr;
+  set_msghdr_for_write (&msg, &dstaddr, dst, niov, iov, flags);
+  ddsrt_mutex_lock (&conn->m_zc_lock);
+  if (conn->m_zc_next - conn->m_zc_done >= DDSI_UDP_MAX_ZEROCOPY_INFLIGHT)
+  {
+    ddsi_udp_zerocopy_reap (conn);
+    if (conn->m_zc_next - conn->m_zc_done >= DDSI_UDP_MAX_ZEROCOPY_INFLIGHT)
+    {
+      ddsrt_mutex_unlock (&conn->m_zc_lock);
+      return -1;
+    }
+  }
+  /* Errors are left to the regular write the caller falls back to, that
+     includes ENOBUFS if the pinned pages exceed the socket's option memory */
+  do {
+    rc = ddsrt_sendmsg (conn->m_sock, &msg, MSG_NOSIGNAL | MSG_ZEROCOPY, &ret);
+  } while (rc == DDS_RETCODE_INTERRUPTED);
+  if (rc == DDS_RETCODE_OK)
+    *seq = conn->m_zc_next++;
+  ddsrt_mutex_unlock (&conn->m_zc_lock);
+  if (rc != DDS_RETCODE_OK)
+    return -1;
+  if (gv->pcap_fp)
+  {
+    union addr sa;
+    socklen_t alen = sizeof (sa);
+    if (ddsrt_getsockname (conn->m_sock, &sa.a, &alen) != DDS_RETCODE_OK)
+      memset(&sa, 0, sizeof(sa));
+    write_pcap_sent (gv, ddsrt_time_wallclock (), &sa.x, &msg, (size_t) ret);
+  }
+  return ret;
+}
+
+static bool ddsi_udp_conn_zerocopy_done (ddsi_tran_conn_t conn_cmn, uint32_t seq, bool wait)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  bool done;
+  ddsrt_mutex_lock (&conn->m_zc_lock);
+  ddsi_udp_zerocopy_reap (conn);
+  while (!(done = ((int32_t) (seq - conn->m_zc_done) < 0)) && wait)
+  {
+    /* a pending notification shows up as an error condition on the socket */
+    struct pollfd pfd = { .fd = conn->m_sock, .events = 0, .revents = 0 };
+    ddsrt_mutex_unlock (&conn->m_zc_lock);
+    (void) poll (&pfd, 1, 100);
+    ddsrt_mutex_lock (&conn->m_zc_lock);
+    ddsi_udp_zerocopy_reap (conn);
+  }
+  ddsrt_mutex_unlock (&conn->m_zc_lock);
+  return done;
+}
+
+static void ddsi_udp_init_zerocopy (ddsi_udp_conn_t conn, const struct ddsi_domaingv *gv)
+{
+  int one = 1;
+  if (ddsrt_setsockopt (conn->m_sock, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof (one)) != DDS_RETCODE_OK)
+  {
+    GVLOG (DDS_LC_CONFIG, "ddsi_udp_create_conn: zero-copy transmit not supported\n");
+    return;
+  }
+  ddsrt_mutex_init (&conn->m_zc_lock);
+  conn->m_base.m_write_zerocopy_fn = ddsi_udp_conn_write_zerocopy;
+  conn->m_base.m_zerocopy_done_fn = ddsi_udp_conn_zerocopy_done;
+}
+#endif
+
+#if DDSI_UDP_RXTIMESTAMP
+static void ddsi_udp_init_rxtimestamp (ddsi_udp_conn_t conn, const struct ddsi_domaingv *gv)
+{
+  int one = 1;
+  if (ddsrt_setsockopt (conn->m_sock, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof (one)) != DDS_RETCODE_OK)
+  {
+    GVLOG (DDS_LC_CONFIG, "ddsi_udp_create_conn: kernel receive timestamps not supported\n");
+    return;
+  }
+  conn->m_rxtstamp = true;
+}
+#endif
+
+#if defined __linux && defined SO_BUSY_POLL
+static void ddsi_udp_init_busy_poll (ddsi_udp_conn_t conn, const struct ddsi_domaingv *gv)
+{
+  /* the kernel interprets the value as microseconds */
+  const int64_t us = gv->config.recv_busy_poll / DDS_NSECS_IN_USEC;
+  int val = (us > INT32_MAX) ? INT32_MAX : (us < 1) ? 1 : (int) us;
+  if (ddsrt_setsockopt (conn->m_sock, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof (val)) != DDS_RETCODE_OK)
+    GVLOG (DDS_LC_CONFIG, "ddsi_udp_create_conn: failed to enable socket busy polling (insufficient privileges?)\n");
+}
+#endif
+
+#if DDSI_HAVE_IO_URING
+/* user_data values of requests other than sends, which use the slot index */
+#define URING_UD_RECV UINT64_MAX
+#define URING_UD_CANCEL (UINT64_MAX - 1)
+
+struct ddsi_udp_uring_slot {
+  ddsrt_msghdr_t msg;
+  ddsrt_iovec_t iov;
+  union addr dst;
+  uint32_t next_free;
+};
+
+struct ddsi_udp_uring {
+  struct ddsi_uring ring;
+
+  /* Sending: packets are copied into a free slot and queued, the slot is
+     freed once the completion has been seen; all protected by lock */
+  ddsrt_mutex_t lock;
+  uint32_t nslots;
+  uint32_t first_free; // UINT32_MAX if none
+  uint32_t ninflight;
+  size_t slot_bufsize;
+  unsigned char *slot_bufs;
+  struct ddsi_udp_uring_slot *slots;
+
+  /* Receiving: a single multishot recvmsg request picks buffers from the
+     buffer ring, the buffer id is the id under which it was posted; only
+     used by the receive thread */
+  bool recv_bufring_registered;
+  bool recv_armed;
+  struct ddsi_uring_bufring recv_bufring;
+  ddsrt_msghdr_t recv_msg;
+  unsigned char *posted[DDSI_MAX_RECV_BATCH_SIZE];
+  size_t posted_len[DDSI_MAX_RECV_BATCH_SIZE];
+};
+
+static void ddsi_udp_uring_reap_sends (ddsi_udp_conn_t conn)
+{
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  struct ddsi_udp_uring * const u = conn->m_uring;
+  struct io_uring_cqe *cqe;
+  while ((cqe = ddsi_uring_peek_cqe (&u->ring)) != NULL)
+  {
+    const uint32_t idx = (uint32_t) cqe->user_data;
+    const int32_t res = cqe->res;
+    ddsi_uring_cqe_seen (&u->ring);
+    assert (idx < u->nslots);
+    struct ddsi_udp_uring_slot * const slot = &u->slots[idx];
+    /* same errors ignored as in ddsi_udp_conn_write */
+    if (res < 0 && res != -EPERM && res != -ENETUNREACH && res != -EHOSTUNREACH)
+    {
+      char locbuf[DDSI_LOCSTRLEN];
+      ddsi_locator_t dst;
+      addr_to_loc (conn->m_base.m_factory, &dst, &slot->dst);
+      GVERROR ("ddsi_udp_conn_write to %s failed with error %"PRId32"\n", ddsi_locator_to_string (locbuf, sizeof (locbuf), &dst), -res);
+    }
+    slot->next_free = u->first_free;
+    u->first_free = idx;
+    u->ninflight--;
+  }
+}
+
+static ssize_t ddsi_udp_conn_write_uring (ddsi_tran_conn_t conn_cmn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  struct ddsi_udp_uring * const u = conn->m_uring;
+  size_t len = 0;
+  for (size_t i = 0; i < niov; i++)
+    len += iov[i].iov_len;
+  if (len > u->slot_bufsize)
+    return ddsi_udp_conn_write (conn_cmn, dst, niov, iov, flags);
+
+  ddsrt_mutex_lock (&u->lock);
+  ddsi_udp_uring_reap_sends (conn);
+  while (u->first_free == UINT32_MAX)
+  {
+    /* all slots in flight: wait for a send to complete, like a blocking
+       socket would */
+    dds_return_t rc = ddsi_uring_submit (&u->ring, 1);
+    if (rc != DDS_RETCODE_OK && rc != DDS_RETCODE_INTERRUPTED)
+    {
+      ddsrt_mutex_unlock (&u->lock);
+      GVERROR ("ddsi_udp_conn_write: io_uring wait failed with retcode %"PRId32"\n", rc);
+      return -1;
+    }
+    ddsi_udp_uring_reap_sends (conn);
+  }
+  const uint32_t idx = u->first_free;
+  struct ddsi_udp_uring_slot * const slot = &u->slots[idx];
+  u->first_free = slot->next_free;
+  u->ninflight++;
+
+  unsigned char * const buf = u->slot_bufs + idx * u->slot_bufsize;
+  size_t off = 0;
+  for (size_t i = 0; i < niov; i++)
+  {
+    memcpy (buf + off, iov[i].iov_base, iov[i].iov_len);
+    off += iov[i].iov_len;
+  }
+  slot->iov.iov_base = buf;
+  slot->iov.iov_len = len;
+  set_msghdr_for_write (&slot->msg, &slot->dst, dst, 1, &slot->iov, flags);
+  if (gv->pcap_fp)
+  {
+    union addr sa;
+    socklen_t alen = sizeof (sa);
+    if (ddsrt_getsockname (conn->m_sock, &sa.a, &alen) != DDS_RETCODE_OK)
+      memset(&sa, 0, sizeof(sa));
+    write_pcap_sent (gv, ddsrt_time_wallclock (), &sa.x, &slot->msg, len);
+  }
+
+  /* there are at least as many submission queue entries as slots */
+  struct io_uring_sqe * const sqe = ddsi_uring_get_sqe (&u->ring);
+  assert (sqe != NULL);
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = conn->m_sock;
+  sqe->addr = (uintptr_t) &slot->msg;
+  sqe->len = 1;
+  sqe->msg_flags = MSG_NOSIGNAL;
+  sqe->user_data = idx;
+  dds_return_t rc;
+  do {
+    rc = ddsi_uring_submit (&u->ring, 0);
+  } while (rc == DDS_RETCODE_INTERRUPTED);
+  ddsrt_mutex_unlock (&u->lock);
+  /* on failure the request remains queued and goes out with the next */
+  if (rc != DDS_RETCODE_OK && rc != DDS_RETCODE_TRY_AGAIN)
+    GVERROR ("ddsi_udp_conn_write: io_uring submit failed with retcode %"PRId32"\n", rc);
+  return (ssize_t) len;
+}
+
+static void ddsi_udp_init_uring_xmit (ddsi_udp_conn_t conn, const struct ddsi_domaingv *gv)
+{
+  struct ddsi_udp_uring *u = ddsrt_malloc (sizeof (*u));
+  memset (u, 0, sizeof (*u));
+  u->nslots = (uint32_t) gv->config.io_uring_send_slots;
+  if (gv->config.io_uring == DDSI_IOURING_SQPOLL && ddsi_uring_init (&u->ring, u->nslots, 10) != DDS_RETCODE_OK)
+    GVLOG (DDS_LC_CONFIG, "ddsi_udp_create_conn: io_uring with submission queue polling not supported\n");
+  else if (gv->config.io_uring == DDSI_IOURING_SQPOLL)
+    goto ring_ok;
+  if (ddsi_uring_init (&u->ring, u->nslots, 0) != DDS_RETCODE_OK)
+  {
+    GVLOG (DDS_LC_CONFIG, "ddsi_udp_create_conn: io_uring not supported\n");
+    ddsrt_free (u);
+    return;
+  }
+ring_ok:
+  assert (u->ring.sq_entries >= u->nslots);
+  ddsrt_mutex_init (&u->lock);
+  u->slot_bufsize = gv->config.max_msg_size;
+  u->slot_bufs = ddsrt_malloc (u->nslots * u->slot_bufsize);
+  u->slots = ddsrt_malloc (u->nslots * sizeof (*u->slots));
+  for (uint32_t i = 0; i < u->nslots; i++)
+    u->slots[i].next_free = (i + 1 < u->nslots) ? i + 1 : UINT32_MAX;
+  u->first_free = 0;
+  u->ninflight = 0;
+  conn->m_uring = u;
+  /* sendmmsg, segmentation offload and zero-copy sends would bypass the
+     queue */
+  conn->m_base.m_write_fn = ddsi_udp_conn_write_uring;
+  conn->m_base.m_write_multi_fn = 0;
+  conn->m_base.m_write_gso_fn = 0;
+  conn->m_base.m_write_zerocopy_fn = 0;
+}
+
+static dds_return_t ddsi_udp_uring_arm_recv (ddsi_udp_conn_t conn)
+{
+  struct ddsi_udp_uring * const u = conn->m_uring;
+  struct io_uring_sqe * const sqe = ddsi_uring_get_sqe (&u->ring);
+  dds_return_t rc;
+  assert (sqe != NULL);
+  sqe->opcode = IORING_OP_RECVMSG;
+  sqe->fd = conn->m_sock;
+  sqe->addr = (uintptr_t) &u->recv_msg;
+  sqe->len = 1;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = u->recv_bufring.bgid;
+  sqe->user_data = URING_UD_RECV;
+  do {
+    rc = ddsi_uring_submit (&u->ring, 0);
+  } while (rc == DDS_RETCODE_INTERRUPTED);
+  if (rc == DDS_RETCODE_OK)
+    u->recv_armed = true;
+  return rc;
+}
+
+static dds_return_t ddsi_udp_conn_post_readbuf (ddsi_tran_conn_t conn_cmn, uint32_t id, unsigned char *buf, size_t len)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  struct ddsi_udp_uring *u = conn->m_uring;
+  DDSRT_STATIC_ASSERT ((DDSI_MAX_RECV_BATCH_SIZE & (DDSI_MAX_RECV_BATCH_SIZE - 1)) == 0);
+  assert (id < DDSI_MAX_RECV_BATCH_SIZE);
+  if (u == NULL)
+  {
+    /* set up on first use, most receiving conns are served by a thread
+       waiting on many sockets and never use it */
+    u = ddsrt_malloc (sizeof (*u));
+    memset (u, 0, sizeof (*u));
+    if (ddsi_uring_init (&u->ring, 4, 0) != DDS_RETCODE_OK)
+    {
+      GVLOG (DDS_LC_CONFIG, "ddsi_udp_conn_post_readbuf: io_uring not supported\n");
+      ddsrt_free (u);
+      return DDS_RETCODE_UNSUPPORTED;
+    }
+    if (ddsi_uring_bufring_init (&u->ring, &u->recv_bufring, DDSI_MAX_RECV_BATCH_SIZE, 0) != DDS_RETCODE_OK)
+    {
+      GVLOG (DDS_LC_CONFIG, "ddsi_udp_conn_post_readbuf: io_uring buffer rings not supported\n");
+      ddsi_uring_fini (&u->ring);
+      ddsrt_free (u);
+      return DDS_RETCODE_UNSUPPORTED;
+    }
+    u->recv_bufring_registered = true;
+    u->recv_msg.msg_namelen = (socklen_t) sizeof (union addr);
+#if DDSI_UDP_RECV_CTRL
+    if (ddsi_udp_wants_recv_ctrl (conn))
+      u->recv_msg.msg_controllen = DDSI_UDP_RECV_CTRL_SIZE;
+#endif
+    conn->m_uring = u;
+  }
+  if (len > UINT32_MAX)
+    len = UINT32_MAX;
+  u->posted[id] = buf;
+  u->posted_len[id] = len;
+  ddsi_uring_bufring_add (&u->recv_bufring, buf, (uint32_t) len, (uint16_t) id);
+  return DDS_RETCODE_OK;
+}
+
+static void ddsi_udp_uring_received (ddsi_udp_conn_t conn, uint16_t bid, size_t res, struct ddsi_tran_readbuf *rb)
+{
+  /* The kernel fills the buffer with a header, the source address, the
+     control data and the datagram, the sizes of the address and control
+     areas are those of recv_msg, the header gives the actual lengths */
+  struct ddsi_udp_uring * const u = conn->m_uring;
+  unsigned char * const buf = u->posted[bid];
+  const size_t namepos = sizeof (struct io_uring_recvmsg_out);
+  const size_t ctrlpos = namepos + u->recv_msg.msg_namelen;
+  const size_t datapos = ctrlpos + u->recv_msg.msg_controllen;
+  rb->id = bid;
+  rb->buf = buf + datapos;
+  rb->len = 0;
+  rb->segsize = 0;
+  rb->timestamp.v = 0;
+  if (res < datapos)
+    return;
+
+  struct io_uring_recvmsg_out out;
+  union addr src;
+  ddsrt_msghdr_t ctrlmsg;
+  memcpy (&out, buf, sizeof (out));
+  memset (&src, 0, sizeof (src));
+  memcpy (&src, buf + namepos, (out.namelen < sizeof (src)) ? out.namelen : sizeof (src));
+  memset (&ctrlmsg, 0, sizeof (ctrlmsg));
+  ctrlmsg.msg_control = buf + ctrlpos;
+  ctrlmsg.msg_controllen = out.controllen;
+
+  const size_t sz = res - datapos;
+  size_t segsize;
+  ddsi_udp_parse_recv_ctrl (conn, &ctrlmsg, sz, &segsize, &rb->timestamp);
+  addr_to_loc (conn->m_base.m_factory, &rb->srcloc, &src);
+  ddsi_udp_conn_note_received_segs (conn, &src, rb->buf, u->posted_len[bid] - datapos, out.payloadlen, segsize, (out.flags & MSG_TRUNC) != 0);
+  rb->len = sz;
+  rb->segsize = segsize;
+}
+
+static int ddsi_udp_conn_read_posted (ddsi_tran_conn_t conn_cmn, size_t nbufs, struct ddsi_tran_readbuf *bufs)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  struct ddsi_udp_uring * const u = conn->m_uring;
+  size_t n = 0;
+  assert (u != NULL && u->recv_bufring_registered);
+  while (n == 0)
+  {
+    struct io_uring_cqe *cqe;
+    dds_return_t rc;
+    if (!u->recv_armed && (rc = ddsi_udp_uring_arm_recv (conn)) != DDS_RETCODE_OK)
+    {
+      GVERROR ("UDP io_uring recvmsg sock %d: retcode %"PRId32"\n", (int) conn->m_sock, rc);
+      return -1;
+    }
+    while (n < nbufs && (cqe = ddsi_uring_peek_cqe (&u->ring)) != NULL)
+    {
+      const uint64_t ud = cqe->user_data;
+      const int32_t res = cqe->res;
+      const uint32_t cflags = cqe->flags;
+      ddsi_uring_cqe_seen (&u->ring);
+      if (ud != URING_UD_RECV)
+        continue;
+      if (!(cflags & IORING_CQE_F_MORE))
+        u->recv_armed = false;
+      if (res == -ENOBUFS)
+      {
+        /* all posted buffers in use, request re-armed once some have been
+           returned (the datagrams remain queued in the socket) */
+        continue;
+      }
+      else if (res < 0)
+      {
+        /* EINVAL on the first one if the kernel doesn't do multishot */
+        if (res == -EINVAL)
+          GVLOG (DDS_LC_CONFIG, "UDP io_uring: multishot receive not supported\n");
+        else
+          GVERROR ("UDP io_uring recvmsg sock %d: error %"PRId32"\n", (int) conn->m_sock, -res);
+        return -1;
+      }
+      assert (cflags & IORING_CQE_F_BUFFER);
+      ddsi_udp_uring_received (conn, (uint16_t) (cflags >> IORING_CQE_BUFFER_SHIFT), (size_t) res, &bufs[n]);
+      n++;
+    }
+    if (n == 0 && u->recv_armed)
+    {
+      rc = ddsi_uring_submit (&u->ring, 1);
+      if (rc != DDS_RETCODE_OK && rc != DDS_RETCODE_INTERRUPTED)
+      {
+        GVERROR ("UDP io_uring wait sock %d: retcode %"PRId32"\n", (int) conn->m_sock, rc);
+        return -1;
+      }
+    }
+  }
+  return (int) n;
+}
+
+static void ddsi_udp_conn_cancel_posted (ddsi_tran_conn_t conn_cmn)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_udp_uring * const u = conn->m_uring;
+  if (u == NULL || !u->recv_bufring_registered)
+    return;
+  if (u->recv_armed)
+  {
+    struct io_uring_sqe * const sqe = ddsi_uring_get_sqe (&u->ring);
+    assert (sqe != NULL);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = URING_UD_RECV;
+    sqe->user_data = URING_UD_CANCEL;
+    /* the request is done once its final completion (the one without
+       IORING_CQE_F_MORE) has been seen, any data it carries is dropped */
+    while (u->recv_armed)
+    {
+      struct io_uring_cqe *cqe;
+      if (ddsi_uring_submit (&u->ring, 1) == DDS_RETCODE_ERROR)
+        break;
+      while ((cqe = ddsi_uring_peek_cqe (&u->ring)) != NULL)
+      {
+        if (cqe->user_data == URING_UD_RECV && !(cqe->flags & IORING_CQE_F_MORE))
+          u->recv_armed = false;
+        ddsi_uring_cqe_seen (&u->ring);
+      }
+    }
+  }
+  ddsi_uring_bufring_fini (&u->ring, &u->recv_bufring);
+  u->recv_bufring_registered = false;
+}
+
+static void ddsi_udp_uring_free (ddsi_udp_conn_t conn)
+{
+  struct ddsi_udp_uring * const u = conn->m_uring;
+  if (u->slots)
+  {
+    /* the kernel may still be reading from the slots */
+    ddsrt_mutex_lock (&u->lock);
+    while (u->ninflight > 0 && ddsi_uring_submit (&u->ring, 1) != DDS_RETCODE_ERROR)
+      ddsi_udp_uring_reap_sends (conn);
+    ddsrt_mutex_unlock (&u->lock);
+    ddsrt_mutex_destroy (&u->lock);
+    ddsrt_free (u->slots);
+    ddsrt_free (u->slot_bufs);
+  }
+  if (u->recv_bufring_registered)
+    ddsi_uring_bufring_fini (&u->ring, &u->recv_bufring);
+  ddsi_uring_fini (&u->ring);
+  ddsrt_free (u);
+  conn->m_uring = NULL;
+}
+#endif
+
+#if DDSRT_HAVE_REUSEPORT
+static dds_return_t set_reuseport_steering (const struct ddsi_domaingv *gv, ddsrt_socket_t sock, uint32_t nshards)
+{
+  /* The program returns the index of the socket in the SO_REUSEPORT group
+     (an out-of-range index makes the kernel fall back to hashing the
+     addresses). Messages too short to be RTPS messages are the ones
+     trigger_recv_threads uses to wake up a specific receive thread, these
+     carry the index in their first byte. */
+  struct sock_filter by_participant[] = {
+    BPF_STMT (BPF_LD | BPF_W | BPF_LEN, 0),
+    BPF_JUMP (BPF_JMP | BPF_JGE | BPF_K, (uint32_t) RTPS_MESSAGE_HEADER_SIZE, 2, 0),
+    BPF_STMT (BPF_LD | BPF_B | BPF_ABS, 0),
+    BPF_STMT (BPF_RET | BPF_A, 0),
+    BPF_STMT (BPF_LD | BPF_W | BPF_ABS, offsetof (Header_t, guid_prefix)),
+    BPF_STMT (BPF_MISC | BPF_TAX, 0),
+    BPF_STMT (BPF_LD | BPF_W | BPF_ABS, offsetof (Header_t, guid_prefix) + 4),
+    BPF_STMT (BPF_ALU | BPF_XOR | BPF_X, 0),
+    BPF_STMT (BPF_MISC | BPF_TAX, 0),
+    BPF_STMT (BPF_LD | BPF_W | BPF_ABS, offsetof (Header_t, guid_prefix) + 8),
+    BPF_STMT (BPF_ALU | BPF_XOR | BPF_X, 0),
+    BPF_STMT (BPF_ALU | BPF_MOD | BPF_K, nshards),
+    BPF_STMT (BPF_RET | BPF_A, 0)
+  };
+  struct sock_filter by_cpu[] = {
+    BPF_STMT (BPF_LD | BPF_W | BPF_LEN, 0),
+    BPF_JUMP (BPF_JMP | BPF_JGE | BPF_K, (uint32_t) RTPS_MESSAGE_HEADER_SIZE, 2, 0),
+    BPF_STMT (BPF_LD | BPF_B | BPF_ABS, 0),
+    BPF_STMT (BPF_RET | BPF_A, 0),
+    BPF_STMT (BPF_LD | BPF_W | BPF_ABS, (uint32_t) (SKF_AD_OFF + SKF_AD_CPU)),
+    BPF_STMT (BPF_ALU | BPF_MOD | BPF_K, nshards),
+    BPF_STMT (BPF_RET | BPF_A, 0)
+  };
+  struct sock_fprog prog;
+  if (gv->config.recv_shard_steering == DDSI_RSS_CPU) {
+    prog.len = (unsigned short) (sizeof (by_cpu) / sizeof (by_cpu[0]));
+    prog.filter = by_cpu;
+  } else {
+    prog.len = (unsigned short) (sizeof (by_participant) / sizeof (by_participant[0]));
+    prog.filter = by_participant;
+  }
+  return ddsrt_setsockopt (sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof (prog));
+}
+#endif
+
 static void ddsi_udp_disable_multiplexing (ddsi_tran_conn_t conn_cmn)
 {
 #if defined _WIN32 && !defined WINCE
@@ -518,6 +1447,14 @@ static dds_return_t ddsi_udp_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_
     }
   }
 
+#if DDSRT_HAVE_REUSEPORT
+  if (qos->m_shards > 1 && (rc = ddsrt_setsockopt (sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof (one))) != DDS_RETCODE_OK)
+  {
+    GVERROR ("ddsi_udp_create_conn: failed to enable port reuse: %s\n", dds_strretcode (rc));
+    goto fail_w_socket;
+  }
+#endif
+
   if ((rc = set_rcvbuf (gv, sock, &gv->config.socket_min_rcvbuf_size)) < 0)
     goto fail_w_socket;
   if (rc > 0) {
@@ -552,6 +1489,16 @@ static dds_return_t ddsi_udp_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_
     goto fail_w_socket;
   }
 
+#if DDSRT_HAVE_REUSEPORT
+  /* The program applies to the group as a whole, but attaching it again for
+     each member is harmless and saves tracking which one was first */
+  if (qos->m_shards > 1 && (rc = set_reuseport_steering (gv, sock, qos->m_shards)) != DDS_RETCODE_OK)
+  {
+    GVERROR ("ddsi_udp_create_conn: failed to attach port reuse steering program: %s\n", dds_strretcode (rc));
+    goto fail_w_socket;
+  }
+#endif
+
   rc = ipv6 ? set_mc_options_transmit_ipv6 (gv, intf, sock) : set_mc_options_transmit_ipv4 (gv, intf, sock);
   if (rc != DDS_RETCODE_OK)
     goto fail_w_socket;
@@ -584,9 +1531,46 @@ static dds_return_t ddsi_udp_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_
   conn->m_base.m_base.m_handle_fn = ddsi_udp_conn_handle;
 
   conn->m_base.m_read_fn = ddsi_udp_conn_read;
+#if DDSRT_HAVE_MMSG
+  conn->m_base.m_read_multi_fn = ddsi_udp_conn_read_multi;
+#endif
   conn->m_base.m_write_fn = ddsi_udp_conn_write;
+#if DDSRT_HAVE_MMSG
+  conn->m_base.m_write_multi_fn = ddsi_udp_conn_write_multi;
+#endif
   conn->m_base.m_disable_multiplexing_fn = ddsi_udp_disable_multiplexing;
   conn->m_base.m_locator_fn = ddsi_udp_conn_locator;
+#if DDSRT_HAVE_UDP_GSO
+  if (gv->config.send_gso && qos->m_purpose == DDSI_TRAN_QOS_XMIT)
+    ddsi_udp_init_gso (conn, gv);
+  if (gv->config.recv_gro && qos->m_purpose != DDSI_TRAN_QOS_XMIT)
+    ddsi_udp_init_gro (conn, gv);
+#endif
+#if DDSRT_HAVE_ZEROCOPY
+  if (gv->config.send_zerocopy_threshold > 0 && qos->m_purpose == DDSI_TRAN_QOS_XMIT)
+    ddsi_udp_init_zerocopy (conn, gv);
+#endif
+#if DDSI_UDP_RXTIMESTAMP
+  if (gv->config.recv_latency_stats && qos->m_purpose != DDSI_TRAN_QOS_XMIT)
+    ddsi_udp_init_rxtimestamp (conn, gv);
+#endif
+#if defined __linux && defined SO_BUSY_POLL
+  if (gv->config.socket_busy_poll && gv->config.recv_busy_poll > 0 && qos->m_purpose != DDSI_TRAN_QOS_XMIT)
+    ddsi_udp_init_busy_poll (conn, gv);
+#endif
+#if DDSI_HAVE_IO_URING
+  if (gv->config.io_uring != DDSI_IOURING_FALSE)
+  {
+    if (qos->m_purpose == DDSI_TRAN_QOS_XMIT)
+      ddsi_udp_init_uring_xmit (conn, gv);
+    else
+    {
+      conn->m_base.m_post_readbuf_fn = ddsi_udp_conn_post_readbuf;
+      conn->m_base.m_read_posted_fn = ddsi_udp_conn_read_posted;
+      conn->m_base.m_cancel_posted_fn = ddsi_udp_conn_cancel_posted;
+    }
+  }
+#endif
 
   GVTRACE ("ddsi_udp_create_conn %s socket %"PRIdSOCK" port %"PRIu32"\n", purpose_str, conn->m_sock, conn->m_base.m_base.m_port);
   *conn_out = &conn->m_base;
@@ -695,6 +1679,14 @@ static void ddsi_udp_release_conn (ddsi_tran_conn_t conn_cmn)
   GVTRACE ("ddsi_udp_release_conn %s socket %"PRIdSOCK" port %"PRIu32"\n",
            conn_cmn->m_base.m_multicast ? "multicast" : "unicast",
            conn->m_sock, conn->m_base.m_base.m_port);
+#if DDSI_HAVE_IO_URING
+  if (conn->m_uring)
+    ddsi_udp_uring_free (conn);
+#endif
+#if DDSRT_HAVE_ZEROCOPY
+  if (conn->m_base.m_zerocopy_done_fn)
+    ddsrt_mutex_destroy (&conn->m_zc_lock);
+#endif
   ddsrt_close (conn->m_sock);
 #if defined _WIN32 && !defined WINCE
   WSACloseEvent (conn->m_sockEvent);
@@ -0,0 +1,236 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include "ddsi_uring.h"
+
+#if DDSI_HAVE_IO_URING
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "dds/ddsrt/atomics.h"
+
+static int sys_io_uring_setup (unsigned entries, struct io_uring_params *p)
+{
+  return (int) syscall (__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter (int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+  return (int) syscall (__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register (int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+  return (int) syscall (__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+/* The ring indices are shared with the kernel: the consumer's loads of the
+   producer's index must be acquires, and the producer's stores releases */
+static unsigned load_acquire (const unsigned *p)
+{
+  const unsigned v = *(const volatile unsigned *) p;
+  ddsrt_atomic_fence_acq ();
+  return v;
+}
+
+static void store_release (unsigned *p, unsigned v)
+{
+  ddsrt_atomic_fence_rel ();
+  *(volatile unsigned *) p = v;
+}
+
+dds_return_t ddsi_uring_init (struct ddsi_uring *ring, unsigned entries, unsigned sqpoll_idle_ms)
+{
+  struct io_uring_params p;
+  memset (ring, 0, sizeof (*ring));
+  memset (&p, 0, sizeof (p));
+  if (sqpoll_idle_ms > 0)
+  {
+    p.flags |= IORING_SETUP_SQPOLL;
+    p.sq_thread_idle = sqpoll_idle_ms;
+  }
+  if ((ring->fd = sys_io_uring_setup (entries, &p)) < 0)
+    return DDS_RETCODE_UNSUPPORTED;
+  ring->flags = p.flags;
+
+  ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof (unsigned);
+  ring->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    if (ring->cq_ring_size > ring->sq_ring_size)
+      ring->sq_ring_size = ring->cq_ring_size;
+    ring->cq_ring_size = ring->sq_ring_size;
+  }
+  ring->sq_ring = mmap (NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ring == MAP_FAILED)
+    goto err_sq_ring;
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    ring->cq_ring = ring->sq_ring;
+  else
+  {
+    ring->cq_ring = mmap (NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ring == MAP_FAILED)
+      goto err_cq_ring;
+  }
+  ring->sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+  ring->sqes = mmap (NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED)
+    goto err_sqes;
+
+  char * const sq = ring->sq_ring;
+  char * const cq = ring->cq_ring;
+  ring->sq_head = (unsigned *) (sq + p.sq_off.head);
+  ring->sq_tail = (unsigned *) (sq + p.sq_off.tail);
+  ring->sq_flags = (unsigned *) (sq + p.sq_off.flags);
+  ring->sq_mask = *(unsigned *) (sq + p.sq_off.ring_mask);
+  ring->sq_entries = *(unsigned *) (sq + p.sq_off.ring_entries);
+  ring->sqe_tail = *ring->sq_tail;
+  ring->cq_head = (unsigned *) (cq + p.cq_off.head);
+  ring->cq_tail = (unsigned *) (cq + p.cq_off.tail);
+  ring->cq_mask = *(unsigned *) (cq + p.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+
+  /* Submission queue entry i always goes in slot i of the index array, so
+     the array can be initialised once */
+  unsigned * const sq_array = (unsigned *) (sq + p.sq_off.array);
+  for (unsigned i = 0; i < ring->sq_entries; i++)
+    sq_array[i] = i;
+  return DDS_RETCODE_OK;
+
+err_sqes:
+  if (ring->cq_ring != ring->sq_ring)
+    munmap (ring->cq_ring, ring->cq_ring_size);
+err_cq_ring:
+  munmap (ring->sq_ring, ring->sq_ring_size);
+err_sq_ring:
+  close (ring->fd);
+  return DDS_RETCODE_OUT_OF_RESOURCES;
+}
+
+void ddsi_uring_fini (struct ddsi_uring *ring)
+{
+  munmap (ring->sqes, ring->sqes_size);
+  if (ring->cq_ring != ring->sq_ring)
+    munmap (ring->cq_ring, ring->cq_ring_size);
+  munmap (ring->sq_ring, ring->sq_ring_size);
+  close (ring->fd);
+}
+
+struct io_uring_sqe *ddsi_uring_get_sqe (struct ddsi_uring *ring)
+{
+  const unsigned head = (ring->flags & IORING_SETUP_SQPOLL) ? load_acquire (ring->sq_head) : *ring->sq_head;
+  if (ring->sqe_tail - head >= ring->sq_entries)
+    return NULL;
+  struct io_uring_sqe *sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+  ring->sqe_tail++;
+  memset (sqe, 0, sizeof (*sqe));
+  return sqe;
+}
+
+dds_return_t ddsi_uring_submit (struct ddsi_uring *ring, unsigned wait_nr)
+{
+  /* entries not yet consumed by the kernel, this includes those of an
+     earlier call that failed */
+  const unsigned to_submit = ring->sqe_tail - load_acquire (ring->sq_head);
+  unsigned flags = 0;
+  if (ring->sqe_tail != *ring->sq_tail)
+    store_release (ring->sq_tail, ring->sqe_tail);
+  if (ring->flags & IORING_SETUP_SQPOLL)
+  {
+    /* the store of the tail must be visible before checking whether the
+       polling thread went to sleep */
+    ddsrt_atomic_fence ();
+    if (*(volatile unsigned *) ring->sq_flags & IORING_SQ_NEED_WAKEUP)
+      flags |= IORING_ENTER_SQ_WAKEUP;
+    else if (wait_nr == 0)
+      return DDS_RETCODE_OK;
+  }
+  else if (to_submit == 0 && wait_nr == 0)
+  {
+    return DDS_RETCODE_OK;
+  }
+  if (wait_nr > 0)
+    flags |= IORING_ENTER_GETEVENTS;
+  if (sys_io_uring_enter (ring->fd, to_submit, wait_nr, flags) < 0)
+  {
+    switch (errno)
+    {
+      case EINTR: return DDS_RETCODE_INTERRUPTED;
+      case EAGAIN: case EBUSY: return DDS_RETCODE_TRY_AGAIN;
+      default: return DDS_RETCODE_ERROR;
+    }
+  }
+  return DDS_RETCODE_OK;
+}
+
+struct io_uring_cqe *ddsi_uring_peek_cqe (struct ddsi_uring *ring)
+{
+  const unsigned head = *ring->cq_head;
+  if (head == load_acquire (ring->cq_tail))
+    return NULL;
+  return &ring->cqes[head & ring->cq_mask];
+}
+
+void ddsi_uring_cqe_seen (struct ddsi_uring *ring)
+{
+  store_release (ring->cq_head, *ring->cq_head + 1);
+}
+
+dds_return_t ddsi_uring_bufring_init (struct ddsi_uring *ring, struct ddsi_uring_bufring *br, uint16_t entries, uint16_t bgid)
+{
+  struct io_uring_buf_reg reg;
+  assert (entries > 0 && (entries & (entries - 1)) == 0);
+  br->size = entries * sizeof (struct io_uring_buf);
+  br->br = mmap (NULL, br->size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (br->br == MAP_FAILED)
+    return DDS_RETCODE_OUT_OF_RESOURCES;
+  memset (&reg, 0, sizeof (reg));
+  reg.ring_addr = (uintptr_t) br->br;
+  reg.ring_entries = entries;
+  reg.bgid = bgid;
+  if (sys_io_uring_register (ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+  {
+    munmap (br->br, br->size);
+    return DDS_RETCODE_UNSUPPORTED;
+  }
+  br->bgid = bgid;
+  br->tail = 0;
+  br->mask = (uint16_t) (entries - 1);
+  return DDS_RETCODE_OK;
+}
+
+void ddsi_uring_bufring_fini (struct ddsi_uring *ring, struct ddsi_uring_bufring *br)
+{
+  struct io_uring_buf_reg reg;
+  memset (&reg, 0, sizeof (reg));
+  reg.bgid = br->bgid;
+  (void) sys_io_uring_register (ring->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+  munmap (br->br, br->size);
+}
+
+void ddsi_uring_bufring_add (struct ddsi_uring_bufring *br, void *addr, uint32_t len, uint16_t bid)
+{
+  /* the tail overlays the reserved field of the first entry, so only the
+     other fields may be written */
+  struct io_uring_buf * const buf = &br->br->bufs[br->tail & br->mask];
+  buf->addr = (uintptr_t) addr;
+  buf->len = len;
+  buf->bid = bid;
+  br->tail++;
+  ddsrt_atomic_fence_rel ();
+  *(volatile uint16_t *) &br->br->tail = br->tail;
+}
+
+#endif /* DDSI_HAVE_IO_URING */
@@ -0,0 +1,110 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef DDSI_URING_H
+#define DDSI_URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dds/ddsrt/retcode.h"
+#include "dds/ddsrt/sockets.h"
+
+/* Minimal io_uring support for the UDP transport: just the rings and the
+   provided buffer rings used for multishot receive, no dependency on
+   liburing.  Requires the Linux 6.0 headers at build time (for multishot
+   receive), the kernel may still lack support, which shows up as an error
+   initialising the ring or in the completion of the first request. */
+#if defined(__linux) && !LWIP_SOCKET && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined IORING_RECV_MULTISHOT
+#define DDSI_HAVE_IO_URING 1
+#endif
+#endif
+#endif
+#ifndef DDSI_HAVE_IO_URING
+#define DDSI_HAVE_IO_URING 0
+#endif
+
+#if DDSI_HAVE_IO_URING
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+struct ddsi_uring {
+  int fd;
+  uint32_t flags;
+
+  /* submission queue: sqe_tail is the local tail, entries up to it have
+     been handed out by ddsi_uring_get_sqe but not necessarily submitted */
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_flags;
+  unsigned sq_mask;
+  unsigned sq_entries;
+  unsigned sqe_tail;
+  struct io_uring_sqe *sqes;
+
+  /* completion queue */
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned cq_mask;
+  struct io_uring_cqe *cqes;
+
+  void *sq_ring;
+  size_t sq_ring_size;
+  void *cq_ring;
+  size_t cq_ring_size;
+  size_t sqes_size;
+};
+
+/* Ring of buffers the kernel picks from when a request has
+   IOSQE_BUFFER_SELECT set, the buffer id is returned in the completion */
+struct ddsi_uring_bufring {
+  struct io_uring_buf_ring *br;
+  size_t size;
+  uint16_t bgid;
+  uint16_t tail;
+  uint16_t mask;
+};
+
+/* sqpoll_idle_ms > 0: kernel thread polls the submission queue, sleeping
+   after that many milliseconds without submissions */
+dds_return_t ddsi_uring_init (struct ddsi_uring *ring, unsigned entries, unsigned sqpoll_idle_ms);
+void ddsi_uring_fini (struct ddsi_uring *ring);
+
+/* Returns a zero-initialised submission queue entry, or NULL if the queue
+   is full */
+struct io_uring_sqe *ddsi_uring_get_sqe (struct ddsi_uring *ring);
+
+/* Submits all entries obtained from ddsi_uring_get_sqe and waits for at
+   least wait_nr completions.  With a polling kernel thread this only
+   makes a system call if the thread needs waking up or wait_nr > 0. */
+dds_return_t ddsi_uring_submit (struct ddsi_uring *ring, unsigned wait_nr);
+
+/* Oldest unconsumed completion, or NULL if none; ddsi_uring_cqe_seen
+   consumes it */
+struct io_uring_cqe *ddsi_uring_peek_cqe (struct ddsi_uring *ring);
+void ddsi_uring_cqe_seen (struct ddsi_uring *ring);
+
+/* entries must be a power of 2 */
+dds_return_t ddsi_uring_bufring_init (struct ddsi_uring *ring, struct ddsi_uring_bufring *br, uint16_t entries, uint16_t bgid);
+void ddsi_uring_bufring_fini (struct ddsi_uring *ring, struct ddsi_uring_bufring *br);
+void ddsi_uring_bufring_add (struct ddsi_uring_bufring *br, void *addr, uint32_t len, uint16_t bid);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* DDSI_HAVE_IO_URING */
+
+#endif /* DDSI_URING_H */
@@ -16,4 +16,11 @@ extern inline void nn_bitset_set (uint32_t numbits, uint32_t *bits, uint32_t idx
 extern inline void nn_bitset_clear (uint32_t numbits, uint32_t *bits, uint32_t idx);
 extern inline void nn_bitset_zero (uint32_t numbits, uint32_t *bits);
 extern inline void nn_bitset_one (uint32_t numbits, uint32_t *bits);
+extern inline uint32_t nn_bitset_popcount32 (uint32_t x);
+extern inline uint32_t nn_bitset_clz32 (uint32_t x);
+extern inline uint32_t nn_bitset_ctz32 (uint32_t x);
+extern inline uint32_t nn_bitset_set_range (uint32_t numbits, uint32_t *bits, uint32_t min, uint32_t maxp1);
+extern inline uint32_t nn_bitset_find_clear (uint32_t numbits, const uint32_t *bits, uint32_t idx);
+extern inline uint32_t nn_bitset_rfind_clear (uint32_t numbits, const uint32_t *bits, uint32_t idx);
+extern inline uint32_t nn_bitset_get32 (uint32_t numbits, const uint32_t *bits, uint32_t idx);
 
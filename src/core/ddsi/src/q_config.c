@@ -161,6 +161,10 @@ DUPF(uint32);
 #endif
 DU(natint);
 DU(natint_255);
+DU(recv_batch_size);
+DU(recv_shards);
+DU(dqueue_shards);
+DU(io_uring_send_slots);
 DUPF(participantIndex);
 DU(dyn_port);
 DUPF(memsize);
@@ -177,12 +181,15 @@ DUPF(retransmit_merging);
 DUPF(sched_class);
 DUPF(maybe_memsize);
 DUPF(maybe_int32);
+DUPF(cpu_set);
 #ifdef DDS_HAS_BANDWIDTH_LIMITING
 DUPF(bandwidth);
 #endif
 DUPF(domainId);
 DUPF(transport_selector);
 DUPF(many_sockets_mode);
+DUPF(recv_shard_steering);
+DUPF(io_uring);
 DU(deaf_mute);
 #ifdef DDS_HAS_SSL
 DUPF(min_tls_version);
@@ -197,6 +204,7 @@ DUPF(shm_loglevel);
 #define DF(fname) static void fname (struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem)
 DF(ff_free);
 DF(ff_networkAddresses);
+DF(ff_cpu_set);
 #undef DF
 
 #define DI(fname) static int fname (struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem)
@@ -930,8 +938,8 @@ static const char *en_sched_class_vs[] = { "realtime", "timeshare", "default", N
 static const ddsrt_sched_t en_sched_class_ms[] = { DDSRT_SCHED_REALTIME, DDSRT_SCHED_TIMESHARE, DDSRT_SCHED_DEFAULT, 0 };
 GENERIC_ENUM_CTYPE (sched_class, ddsrt_sched_t)
 
-static const char *en_transport_selector_vs[] = { "default", "udp", "udp6", "tcp", "tcp6", "raweth", NULL };
-static const enum ddsi_transport_selector en_transport_selector_ms[] = { DDSI_TRANS_DEFAULT, DDSI_TRANS_UDP, DDSI_TRANS_UDP6, DDSI_TRANS_TCP, DDSI_TRANS_TCP6, DDSI_TRANS_RAWETH, 0 };
+static const char *en_transport_selector_vs[] = { "default", "udp", "udp6", "tcp", "tcp6", "raweth", "shmring", "inproc", NULL };
+static const enum ddsi_transport_selector en_transport_selector_ms[] = { DDSI_TRANS_DEFAULT, DDSI_TRANS_UDP, DDSI_TRANS_UDP6, DDSI_TRANS_TCP, DDSI_TRANS_TCP6, DDSI_TRANS_RAWETH, DDSI_TRANS_SHMRING, DDSI_TRANS_INPROC, 0 };
 GENERIC_ENUM_CTYPE (transport_selector, enum ddsi_transport_selector)
 
 /* by putting the  "true" and "false" aliases at the end, they won't come out of the
@@ -941,6 +949,14 @@ static const enum ddsi_many_sockets_mode en_many_sockets_mode_ms[] = {
   DDSI_MSM_SINGLE_UNICAST, DDSI_MSM_NO_UNICAST, DDSI_MSM_MANY_UNICAST, DDSI_MSM_SINGLE_UNICAST, DDSI_MSM_MANY_UNICAST, 0 };
 GENERIC_ENUM_CTYPE (many_sockets_mode, enum ddsi_many_sockets_mode)
 
+static const char *en_recv_shard_steering_vs[] = { "participant", "cpu", NULL };
+static const enum ddsi_recv_shard_steering en_recv_shard_steering_ms[] = { DDSI_RSS_PARTICIPANT, DDSI_RSS_CPU, 0 };
+GENERIC_ENUM_CTYPE (recv_shard_steering, enum ddsi_recv_shard_steering)
+
+static const char *en_io_uring_vs[] = { "false", "true", "sqpoll", NULL };
+static const enum ddsi_io_uring_mode en_io_uring_ms[] = { DDSI_IOURING_FALSE, DDSI_IOURING_TRUE, DDSI_IOURING_SQPOLL, 0 };
+GENERIC_ENUM_CTYPE (io_uring, enum ddsi_io_uring_mode)
+
 static const char *en_standards_conformance_vs[] = { "pedantic", "strict", "lax", NULL };
 static const enum ddsi_standards_conformance en_standards_conformance_ms[] = { DDSI_SC_PEDANTIC, DDSI_SC_STRICT, DDSI_SC_LAX, 0 };
 GENERIC_ENUM_CTYPE (standards_conformance, enum ddsi_standards_conformance)
@@ -1270,6 +1286,82 @@ static void pf_allow_multicast(struct cfgst *cfgst, void *parent, struct cfgelem
   }
 }
 
+static enum update_result uf_cpu_set (struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, UNUSED_ARG (int first), const char *value)
+{
+  struct ddsi_config_cpu_set * const elem = cfg_address (cfgst, parent, cfgelem);
+  const uint32_t maxcpu = 1023;
+  elem->n = 0;
+  elem->cpus = NULL;
+  if (ddsrt_strcasecmp (value, "default") == 0)
+    return URES_SUCCESS;
+
+  char *copy = ddsrt_strdup (value), *cursor = copy, *tok;
+  uint32_t size = 0;
+  while ((tok = ddsrt_strsep (&cursor, ",")) != NULL)
+  {
+    unsigned long lo, hi;
+    char *endptr;
+    lo = strtoul (tok, &endptr, 10);
+    if (endptr == tok)
+      goto err;
+    if (*endptr != '-')
+      hi = lo;
+    else
+    {
+      const char *tok_hi = endptr + 1;
+      hi = strtoul (tok_hi, &endptr, 10);
+      if (endptr == tok_hi)
+        goto err;
+    }
+    if (*endptr != 0 || lo > hi || hi > maxcpu)
+      goto err;
+    for (unsigned long c = lo; c <= hi; c++)
+    {
+      if (elem->n == size)
+      {
+        size = (size == 0) ? 8 : 2 * size;
+        elem->cpus = ddsrt_realloc (elem->cpus, size * sizeof (*elem->cpus));
+      }
+      elem->cpus[elem->n++] = (uint32_t) c;
+    }
+  }
+  ddsrt_free (copy);
+  return URES_SUCCESS;
+
+err:
+  ddsrt_free (copy);
+  ddsrt_free (elem->cpus);
+  elem->n = 0;
+  elem->cpus = NULL;
+  return cfg_error (cfgst, "%s: not a list of CPU numbers and ranges in [0,%"PRIu32"]", value, maxcpu);
+}
+
+static void pf_cpu_set (struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, uint32_t sources)
+{
+  struct ddsi_config_cpu_set const * const p = cfg_address (cfgst, parent, cfgelem);
+  if (p->n == 0)
+    cfg_logelem (cfgst, sources, "default");
+  else
+  {
+    char buf[256];
+    size_t pos = 0;
+    for (uint32_t i = 0; i < p->n && pos < sizeof (buf); i++)
+    {
+      int n = snprintf (buf + pos, sizeof (buf) - pos, "%s%"PRIu32, (i == 0) ? "" : ",", p->cpus[i]);
+      if (n < 0)
+        break;
+      pos += (size_t) n;
+    }
+    cfg_logelem (cfgst, sources, "%s", buf);
+  }
+}
+
+static void ff_cpu_set (struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem)
+{
+  struct ddsi_config_cpu_set * const elem = cfg_address (cfgst, parent, cfgelem);
+  ddsrt_free (elem->cpus);
+}
+
 static enum update_result uf_maybe_int32 (struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, UNUSED_ARG (int first), const char *value)
 {
   DDSRT_WARNING_MSVC_OFF(4996);
@@ -1368,6 +1460,26 @@ static enum update_result uf_natint_255(struct cfgst *cfgst, void *parent, struc
   return uf_int_min_max(cfgst, parent, cfgelem, first, value, 0, 255);
 }
 
+static enum update_result uf_recv_batch_size(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int first, const char *value)
+{
+  return uf_int_min_max(cfgst, parent, cfgelem, first, value, 1, DDSI_MAX_RECV_BATCH_SIZE);
+}
+
+static enum update_result uf_recv_shards(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int first, const char *value)
+{
+  return uf_int_min_max(cfgst, parent, cfgelem, first, value, 1, DDSI_MAX_RECV_SHARDS);
+}
+
+static enum update_result uf_dqueue_shards(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int first, const char *value)
+{
+  return uf_int_min_max(cfgst, parent, cfgelem, first, value, 1, DDSI_MAX_DQUEUE_SHARDS);
+}
+
+static enum update_result uf_io_uring_send_slots(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int first, const char *value)
+{
+  return uf_int_min_max(cfgst, parent, cfgelem, first, value, 1, 4096);
+}
+
 static enum update_result uf_uint (struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, UNUSED_ARG (int first), const char *value)
 {
   uint32_t * const elem = cfg_address (cfgst, parent, cfgelem);
@@ -2297,6 +2409,8 @@ struct cfgst *config_init (const char *config, struct ddsi_config *cfg, uint32_t
         ok1 = !(cfgst->cfg->compat_tcp_enable == DDSI_BOOLDEF_TRUE || cfgst->cfg->compat_use_ipv6 == DDSI_BOOLDEF_FALSE);
         break;
       case DDSI_TRANS_RAWETH:
+      case DDSI_TRANS_SHMRING:
+      case DDSI_TRANS_INPROC:
         ok1 = !(cfgst->cfg->compat_tcp_enable == DDSI_BOOLDEF_TRUE || cfgst->cfg->compat_use_ipv6 == DDSI_BOOLDEF_TRUE);
         break;
     }
@@ -1535,6 +1535,18 @@ static void addrset_from_locatorlists_collect_interfaces (const ddsi_xlocator_t
   }
 }
 
+#ifndef DDS_HAS_NETWORK_CHANNELS
+static struct nn_dqueue *user_dqueue_for_writer (const struct ddsi_domaingv *gv, const ddsi_guid_t *guid)
+{
+  /* All data from one writer must go through the same delivery queue to
+     retain the order, any (reasonable) hash of the GUID will do */
+  const uint64_t h =
+    ((uint64_t) (guid->prefix.u[0] ^ guid->prefix.u[1]) + UINT64_C (16292676669999574021)) *
+    ((uint64_t) (guid->prefix.u[2] ^ guid->entityid.u) + UINT64_C (10242350189706880077));
+  return gv->user_dqueues[(uint32_t) (h >> 32) % gv->n_user_dqueues];
+}
+#endif
+
 static void handle_sedp_alive_endpoint (const struct receiver_state *rst, seqno_t seq, ddsi_plist_t *datap /* note: potentially modifies datap */, ddsi_sedp_kind_t sedp_kind, const ddsi_guid_prefix_t *src_guid_prefix, nn_vendorid_t vendorid, ddsrt_wctime_t timestamp)
 {
 #define E(msg, lbl) do { GVLOGDISC (msg); goto lbl; } while (0)
@@ -1698,7 +1710,7 @@ static void handle_sedp_alive_endpoint (const struct receiver_state *rst, seqno_
           new_proxy_writer (gv, &ppguid, &datap->endpoint_guid, as, datap, channel->dqueue, channel->evq ? channel->evq : gv->xevents, timestamp, seq);
         }
 #else
-        new_proxy_writer (gv, &ppguid, &datap->endpoint_guid, as, datap, gv->user_dqueue, gv->xevents, timestamp, seq);
+        new_proxy_writer (gv, &ppguid, &datap->endpoint_guid, as, datap, user_dqueue_for_writer (gv, &datap->endpoint_guid), gv->xevents, timestamp, seq);
 #endif
       }
     }
@@ -33,6 +33,7 @@
 #include "dds/ddsi/q_protocol.h" /* NN_ENTITYID_... */
 #include "dds/ddsi/q_unused.h"
 #include "dds/ddsi/q_debmon.h"
+#include "dds/ddsi/ddsi_statistics.h"
 #include "dds/ddsi/ddsi_serdata.h"
 #include "dds/ddsi/ddsi_tran.h"
 #include "dds/ddsi/ddsi_tcp.h"
@@ -308,6 +309,22 @@ static int print_proxy_participants (struct thread_state1 * const ts1, struct dd
   return x;
 }
 
+static int print_dqueues (struct ddsi_domaingv *gv, ddsi_tran_conn_t conn)
+{
+  const uint32_t n = ddsi_get_dqueue_shard_count (gv);
+  int x = 0;
+  for (uint32_t i = 0; i < n; i++)
+  {
+    uint32_t depth, max_depth, lat[DDSI_LATENCY_NBUCKETS];
+    ddsi_get_dqueue_shard_stats (gv, i, &depth, &max_depth, lat);
+    x += cpf (conn, "dqueue %"PRIu32" depth %"PRIu32" max %"PRIu32" latency", i, depth, max_depth);
+    for (uint32_t j = 0; j < DDSI_LATENCY_NBUCKETS; j++)
+      x += cpf (conn, " %"PRIu32, lat[j]);
+    x += cpf (conn, "\n");
+  }
+  return x;
+}
+
 static void debmon_handle_connection (struct debug_monitor *dm, ddsi_tran_conn_t conn)
 {
   struct thread_state1 * const ts1 = lookup_thread_state ();
@@ -316,6 +333,8 @@ static void debmon_handle_connection (struct debug_monitor *dm, ddsi_tran_conn_t
   r += print_participants (ts1, dm->gv, conn);
   if (r == 0)
     r += print_proxy_participants (ts1, dm->gv, conn);
+  if (r == 0)
+    r += print_dqueues (dm->gv, conn);
 
   /* Note: can only add plugins (at the tail) */
   ddsrt_mutex_lock (&dm->lock);
@@ -334,70 +334,80 @@ static void entity_common_fini (struct entity_common *e)
 
 static void local_reader_ary_init (struct local_reader_ary *x)
 {
+  struct reader **rdary = ddsrt_malloc (sizeof (*rdary));
+  rdary[0] = NULL;
   ddsrt_mutex_init (&x->rdary_lock);
   x->valid = 1;
-  x->fastpath_ok = 1;
+  ddsrt_atomic_st32 (&x->fastpath_ok, 1);
   x->n_readers = 0;
-  x->rdary = ddsrt_malloc (sizeof (*x->rdary));
-  x->rdary[0] = NULL;
+  ddsrt_atomic_stvoidp (&x->rdary, rdary);
 }
 
 static void local_reader_ary_fini (struct local_reader_ary *x)
 {
-  ddsrt_free (x->rdary);
+  /* the owner is freed by the garbage collector, so no one can be using it */
+  ddsrt_free (ddsrt_atomic_ldvoidp (&x->rdary));
   ddsrt_mutex_destroy (&x->rdary_lock);
 }
 
-static void local_reader_ary_insert (struct local_reader_ary *x, struct reader *rd)
+static void gc_local_reader_ary_cb (struct gcreq *gcreq)
 {
-  ddsrt_mutex_lock (&x->rdary_lock);
-  x->rdary = ddsrt_realloc (x->rdary, (x->n_readers + 2) * sizeof (*x->rdary));
-  if (x->n_readers <= 1 || rd->type == x->rdary[x->n_readers - 1]->type)
-  {
-    /* if the first or second reader, or if the type is the same as that of
-       the last one in the list simply appending the new will maintain order */
-    x->rdary[x->n_readers] = rd;
-  }
+  void *rdary = gcreq->arg;
+  gcreq_free (gcreq);
+  ddsrt_free (rdary);
+}
+
+static void local_reader_ary_publish (struct local_reader_ary *x, struct ddsi_domaingv *gv, struct reader **rdary)
+{
+  /* contents must be visible before the pointer, the old one can only be
+     freed once all threads that might still be delivering through it have
+     made progress */
+  struct reader **old = ddsrt_atomic_ldvoidp (&x->rdary);
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_stvoidp (&x->rdary, rdary);
+  if (gv->gcreq_queue == NULL)
+    ddsrt_free (old);
   else
   {
-    uint32_t i;
-    for (i = 0; i < x->n_readers; i++)
-      if (x->rdary[i]->type == rd->type)
-        break;
-    if (i < x->n_readers)
-    {
-      /* shift any with the same type plus whichever follow to make room */
-      memmove (&x->rdary[i + 1], &x->rdary[i], (x->n_readers - i) * sizeof (x->rdary[i]));
-    }
-    x->rdary[i] = rd;
+    struct gcreq *gcreq = gcreq_new (gv->gcreq_queue, gc_local_reader_ary_cb);
+    gcreq->arg = old;
+    gcreq_enqueue (gcreq);
   }
-  x->rdary[x->n_readers + 1] = NULL;
+}
+
+static void local_reader_ary_insert (struct local_reader_ary *x, struct reader *rd)
+{
+  ddsrt_mutex_lock (&x->rdary_lock);
+  struct reader * const * const cur = ddsrt_atomic_ldvoidp (&x->rdary);
+  struct reader **rdary = ddsrt_malloc ((x->n_readers + 2) * sizeof (*rdary));
+  uint32_t i;
+  /* insert it in front of the first one with the same type to keep it grouped
+     by type, or at the end if there is none */
+  for (i = 0; i < x->n_readers; i++)
+    if (cur[i]->type == rd->type)
+      break;
+  memcpy (rdary, cur, i * sizeof (*rdary));
+  rdary[i] = rd;
+  memcpy (&rdary[i + 1], &cur[i], (x->n_readers - i) * sizeof (*rdary));
+  rdary[x->n_readers + 1] = NULL;
   x->n_readers++;
+  local_reader_ary_publish (x, rd->e.gv, rdary);
   ddsrt_mutex_unlock (&x->rdary_lock);
 }
 
 static void local_reader_ary_remove (struct local_reader_ary *x, struct reader *rd)
 {
-  uint32_t i;
   ddsrt_mutex_lock (&x->rdary_lock);
-  for (i = 0; i < x->n_readers; i++)
-    if (x->rdary[i] == rd)
-      break;
-  assert (i < x->n_readers);
-  if (i + 1 < x->n_readers)
-  {
-    /* dropping the final one never requires any fixups; dropping one that has
-       the same type as the last is as simple as moving the last one in the
-       removed one's location; else shift all following readers to keep it
-       grouped by type */
-    if (rd->type == x->rdary[x->n_readers - 1]->type)
-      x->rdary[i] = x->rdary[x->n_readers - 1];
-    else
-      memmove (&x->rdary[i], &x->rdary[i + 1], (x->n_readers - i - 1) * sizeof (x->rdary[i]));
-  }
+  struct reader * const * const cur = ddsrt_atomic_ldvoidp (&x->rdary);
+  struct reader **rdary = ddsrt_malloc (x->n_readers * sizeof (*rdary));
+  uint32_t i, j;
+  for (i = 0, j = 0; i < x->n_readers; i++)
+    if (cur[i] != rd)
+      rdary[j++] = cur[i];
+  assert (j + 1 == x->n_readers);
+  rdary[j] = NULL;
   x->n_readers--;
-  x->rdary[x->n_readers] = NULL;
-  x->rdary = ddsrt_realloc (x->rdary, (x->n_readers + 1) * sizeof (*x->rdary));
+  local_reader_ary_publish (x, rd->e.gv, rdary);
   ddsrt_mutex_unlock (&x->rdary_lock);
 }
 
@@ -405,7 +415,7 @@ void local_reader_ary_setfastpath_ok (struct local_reader_ary *x, bool fastpath_
 {
   ddsrt_mutex_lock (&x->rdary_lock);
   if (x->valid)
-    x->fastpath_ok = fastpath_ok;
+    ddsrt_atomic_st32 (&x->fastpath_ok, fastpath_ok);
   ddsrt_mutex_unlock (&x->rdary_lock);
 }
 
@@ -413,7 +423,7 @@ static void local_reader_ary_setinvalid (struct local_reader_ary *x)
 {
   ddsrt_mutex_lock (&x->rdary_lock);
   x->valid = 0;
-  x->fastpath_ok = 0;
+  ddsrt_atomic_st32 (&x->fastpath_ok, 0);
   ddsrt_mutex_unlock (&x->rdary_lock);
 }
 
@@ -4353,6 +4363,7 @@ static dds_return_t new_reader_guid
   rd->request_keyhash = rd->type->request_keyhash;
   rd->ddsi2direct_cb = 0;
   rd->ddsi2direct_cbarg = 0;
+  ddsi_latency_stats_init (&rd->latency_stats);
   rd->init_acknack_count = 1;
   rd->num_writers = 0;
 #ifdef DDS_HAS_SSM
@@ -4468,28 +4479,12 @@ dds_return_t new_reader
   return new_reader_guid (rd_out, rdguid, group_guid, pp, topic_name, type, xqos, rhc, status_cb, status_cbarg);
 }
 
-static void gc_delete_reader (struct gcreq *gcreq)
+static void gc_delete_reader_final (struct gcreq *gcreq)
 {
-  /* see gc_delete_writer for comments */
   struct reader *rd = gcreq->arg;
-  ELOGDISC (rd, "gc_delete_reader(%p, "PGUIDFMT")\n", (void *) gcreq, PGUID (rd->e.guid));
+  ELOGDISC (rd, "gc_delete_reader_final(%p, "PGUIDFMT")\n", (void *) gcreq, PGUID (rd->e.guid));
   gcreq_free (gcreq);
 
-  while (!ddsrt_avl_is_empty (&rd->writers))
-  {
-    struct rd_pwr_match *m = ddsrt_avl_root_non_empty (&rd_writers_treedef, &rd->writers);
-    ddsrt_avl_delete (&rd_writers_treedef, &rd->writers, m);
-    proxy_writer_drop_connection (&m->pwr_guid, rd);
-    free_rd_pwr_match (rd->e.gv, &rd->e.guid, m);
-  }
-  while (!ddsrt_avl_is_empty (&rd->local_writers))
-  {
-    struct rd_wr_match *m = ddsrt_avl_root_non_empty (&rd_local_writers_treedef, &rd->local_writers);
-    ddsrt_avl_delete (&rd_local_writers_treedef, &rd->local_writers, m);
-    writer_drop_local_connection (&m->wr_guid, rd);
-    free_rd_wr_match (m);
-  }
-
 #ifdef DDS_HAS_SECURITY
   q_omg_security_deregister_reader(rd);
 #endif
@@ -4519,6 +4514,38 @@ static void gc_delete_reader (struct gcreq *gcreq)
   ddsrt_free (rd);
 }
 
+static void gc_delete_reader (struct gcreq *gcreq)
+{
+  /* see gc_delete_writer for comments */
+  struct reader *rd = gcreq->arg;
+  ELOGDISC (rd, "gc_delete_reader(%p, "PGUIDFMT")\n", (void *) gcreq, PGUID (rd->e.guid));
+  gcreq_free (gcreq);
+
+  while (!ddsrt_avl_is_empty (&rd->writers))
+  {
+    struct rd_pwr_match *m = ddsrt_avl_root_non_empty (&rd_writers_treedef, &rd->writers);
+    ddsrt_avl_delete (&rd_writers_treedef, &rd->writers, m);
+    proxy_writer_drop_connection (&m->pwr_guid, rd);
+    free_rd_pwr_match (rd->e.gv, &rd->e.guid, m);
+  }
+  while (!ddsrt_avl_is_empty (&rd->local_writers))
+  {
+    struct rd_wr_match *m = ddsrt_avl_root_non_empty (&rd_local_writers_treedef, &rd->local_writers);
+    ddsrt_avl_delete (&rd_local_writers_treedef, &rd->local_writers, m);
+    writer_drop_local_connection (&m->wr_guid, rd);
+    free_rd_wr_match (m);
+  }
+
+  /* Threads delivering data without locking through a snapshot of a
+     writer's or proxy writer's reader array taken before the reader was
+     removed from it may still be using the reader and its history cache,
+     so the remainder has to wait until all threads have made progress
+     again (see local_reader_ary_publish). */
+  struct gcreq *gcreq_final = gcreq_new (rd->e.gv->gcreq_queue, gc_delete_reader_final);
+  gcreq_final->arg = rd;
+  gcreq_enqueue (gcreq_final);
+}
+
 dds_return_t delete_reader (struct ddsi_domaingv *gv, const struct ddsi_guid *guid)
 {
   struct reader *rd;
@@ -6057,6 +6084,11 @@ int new_proxy_writer (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid,
   } else {
     pwr->deliver_synchronously = 0;
   }
+  pwr->adaptive_delivery = pwr->deliver_synchronously && gv->config.synchronous_delivery_cost_bound != DDS_INFINITY;
+  pwr->delivery_stats.avg_cost = 0;
+  pwr->delivery_stats.busy = 0;
+  pwr->delivery_stats.tstart = ddsrt_time_monotonic ();
+  pwr->delivery_stats.utilisation = 0;
   /* Pretend we have seen a heartbeat if the proxy writer is a best-effort one */
   isreliable = (pwr->c.xqos->reliability.kind != DDS_RELIABILITY_BEST_EFFORT);
   pwr->have_seen_heartbeat = !isreliable;
@@ -6093,13 +6125,14 @@ int new_proxy_writer (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid,
     pwr->lease = NULL;
   }
 
+  const uint32_t defrag_contig_max = (gv->config.defrag_contig_max_size < gv->config.max_sample_size) ? gv->config.defrag_contig_max_size : gv->config.max_sample_size;
   if (isreliable)
   {
-    pwr->defrag = nn_defrag_new (&gv->logconfig, NN_DEFRAG_DROP_LATEST, gv->config.defrag_reliable_maxsamples);
+    pwr->defrag = nn_defrag_new (&gv->logconfig, NN_DEFRAG_DROP_LATEST, gv->config.defrag_reliable_maxsamples, gv->config.defrag_contig_threshold, defrag_contig_max);
   }
   else
   {
-    pwr->defrag = nn_defrag_new (&gv->logconfig, NN_DEFRAG_DROP_OLDEST, gv->config.defrag_unreliable_maxsamples);
+    pwr->defrag = nn_defrag_new (&gv->logconfig, NN_DEFRAG_DROP_OLDEST, gv->config.defrag_unreliable_maxsamples, gv->config.defrag_contig_threshold, defrag_contig_max);
   }
   reorder_mode = get_proxy_writer_reorder_mode(pwr->e.guid.entityid, isreliable);
   pwr->reorder = nn_reorder_new (&gv->logconfig, reorder_mode, gv->config.primary_reorder_maxsamples, gv->config.late_ack_mode);
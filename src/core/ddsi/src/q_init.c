@@ -18,6 +18,7 @@
 #include "dds/ddsrt/time.h"
 #include "dds/ddsrt/string.h"
 #include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/static_assert.h"
 
 #include "dds/ddsrt/avl.h"
 
@@ -56,6 +57,8 @@
 #include "dds/ddsi/ddsi_udp.h"
 #include "dds/ddsi/ddsi_tcp.h"
 #include "dds/ddsi/ddsi_raweth.h"
+#include "dds/ddsi/ddsi_shmring.h"
+#include "dds/ddsi/ddsi_inproc.h"
 #include "dds/ddsi/ddsi_vnet.h"
 #include "dds/ddsi/ddsi_mcgroup.h"
 #include "dds/ddsi/ddsi_serdata_default.h"
@@ -91,6 +94,26 @@ enum make_uc_sockets_ret {
   MUSRET_ERROR          /* generic error, no use continuing */
 };
 
+static bool use_multiple_receive_threads (const struct ddsi_config *cfg);
+
+static uint32_t recv_shards (const struct ddsi_domaingv *gv)
+{
+  /* Sharing the data port only helps if each socket gets a receive thread of
+     its own, which is only the case with a single unicast data socket */
+#if DDSRT_HAVE_REUSEPORT
+  if (gv->config.recv_shards > 1)
+  {
+    if ((gv->config.transport_selector == DDSI_TRANS_UDP || gv->config.transport_selector == DDSI_TRANS_UDP6) &&
+        gv->config.many_sockets_mode == DDSI_MSM_SINGLE_UNICAST && use_multiple_receive_threads (&gv->config))
+      return (uint32_t) gv->config.recv_shards;
+    GVLOG (DDS_LC_CONFIG, "ReceiveShards requires UDP, ManySocketsMode single and MultipleReceiveThreads\n");
+  }
+#else
+  (void) gv;
+#endif
+  return 1;
+}
+
 static enum make_uc_sockets_ret make_uc_sockets (struct ddsi_domaingv *gv, uint32_t * pdisc, uint32_t * pdata, int ppid)
 {
   dds_return_t rc;
@@ -117,18 +140,44 @@ static enum make_uc_sockets_ret make_uc_sockets (struct ddsi_domaingv *gv, uint3
   if (rc != DDS_RETCODE_OK)
     goto fail_disc;
 
-  if (*pdata == 0 || *pdata == *pdisc)
+  const uint32_t shards = recv_shards (gv);
+  if ((*pdata == 0 && shards == 1) || (*pdata != 0 && *pdata == *pdisc))
     gv->data_conn_uc = gv->disc_conn_uc;
   else
   {
-    rc = ddsi_factory_create_conn (&gv->data_conn_uc, gv->m_factory, *pdata, &qos);
+    /* Without a participant index, data normally shares the discovery
+       socket, but sharding needs a socket of its own: so create one on a
+       random port and bind the shards to the port it got */
+    const ddsi_tran_qos_t data_qos = { .m_purpose = DDSI_TRAN_QOS_RECV_UC, .m_diffserv = 0, .m_interface = NULL, .m_shards = shards };
+    rc = ddsi_factory_create_conn (&gv->data_conn_uc, gv->m_factory, *pdata, &data_qos);
     if (rc != DDS_RETCODE_OK)
       goto fail_data;
+    if (*pdata == 0)
+    {
+      ddsi_locator_t loc;
+      ddsi_conn_locator (gv->data_conn_uc, &loc);
+      *pdata = loc.port;
+    }
+    for (gv->n_data_conn_uc_shards = 0; gv->n_data_conn_uc_shards + 1 < data_qos.m_shards; gv->n_data_conn_uc_shards++)
+    {
+      rc = ddsi_factory_create_conn (&gv->data_conn_uc_shards[gv->n_data_conn_uc_shards], gv->m_factory, *pdata, &data_qos);
+      if (rc != DDS_RETCODE_OK)
+        goto fail_shards;
+    }
   }
   ddsi_conn_locator (gv->disc_conn_uc, &gv->loc_meta_uc);
   ddsi_conn_locator (gv->data_conn_uc, &gv->loc_default_uc);
   return MUSRET_SUCCESS;
 
+fail_shards:
+  while (gv->n_data_conn_uc_shards > 0)
+  {
+    gv->n_data_conn_uc_shards--;
+    ddsi_conn_free (gv->data_conn_uc_shards[gv->n_data_conn_uc_shards]);
+    gv->data_conn_uc_shards[gv->n_data_conn_uc_shards] = NULL;
+  }
+  ddsi_conn_free (gv->data_conn_uc);
+  gv->data_conn_uc = NULL;
 fail_data:
   ddsi_conn_free (gv->disc_conn_uc);
   gv->disc_conn_uc = NULL;
@@ -431,10 +480,10 @@ static int known_channel_p (const struct ddsi_domaingv *gv, const char *name)
 static int check_thread_properties (const struct ddsi_domaingv *gv)
 {
 #ifdef DDS_HAS_NETWORK_CHANNELS
-  static const char *fixed[] = { "recv", "tev", "gc", "lease", "dq.builtins", "debmon", "fsm", NULL };
+  static const char *fixed[] = { "recv", "recvMC", "recvUC", "recvUC1", "recvUC2", "recvUC3", "recvUC4", "recvUC5", "recvUC6", "recvUC7", "tev", "tcpsend", "gc", "lease", "dq.builtins", "debmon", "fsm", NULL };
   static const char *chanprefix[] = { "xmit.", "tev.","dq.",NULL };
 #else
-  static const char *fixed[] = { "recv", "tev", "gc", "lease", "dq.builtins", "xmit.user", "dq.user", "debmon", "fsm", NULL };
+  static const char *fixed[] = { "recv", "recvMC", "recvUC", "recvUC1", "recvUC2", "recvUC3", "recvUC4", "recvUC5", "recvUC6", "recvUC7", "tev", "tcpsend", "gc", "lease", "dq.builtins", "xmit.user", "dq.user", "dq.user1", "dq.user2", "dq.user3", "dq.user4", "dq.user5", "dq.user6", "dq.user7", "dq.user8", "dq.user9", "dq.user10", "dq.user11", "dq.user12", "dq.user13", "dq.user14", "dq.user15", "debmon", "fsm", NULL };
 #endif
   const struct ddsi_config_thread_properties_listelem *e;
   int ok = 1, i;
@@ -954,6 +1003,37 @@ static bool use_multiple_receive_threads (const struct ddsi_config *cfg)
   return false;
 }
 
+static dds_return_t new_recv_thread_rbufpools (struct ddsi_domaingv *gv, struct recv_thread_arg *arg)
+{
+  /* Batched reads need a pool per datagram in a batch, and only make sense for
+     connectionless transports (see recv_thread) */
+  const uint32_t n = (gv->m_factory->m_connless && gv->config.recv_batch_size > 1) ? (uint32_t) gv->config.recv_batch_size : 1;
+  arg->rbpools = ddsrt_malloc (n * sizeof (*arg->rbpools));
+  for (arg->nrbpools = 0; arg->nrbpools < n; arg->nrbpools++)
+  {
+    if ((arg->rbpools[arg->nrbpools] = nn_rbufpool_new (&gv->logconfig, gv->config.rbuf_size, gv->config.rmsg_chunk_size)) == NULL)
+      return DDS_RETCODE_OUT_OF_RESOURCES;
+  }
+  arg->rbpool = arg->rbpools[0];
+  return DDS_RETCODE_OK;
+}
+
+static void free_recv_thread_rbufpools (struct recv_thread_arg *arg)
+{
+  for (uint32_t i = 0; i < arg->nrbpools; i++)
+    nn_rbufpool_free (arg->rbpools[i]);
+  ddsrt_free (arg->rbpools);
+  arg->rbpools = NULL;
+  arg->nrbpools = 0;
+  arg->rbpool = NULL;
+}
+
+/* Thread names for the receive threads serving data_conn_uc_shards */
+static const char *recv_shard_thread_names[DDSI_MAX_RECV_SHARDS - 1] = {
+  "recvUC1", "recvUC2", "recvUC3", "recvUC4", "recvUC5", "recvUC6", "recvUC7"
+};
+DDSRT_STATIC_ASSERT (DDSI_MAX_RECV_SHARDS == 8);
+
 static int setup_and_start_recv_threads (struct ddsi_domaingv *gv)
 {
   const bool multi_recv_thr = use_multiple_receive_threads (&gv->config);
@@ -963,9 +1043,12 @@ static int setup_and_start_recv_threads (struct ddsi_domaingv *gv)
     gv->recv_threads[i].ts = NULL;
     gv->recv_threads[i].arg.mode = RTM_SINGLE;
     gv->recv_threads[i].arg.rbpool = NULL;
+    gv->recv_threads[i].arg.nrbpools = 0;
+    gv->recv_threads[i].arg.rbpools = NULL;
     gv->recv_threads[i].arg.gv = gv;
     gv->recv_threads[i].arg.u.single.loc = NULL;
     gv->recv_threads[i].arg.u.single.conn = NULL;
+    gv->recv_threads[i].arg.u.single.shard = 0;
   }
 
   /* First thread always uses a waitset and gobbles up all sockets not handled by dedicated threads - FIXME: DDSI_MSM_NO_UNICAST mode with UDP probably doesn't even need this one to use a waitset */
@@ -993,6 +1076,18 @@ static int setup_and_start_recv_threads (struct ddsi_domaingv *gv)
       gv->recv_threads[gv->n_recv_threads].arg.u.single.loc = &gv->loc_default_uc;
       ddsi_conn_disable_multiplexing (gv->data_conn_uc);
       gv->n_recv_threads++;
+
+      /* Sockets sharing the data port each get a thread as well */
+      for (uint32_t i = 0; i < gv->n_data_conn_uc_shards; i++)
+      {
+        gv->recv_threads[gv->n_recv_threads].name = recv_shard_thread_names[i];
+        gv->recv_threads[gv->n_recv_threads].arg.mode = RTM_SINGLE;
+        gv->recv_threads[gv->n_recv_threads].arg.u.single.conn = gv->data_conn_uc_shards[i];
+        gv->recv_threads[gv->n_recv_threads].arg.u.single.loc = &gv->loc_default_uc;
+        gv->recv_threads[gv->n_recv_threads].arg.u.single.shard = i + 1;
+        ddsi_conn_disable_multiplexing (gv->data_conn_uc_shards[i]);
+        gv->n_recv_threads++;
+      }
     }
   }
   assert (gv->n_recv_threads <= MAX_RECV_THREADS);
@@ -1003,7 +1098,7 @@ static int setup_and_start_recv_threads (struct ddsi_domaingv *gv)
     /* We create the rbufpool for the receive thread, and so we'll
        become the initial owner thread. The receive thread will change
        it before it does anything with it. */
-    if ((gv->recv_threads[i].arg.rbpool = nn_rbufpool_new (&gv->logconfig, gv->config.rbuf_size, gv->config.rmsg_chunk_size)) == NULL)
+    if (new_recv_thread_rbufpools (gv, &gv->recv_threads[i].arg) != DDS_RETCODE_OK)
     {
       GVERROR ("rtps_init: can't allocate receive buffer pool for thread %s\n", gv->recv_threads[i].name);
       goto fail;
@@ -1032,8 +1127,7 @@ fail:
   {
     if (gv->recv_threads[i].arg.mode == RTM_MANY && gv->recv_threads[i].arg.u.many.ws)
       os_sockWaitsetFree (gv->recv_threads[i].arg.u.many.ws);
-    if (gv->recv_threads[i].arg.rbpool)
-      nn_rbufpool_free (gv->recv_threads[i].arg.rbpool);
+    free_recv_thread_rbufpools (&gv->recv_threads[i].arg);
   }
   return -1;
 }
@@ -1097,9 +1191,11 @@ static void free_conns (struct ddsi_domaingv *gv)
 {
   // Depending on settings, various "conn"s can alias others, this makes sure we free each one only once
   // FIXME: perhaps store them in a table instead?
-  ddsi_tran_conn_t cs[4 + MAX_XMIT_CONNS] = { gv->disc_conn_mc, gv->data_conn_mc, gv->disc_conn_uc, gv->data_conn_uc };
+  ddsi_tran_conn_t cs[4 + MAX_XMIT_CONNS + DDSI_MAX_RECV_SHARDS - 1] = { gv->disc_conn_mc, gv->data_conn_mc, gv->disc_conn_uc, gv->data_conn_uc };
   for (size_t i = 0; i < MAX_XMIT_CONNS; i++)
     cs[4 + i] = gv->xmit_conns[i];
+  for (size_t i = 0; i < DDSI_MAX_RECV_SHARDS - 1; i++)
+    cs[4 + MAX_XMIT_CONNS + i] = gv->data_conn_uc_shards[i];
   for (size_t i = 0; i < sizeof (cs) / sizeof (cs[0]); i++)
   {
     if (cs[i] == NULL)
@@ -1326,6 +1422,9 @@ int rtps_init (struct ddsi_domaingv *gv)
 
   gv->disc_conn_uc = NULL;
   gv->data_conn_uc = NULL;
+  gv->n_data_conn_uc_shards = 0;
+  for (size_t i = 0; i < DDSI_MAX_RECV_SHARDS - 1; i++)
+    gv->data_conn_uc_shards[i] = NULL;
   gv->disc_conn_mc = NULL;
   gv->data_conn_mc = NULL;
   for (size_t i = 0; i < MAX_XMIT_CONNS; i++)
@@ -1384,6 +1483,27 @@ int rtps_init (struct ddsi_domaingv *gv)
         goto err_udp_tcp_init;
       gv->m_factory = ddsi_factory_find (gv, "raweth");
       break;
+    case DDSI_TRANS_SHMRING:
+      gv->config.publish_uc_locators = 1;
+      gv->config.enable_uc_locators = 1;
+      /* multicast means writing into the rings of all members, which is fine
+         for SPDP but too expensive for data */
+      if (gv->config.allowMulticast & DDSI_AMC_DEFAULT)
+        gv->config.allowMulticast = DDSI_AMC_SPDP;
+      if (ddsi_shmring_init (gv) < 0)
+        goto err_udp_tcp_init;
+      gv->m_factory = ddsi_factory_find (gv, "shmring");
+      break;
+    case DDSI_TRANS_INPROC:
+      gv->config.publish_uc_locators = 1;
+      gv->config.enable_uc_locators = 1;
+      /* likewise, multicast is a loop over all members with a global lock held */
+      if (gv->config.allowMulticast & DDSI_AMC_DEFAULT)
+        gv->config.allowMulticast = DDSI_AMC_SPDP;
+      if (ddsi_inproc_init (gv) < 0)
+        goto err_udp_tcp_init;
+      gv->m_factory = ddsi_factory_find (gv, "inproc");
+      break;
   }
   gv->m_factory->m_enable = true;
 
@@ -1561,7 +1681,7 @@ int rtps_init (struct ddsi_domaingv *gv)
 
   ddsrt_mutex_init (&gv->lock);
   ddsrt_mutex_init (&gv->spdp_lock);
-  gv->spdp_defrag = nn_defrag_new (&gv->logconfig, NN_DEFRAG_DROP_OLDEST, gv->config.defrag_unreliable_maxsamples);
+  gv->spdp_defrag = nn_defrag_new (&gv->logconfig, NN_DEFRAG_DROP_OLDEST, gv->config.defrag_unreliable_maxsamples, 0, 0);
   gv->spdp_reorder = nn_reorder_new (&gv->logconfig, NN_REORDER_MODE_ALWAYS_DELIVER, gv->config.primary_reorder_maxsamples, false);
 
   gv->m_tkmap = ddsi_tkmap_new (gv);
@@ -1623,6 +1743,8 @@ int rtps_init (struct ddsi_domaingv *gv)
       assert(0);
     }
     GVLOG (DDS_LC_CONFIG, "rtps_init: uc ports: disc %"PRIu32" data %"PRIu32"\n", port_disc_uc, port_data_uc);
+    if (gv->config.recv_shards > 1 && gv->n_data_conn_uc_shards == 0)
+      GVWARNING ("Internal/ReceiveShards ignored: requires UDP on Linux, ManySocketsMode single and MultipleReceiveThreads\n");
   }
   GVLOG (DDS_LC_CONFIG, "rtps_init: domainid %"PRIu32" participantid %d\n", gv->config.domainId, gv->config.participantIndex);
 
@@ -1684,6 +1806,13 @@ int rtps_init (struct ddsi_domaingv *gv)
       {
         gv->data_conn_uc = gv->data_conn_mc;
         gv->disc_conn_uc = gv->disc_conn_mc;
+        /* make_uc_sockets left the unicast locators unset and the transmit
+           connection was taken from data_conn_uc before it existed */
+        ddsi_conn_locator (gv->disc_conn_uc, &gv->loc_meta_uc);
+        ddsi_conn_locator (gv->data_conn_uc, &gv->loc_default_uc);
+        gv->xmit_conns[0] = gv->data_conn_uc;
+        gv->intf_xlocators[0].conn = gv->xmit_conns[0];
+        gv->intf_xlocators[0].c = gv->interfaces[0].loc;
       }
 
       /* Set multicast locators */
@@ -1843,12 +1972,21 @@ int rtps_init (struct ddsi_domaingv *gv)
   gv->sendq_running = false;
   ddsrt_mutex_init (&gv->sendq_running_lock);
 
-  gv->builtins_dqueue = nn_dqueue_new ("builtins", gv, gv->config.delivery_queue_maxsamples, builtins_dqueue_handler, NULL);
+  gv->builtins_dqueue = nn_dqueue_new ("builtins", gv, gv->config.delivery_queue_maxsamples, builtins_dqueue_handler, NULL, NULL);
 #ifdef DDS_HAS_NETWORK_CHANNELS
   for (struct ddsi_config_channel_listelem *chptr = gv->config.channels; chptr; chptr = chptr->next)
-    chptr->dqueue = nn_dqueue_new (chptr->name, &gv->config, gv->config.delivery_queue_maxsamples, user_dqueue_handler, NULL);
+    chptr->dqueue = nn_dqueue_new (chptr->name, &gv->config, gv->config.delivery_queue_maxsamples, user_dqueue_handler, user_dqueue_batch_handler, NULL);
 #else
-  gv->user_dqueue = nn_dqueue_new ("user", gv, gv->config.delivery_queue_maxsamples, user_dqueue_handler, NULL);
+  gv->n_user_dqueues = (uint32_t) gv->config.delivery_queue_shards;
+  for (uint32_t i = 0; i < gv->n_user_dqueues; i++)
+  {
+    char name[16];
+    if (i == 0)
+      (void) snprintf (name, sizeof (name), "user");
+    else
+      (void) snprintf (name, sizeof (name), "user%"PRIu32, i);
+    gv->user_dqueues[i] = nn_dqueue_new (name, gv, gv->config.delivery_queue_maxsamples, user_dqueue_handler, user_dqueue_batch_handler, NULL);
+  }
 #endif
 
   if (reset_deaf_mute_time.v < DDS_NEVER)
@@ -2174,8 +2312,10 @@ void rtps_stop (struct ddsi_domaingv *gv)
 
 void rtps_fini (struct ddsi_domaingv *gv)
 {
-  /* Shut down the GC system -- no new requests will be added */
+  /* Shut down the GC system -- no new requests will be added; the TCP
+     connection cache checks for a null pointer and frees immediately */
   gcreq_queue_free (gv->gcreq_queue);
+  gv->gcreq_queue = NULL;
 
   /* No new data gets added to any admin, all synchronous processing
      has ended, so now we can drain the delivery queues to end up with
@@ -2190,7 +2330,8 @@ void rtps_fini (struct ddsi_domaingv *gv)
     chptr = chptr->next;
   }
 #else
-  nn_dqueue_free (gv->user_dqueue);
+  for (uint32_t i = 0; i < gv->n_user_dqueues; i++)
+    nn_dqueue_free (gv->user_dqueues[i]);
 #endif
 
 #ifdef DDS_HAS_SECURITY
@@ -2252,7 +2393,7 @@ void rtps_fini (struct ddsi_domaingv *gv)
   {
     if (gv->recv_threads[i].arg.mode == RTM_MANY)
       os_sockWaitsetFree (gv->recv_threads[i].arg.u.many.ws);
-    nn_rbufpool_free (gv->recv_threads[i].arg.rbpool);
+    free_recv_thread_rbufpools (&gv->recv_threads[i].arg);
   }
 
   ddsi_tkmap_free (gv->m_tkmap);
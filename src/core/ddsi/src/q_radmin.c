@@ -42,6 +42,7 @@
 #include "dds/ddsi/q_bitset.h"
 #include "dds/ddsi/q_thread.h"
 #include "dds/ddsi/ddsi_domaingv.h" /* for mattr, cattr */
+#include "dds/ddsi/ddsi_statistics.h"
 
 /* OVERVIEW ------------------------------------------------------------
 
@@ -81,19 +82,12 @@
                 allocate memory from the rbufs contained in the pool
                 and increment reference counts to the messages in it,
                 while all threads may decrement these reference counts
-                / release memory from it.
-
-                (It is probably better to share the pool amongst all
-                threads and make the rbuf the thing owned by this
-                thread; and in fact the buffer pool isn't really
-                necessary 'cos they handle multiple messages and
-                therefore the malloc/free overhead is negligible.  It
-                does provide a convenient location for storing some
-                constant data.)
+                / release memory from it.  Emptied rbufs are returned
+                to the owner via a lock-free list.
 
    nn_rbuf
 
-                Largish buffer for receiving several UDP packets and
+                Fixed-size slab for receiving several UDP packets and
                 for storing partially decoded and indexing information
                 directly following the packet.
 
@@ -242,6 +236,10 @@
    you can't get anything through anymore if there are multiple
    writers.
 
+   The alternative is nonetheless available for samples larger than a
+   configurable threshold (see DEFRAG), because for very large samples
+   it avoids copying the data when converting it to a serdata.
+
    Gaps and Heartbeats prune the defragmenting index and are (when
    needed) stored as intervals of specially marked rdatas in the
    reordering indices.
@@ -272,16 +270,26 @@ struct nn_rbufpool {
      only allocating rmsgs from the rbufs in the pool. Any thread may
      be releasing buffers to the pool as they become empty.
 
-     Currently, we only have maintain a current rbuf, which gets
-     replaced when allocating a new one from it fails. Any rbufs that
-     are released are freed completely if different from the current
-     one.
-
-     Could trivially be done lockless, except that it requires
-     compare-and-swap, and we don't have that. But it hardly ever
-     happens anyway. */
+     The owner allocates from the current rbuf, which gets replaced when
+     allocating a new message from it fails.  Whichever thread drops the
+     last reference to an rbuf pushes it on the "remote_free" stack.
+     The owner moves those to its private list of spare rbufs when it
+     needs a new one, so that rbufs all of the same size get recycled
+     without going through the heap, and frees those in excess of
+     MAX_SPARE_RBUFS, so that memory use follows the number of rbufs
+     that still contain live messages.
+
+     Popping the whole stack at once is safe from the ABA problem as
+     there is only a single thread taking entries from it. */
   ddsrt_mutex_t lock;
   struct nn_rbuf *current;
+  struct nn_rbuf *spare; /* owner only */
+  uint32_t nspare; /* owner only */
+  ddsrt_atomic_voidp_t remote_free;
+  ddsrt_atomic_uint32_t nremote_free;
+  uint32_t nrbufs; /* owner only, all rbufs, including spare and current */
+  uint32_t nrbufs_peak; /* owner only */
+  uint64_t nrecycled; /* owner only */
   uint32_t rbuf_size;
   uint32_t max_rmsg_size;
   const struct ddsrt_log_cfg *logcfg;
@@ -293,15 +301,18 @@ struct nn_rbufpool {
 #endif
 };
 
+#define MAX_SPARE_RBUFS 1u
+
 static struct nn_rbuf *nn_rbuf_alloc_new (struct nn_rbufpool *rbp);
 static void nn_rbuf_release (struct nn_rbuf *rbuf);
+static void nn_rbufpool_reclaim (struct nn_rbufpool *rbp, uint32_t max_spare);
 
 #define TRACE_CFG(obj, logcfg, ...) ((obj)->trace ? (void) DDS_CLOG (DDS_LC_RADMIN, (logcfg), __VA_ARGS__) : (void) 0)
 #define TRACE(obj, ...)             TRACE_CFG ((obj), (obj)->logcfg, __VA_ARGS__)
 #define RBPTRACE(...)               TRACE_CFG (rbp, rbp->logcfg, __VA_ARGS__)
-#define RBUFTRACE(...)              TRACE_CFG (rbuf, rbuf->rbufpool->logcfg, __VA_ARGS__)
-#define RMSGTRACE(...)              TRACE_CFG (rmsg, rmsg->chunk.rbuf->rbufpool->logcfg, __VA_ARGS__)
-#define RDATATRACE(rdata, ...)      TRACE_CFG ((rdata)->rmsg, (rdata)->rmsg->chunk.rbuf->rbufpool->logcfg, __VA_ARGS__)
+#define RBUFTRACE(...)              TRACE_CFG (rbuf, rbuf->logcfg, __VA_ARGS__)
+#define RMSGTRACE(...)              TRACE_CFG (rmsg, rmsg->chunk.rbuf->logcfg, __VA_ARGS__)
+#define RDATATRACE(rdata, ...)      TRACE_CFG ((rdata)->rmsg, (rdata)->rmsg->chunk.rbuf->logcfg, __VA_ARGS__)
 
 static uint32_t align_rmsg (uint32_t x)
 {
@@ -357,6 +368,13 @@ struct nn_rbufpool *nn_rbufpool_new (const struct ddsrt_log_cfg *logcfg, uint32_
 
   ddsrt_mutex_init (&rbp->lock);
 
+  rbp->spare = NULL;
+  rbp->nspare = 0;
+  ddsrt_atomic_stvoidp (&rbp->remote_free, NULL);
+  ddsrt_atomic_st32 (&rbp->nremote_free, 0);
+  rbp->nrbufs = 0;
+  rbp->nrbufs_peak = 0;
+  rbp->nrecycled = 0;
   rbp->rbuf_size = rbuf_size;
   rbp->max_rmsg_size = max_rmsg_size;
   rbp->logcfg = logcfg;
@@ -397,6 +415,8 @@ void nn_rbufpool_free (struct nn_rbufpool *rbp)
   ASSERT_RBUFPOOL_OWNER (rbp);
 #endif
   nn_rbuf_release (rbp->current);
+  nn_rbufpool_reclaim (rbp, 0);
+  assert (rbp->nrbufs == 0);
 #if USE_VALGRIND
   VALGRIND_DESTROY_MEMPOOL (rbp);
 #endif
@@ -404,14 +424,30 @@ void nn_rbufpool_free (struct nn_rbufpool *rbp)
   ddsrt_free (rbp);
 }
 
+void nn_rbufpool_get_stats (const struct nn_rbufpool *rbp, struct nn_rbufpool_stats *st)
+{
+  /* Only meaningful when called by the owner, the number on the remote
+     free list may be slightly out of date */
+  const uint32_t nremote = ddsrt_atomic_ld32 (&rbp->nremote_free);
+  st->rbuf_size = rbp->rbuf_size;
+  st->nrbufs = rbp->nrbufs;
+  st->nrbufs_peak = rbp->nrbufs_peak;
+  st->nspare = rbp->nspare + nremote;
+  st->npinned = (rbp->nrbufs > 1 + st->nspare) ? rbp->nrbufs - 1 - st->nspare : 0;
+  st->nrecycled = rbp->nrecycled;
+}
+
 /* RBUF ---------------------------------------------------------------- */
 
 struct nn_rbuf {
   ddsrt_atomic_uint32_t n_live_rmsg_chunks;
   uint32_t size;
   uint32_t max_rmsg_size;
-  struct nn_rbufpool *rbufpool;
+  struct nn_rbufpool *rbufpool; /* NULL if contig */
+  struct nn_rbuf *next_free;
+  const struct ddsrt_log_cfg *logcfg;
   bool trace;
+  bool contig; /* holds a single sample being reassembled, not part of the pool */
 
   /* Allocating sequentially, releasing in random order, not bothering
      to reuse memory as soon as it becomes available again. I think
@@ -430,22 +466,69 @@ struct nn_rbuf {
   unsigned char raw[];
 };
 
+static void nn_rbufpool_reclaim (struct nn_rbufpool *rbp, uint32_t max_spare)
+{
+  struct nn_rbuf *rb;
+  void *head;
+  do {
+    head = ddsrt_atomic_ldvoidp (&rbp->remote_free);
+  } while (head != NULL && !ddsrt_atomic_casvoidp (&rbp->remote_free, head, NULL));
+  for (rb = head; rb != NULL; )
+  {
+    struct nn_rbuf * const next = rb->next_free;
+    ddsrt_atomic_dec32 (&rbp->nremote_free);
+    if (rbp->nspare < max_spare)
+    {
+      rb->next_free = rbp->spare;
+      rbp->spare = rb;
+      rbp->nspare++;
+    }
+    else
+    {
+      RBPTRACE ("rbuf_reclaim(%p) free %p\n", (void *) rbp, (void *) rb);
+      rbp->nrbufs--;
+      ddsrt_free (rb);
+    }
+    rb = next;
+  }
+  while (rbp->nspare > max_spare)
+  {
+    rb = rbp->spare;
+    rbp->spare = rb->next_free;
+    rbp->nspare--;
+    rbp->nrbufs--;
+    ddsrt_free (rb);
+  }
+}
+
 static struct nn_rbuf *nn_rbuf_alloc_new (struct nn_rbufpool *rbp)
 {
   struct nn_rbuf *rb;
   ASSERT_RBUFPOOL_OWNER (rbp);
 
-  if ((rb = ddsrt_malloc (sizeof (struct nn_rbuf) + rbp->rbuf_size)) == NULL)
+  nn_rbufpool_reclaim (rbp, MAX_SPARE_RBUFS);
+  if ((rb = rbp->spare) != NULL)
+  {
+    rbp->spare = rb->next_free;
+    rbp->nspare--;
+    rbp->nrecycled++;
+  }
+  else if ((rb = ddsrt_malloc (sizeof (struct nn_rbuf) + rbp->rbuf_size)) == NULL)
     return NULL;
+  else if (++rbp->nrbufs > rbp->nrbufs_peak)
+    rbp->nrbufs_peak = rbp->nrbufs;
 #if USE_VALGRIND
   VALGRIND_MAKE_MEM_NOACCESS (rb->raw, rbp->rbuf_size);
 #endif
 
   rb->rbufpool = rbp;
+  rb->next_free = NULL;
+  rb->contig = false;
   ddsrt_atomic_st32 (&rb->n_live_rmsg_chunks, 1);
   rb->size = rbp->rbuf_size;
   rb->max_rmsg_size = rbp->max_rmsg_size;
   rb->freeptr = rb->raw;
+  rb->logcfg = rbp->logcfg;
   rb->trace = rbp->trace;
   RBPTRACE ("rbuf_alloc_new(%p) = %p\n", (void *) rbp, (void *) rb);
   return rb;
@@ -469,11 +552,24 @@ static struct nn_rbuf *nn_rbuf_new (struct nn_rbufpool *rbp)
 static void nn_rbuf_release (struct nn_rbuf *rbuf)
 {
   struct nn_rbufpool *rbp = rbuf->rbufpool;
+  if (rbuf->contig)
+  {
+    /* may outlive the pool it was created for */
+    RBUFTRACE ("rbuf_release(%p) contig\n", (void *) rbuf);
+    if (ddsrt_atomic_dec32_ov (&rbuf->n_live_rmsg_chunks) == 1)
+      ddsrt_free (rbuf);
+    return;
+  }
   RBPTRACE ("rbuf_release(%p) pool %p current %p\n", (void *) rbuf, (void *) rbp, (void *) rbp->current);
   if (ddsrt_atomic_dec32_ov (&rbuf->n_live_rmsg_chunks) == 1)
   {
+    void *head;
     RBPTRACE ("rbuf_release(%p) free\n", (void *) rbuf);
-    ddsrt_free (rbuf);
+    ddsrt_atomic_inc32 (&rbp->nremote_free);
+    do {
+      head = ddsrt_atomic_ldvoidp (&rbp->remote_free);
+      rbuf->next_free = head;
+    } while (!ddsrt_atomic_casvoidp (&rbp->remote_free, head, rbuf));
   }
 }
 
@@ -587,7 +683,9 @@ void nn_rmsg_free (struct nn_rmsg *rmsg)
     struct nn_rbuf *rbuf = c->rbuf;
     struct nn_rmsg_chunk *c1 = c->next;
 #if USE_VALGRIND
-    if (c == &rmsg->chunk) {
+    if (rbuf->contig) {
+      /* not allocated from the pool */
+    } else if (c == &rmsg->chunk) {
       VALGRIND_MEMPOOL_FREE (rbuf->rbufpool, rmsg);
     } else {
       VALGRIND_MEMPOOL_FREE (rbuf->rbufpool, c);
@@ -825,7 +923,33 @@ static void nn_rdata_unref (struct nn_rdata *rdata)
    fragmented message will have at least one interval allocated to it
    and thus have sufficient space for the chain node.
 
-   FIXME: These AVL trees are overkill.  Either switch to parent-less
+   If the fragment size is known, which it always is for a sample
+   that is really fragmented, the intervals are instead tracked using
+   a bitmap with a bit per fragment (nn_defrag_fragmap), allocated in
+   the first rmsg just like the interval nodes.  That turns checking
+   for completeness, merging with neighbouring fragments and
+   generating NACKs into a handful of word-sized operations rather
+   than a tree walk, which matters when there are many fragments per
+   sample and retransmits cause them to arrive out-of-order.  A
+   fragment is retained only if it completes at least one fragment
+   that was still missing; retained fragments are chained in order of
+   arrival, which typically is in-order, and sorted only if necessary
+   upon completion of the sample.  The interval tree remains in use
+   only when the bitmap can't be allocated.
+
+   Samples of at least contig_threshold bytes are instead reassembled
+   in a contiguous buffer (nn_defrag_contig) allocated when the first
+   fragment arrives, in memory that is not part of the receive buffer
+   pool.  The fragments are copied into place on arrival and a bitmap
+   tracks which ones have been received, so that only the rdata that
+   provides the sampleinfo need be retained.  On completion, the
+   fragment chain is formed by that rdata (then necessarily the first
+   fragment) followed by an rdata covering the buffer, see also
+   nn_fragchain_claim_contig.  The size of the buffer comes from the
+   first fragment to arrive, so samples claiming to be larger than
+   contig_max bytes are reassembled the normal way.
+
+   FIXME: These AVL trees (well, the remaining ones) are overkill.  Either switch to parent-less
    red-black trees (they have better performance anyway and only need
    a single bit of state) or to splay trees (must have a parent
    because they can degenerate to linear structures, unless the number
@@ -839,6 +963,33 @@ struct nn_defrag_iv {
   struct nn_rdata *last;
 };
 
+struct nn_defrag_fragmap {
+  struct nn_rdata *first;   /* retained fragments, in order of arrival */
+  struct nn_rdata *last;
+  uint32_t fragsize;
+  uint32_t nfrags;
+  uint32_t nmissing;
+  bool sorted;              /* whether order of arrival is in order of min */
+  uint32_t bitmap[];        /* received fragments */
+};
+
+/* fragment map is re-used as sample chain element once complete */
+DDSRT_STATIC_ASSERT (sizeof (struct nn_defrag_fragmap) >= sizeof (struct nn_rsample_chain_elem));
+
+DDSRT_STATIC_ASSERT ((NN_RDATA_CONTIG_HEADROOM % 8) == 4);
+
+struct nn_defrag_contig {
+  struct nn_rdata *rdata;   /* covering the entire sample, in the same rmsg as this */
+  struct nn_rdata *info;    /* providing sampleinfo, first fragment once received */
+  struct nn_rsample_chain_elem *sce; /* for the conversion to reorder format */
+  uint32_t size;
+  uint32_t fragsize;
+  uint32_t nfrags;
+  uint32_t nmissing;
+  ddsrt_atomic_uint32_t claimed;
+  uint32_t bitmap[];        /* received fragments */
+};
+
 struct nn_rsample {
   union {
     struct nn_rsample_defrag {
@@ -846,6 +997,8 @@ struct nn_rsample {
       ddsrt_avl_tree_t fragtree;
       struct nn_defrag_iv *lastfrag;
       struct nn_rsample_info *sampleinfo;
+      struct nn_defrag_fragmap *fragmap; /* non-NULL: fragtree is not used */
+      struct nn_defrag_contig *contig; /* non-NULL: fragtree is not used */
       seqno_t seq;
     } defrag;
     struct nn_rsample_reorder {
@@ -862,6 +1015,8 @@ struct nn_defrag {
   struct nn_rsample *max_sample; /* = max(sampletree) */
   uint32_t n_samples;
   uint32_t max_samples;
+  uint32_t contig_threshold;
+  uint32_t contig_max;
   enum nn_defrag_drop_mode drop_mode;
   uint64_t discarded_bytes;
   const struct ddsrt_log_cfg *logcfg;
@@ -888,7 +1043,7 @@ static int compare_seqno (const void *va, const void *vb)
   return (a == b) ? 0 : (a < b) ? -1 : 1;
 }
 
-struct nn_defrag *nn_defrag_new (const struct ddsrt_log_cfg *logcfg, enum nn_defrag_drop_mode drop_mode, uint32_t max_samples)
+struct nn_defrag *nn_defrag_new (const struct ddsrt_log_cfg *logcfg, enum nn_defrag_drop_mode drop_mode, uint32_t max_samples, uint32_t contig_threshold, uint32_t contig_max)
 {
   struct nn_defrag *d;
   assert (max_samples >= 1);
@@ -897,6 +1052,8 @@ struct nn_defrag *nn_defrag_new (const struct ddsrt_log_cfg *logcfg, enum nn_def
   ddsrt_avl_init (&defrag_sampletree_treedef, &d->sampletree);
   d->drop_mode = drop_mode;
   d->max_samples = max_samples;
+  d->contig_threshold = contig_threshold;
+  d->contig_max = contig_max;
   d->n_samples = 0;
   d->max_sample = NULL;
   d->discarded_bytes = 0;
@@ -941,6 +1098,20 @@ static void defrag_rsample_drop (struct nn_defrag *defrag, struct nn_rsample *rs
   ddsrt_avl_delete (&defrag_sampletree_treedef, &defrag->sampletree, rsample);
   assert (defrag->n_samples > 0);
   defrag->n_samples--;
+  if (rsample->u.defrag.contig)
+  {
+    /* the rsample is stored in the contiguous buffer, so that one goes last */
+    struct nn_defrag_contig * const contig = rsample->u.defrag.contig;
+    if (contig->info)
+      nn_fragchain_rmbias (contig->info);
+    nn_fragchain_rmbias (contig->rdata);
+    return;
+  }
+  if (rsample->u.defrag.fragmap)
+  {
+    nn_fragchain_rmbias (rsample->u.defrag.fragmap->first);
+    return;
+  }
   for (iv = ddsrt_avl_iter_first (&rsample_defrag_fragtree_treedef, &rsample->u.defrag.fragtree, &iter); iv; iv = ddsrt_avl_iter_next (&iter))
   {
     if (iv->first)
@@ -1014,10 +1185,15 @@ static int defrag_try_merge_with_succ (const struct nn_defrag *defrag, struct nn
 
     node->last->nextfrag = succ->first;
     node->last = succ->last;
-    node->maxp1 = succ_maxp1;
+    if (node->maxp1 < succ_maxp1)
+    {
+      node->maxp1 = succ_maxp1;
+      return 0;
+    }
 
     /* if the new fragment contains data beyond succ it may even
-       allow merging with succ-succ */
+       allow merging with succ-succ (and node must not shrink to succ,
+       or the data beyond it would be requested again) */
     return node->maxp1 > succ_maxp1;
   }
 }
@@ -1052,6 +1228,8 @@ static struct nn_rsample *defrag_rsample_new (struct nn_rdata *rdata, const stru
   rsample_init_common (rsample, rdata, sampleinfo);
   dfsample = &rsample->u.defrag;
   dfsample->lastfrag = NULL;
+  dfsample->fragmap = NULL;
+  dfsample->contig = NULL;
   dfsample->seq = sampleinfo->seq;
   if ((dfsample->sampleinfo = nn_rmsg_alloc (rdata->rmsg, sizeof (*dfsample->sampleinfo))) == NULL)
     return NULL;
@@ -1077,6 +1255,167 @@ static struct nn_rsample *defrag_rsample_new (struct nn_rdata *rdata, const stru
   return rsample;
 }
 
+static uint32_t defrag_nfrags (uint32_t size, uint32_t fragsize)
+{
+  return size / fragsize + (size % fragsize != 0);
+}
+
+static void defrag_fragrange (uint32_t size, uint32_t fragsize, uint32_t nfrags, uint32_t min, uint32_t maxp1, uint32_t *fmin, uint32_t *fmaxp1)
+{
+  /* Fragments entirely covered by [min,maxp1), which can only differ
+     from the fragments in the DATAFRAG if the sender changed the
+     fragment size */
+  *fmin = min / fragsize + (min % fragsize != 0);
+  *fmaxp1 = (maxp1 >= size) ? nfrags : maxp1 / fragsize;
+  if (*fmin > *fmaxp1)
+    *fmin = *fmaxp1;
+}
+
+static struct nn_rsample *defrag_rsample_new_fragmap (struct nn_defrag *defrag, struct nn_rdata *rdata, const struct nn_rsample_info *sampleinfo)
+{
+  /* Returns NULL if the sample can't be tracked using a fragment map,
+     in which case the caller falls back to the interval tree, or the
+     sample if it can, with rdata recorded in it, just like
+     defrag_rsample_new */
+  const uint32_t fragsize = sampleinfo->fragsize;
+  struct nn_defrag_fragmap *fm;
+  struct nn_rsample *rsample;
+  struct nn_rsample_defrag *dfsample;
+  uint32_t nfrags, fmin, fmaxp1;
+  size_t fmsize;
+
+  if (fragsize == 0)
+    return NULL;
+  nfrags = defrag_nfrags (sampleinfo->size, fragsize);
+  fmsize = offsetof (struct nn_defrag_fragmap, bitmap) + 4 * (((size_t) nfrags + 31) / 32);
+  if (fmsize > rdata->rmsg->chunk.rbuf->max_rmsg_size / 4)
+    return NULL;
+
+  if ((rsample = nn_rmsg_alloc (rdata->rmsg, sizeof (*rsample))) == NULL)
+    return NULL;
+  rsample_init_common (rsample, rdata, sampleinfo);
+  dfsample = &rsample->u.defrag;
+  dfsample->lastfrag = NULL;
+  dfsample->contig = NULL;
+  dfsample->seq = sampleinfo->seq;
+  if ((dfsample->sampleinfo = nn_rmsg_alloc (rdata->rmsg, sizeof (*dfsample->sampleinfo))) == NULL)
+    return NULL;
+  *dfsample->sampleinfo = *sampleinfo;
+  ddsrt_avl_init (&rsample_defrag_fragtree_treedef, &dfsample->fragtree);
+  if ((fm = dfsample->fragmap = nn_rmsg_alloc (rdata->rmsg, (uint32_t) fmsize)) == NULL)
+    return NULL;
+  fm->fragsize = fragsize;
+  fm->nfrags = nfrags;
+  fm->sorted = true;
+  nn_bitset_zero (nfrags, fm->bitmap);
+
+  /* the rsample lives in this rdata's rmsg, so it must be retained even
+     if it doesn't complete a single fragment */
+  defrag_fragrange (sampleinfo->size, fragsize, nfrags, rdata->min, rdata->maxp1, &fmin, &fmaxp1);
+  fm->nmissing = nfrags - nn_bitset_set_range (nfrags, fm->bitmap, fmin, fmaxp1);
+  nn_rdata_addbias (rdata);
+  rdata->nextfrag = NULL;
+  fm->first = fm->last = rdata;
+  TRACE (defrag, "  fragmap %p nfrags %"PRIu32" missing %"PRIu32"\n", (void *) fm, nfrags, fm->nmissing);
+  return rsample;
+}
+
+static size_t align_contig (size_t x)
+{
+  return (x + ALIGNOF_RMSG - 1) & ~(size_t) (ALIGNOF_RMSG - 1);
+}
+
+static struct nn_rsample *defrag_rsample_new_contig (struct nn_defrag *defrag, struct nn_rdata *rdata, const struct nn_rsample_info *sampleinfo)
+{
+  /* Allocates a single block containing an rbuf with an rmsg that in turn
+     contains the admin, headroom, payload and rdata, rsample, sampleinfo
+     and sample chain element:
+
+       rbuf | rmsg | contig admin + bitmap | headroom | payload | rdata ...
+
+     The rmsg starts out with a reference for the rdata covering the
+     payload, which the defragmenter holds until the sample is complete.
+     Returns NULL if the sample is not suitable, in which case the caller
+     falls back to the normal method. */
+  const uint32_t size = sampleinfo->size;
+  const uint32_t fragsize = sampleinfo->fragsize;
+  struct nn_defrag_contig *contig;
+  struct nn_rsample *rsample;
+  struct nn_rbuf *rbuf;
+  struct nn_rmsg *rmsg;
+  struct nn_rdata *d;
+
+  if (fragsize == 0 || size < 4)
+    return NULL;
+  const uint32_t nfrags = defrag_nfrags (size, fragsize);
+  const size_t admin_size = offsetof (struct nn_defrag_contig, bitmap) + 4 * (((size_t) nfrags + 31) / 32);
+  /* rmsg payload is aligned, so this puts the payload at 4 mod 8 */
+  const size_t payload_off = align_contig (admin_size) + NN_RDATA_CONTIG_HEADROOM;
+  const size_t rdata_off = align_contig (payload_off + size);
+  const size_t rsample_off = rdata_off + align_contig (sizeof (struct nn_rdata));
+  const size_t info_off = rsample_off + align_contig (sizeof (struct nn_rsample));
+  const size_t sce_off = info_off + align_contig (sizeof (struct nn_rsample_info));
+  const size_t area = sce_off + align_contig (sizeof (struct nn_rsample_chain_elem));
+  if (payload_off >= 65536 || area > UINT32_MAX - sizeof (*rmsg))
+    return NULL;
+  if ((rbuf = ddsrt_malloc_s (sizeof (*rbuf) + sizeof (*rmsg) + area)) == NULL)
+    return NULL;
+
+  ddsrt_atomic_st32 (&rbuf->n_live_rmsg_chunks, 1);
+  rbuf->size = (uint32_t) (sizeof (*rmsg) + area);
+  rbuf->max_rmsg_size = rbuf->size;
+  /* The claimant of the sample (e.g., a serdata constructed in place) may
+     release it after the pool and the domain have been freed, so it can't
+     reference either of them, and that includes the log configuration */
+  rbuf->rbufpool = NULL;
+  rbuf->next_free = NULL;
+  rbuf->logcfg = NULL;
+  rbuf->trace = false;
+  rbuf->contig = true;
+  rbuf->freeptr = rbuf->raw + rbuf->size;
+
+  rmsg = (struct nn_rmsg *) rbuf->raw;
+  ddsrt_atomic_st32 (&rmsg->refcount, RMSG_REFCOUNT_RDATA_BIAS);
+  rmsg->chunk.rbuf = rbuf;
+  rmsg->chunk.next = NULL;
+  rmsg->chunk.u.size = (uint32_t) area;
+  rmsg->lastchunk = &rmsg->chunk;
+  rmsg->trace = false;
+
+  contig = (struct nn_defrag_contig *) NN_RMSG_PAYLOAD (rmsg);
+  d = contig->rdata = (struct nn_rdata *) NN_RMSG_PAYLOADOFF (rmsg, rdata_off);
+  d->rmsg = rmsg;
+  d->nextfrag = NULL;
+  d->min = 0;
+  d->maxp1 = size;
+  d->submsg_zoff = 0;
+  d->payload_zoff = (uint16_t) NN_OFF_TO_ZOFF (payload_off);
+  d->keyhash_zoff = 0;
+#ifndef NDEBUG
+  ddsrt_atomic_st32 (&d->refcount_bias_added, 1);
+#endif
+  contig->info = NULL;
+  contig->sce = (struct nn_rsample_chain_elem *) NN_RMSG_PAYLOADOFF (rmsg, sce_off);
+  contig->size = size;
+  contig->fragsize = fragsize;
+  contig->nfrags = nfrags;
+  contig->nmissing = nfrags;
+  ddsrt_atomic_st32 (&contig->claimed, 0);
+  nn_bitset_zero (nfrags, contig->bitmap);
+
+  rsample = (struct nn_rsample *) NN_RMSG_PAYLOADOFF (rmsg, rsample_off);
+  rsample_init_common (rsample, rdata, sampleinfo);
+  rsample->u.defrag.lastfrag = NULL;
+  rsample->u.defrag.fragmap = NULL;
+  rsample->u.defrag.contig = contig;
+  rsample->u.defrag.seq = sampleinfo->seq;
+  rsample->u.defrag.sampleinfo = (struct nn_rsample_info *) NN_RMSG_PAYLOADOFF (rmsg, info_off);
+  *rsample->u.defrag.sampleinfo = *sampleinfo;
+  ddsrt_avl_init (&rsample_defrag_fragtree_treedef, &rsample->u.defrag.fragtree);
+  TRACE (defrag, "  contig %p rmsg %p nfrags %"PRIu32"\n", (void *) contig, (void *) rmsg, nfrags);
+  return rsample;
+}
+
 static struct nn_rsample *reorder_rsample_new (struct nn_rdata *rdata, const struct nn_rsample_info *sampleinfo)
 {
   /* Implements:
@@ -1146,14 +1485,31 @@ static void rsample_convert_defrag_to_reorder (struct nn_rsample *sample)
      self-respecting compiler will optimise them away, and any
      self-respecting CPU would need to copy them via registers anyway
      because it uses a load-store architecture. */
-  struct nn_defrag_iv *iv = ddsrt_avl_root_non_empty (&rsample_defrag_fragtree_treedef, &sample->u.defrag.fragtree);
-  struct nn_rdata *fragchain = iv->first;
+  struct nn_rdata *fragchain;
   struct nn_rsample_info *sampleinfo = sample->u.defrag.sampleinfo;
   struct nn_rsample_chain_elem *sce;
   seqno_t seq = sample->u.defrag.seq;
 
-  /* re-use memory fragment interval node for sample chain */
-  sce = (struct nn_rsample_chain_elem *) ddsrt_avl_root_non_empty (&rsample_defrag_fragtree_treedef, &sample->u.defrag.fragtree);
+  if (sample->u.defrag.contig)
+  {
+    struct nn_defrag_contig * const contig = sample->u.defrag.contig;
+    fragchain = contig->info;
+    fragchain->nextfrag = contig->rdata;
+    sce = contig->sce;
+  }
+  else if (sample->u.defrag.fragmap)
+  {
+    /* re-use memory of the fragment map for sample chain */
+    fragchain = sample->u.defrag.fragmap->first;
+    sce = (struct nn_rsample_chain_elem *) sample->u.defrag.fragmap;
+  }
+  else
+  {
+    /* re-use memory fragment interval node for sample chain */
+    struct nn_defrag_iv *iv = ddsrt_avl_root_non_empty (&rsample_defrag_fragtree_treedef, &sample->u.defrag.fragtree);
+    fragchain = iv->first;
+    sce = (struct nn_rsample_chain_elem *) iv;
+  }
   sce->fragchain = fragchain;
   sce->next = NULL;
   sce->sampleinfo = sampleinfo;
@@ -1277,6 +1633,127 @@ static struct nn_rsample *defrag_add_fragment (struct nn_defrag *defrag, struct
   }
 }
 
+static struct nn_rsample *defrag_add_fragment_contig (struct nn_defrag *defrag, struct nn_rsample *sample, struct nn_rdata *rdata, const struct nn_rsample_info *sampleinfo)
+{
+  /* Copies the data into place and marks the fragments it covers
+     completely.  The rdata that provides the sampleinfo is retained
+     because sampleinfo references it, just like the first fragment in
+     the normal case; it is replaced by the first fragment once that
+     arrives, because that one also provides the submessage header and
+     inline QoS. */
+  struct nn_rsample_defrag * const dfsample = &sample->u.defrag;
+  struct nn_defrag_contig * const contig = dfsample->contig;
+  const uint32_t min = rdata->min;
+  const uint32_t maxp1 = (rdata->maxp1 < contig->size) ? rdata->maxp1 : contig->size;
+  const bool new_info = (contig->info == NULL || (min == 0 && contig->info->min != 0));
+  uint32_t fmin, fmaxp1, nnew;
+
+  defrag_fragrange (contig->size, contig->fragsize, contig->nfrags, min, maxp1, &fmin, &fmaxp1);
+  nnew = nn_bitset_set_range (contig->nfrags, contig->bitmap, fmin, fmaxp1);
+  if (nnew == 0 && !new_info)
+  {
+    TRACE (defrag, "  contig: no new fragments\n");
+    defrag->discarded_bytes += rdata->maxp1 - min;
+    return NULL;
+  }
+  if (min < maxp1)
+  {
+    unsigned char *dst = NN_RMSG_PAYLOADOFF (contig->rdata->rmsg, NN_RDATA_PAYLOAD_OFF (contig->rdata));
+    memcpy (dst + min, NN_RMSG_PAYLOADOFF (rdata->rmsg, NN_RDATA_PAYLOAD_OFF (rdata)), maxp1 - min);
+  }
+  contig->nmissing -= nnew;
+  if (new_info)
+  {
+    struct nn_rdata * const old = contig->info;
+    nn_rdata_addbias (rdata);
+    rdata->nextfrag = NULL;
+    contig->info = rdata;
+    *dfsample->sampleinfo = *sampleinfo;
+    if (old)
+      nn_fragchain_rmbias (old);
+  }
+  TRACE (defrag, "  contig: %"PRIu32" new fragments, %"PRIu32" missing\n", nnew, contig->nmissing);
+  return (contig->nmissing == 0 && contig->info->min == 0) ? sample : NULL;
+}
+
+static struct nn_rdata *fragchain_merge (struct nn_rdata *a, struct nn_rdata *b)
+{
+  struct nn_rdata *head = NULL, **tail = &head;
+  while (a && b)
+  {
+    if (b->min < a->min)
+    {
+      *tail = b;
+      b = b->nextfrag;
+    }
+    else
+    {
+      *tail = a;
+      a = a->nextfrag;
+    }
+    tail = &(*tail)->nextfrag;
+  }
+  *tail = a ? a : b;
+  return head;
+}
+
+static struct nn_rdata *fragchain_sort (struct nn_rdata *chain)
+{
+  /* Merge sort on min, stable so overlapping fragments remain in order
+     of arrival */
+  struct nn_rdata *slow = chain, *fast, *second;
+  if (chain == NULL || chain->nextfrag == NULL)
+    return chain;
+  fast = chain->nextfrag;
+  while (fast && fast->nextfrag)
+  {
+    slow = slow->nextfrag;
+    fast = fast->nextfrag->nextfrag;
+  }
+  second = slow->nextfrag;
+  slow->nextfrag = NULL;
+  return fragchain_merge (fragchain_sort (chain), fragchain_sort (second));
+}
+
+static struct nn_rsample *defrag_add_fragment_fragmap (struct nn_defrag *defrag, struct nn_rsample *sample, struct nn_rdata *rdata, const struct nn_rsample_info *sampleinfo)
+{
+  struct nn_rsample_defrag * const dfsample = &sample->u.defrag;
+  struct nn_defrag_fragmap * const fm = dfsample->fragmap;
+  uint32_t fmin, fmaxp1, nnew;
+
+  assert (dfsample->seq == sampleinfo->seq);
+  assert (rdata->min < rdata->maxp1);
+  defrag_fragrange (dfsample->sampleinfo->size, fm->fragsize, fm->nfrags, rdata->min, rdata->maxp1, &fmin, &fmaxp1);
+  if ((nnew = nn_bitset_set_range (fm->nfrags, fm->bitmap, fmin, fmaxp1)) == 0)
+  {
+    TRACE (defrag, "  fragmap: no new fragments\n");
+    defrag->discarded_bytes += rdata->maxp1 - rdata->min;
+    return NULL;
+  }
+  fm->nmissing -= nnew;
+  nn_rdata_addbias (rdata);
+  rdata->nextfrag = NULL;
+  if (rdata->min < fm->last->min)
+    fm->sorted = false;
+  fm->last->nextfrag = rdata;
+  fm->last = rdata;
+  /* any fragment starting at byte 0 necessarily completes fragment 0 and
+     so will only get here once: use the sample info contributed by the
+     first fragment */
+  if (rdata->min == 0)
+    *dfsample->sampleinfo = *sampleinfo;
+  TRACE (defrag, "  fragmap: %"PRIu32" new fragments, %"PRIu32" missing\n", nnew, fm->nmissing);
+  if (fm->nmissing > 0)
+    return NULL;
+  if (!fm->sorted)
+  {
+    fm->first = fragchain_sort (fm->first);
+    fm->sorted = true;
+  }
+  assert (fm->first->min == 0);
+  return sample;
+}
+
 static int nn_rdata_is_fragment (const struct nn_rdata *rdata, const struct nn_rsample_info *sampleinfo)
 {
   /* sanity check: min, maxp1 must be within bounds */
@@ -1327,6 +1804,29 @@ static int defrag_limit_samples (struct nn_defrag *defrag, seqno_t seq, seqno_t
   return 1;
 }
 
+static struct nn_rsample *defrag_rsample_new_any (struct nn_defrag *defrag, struct nn_rdata *rdata, const struct nn_rsample_info *sampleinfo)
+{
+  struct nn_rsample *sample;
+  /* the size is whatever the first fragment claims, so the buffer size is
+     capped to limit what a remote writer can make us allocate */
+  if (defrag->contig_threshold > 0 && sampleinfo->size >= defrag->contig_threshold && sampleinfo->size <= defrag->contig_max &&
+      (sample = defrag_rsample_new_contig (defrag, rdata, sampleinfo)) != NULL)
+    return sample;
+  if ((sample = defrag_rsample_new_fragmap (defrag, rdata, sampleinfo)) != NULL)
+    return sample;
+  return defrag_rsample_new (rdata, sampleinfo);
+}
+
+static struct nn_rsample *defrag_add_fragment_any (struct nn_defrag *defrag, struct nn_rsample *sample, struct nn_rdata *rdata, const struct nn_rsample_info *sampleinfo)
+{
+  if (sample->u.defrag.contig)
+    return defrag_add_fragment_contig (defrag, sample, rdata, sampleinfo);
+  else if (sample->u.defrag.fragmap)
+    return defrag_add_fragment_fragmap (defrag, sample, rdata, sampleinfo);
+  else
+    return defrag_add_fragment (defrag, sample, rdata, sampleinfo);
+}
+
 struct nn_rsample *nn_defrag_rsample (struct nn_defrag *defrag, struct nn_rdata *rdata, const struct nn_rsample_info *sampleinfo)
 {
   /* Takes an rdata, records it in defrag if needed and returns an
@@ -1376,7 +1876,7 @@ struct nn_rsample *nn_defrag_rsample (struct nn_defrag *defrag, struct nn_rdata
   if (sampleinfo->seq == max_seq)
   {
     TRACE (defrag, "  add fragment to max_sample\n");
-    result = defrag_add_fragment (defrag, defrag->max_sample, rdata, sampleinfo);
+    result = defrag_add_fragment_any (defrag, defrag->max_sample, rdata, sampleinfo);
   }
   else if (!defrag_limit_samples (defrag, sampleinfo->seq, &max_seq))
   {
@@ -1390,29 +1890,29 @@ struct nn_rsample *nn_defrag_rsample (struct nn_defrag *defrag, struct nn_rdata
     /* FIXME: MERGE THIS ONE WITH THE NEXT */
     TRACE (defrag, "  new max sample\n");
     ddsrt_avl_lookup_ipath (&defrag_sampletree_treedef, &defrag->sampletree, &sampleinfo->seq, &path);
-    if ((sample = defrag_rsample_new (rdata, sampleinfo)) == NULL)
+    if ((sample = defrag_rsample_new_any (defrag, rdata, sampleinfo)) == NULL)
       return NULL;
     ddsrt_avl_insert_ipath (&defrag_sampletree_treedef, &defrag->sampletree, sample, &path);
     defrag->max_sample = sample;
     defrag->n_samples++;
-    result = NULL;
+    result = sample->u.defrag.contig ? defrag_add_fragment_contig (defrag, sample, rdata, sampleinfo) : NULL;
   }
   else if ((sample = ddsrt_avl_lookup_ipath (&defrag_sampletree_treedef, &defrag->sampletree, &sampleinfo->seq, &path)) == NULL)
   {
     /* a new sequence number, but smaller than the maximum */
     TRACE (defrag, "  new sample less than max\n");
     assert (sampleinfo->seq < max_seq);
-    if ((sample = defrag_rsample_new (rdata, sampleinfo)) == NULL)
+    if ((sample = defrag_rsample_new_any (defrag, rdata, sampleinfo)) == NULL)
       return NULL;
     ddsrt_avl_insert_ipath (&defrag_sampletree_treedef, &defrag->sampletree, sample, &path);
     defrag->n_samples++;
-    result = NULL;
+    result = sample->u.defrag.contig ? defrag_add_fragment_contig (defrag, sample, rdata, sampleinfo) : NULL;
   }
   else
   {
     /* adds (or, as the case may be, doesn't add) to a known message */
     TRACE (defrag, "  add fragment to %p\n", (void *) sample);
-    result = defrag_add_fragment (defrag, sample, rdata, sampleinfo);
+    result = defrag_add_fragment_any (defrag, sample, rdata, sampleinfo);
   }
 
   if (result != NULL)
@@ -1452,6 +1952,27 @@ void nn_defrag_notegap (struct nn_defrag *defrag, seqno_t min, seqno_t maxp1)
   defrag->max_sample = ddsrt_avl_find_max (&defrag_sampletree_treedef, &defrag->sampletree);
 }
 
+static enum nn_defrag_nackmap_result defrag_bitmap_nackmap (uint32_t nfrags, const uint32_t *bitmap, uint32_t maxfragnum, struct nn_fragment_number_set_header *map, uint32_t *mapbits, uint32_t maxsz)
+{
+  /* Bitmap runs from the first missing fragment to the last missing one
+     that has been published so far, and is the complement of the
+     received fragments in that range */
+  uint32_t base, end;
+  if (maxfragnum >= nfrags)
+    maxfragnum = nfrags - 1;
+  if ((base = nn_bitset_find_clear (nfrags, bitmap, 0)) > maxfragnum)
+    return DEFRAG_NACKMAP_ALL_ADVERTISED_FRAGMENTS_KNOWN;
+  end = nn_bitset_rfind_clear (nfrags, bitmap, maxfragnum);
+  assert (end != UINT32_MAX && end >= base);
+  map->bitmap_base = base;
+  map->numbits = (end - base + 1 > maxsz) ? maxsz : end - base + 1;
+  for (uint32_t k = 0; k < (map->numbits + 31) / 32; k++)
+    mapbits[k] = ~nn_bitset_get32 (nfrags, bitmap, base + 32 * k);
+  if ((map->numbits % 32) != 0)
+    mapbits[map->numbits / 32] &= ~(~UINT32_C(0) >> (map->numbits % 32));
+  return DEFRAG_NACKMAP_FRAGMENTS_MISSING;
+}
+
 enum nn_defrag_nackmap_result nn_defrag_nackmap (struct nn_defrag *defrag, seqno_t seq, uint32_t maxfragnum, struct nn_fragment_number_set_header *map, uint32_t *mapbits, uint32_t maxsz)
 {
   struct nn_rsample *s;
@@ -1480,6 +2001,14 @@ enum nn_defrag_nackmap_result nn_defrag_nackmap (struct nn_defrag *defrag, seqno
       return DEFRAG_NACKMAP_FRAGMENTS_MISSING;
     }
   }
+  else if (s->u.defrag.contig)
+  {
+    return defrag_bitmap_nackmap (s->u.defrag.contig->nfrags, s->u.defrag.contig->bitmap, maxfragnum, map, mapbits, maxsz);
+  }
+  else if (s->u.defrag.fragmap)
+  {
+    return defrag_bitmap_nackmap (s->u.defrag.fragmap->nfrags, s->u.defrag.fragmap->bitmap, maxfragnum, map, mapbits, maxsz);
+  }
 
   /* Limit maxfragnum to actual sample size, so that the caller can
      get accurate info without knowing maxfragnum.  MAXFRAGNUM is
@@ -1580,6 +2109,28 @@ void nn_defrag_prune (struct nn_defrag *defrag, ddsi_guid_prefix_t *dst, seqno_t
   defrag->max_sample = ddsrt_avl_find_max (&defrag_sampletree_treedef, &defrag->sampletree);
 }
 
+const struct nn_rdata *nn_fragchain_claim_contig (const struct nn_rdata *fragchain)
+{
+  /* Any thread may call this, but only while holding a reference to the
+     fragment chain, so adding a reference is safe */
+  const struct nn_rdata *rdata = fragchain->nextfrag;
+  struct nn_defrag_contig *contig;
+  if (rdata == NULL || rdata->nextfrag != NULL || !rdata->rmsg->chunk.rbuf->contig)
+    return NULL;
+  contig = (struct nn_defrag_contig *) NN_RMSG_PAYLOAD (rdata->rmsg);
+  assert (contig->rdata == rdata);
+  if (!ddsrt_atomic_cas32 (&contig->claimed, 0, 1))
+    return NULL;
+  RDATATRACE (rdata, "fragchain_claim_contig(%p) = %p\n", (void *) fragchain, (void *) rdata);
+  ddsrt_atomic_inc32 (&rdata->rmsg->refcount);
+  return rdata;
+}
+
+void nn_rdata_contig_release (const struct nn_rdata *rdata)
+{
+  nn_rmsg_unref (rdata->rmsg);
+}
+
 /* REORDER -------------------------------------------------------------
 
    The reorder index tracks out-of-order messages as non-overlapping,
@@ -1654,7 +2205,21 @@ void nn_defrag_prune (struct nn_defrag *defrag, ddsi_guid_prefix_t *dst, seqno_t
    admins that accepted it, less BIAS for the initial reference.  We
    can't use the original sample because of [CASE I], so we adjust
    based on the fragment chain instead of the sample.  Example code is
-   in the overview comment at the top of this file. */
+   in the overview comment at the top of this file.
+
+   Most out-of-order samples on a reliable stream are due to the loss
+   of a few messages, and fill a small range of sequence numbers
+   following next_seq until the retransmits arrive.  Samples within
+   NN_REORDER_WINDOW of next_seq are therefore stored in a ring indexed
+   by sequence number, with a bitmap of the sequence numbers present
+   relative to next_seq, for which insertion, delivery and computing
+   the NACK bitmap are but a few word operations.  The interval tree
+   is used for everything beyond it.  The samples in the window all
+   precede those in the tree, which is what samples go into it
+   require, and so the window is simply moved into the tree before
+   processing a gap.  All samples count towards max_samples. */
+
+#define NN_REORDER_WINDOW 256u
 
 struct nn_reorder {
   ddsrt_avl_tree_t sampleivtree;
@@ -1667,6 +2232,9 @@ struct nn_reorder {
   const struct ddsrt_log_cfg *logcfg;
   bool late_ack_mode;
   bool trace;
+  uint32_t win_n; /* number of samples in window */
+  struct nn_rsample **win; /* indexed by seq % NN_REORDER_WINDOW, allocated on first use */
+  uint32_t win_present[NN_REORDER_WINDOW / 32]; /* bit i: next_seq+i present, all 0 if win_n = 0 */
 };
 
 static const ddsrt_avl_treedef_t reorder_sampleivtree_treedef =
@@ -1687,6 +2255,9 @@ struct nn_reorder *nn_reorder_new (const struct ddsrt_log_cfg *logcfg, enum nn_r
   r->late_ack_mode = late_ack_mode;
   r->logcfg = logcfg;
   r->trace = (logcfg->c.mask & DDS_LC_RADMIN) != 0;
+  r->win_n = 0;
+  r->win = NULL;
+  nn_bitset_zero (NN_REORDER_WINDOW, r->win_present);
   return r;
 }
 
@@ -1706,10 +2277,83 @@ void nn_fragchain_unref (struct nn_rdata *frag)
   }
 }
 
+static uint32_t reorder_win_find (const struct nn_reorder *reorder, uint32_t idx)
+{
+  /* index of first sample in window at or following next_seq+idx, or
+     NN_REORDER_WINDOW if there is none */
+  while (idx < NN_REORDER_WINDOW)
+  {
+    const uint32_t k = idx / 32;
+    const uint32_t w = reorder->win_present[k] & (~UINT32_C(0) >> (idx % 32));
+    if (w)
+      return 32 * k + nn_bitset_clz32 (w);
+    idx = 32 * (k + 1);
+  }
+  return NN_REORDER_WINDOW;
+}
+
+static uint32_t reorder_win_last (const struct nn_reorder *reorder)
+{
+  /* index of last sample in window, window must not be empty */
+  uint32_t k = NN_REORDER_WINDOW / 32;
+  assert (reorder->win_n > 0);
+  while (reorder->win_present[--k] == 0)
+    assert (k > 0);
+  return 32 * k + 31 - nn_bitset_ctz32 (reorder->win_present[k]);
+}
+
+static struct nn_rsample *reorder_win_sample (const struct nn_reorder *reorder, uint32_t idx)
+{
+  return reorder->win[(uint32_t) (reorder->next_seq + idx) % NN_REORDER_WINDOW];
+}
+
+static void reorder_win_advance (struct nn_reorder *reorder, seqno_t next_seq)
+{
+  /* sets next_seq, shifting out the bits of the samples preceding it,
+     which must already have been taken out of the window */
+  assert (next_seq >= reorder->next_seq);
+  if (next_seq - reorder->next_seq >= NN_REORDER_WINDOW)
+  {
+    assert (reorder->win_n == 0);
+    nn_bitset_zero (NN_REORDER_WINDOW, reorder->win_present);
+  }
+  else
+  {
+    const uint32_t d = (uint32_t) (next_seq - reorder->next_seq);
+    for (uint32_t k = 0; k < NN_REORDER_WINDOW / 32; k++)
+      reorder->win_present[k] = nn_bitset_get32 (NN_REORDER_WINDOW, reorder->win_present, 32 * k + d);
+  }
+  reorder->next_seq = next_seq;
+#ifndef NDEBUG
+  uint32_t n = 0;
+  for (uint32_t k = 0; k < NN_REORDER_WINDOW / 32; k++)
+    n += nn_bitset_popcount32 (reorder->win_present[k]);
+  assert (n == reorder->win_n);
+#endif
+}
+
+static void reorder_win_delete_last (struct nn_reorder *reorder)
+{
+  /* like delete_last_sample, but for the window */
+  const uint32_t idx = reorder_win_last (reorder);
+  struct nn_rsample *r = reorder_win_sample (reorder, idx);
+  TRACE (reorder, "  delete_last_sample: in window\n");
+  nn_bitset_clear (NN_REORDER_WINDOW, reorder->win_present, idx);
+  reorder->win_n--;
+  reorder->discarded_bytes += r->u.reorder.sc.first->sampleinfo->size;
+  nn_fragchain_unref (r->u.reorder.sc.first->fragchain);
+}
+
 void nn_reorder_free (struct nn_reorder *r)
 {
   struct nn_rsample *iv;
   struct nn_rsample_chain_elem *sce;
+  if (r->win_n > 0)
+  {
+    for (uint32_t idx = reorder_win_find (r, 0); idx < NN_REORDER_WINDOW; idx = reorder_win_find (r, idx + 1))
+      nn_fragchain_unref (reorder_win_sample (r, idx)->u.reorder.sc.first->fragchain);
+  }
+  ddsrt_free (r->win);
   /* FXIME: instead of findmin/delete, a treewalk can be used. */
   iv = ddsrt_avl_find_min (&reorder_sampleivtree_treedef, &r->sampleivtree);
   while (iv)
@@ -1793,6 +2437,36 @@ static int reorder_try_append_and_discard (struct nn_reorder *reorder, struct nn
   }
 }
 
+static void reorder_win_flush (struct nn_reorder *reorder)
+{
+  /* moves the contents of the window to the interval tree, as the
+     samples in it all precede those in the tree, only the last interval
+     may need to be joined with the first one in the tree */
+  struct nn_rsample * const treemin = ddsrt_avl_find_min (&reorder_sampleivtree_treedef, &reorder->sampleivtree);
+  struct nn_rsample *iv = NULL;
+  if (reorder->win_n == 0)
+    return;
+  TRACE (reorder, "  flushing window (%"PRIu32" samples)\n", reorder->win_n);
+  for (uint32_t idx = reorder_win_find (reorder, 0); idx < NN_REORDER_WINDOW; idx = reorder_win_find (reorder, idx + 1))
+  {
+    struct nn_rsample * const r = reorder_win_sample (reorder, idx);
+    assert (treemin == NULL || r->u.reorder.maxp1 <= treemin->u.reorder.min);
+    if (iv && iv->u.reorder.maxp1 == r->u.reorder.min)
+      append_rsample_interval (iv, r);
+    else
+    {
+      iv = r;
+      reorder_add_rsampleiv (reorder, iv);
+      if (treemin == NULL)
+        reorder->max_sampleiv = iv;
+    }
+  }
+  if (reorder_try_append_and_discard (reorder, iv, treemin))
+    reorder->max_sampleiv = iv;
+  reorder->win_n = 0;
+  nn_bitset_zero (NN_REORDER_WINDOW, reorder->win_present);
+}
+
 struct nn_rsample *nn_reorder_rsample_dup_first (struct nn_rmsg *rmsg, struct nn_rsample *rsampleiv)
 {
   /* Duplicates the rsampleiv without updating any reference counts:
@@ -1865,8 +2539,8 @@ static void delete_last_sample (struct nn_reorder *reorder)
     ddsrt_avl_delete (&reorder_sampleivtree_treedef, &reorder->sampleivtree, reorder->max_sampleiv);
     reorder->max_sampleiv = ddsrt_avl_find_max (&reorder_sampleivtree_treedef, &reorder->sampleivtree);
     /* No harm done if it the sampleivtree is empty, except that we
-       chose not to allow it */
-    assert (reorder->max_sampleiv != NULL);
+       chose not to allow it unless the window holds samples */
+    assert (reorder->max_sampleiv != NULL || reorder->win_n > 0);
   }
   else
   {
@@ -1896,6 +2570,60 @@ static void delete_last_sample (struct nn_reorder *reorder)
   nn_fragchain_unref (fragchain);
 }
 
+static nn_reorder_result_t reorder_win_add (struct nn_reorder *reorder, struct nn_rsample *rsampleiv, int *refcount_adjust, int delivery_queue_full_p)
+{
+  /* stores an out-of-order sample in the window, the same policies
+     apply as for the tree: a sample following all stored samples is
+     treated like one at the end of the last interval, others like the
+     "hard case" */
+  struct nn_rsample_reorder *s = &rsampleiv->u.reorder;
+  const uint32_t idx = (uint32_t) (s->min - reorder->next_seq);
+  seqno_t last;
+  assert (reorder->mode == NN_REORDER_MODE_NORMAL);
+  assert (idx > 0 && idx < NN_REORDER_WINDOW);
+  if (reorder->max_sampleiv)
+    last = reorder->max_sampleiv->u.reorder.maxp1 - 1;
+  else if (reorder->win_n > 0)
+    last = reorder->next_seq + reorder_win_last (reorder);
+  else
+    last = 0;
+  const bool at_end = (s->min > last);
+
+  if (delivery_queue_full_p && (at_end || reorder->late_ack_mode))
+  {
+    TRACE (reorder, "  discarding sample: delivery queue full\n");
+    reorder->discarded_bytes += s->sc.first->sampleinfo->size;
+    return NN_REORDER_REJECT;
+  }
+  if (nn_bitset_isset (NN_REORDER_WINDOW, reorder->win_present, idx))
+  {
+    TRACE (reorder, "  discard: contained in window\n");
+    reorder->discarded_bytes += s->sc.first->sampleinfo->size;
+    return NN_REORDER_REJECT;
+  }
+  if (at_end && reorder->n_samples >= reorder->max_samples)
+  {
+    TRACE (reorder, "  discarding sample: max_samples reached and sample at end\n");
+    reorder->discarded_bytes += s->sc.first->sampleinfo->size;
+    return NN_REORDER_REJECT;
+  }
+  if (reorder->win == NULL)
+    reorder->win = ddsrt_malloc (NN_REORDER_WINDOW * sizeof (*reorder->win));
+
+  TRACE (reorder, "  storing in window at %"PRIu32"\n", idx);
+  reorder->win[(uint32_t) s->min % NN_REORDER_WINDOW] = rsampleiv;
+  nn_bitset_set (NN_REORDER_WINDOW, reorder->win_present, idx);
+  reorder->win_n++;
+  if (reorder->n_samples < reorder->max_samples)
+    reorder->n_samples++;
+  else if (reorder->max_sampleiv)
+    delete_last_sample (reorder);
+  else
+    reorder_win_delete_last (reorder);
+  (*refcount_adjust)++;
+  return NN_REORDER_ACCEPT;
+}
+
 nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_reorder *reorder, struct nn_rsample *rsampleiv, int *refcount_adjust, int delivery_queue_full_p)
 {
   /* Adds an rsample (represented as an interval) to the reorder admin
@@ -1929,6 +2657,9 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
   assert ((!!ddsrt_avl_is_empty (&reorder->sampleivtree)) == (reorder->max_sampleiv == NULL));
   assert (reorder->max_sampleiv == NULL || reorder->max_sampleiv == ddsrt_avl_find_max (&reorder_sampleivtree_treedef, &reorder->sampleivtree));
   assert (reorder->n_samples <= reorder->max_samples);
+  assert (reorder->win_n <= reorder->n_samples);
+  assert (reorder->win_n == 0 || reorder->mode == NN_REORDER_MODE_NORMAL);
+  assert (!nn_bitset_isset (NN_REORDER_WINDOW, reorder->win_present, 0));
   if (reorder->max_sampleiv)
     TRACE (reorder, "  max = [%"PRId64",%"PRId64") @ %p\n", reorder->max_sampleiv->u.reorder.min,
            reorder->max_sampleiv->u.reorder.maxp1, (void *) reorder->max_sampleiv);
@@ -1951,9 +2682,20 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
     }
 
     /* 's' is next sample to be delivered; maybe we can append the
-       first interval in the tree to it.  We can avoid all processing
-       if the index is empty, which is the normal case.  Unreliable
-       out-of-order either ends up here or in discard.)  */
+       consecutive samples in the window and then the first interval in
+       the tree to it.  We can avoid all processing if the index is
+       empty, which is the normal case.  Unreliable out-of-order either
+       ends up here or in discard.)  */
+    const bool win_used = (reorder->win_n > 0);
+    if (win_used)
+    {
+      uint32_t idx;
+      assert (s->min == reorder->next_seq);
+      for (idx = 1; nn_bitset_isset (NN_REORDER_WINDOW, reorder->win_present, idx); idx++)
+        append_rsample_interval (rsampleiv, reorder_win_sample (reorder, idx));
+      TRACE (reorder, "  appended %"PRIu32" samples from window\n", idx - 1);
+      reorder->win_n -= idx - 1;
+    }
     if (reorder->max_sampleiv != NULL)
     {
       struct nn_rsample *min = ddsrt_avl_find_min (&reorder_sampleivtree_treedef, &reorder->sampleivtree);
@@ -1961,7 +2703,10 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
       if (reorder_try_append_and_discard (reorder, rsampleiv, min))
         reorder->max_sampleiv = NULL;
     }
-    reorder->next_seq = s->maxp1;
+    if (win_used)
+      reorder_win_advance (reorder, s->maxp1);
+    else
+      reorder->next_seq = s->maxp1;
     *sc = rsampleiv->u.reorder.sc;
     (*refcount_adjust)++;
     TRACE (reorder, "  return [%"PRId64",%"PRId64")\n", s->min, s->maxp1);
@@ -1982,14 +2727,20 @@ nn_reorder_result_t nn_reorder_rsample (struct nn_rsample_chain *sc, struct nn_r
     reorder->discarded_bytes += s->sc.first->sampleinfo->size;
     return NN_REORDER_TOO_OLD; /* don't want refcount increment */
   }
+  else if (reorder->mode == NN_REORDER_MODE_NORMAL && s->min - reorder->next_seq < NN_REORDER_WINDOW &&
+           (reorder->max_sampleiv == NULL || s->min < ((struct nn_rsample *) ddsrt_avl_find_min (&reorder_sampleivtree_treedef, &reorder->sampleivtree))->u.reorder.min))
+  {
+    /* within the window and preceding everything in the tree */
+    return reorder_win_add (reorder, rsampleiv, refcount_adjust, delivery_queue_full_p);
+  }
   else if (ddsrt_avl_is_empty (&reorder->sampleivtree))
   {
-    /* else, if nothing's stored simply add this one, max_samples = 0
-       is technically allowed, and potentially useful, so check for
-       it */
-    assert (reorder->n_samples == 0);
+    /* else, if nothing's stored (other than in the window) simply add
+       this one, max_samples = 0 is technically allowed, and potentially
+       useful, so check for it */
+    assert (reorder->n_samples == reorder->win_n);
     TRACE (reorder, "  adding to empty store\n");
-    if (reorder->max_samples == 0)
+    if (reorder->n_samples >= reorder->max_samples)
     {
       TRACE (reorder, "  NOT - max_samples hit\n");
       reorder->discarded_bytes += s->sc.first->sampleinfo->size;
@@ -2270,6 +3021,8 @@ nn_reorder_result_t nn_reorder_gap (struct nn_rsample_chain *sc, struct nn_reord
     return NN_REORDER_REJECT;
   }
 
+  reorder_win_flush (reorder);
+
   /* Coalesce all intervals [m,n) with n >= min or m <= maxp1 */
   if ((coalesced = coalesce_intervals_touching_range (reorder, min, maxp1, &valuable)) == NULL)
   {
@@ -2345,6 +3098,7 @@ void nn_reorder_drop_upto (struct nn_reorder *reorder, seqno_t maxp1)
   // Requiring that no samples are present beyond maxp1 means we're not dropping
   // too much.  That's good enough for the current purpose.
   assert (reorder->max_sampleiv == NULL || reorder->max_sampleiv->u.reorder.maxp1 <= maxp1);
+  assert (reorder->win_n == 0 || reorder->next_seq + reorder_win_last (reorder) < maxp1);
   // gap won't be stored, so can safely be stack-allocated for the purpose of calling
   // nn_reorder_gap
   struct nn_rdata gap = {
@@ -2374,6 +3128,8 @@ int nn_reorder_wantsample (const struct nn_reorder *reorder, seqno_t seq)
   if (seq < reorder->next_seq)
     /* trivially not interesting */
     return 0;
+  if (seq - reorder->next_seq < NN_REORDER_WINDOW && nn_bitset_isset (NN_REORDER_WINDOW, reorder->win_present, (uint32_t) (seq - reorder->next_seq)))
+    return 0;
   /* Find interval that contains seq, if we know seq.  We are
      interested if seq is outside this interval (if any). */
   s = ddsrt_avl_lookup_pred_eq (&reorder_sampleivtree_treedef, &reorder->sampleivtree, &seq);
@@ -2383,7 +3139,6 @@ int nn_reorder_wantsample (const struct nn_reorder *reorder, seqno_t seq)
 unsigned nn_reorder_nackmap (const struct nn_reorder *reorder, seqno_t base, seqno_t maxseq, struct nn_sequence_number_set_header *map, uint32_t *mapbits, uint32_t maxsz, int notail)
 {
   struct nn_rsample *iv;
-  seqno_t i;
 
   /* reorder->next_seq-1 is the last one we delivered, so the last one
      we ack; maxseq is the latest sample we know exists.  Valid bitmap
@@ -2417,31 +3172,50 @@ unsigned nn_reorder_nackmap (const struct nn_reorder *reorder, seqno_t base, seq
     map->numbits = maxsz;
   else
     map->numbits = (uint32_t) (maxseq + 1 - base);
-  nn_bitset_zero (map->numbits, mapbits);
 
+  /* with notail, the bitmap ends at the last sample we have */
+  if (notail)
+  {
+    seqno_t end;
+    if (reorder->max_sampleiv)
+      end = reorder->max_sampleiv->u.reorder.maxp1;
+    else if (reorder->win_n > 0)
+      end = reorder->next_seq + reorder_win_last (reorder) + 1;
+    else
+      end = base;
+    if (end < base + map->numbits)
+      map->numbits = (uint32_t) (end - base);
+  }
+
+  /* mark everything we have: intervals in the tree that overlap with the
+     bitmap, then the window as a copy of its bitmap shifted by the
+     difference between base and next_seq */
+  nn_bitset_zero (map->numbits, mapbits);
   if ((iv = ddsrt_avl_find_min (&reorder_sampleivtree_treedef, &reorder->sampleivtree)) != NULL)
     assert (iv->u.reorder.min > base);
-  i = base;
-  while (iv && i < base + map->numbits)
+  while (iv && iv->u.reorder.min < base + map->numbits)
   {
-    for (; i < base + map->numbits && i < iv->u.reorder.min; i++)
-    {
-      unsigned x = (unsigned) (i - base);
-      nn_bitset_set (map->numbits, mapbits, x);
-    }
-    i = iv->u.reorder.maxp1;
+    const seqno_t maxp1 = (iv->u.reorder.maxp1 < base + map->numbits) ? iv->u.reorder.maxp1 : base + map->numbits;
+    (void) nn_bitset_set_range (map->numbits, mapbits, (uint32_t) (iv->u.reorder.min - base), (uint32_t) (maxp1 - base));
     iv = ddsrt_avl_find_succ (&reorder_sampleivtree_treedef, &reorder->sampleivtree, iv);
   }
-  if (notail && i < base + map->numbits)
-    map->numbits = (unsigned) (i - base);
-  else
+  if (reorder->win_n > 0 && reorder->next_seq - base < map->numbits)
   {
-    for (; i < base + map->numbits; i++)
+    const uint32_t d = (uint32_t) (reorder->next_seq - base);
+    for (uint32_t k = d / 32; k < (map->numbits + 31) / 32; k++)
     {
-      unsigned x = (unsigned) (i - base);
-      nn_bitset_set (map->numbits, mapbits, x);
+      if (32 * k >= d)
+        mapbits[k] |= nn_bitset_get32 (NN_REORDER_WINDOW, reorder->win_present, 32 * k - d);
+      else
+        mapbits[k] |= nn_bitset_get32 (NN_REORDER_WINDOW, reorder->win_present, 0) >> (d - 32 * k);
     }
   }
+
+  /* the bitmap lists what is missing */
+  for (uint32_t k = 0; k < (map->numbits + 31) / 32; k++)
+    mapbits[k] = ~mapbits[k];
+  if ((map->numbits % 32) != 0)
+    mapbits[map->numbits / 32] &= ~(~UINT32_C(0) >> (map->numbits % 32));
   return map->numbits;
 }
 
@@ -2452,6 +3226,7 @@ seqno_t nn_reorder_next_seq (const struct nn_reorder *reorder)
 
 void nn_reorder_set_next_seq (struct nn_reorder *reorder, seqno_t seq)
 {
+  reorder_win_flush (reorder);
   reorder->next_seq = seq;
 }
 
@@ -2461,6 +3236,7 @@ struct nn_dqueue {
   ddsrt_mutex_t lock;
   ddsrt_cond_t cond;
   nn_dqueue_handler_t handler;
+  nn_dqueue_batch_handler_t batch_handler;
   void *handler_arg;
 
   struct nn_rsample_chain sc;
@@ -2469,6 +3245,12 @@ struct nn_dqueue {
   char *name;
   uint32_t max_samples;
   ddsrt_atomic_uint32_t nof_samples;
+
+  /* statistics: max_nof_samples is only updated with lock held, latency
+     only by the delivery thread and only if latency_stats is set */
+  ddsrt_atomic_uint32_t max_nof_samples;
+  bool latency_stats;
+  ddsrt_atomic_uint32_t latency[DDSI_LATENCY_NBUCKETS];
 };
 
 enum dqueue_elem_kind {
@@ -2512,6 +3294,18 @@ static enum dqueue_elem_kind dqueue_elem_kind (const struct nn_rsample_chain_ele
     return DQEK_BUBBLE;
 }
 
+static void dqueue_account_dequeued (struct nn_dqueue *q, const struct nn_rsample_chain_elem *e)
+{
+  if (ddsrt_atomic_dec32_ov (&q->nof_samples) == 1) {
+    ddsrt_cond_broadcast (&q->cond);
+  }
+  if (q->latency_stats && dqueue_elem_kind (e) == DQEK_DATA)
+  {
+    const int64_t lat = ddsrt_time_wallclock ().v - e->sampleinfo->reception_timestamp.v;
+    ddsrt_atomic_inc32 (&q->latency[ddsi_latency_bucket (lat)]);
+  }
+}
+
 static uint32_t dqueue_thread (struct nn_dqueue *q)
 {
   struct thread_state1 * const ts1 = lookup_thread_state ();
@@ -2541,10 +3335,32 @@ static uint32_t dqueue_thread (struct nn_dqueue *q)
     {
       struct nn_rsample_chain_elem *e = sc.first;
       int ret;
-      sc.first = e->next;
-      if (ddsrt_atomic_dec32_ov (&q->nof_samples) == 1) {
-        ddsrt_cond_broadcast (&q->cond);
+      if (q->batch_handler && prdguid == NULL && dqueue_elem_kind (e) != DQEK_BUBBLE)
+      {
+        /* Hand the run of samples and gaps up to the next bubble to the
+           batch handler in one go; fragchains are released only after it
+           returns because the chain elements live in the messages */
+        struct nn_rsample_chain_elem *last = e;
+        dqueue_account_dequeued (q, last);
+        while (last->next && dqueue_elem_kind (last->next) != DQEK_BUBBLE)
+        {
+          last = last->next;
+          dqueue_account_dequeued (q, last);
+        }
+        sc.first = last->next;
+        last->next = NULL;
+        thread_state_awake_to_awake_no_nest (ts1);
+        q->batch_handler (e, q->handler_arg);
+        while (e)
+        {
+          struct nn_rdata * const fragchain = e->fragchain;
+          e = e->next;
+          nn_fragchain_unref (fragchain);
+        }
+        continue;
       }
+      sc.first = e->next;
+      dqueue_account_dequeued (q, e);
       thread_state_awake_to_awake_no_nest (ts1);
       switch (dqueue_elem_kind (e))
       {
@@ -2604,7 +3420,7 @@ static uint32_t dqueue_thread (struct nn_dqueue *q)
   return 0;
 }
 
-struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *gv, uint32_t max_samples, nn_dqueue_handler_t handler, void *arg)
+struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *gv, uint32_t max_samples, nn_dqueue_handler_t handler, nn_dqueue_batch_handler_t batch_handler, void *arg)
 {
   struct nn_dqueue *q;
   char *thrname;
@@ -2616,7 +3432,12 @@ struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *g
     goto fail_name;
   q->max_samples = max_samples;
   ddsrt_atomic_st32 (&q->nof_samples, 0);
+  ddsrt_atomic_st32 (&q->max_nof_samples, 0);
+  q->latency_stats = gv->config.recv_latency_stats;
+  for (uint32_t i = 0; i < DDSI_LATENCY_NBUCKETS; i++)
+    ddsrt_atomic_st32 (&q->latency[i], 0);
   q->handler = handler;
+  q->batch_handler = batch_handler;
   q->handler_arg = arg;
   q->sc.first = q->sc.last = NULL;
 
@@ -2644,6 +3465,13 @@ struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *g
   return NULL;
 }
 
+static void nn_dqueue_add_count_locked (struct nn_dqueue *q, uint32_t n)
+{
+  const uint32_t count = ddsrt_atomic_add32_nv (&q->nof_samples, n);
+  if (count > ddsrt_atomic_ld32 (&q->max_nof_samples))
+    ddsrt_atomic_st32 (&q->max_nof_samples, count);
+}
+
 static int nn_dqueue_enqueue_locked (struct nn_dqueue *q, struct nn_rsample_chain *sc)
 {
   int must_signal;
@@ -2668,7 +3496,7 @@ bool nn_dqueue_enqueue_deferred_wakeup (struct nn_dqueue *q, struct nn_rsample_c
   assert (sc->first);
   assert (sc->last->next == NULL);
   ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_add32 (&q->nof_samples, (uint32_t) rres);
+  nn_dqueue_add_count_locked (q, (uint32_t) rres);
   signal = nn_dqueue_enqueue_locked (q, sc);
   ddsrt_mutex_unlock (&q->lock);
   return signal;
@@ -2687,7 +3515,7 @@ void nn_dqueue_enqueue (struct nn_dqueue *q, struct nn_rsample_chain *sc, nn_reo
   assert (sc->first);
   assert (sc->last->next == NULL);
   ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_add32 (&q->nof_samples, (uint32_t) rres);
+  nn_dqueue_add_count_locked (q, (uint32_t) rres);
   if (nn_dqueue_enqueue_locked (q, sc))
     ddsrt_cond_broadcast (&q->cond);
   ddsrt_mutex_unlock (&q->lock);
@@ -2706,7 +3534,7 @@ static int nn_dqueue_enqueue_bubble_locked (struct nn_dqueue *q, struct nn_dqueu
 static void nn_dqueue_enqueue_bubble (struct nn_dqueue *q, struct nn_dqueue_bubble *b)
 {
   ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_inc32 (&q->nof_samples);
+  nn_dqueue_add_count_locked (q, 1);
   if (nn_dqueue_enqueue_bubble_locked (q, b))
     ddsrt_cond_broadcast (&q->cond);
   ddsrt_mutex_unlock (&q->lock);
@@ -2736,7 +3564,7 @@ void nn_dqueue_enqueue1 (struct nn_dqueue *q, const ddsi_guid_t *rdguid, struct
   assert (sc->first);
   assert (sc->last->next == NULL);
   ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_add32 (&q->nof_samples, 1 + (uint32_t) rres);
+  nn_dqueue_add_count_locked (q, 1 + (uint32_t) rres);
   if (nn_dqueue_enqueue_bubble_locked (q, b))
     ddsrt_cond_broadcast (&q->cond);
   (void) nn_dqueue_enqueue_locked (q, sc);
@@ -2770,6 +3598,14 @@ void nn_dqueue_wait_until_empty_if_full (struct nn_dqueue *q)
   }
 }
 
+void nn_dqueue_get_stats (struct nn_dqueue *q, uint32_t *depth, uint32_t *max_depth, uint32_t *latency)
+{
+  *depth = ddsrt_atomic_ld32 (&q->nof_samples);
+  *max_depth = ddsrt_atomic_ld32 (&q->max_nof_samples);
+  for (uint32_t i = 0; i < DDSI_LATENCY_NBUCKETS; i++)
+    latency[i] = ddsrt_atomic_ld32 (&q->latency[i]);
+}
+
 void nn_dqueue_free (struct nn_dqueue *q)
 {
   /* There must not be any thread enqueueing things anymore at this
@@ -60,6 +60,10 @@
 #include "dds/ddsi/sysdeps.h"
 #include "dds__whc.h"
 
+#if !defined _WIN32 && !LWIP_SOCKET
+#include <poll.h>
+#endif
+
 /*
 Notes:
 
@@ -1924,6 +1928,7 @@ struct remote_sourceinfo {
   const struct nn_rdata *fragchain;
   unsigned statusinfo;
   ddsrt_wctime_t tstamp;
+  ddsrt_wctime_t tdeliver; /* start of delivery if collecting latency statistics, else 0 */
 };
 
 static struct ddsi_serdata *remote_make_sample (struct ddsi_tkmap_instance **tk, struct ddsi_domaingv *gv, struct ddsi_sertype const * const type, void *vsourceinfo)
@@ -2085,8 +2090,8 @@ static struct reader *proxy_writer_next_in_sync_reader (struct entity_index *ent
 
 static dds_return_t remote_on_delivery_failure_fastpath (struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, void *vsourceinfo)
 {
+  (void) fastpath_rdary;
   (void) vsourceinfo;
-  ddsrt_mutex_unlock (&fastpath_rdary->rdary_lock);
   if (source_entity_locked)
     ddsrt_mutex_unlock (&source_entity->lock);
 
@@ -2094,18 +2099,82 @@ static dds_return_t remote_on_delivery_failure_fastpath (struct entity_common *s
 
   if (source_entity_locked)
     ddsrt_mutex_lock (&source_entity->lock);
-  ddsrt_mutex_lock (&fastpath_rdary->rdary_lock);
   return DDS_RETCODE_TRY_AGAIN;
 }
 
+static void remote_delivered (struct reader *rd, void *vsourceinfo)
+{
+  const struct remote_sourceinfo *si = vsourceinfo;
+  if (si->tdeliver.v != 0)
+  {
+    const struct nn_rsample_info *sampleinfo = si->sampleinfo;
+    const ddsrt_wctime_t tstored = ddsrt_time_wallclock ();
+    if (sampleinfo->kernel_timestamp.v != 0)
+      ddsi_latency_stats_add (&rd->latency_stats, DDSI_LATENCY_KERNEL_TO_RECV, sampleinfo->reception_timestamp.v - sampleinfo->kernel_timestamp.v);
+    ddsi_latency_stats_add (&rd->latency_stats, DDSI_LATENCY_RECV_TO_DQUEUE, si->tdeliver.v - sampleinfo->reception_timestamp.v);
+    ddsi_latency_stats_add (&rd->latency_stats, DDSI_LATENCY_DQUEUE_TO_RHC, tstored.v - si->tdeliver.v);
+  }
+}
+
+/* Interval over which the fraction of time spent delivering a proxy writer's
+   data is measured for adapting its delivery mode */
+#define ADAPTIVE_DELIVERY_INTERVAL DDS_MSECS (100)
+
+static void record_delivery_cost (struct proxy_writer *pwr, int pwr_locked, uint32_t n, ddsrt_mtime_t tstart)
+{
+  const int64_t cost = ddsrt_time_monotonic ().v - tstart.v;
+  struct pwr_delivery_stats * const ds = &pwr->delivery_stats;
+  if (!pwr_locked)
+    ddsrt_mutex_lock (&pwr->e.lock);
+  ds->avg_cost += (cost / n - ds->avg_cost) / 8;
+  ds->busy += cost;
+  if (!pwr_locked)
+    ddsrt_mutex_unlock (&pwr->e.lock);
+}
+
+static void adapt_delivery_mode (struct proxy_writer *pwr)
+{
+  /* Called with pwr->e.lock held, before any new data is passed into the
+     reorder admin; next_deliv_seq_lowword catching up with the reorder
+     admin means nothing is left in the delivery queue for this proxy
+     writer, and so that switching to synchronous delivery can't change
+     the order */
+  struct ddsi_domaingv * const gv = pwr->e.gv;
+  struct pwr_delivery_stats * const ds = &pwr->delivery_stats;
+  const ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+  const int64_t elapsed = tnow.v - ds->tstart.v;
+  const int64_t bound = gv->config.synchronous_delivery_cost_bound;
+  if (elapsed < ADAPTIVE_DELIVERY_INTERVAL)
+    return;
+  ds->utilisation = (uint32_t) ((100 * ds->busy) / elapsed);
+  ds->busy = 0;
+  ds->tstart = tnow;
+  if (pwr->deliver_synchronously)
+  {
+    if (ds->avg_cost > bound || ds->utilisation > 50)
+    {
+      pwr->deliver_synchronously = 0;
+      ETRACE (pwr, " "PGUIDFMT": asynchronous delivery (cost %"PRId64"ns, %"PRIu32"%%)", PGUID (pwr->e.guid), ds->avg_cost, ds->utilisation);
+    }
+  }
+  else if (ds->avg_cost <= bound / 2 && ds->utilisation < 25 && pwr->n_readers_out_of_sync == 0 &&
+           ddsrt_atomic_ld32 (&pwr->next_deliv_seq_lowword) == (uint32_t) nn_reorder_next_seq (pwr->reorder))
+  {
+    pwr->deliver_synchronously = 1;
+    ETRACE (pwr, " "PGUIDFMT": synchronous delivery (cost %"PRId64"ns, %"PRIu32"%%)", PGUID (pwr->e.guid), ds->avg_cost, ds->utilisation);
+  }
+}
+
+static const struct deliver_locally_ops remote_deliver_locally_ops = {
+  .makesample = remote_make_sample,
+  .first_reader = proxy_writer_first_in_sync_reader,
+  .next_reader = proxy_writer_next_in_sync_reader,
+  .on_failure_fastpath = remote_on_delivery_failure_fastpath,
+  .delivered = remote_delivered
+};
+
 static int deliver_user_data (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const ddsi_guid_t *rdguid, int pwr_locked)
 {
-  static const struct deliver_locally_ops deliver_locally_ops = {
-    .makesample = remote_make_sample,
-    .first_reader = proxy_writer_first_in_sync_reader,
-    .next_reader = proxy_writer_next_in_sync_reader,
-    .on_failure_fastpath = remote_on_delivery_failure_fastpath
-  };
   struct receiver_state const * const rst = sampleinfo->rst;
   struct ddsi_domaingv * const gv = rst->gv;
   struct proxy_writer * const pwr = sampleinfo->pwr;
@@ -2183,13 +2252,17 @@ static int deliver_user_data (const struct nn_rsample_info *sampleinfo, const st
     .qos = &qos,
     .fragchain = fragchain,
     .statusinfo = statusinfo,
-    .tstamp = tstamp
+    .tstamp = tstamp,
+    .tdeliver = gv->config.recv_latency_stats ? ddsrt_time_wallclock () : (ddsrt_wctime_t) { 0 }
   };
   if (rdguid)
-    (void) deliver_locally_one (gv, &pwr->e, pwr_locked != 0, rdguid, &wrinfo, &deliver_locally_ops, &sourceinfo);
+    (void) deliver_locally_one (gv, &pwr->e, pwr_locked != 0, rdguid, &wrinfo, &remote_deliver_locally_ops, &sourceinfo);
   else
   {
-    (void) deliver_locally_allinsync (gv, &pwr->e, pwr_locked != 0, &pwr->rdary, &wrinfo, &deliver_locally_ops, &sourceinfo);
+    const ddsrt_mtime_t tstart = pwr->adaptive_delivery ? ddsrt_time_monotonic () : (ddsrt_mtime_t) { 0 };
+    (void) deliver_locally_allinsync (gv, &pwr->e, pwr_locked != 0, &pwr->rdary, &wrinfo, &remote_deliver_locally_ops, &sourceinfo);
+    if (pwr->adaptive_delivery)
+      record_delivery_cost (pwr, pwr_locked, 1, tstart);
     ddsrt_atomic_st32 (&pwr->next_deliv_seq_lowword, (uint32_t) (sampleinfo->seq + 1));
   }
 
@@ -2197,6 +2270,89 @@ static int deliver_user_data (const struct nn_rsample_info *sampleinfo, const st
   return 0;
 }
 
+/* Consecutive samples from the same proxy writer that need nothing beyond what
+   deliver_user_data would derive from the sample info get collected here and
+   stored in the readers' history caches in batches */
+struct deliver_user_data_batch {
+  struct proxy_writer *pwr;
+  uint32_t n;
+  ddsi_plist_t qos; /* always empty, shared by all */
+  struct ddsi_writer_info wrinfo[DELIVER_LOCALLY_MAX_BATCH];
+  struct remote_sourceinfo sourceinfo[DELIVER_LOCALLY_MAX_BATCH];
+  void *vsourceinfo[DELIVER_LOCALLY_MAX_BATCH];
+};
+
+static void deliver_user_data_batch_flush (struct deliver_user_data_batch *b, int pwr_locked)
+{
+  if (b->n == 0)
+    return;
+  struct proxy_writer * const pwr = b->pwr;
+  const ddsrt_mtime_t tstart = pwr->adaptive_delivery ? ddsrt_time_monotonic () : (ddsrt_mtime_t) { 0 };
+  (void) deliver_locally_allinsync_many (pwr->e.gv, &pwr->e, pwr_locked != 0, &pwr->rdary, b->n, b->wrinfo, &remote_deliver_locally_ops, b->vsourceinfo);
+  if (pwr->adaptive_delivery)
+    record_delivery_cost (pwr, pwr_locked, b->n, tstart);
+  ddsrt_atomic_st32 (&pwr->next_deliv_seq_lowword, (uint32_t) (b->sourceinfo[b->n - 1].sampleinfo->seq + 1));
+  b->n = 0;
+}
+
+static bool deliver_user_data_batch_add (struct deliver_user_data_batch *b, const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, int pwr_locked)
+{
+  struct proxy_writer * const pwr = sampleinfo->pwr;
+  const Data_DataFrag_common_t *msg;
+  unsigned char data_smhdr_flags;
+  int need_keyhash;
+
+  if (pwr->ddsi2direct_cb)
+    return false;
+  assert (fragchain->min == 0);
+  msg = (const Data_DataFrag_common_t *) NN_RMSG_PAYLOADOFF (fragchain->rmsg, NN_RDATA_SUBMSG_OFF (fragchain));
+  data_smhdr_flags = normalize_data_datafrag_flags (&msg->smhdr);
+  /* same condition as in deliver_user_data for not having to look at the inline QoS */
+  need_keyhash = (sampleinfo->size == 0 || (data_smhdr_flags & (DATA_FLAG_KEYFLAG | DATA_FLAG_DATAFLAG)) == 0);
+  if ((sampleinfo->complex_qos || need_keyhash) && (data_smhdr_flags & DATA_FLAG_INLINE_QOS))
+    return false;
+
+  if (b->n > 0 && (pwr != b->pwr || b->n == DELIVER_LOCALLY_MAX_BATCH))
+    deliver_user_data_batch_flush (b, pwr_locked);
+  b->pwr = pwr;
+
+  struct ddsi_domaingv * const gv = sampleinfo->rst->gv;
+  const uint32_t i = b->n++;
+  ddsi_make_writer_info (&b->wrinfo[i], &pwr->e, pwr->c.xqos, sampleinfo->statusinfo);
+  b->sourceinfo[i] = (struct remote_sourceinfo) {
+    .sampleinfo = sampleinfo,
+    .data_smhdr_flags = data_smhdr_flags,
+    .qos = &b->qos,
+    .fragchain = fragchain,
+    .statusinfo = sampleinfo->statusinfo,
+    .tstamp = (sampleinfo->timestamp.v != DDSRT_WCTIME_INVALID.v) ? sampleinfo->timestamp : ((ddsrt_wctime_t) {0}),
+    .tdeliver = gv->config.recv_latency_stats ? ddsrt_time_wallclock () : (ddsrt_wctime_t) { 0 }
+  };
+  b->vsourceinfo[i] = &b->sourceinfo[i];
+  return true;
+}
+
+static void deliver_user_data_many (const struct nn_rsample_chain_elem *first, int pwr_locked)
+{
+  struct deliver_user_data_batch b;
+  b.pwr = NULL;
+  b.n = 0;
+  ddsi_plist_init_empty (&b.qos);
+  for (const struct nn_rsample_chain_elem *e = first; e; e = e->next)
+  {
+    /* Must not try to deliver a gap -- possibly a FIXME for
+       sample_lost events */
+    if (e->sampleinfo == NULL)
+      continue;
+    if (!deliver_user_data_batch_add (&b, e->sampleinfo, e->fragchain, pwr_locked))
+    {
+      deliver_user_data_batch_flush (&b, pwr_locked);
+      deliver_user_data (e->sampleinfo, e->fragchain, NULL, pwr_locked);
+    }
+  }
+  deliver_user_data_batch_flush (&b, pwr_locked);
+}
+
 int user_dqueue_handler (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const ddsi_guid_t *rdguid, UNUSED_ARG (void *qarg))
 {
   int res;
@@ -2204,13 +2360,22 @@ int user_dqueue_handler (const struct nn_rsample_info *sampleinfo, const struct
   return res;
 }
 
+void user_dqueue_batch_handler (const struct nn_rsample_chain_elem *first, UNUSED_ARG (void *qarg))
+{
+  deliver_user_data_many (first, 0);
+}
+
 static void deliver_user_data_synchronously (struct nn_rsample_chain *sc, const ddsi_guid_t *rdguid)
 {
+  /* The chain elements live in the messages, so the fragchains may only be
+     released once the batch has been delivered */
+  if (rdguid == NULL)
+    deliver_user_data_many (sc->first, 1);
   while (sc->first)
   {
     struct nn_rsample_chain_elem *e = sc->first;
     sc->first = e->next;
-    if (e->sampleinfo != NULL)
+    if (rdguid != NULL && e->sampleinfo != NULL)
     {
       /* Must not try to deliver a gap -- possibly a FIXME for
          sample_lost events. Also note that the synchronous path is
@@ -2362,6 +2527,8 @@ static void handle_regular (struct receiver_state *rst, ddsrt_etime_t tnow, stru
 
     if (!filtered)
     {
+      if (pwr->adaptive_delivery)
+        adapt_delivery_mode (pwr);
       rres = nn_reorder_rsample (&sc, pwr->reorder, rsample, &refc_adjust, 0); // nn_dqueue_is_full (pwr->dqueue));
 
       if (rres == NN_REORDER_ACCEPT && pwr->n_reliable_readers == 0)
@@ -2832,6 +2999,85 @@ static struct receiver_state *rst_cow_if_needed (int *rst_live, struct nn_rmsg *
   }
 }
 
+/* Submessage index: the submessage headers of a message are scanned in
+   bulk before interpreting them, which is also when the entity index
+   buckets of the proxy writers of the Data and DataFrag submessages are
+   prefetched so that the cache misses on those overlap rather than occur
+   one at a time while processing.  Pointers to the proxy writers can't be
+   kept in the index, the garbage collector may free them between two
+   submessages. */
+#define SUBMSG_INDEX_SIZE 64
+
+struct submsg_index_entry {
+  unsigned char *submsg;
+  size_t size;
+  bool byteswap;
+};
+
+static uint32_t scan_submsg_headers (struct submsg_index_entry *index, struct ddsi_domaingv *gv, const ddsi_guid_prefix_t *src_prefix, unsigned char *submsg, const unsigned char *end)
+{
+  /* Stops after a submessage that doesn't fit, after a SEC_PREFIX (decoding
+     it rewrites the submessages following it) and when the index is full.
+     Each header is scanned exactly once, which is when its length gets
+     byte-swapped. */
+  bool prefetch_pwrs = true, first_data = true;
+  ddsi_entityid_t last_wrid = { 0 };
+  uint32_t n = 0;
+  while (n < SUBMSG_INDEX_SIZE && submsg <= (end - sizeof (SubmessageHeader_t)))
+  {
+    SubmessageHeader_t *smhdr = (SubmessageHeader_t *) submsg;
+    struct submsg_index_entry * const e = &index[n++];
+    DDSRT_WARNING_MSVC_OFF(6326)
+    if (smhdr->flags & SMFLAG_ENDIANNESS)
+      e->byteswap = !(DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN);
+    else
+      e->byteswap =  (DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN);
+    DDSRT_WARNING_MSVC_ON(6326)
+    if (e->byteswap)
+      smhdr->octetsToNextHeader = ddsrt_bswap2u (smhdr->octetsToNextHeader);
+    e->submsg = submsg;
+    if (smhdr->octetsToNextHeader != 0)
+      e->size = RTPS_SUBMESSAGE_HEADER_SIZE + smhdr->octetsToNextHeader;
+    else if (smhdr->submessageId == SMID_PAD || smhdr->submessageId == SMID_INFO_TS)
+      e->size = RTPS_SUBMESSAGE_HEADER_SIZE;
+    else
+      e->size = (size_t) (end - submsg);
+    if (e->size > (size_t) (end - submsg))
+      break;
+
+    switch (smhdr->submessageId)
+    {
+      case SMID_DATA:
+      case SMID_DATA_FRAG:
+        if (prefetch_pwrs && e->size >= sizeof (Data_DataFrag_common_t))
+        {
+          /* the first one gets looked up while processing anyway, likewise
+             for ones from the same writer as the one before */
+          const ddsi_entityid_t wrid = nn_ntoh_entityid (((const Data_DataFrag_common_t *) submsg)->writerId);
+          if (first_data)
+            first_data = false;
+          else if (wrid.u != last_wrid.u)
+          {
+            const ddsi_guid_t pwr_guid = { .prefix = *src_prefix, .entityid = wrid };
+            entidx_prefetch_guid (gv->entity_index, &pwr_guid);
+          }
+          last_wrid = wrid;
+        }
+        break;
+      case SMID_INFO_SRC:
+        /* source changes: the prefix is no longer that of the writers */
+        prefetch_pwrs = false;
+        break;
+      case SMID_SEC_PREFIX:
+        return n;
+      default:
+        break;
+    }
+    submsg += e->size;
+  }
+  return n;
+}
+
 static int handle_submsg_sequence
 (
   struct thread_state1 * const ts1,
@@ -2840,6 +3086,7 @@ static int handle_submsg_sequence
   const ddsi_locator_t *srcloc,
   ddsrt_wctime_t tnowWC,
   ddsrt_etime_t tnowE,
+  ddsrt_wctime_t tkernelWC,
   const ddsi_guid_prefix_t * const src_prefix,
   const ddsi_guid_prefix_t * const dst_prefix,
   unsigned char * const msg /* NOT const - we may byteswap it */,
@@ -2860,6 +3107,8 @@ static int handle_submsg_sequence
   struct nn_dqueue *deferred_wakeup = NULL;
   SubmessageKind_t prev_smid = SMID_PAD;
   struct defer_hb_state defer_hb_state;
+  struct submsg_index_entry submsg_index[SUBMSG_INDEX_SIZE];
+  uint32_t submsg_index_pos = 0, submsg_index_n = 0;
 
   /* Receiver state is dynamically allocated with lifetime bound to
      the message.  Updates cause a new copy to be created if the
@@ -2897,36 +3146,16 @@ static int handle_submsg_sequence
   {
     Submessage_t *sm = (Submessage_t *) submsg;
     bool byteswap;
-    unsigned octetsToNextHeader;
 
-    DDSRT_WARNING_MSVC_OFF(6326)
-    if (sm->smhdr.flags & SMFLAG_ENDIANNESS)
-    {
-      byteswap = !(DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN);
-    }
-    else
+    if (submsg_index_pos == submsg_index_n)
     {
-      byteswap =  (DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN);
-    }
-    DDSRT_WARNING_MSVC_ON(6326)
-    if (byteswap)
-    {
-      sm->smhdr.octetsToNextHeader = ddsrt_bswap2u (sm->smhdr.octetsToNextHeader);
-    }
-
-    octetsToNextHeader = sm->smhdr.octetsToNextHeader;
-    if (octetsToNextHeader != 0)
-    {
-      submsg_size = RTPS_SUBMESSAGE_HEADER_SIZE + octetsToNextHeader;
-    }
-    else if (sm->smhdr.submessageId == SMID_PAD || sm->smhdr.submessageId == SMID_INFO_TS)
-    {
-      submsg_size = RTPS_SUBMESSAGE_HEADER_SIZE;
-    }
-    else
-    {
-      submsg_size = (unsigned) (end - submsg);
+      submsg_index_n = scan_submsg_headers (submsg_index, gv, &rst->src_guid_prefix, submsg, end);
+      submsg_index_pos = 0;
     }
+    assert (submsg_index_pos < submsg_index_n && submsg_index[submsg_index_pos].submsg == submsg);
+    byteswap = submsg_index[submsg_index_pos].byteswap;
+    submsg_size = submsg_index[submsg_index_pos].size;
+    submsg_index_pos++;
     /*GVTRACE ("submsg_size %d\n", submsg_size);*/
 
     if (submsg + submsg_size > end)
@@ -3040,6 +3269,7 @@ static int handle_submsg_sequence
           }
           sampleinfo.timestamp = timestamp;
           sampleinfo.reception_timestamp = tnowWC;
+          sampleinfo.kernel_timestamp = tkernelWC;
           handle_DataFrag (rst, tnowE, rmsg, &sm->datafrag, submsg_len, &sampleinfo, keyhash, datap, &deferred_wakeup, prev_smid);
           rst_live = 1;
           ts_for_latmeas = 0;
@@ -3064,6 +3294,7 @@ static int handle_submsg_sequence
             goto malformed;
           sampleinfo.timestamp = timestamp;
           sampleinfo.reception_timestamp = tnowWC;
+          sampleinfo.kernel_timestamp = tkernelWC;
           handle_Data (rst, tnowE, rmsg, &sm->data, submsg_len, &sampleinfo, keyhash, datap, &deferred_wakeup, prev_smid);
           rst_live = 1;
           ts_for_latmeas = 0;
@@ -3177,6 +3408,93 @@ malformed_asleep:
   return -1;
 }
 
+static void handle_rtps_message (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool *rbpool, struct nn_rmsg **rmsg, size_t sz, unsigned char *msg, const ddsi_locator_t *srcloc, ddsrt_wctime_t tkernel)
+{
+  /* rmsg must have had its size set already and remains uncommitted, but
+     decoding the message may replace it */
+  Header_t *hdr = (Header_t *) msg;
+  assert (thread_is_asleep ());
+  if (sz < RTPS_MESSAGE_HEADER_SIZE || *(uint32_t *)msg != NN_PROTOCOLID_AS_UINT32)
+  {
+    /* discard packets that are really too small or don't have magic cookie */
+  }
+  else if (hdr->version.major != RTPS_MAJOR || (hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
+  {
+    if ((hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
+      GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu\n, version mismatch: %d.%d\n",
+               PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, hdr->version.major, hdr->version.minor);
+    if (DDSI_SC_PEDANTIC_P (gv->config))
+      malformed_packet_received_nosubmsg (gv, msg, (ssize_t) sz, "header", hdr->vendorid);
+  }
+  else
+  {
+    ssize_t ssz = (ssize_t) sz;
+    hdr->guid_prefix = nn_ntoh_guid_prefix (hdr->guid_prefix);
+
+    if (gv->logconfig.c.mask & DDS_LC_TRACE)
+    {
+      char addrstr[DDSI_LOCSTRLEN];
+      ddsi_locator_to_string(addrstr, sizeof(addrstr), srcloc);
+      GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu from %s\n",
+               PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, addrstr);
+    }
+    nn_rtps_msg_state_t res = decode_rtps_message (ts1, gv, rmsg, &hdr, &msg, &ssz, rbpool, conn->m_stream);
+    if (res != NN_RTPS_MSG_STATE_ERROR)
+    {
+      handle_submsg_sequence (ts1, gv, conn, srcloc, ddsrt_time_wallclock (), ddsrt_time_elapsed (), tkernel, &hdr->guid_prefix, guidprefix, msg, (size_t) ssz, msg + RTPS_MESSAGE_HEADER_SIZE, *rmsg, res == NN_RTPS_MSG_STATE_ENCODED);
+    }
+  }
+}
+
+static bool rtps_message_may_be_decoded (const unsigned char *msg, size_t sz)
+{
+  /* Decoding a protected message replaces the rmsg, see decode_rtps_message */
+#ifdef DDS_HAS_SECURITY
+  const SubmessageHeader_t *sm = (const SubmessageHeader_t *) (msg + RTPS_MESSAGE_HEADER_SIZE);
+  return sz >= RTPS_MESSAGE_HEADER_SIZE + sizeof (*sm) && sm->submessageId == SMID_SRTPS_PREFIX;
+#else
+  (void) msg; (void) sz;
+  return false;
+#endif
+}
+
+static void handle_rtps_datagrams (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool *rbpool, struct nn_rmsg **rmsg, const struct ddsi_tran_readbuf *rb)
+{
+  /* The transport may have coalesced several datagrams, each of which is an
+     RTPS message of its own, they all share the one rmsg.  Decoding a
+     protected message replaces the rmsg and that releases the buffer, so
+     before handling one the datagrams following it are copied, and from
+     then on each gets an rmsg of its own (a pool only ever has one
+     uncommitted message, so they can't be allocated in advance) */
+  const size_t segsize = (rb->segsize > 0) ? rb->segsize : rb->len;
+  unsigned char *rest = NULL;
+  size_t restoff = 0;
+  for (size_t off = 0; off < rb->len; off += segsize)
+  {
+    const size_t sz = (rb->len - off < segsize) ? rb->len - off : segsize;
+    unsigned char *msg;
+    if (rest == NULL)
+    {
+      msg = rb->buf + off;
+      if (off + sz < rb->len && rtps_message_may_be_decoded (msg, sz))
+      {
+        restoff = off + sz;
+        rest = ddsrt_memdup (rb->buf + restoff, rb->len - restoff);
+      }
+    }
+    else
+    {
+      nn_rmsg_commit (*rmsg);
+      *rmsg = nn_rmsg_new (rbpool);
+      msg = (unsigned char *) NN_RMSG_PAYLOAD (*rmsg);
+      memcpy (msg, rest + (off - restoff), sz);
+      nn_rmsg_setsize (*rmsg, (uint32_t) sz);
+    }
+    handle_rtps_message (ts1, gv, conn, guidprefix, rbpool, rmsg, sz, msg, &rb->srcloc, rb->timestamp);
+  }
+  ddsrt_free (rest);
+}
+
 static bool do_packet (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool *rbpool)
 {
   /* UDP max packet size is 64kB */
@@ -3265,45 +3583,166 @@ static bool do_packet (struct thread_state1 * const ts1, struct ddsi_domaingv *g
   if (sz > 0 && !gv->deaf)
   {
     nn_rmsg_setsize (rmsg, (uint32_t) sz);
-    assert (thread_is_asleep ());
+    handle_rtps_message (ts1, gv, conn, guidprefix, rbpool, &rmsg, (size_t) sz, buff, &srcloc, (ddsrt_wctime_t) { 0 });
+  }
+  nn_rmsg_commit (rmsg);
+  return (sz > 0);
+}
+
+static bool do_packet_batch (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool **rbpools, uint32_t nrbpools, uint32_t *nbatch)
+{
+  /* Same as do_packet, but for datagrams only, reading up to nrbpools
+     datagrams in one go.  Each pool is used for a single message, which
+     preserves the invariant that a pool never has more than one
+     uncommitted message.
+
+     Setting up a message costs about as much as the read itself, so the
+     number of messages offered follows what the previous read returned:
+     doubling when all were filled, dropping back when fewer were.  That
+     way a lone datagram (e.g. a ping) doesn't pay for a full batch */
+  const size_t maxsz = gv->config.rmsg_chunk_size < 65536 ? gv->config.rmsg_chunk_size : 65536;
+  struct nn_rmsg *rmsgs[DDSI_MAX_RECV_BATCH_SIZE];
+  struct ddsi_tran_readbuf bufs[DDSI_MAX_RECV_BATCH_SIZE];
+  uint32_t nalloc;
+  int n;
+
+  assert (!conn->m_stream);
+  assert (nrbpools <= DDSI_MAX_RECV_BATCH_SIZE);
+  assert (*nbatch >= 1 && *nbatch <= nrbpools);
+  for (nalloc = 0; nalloc < *nbatch; nalloc++)
+  {
+    if ((rmsgs[nalloc] = nn_rmsg_new (rbpools[nalloc])) == NULL)
+      break;
+    bufs[nalloc].buf = (unsigned char *) NN_RMSG_PAYLOAD (rmsgs[nalloc]);
+    bufs[nalloc].len = maxsz;
+    bufs[nalloc].segsize = 0;
+    bufs[nalloc].timestamp.v = 0;
+  }
+  if (nalloc == 0)
+    return false;
 
-    if ((size_t)sz < RTPS_MESSAGE_HEADER_SIZE || *(uint32_t *)buff != NN_PROTOCOLID_AS_UINT32)
+  n = ddsi_conn_read_multi (conn, nalloc, bufs);
+  for (uint32_t i = 0; i < nalloc; i++)
+  {
+    if ((int) i < n && bufs[i].len > 0 && !gv->deaf)
     {
-      /* discard packets that are really too small or don't have magic cookie */
+      nn_rmsg_setsize (rmsgs[i], (uint32_t) bufs[i].len);
+      handle_rtps_datagrams (ts1, gv, conn, guidprefix, rbpools[i], &rmsgs[i], &bufs[i]);
     }
-    else if (hdr->version.major != RTPS_MAJOR || (hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
+    nn_rmsg_commit (rmsgs[i]);
+  }
+  if (n >= (int) nalloc)
+    *nbatch = (2 * nalloc < nrbpools) ? 2 * nalloc : nrbpools;
+  else
+    *nbatch = (n > 1) ? (uint32_t) n : 1;
+  return (n > 0);
+}
+
+static bool do_packets (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, const struct recv_thread_arg *recv_thread_arg, uint32_t *nbatch)
+{
+  /* Coalesced datagrams and kernel timestamps can only be received via the
+     batched interface */
+  if ((recv_thread_arg->nrbpools > 1 || gv->config.recv_gro || gv->config.recv_latency_stats) && ddsi_conn_supports_read_multi (conn))
+    return do_packet_batch (ts1, gv, conn, guidprefix, recv_thread_arg->rbpools, recv_thread_arg->nrbpools, nbatch);
+  else
+  {
+    /* A stream transport may have read ahead, the messages it buffered
+       won't cause the socket to become readable again */
+    bool ok;
+    do {
+      ok = do_packet (ts1, gv, conn, guidprefix, recv_thread_arg->rbpool);
+    } while (ok && ddsi_conn_read_pending (conn));
+    return ok;
+  }
+}
+
+static void log_rbufpool_stats (struct ddsi_domaingv *gv, const struct recv_thread_arg *recv_thread_arg, ddsrt_mtime_t *guard)
+{
+  /* Once per second, like the CPU time: pinned rbufs are those kept alive
+     by messages that are still referenced, e.g. in a reorder admin, which
+     is what drives the memory use of the pools */
+  if (gv->logconfig.c.mask & DDS_LC_TIMING)
+  {
+    const ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+    if (tnow.v >= guard->v)
     {
-      if ((hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
-        GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu\n, version mismatch: %d.%d\n",
-                 PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, hdr->version.major, hdr->version.minor);
-      if (DDSI_SC_PEDANTIC_P (gv->config))
-        malformed_packet_received_nosubmsg (gv, buff, sz, "header", hdr->vendorid);
+      for (uint32_t i = 0; i < recv_thread_arg->nrbpools; i++)
+      {
+        struct nn_rbufpool_stats st;
+        nn_rbufpool_get_stats (recv_thread_arg->rbpools[i], &st);
+        GVLOG (DDS_LC_TIMING, "rbufpool %"PRIu32" rbufs %"PRIu32" (peak %"PRIu32") of %"PRIu32" bytes spare %"PRIu32" pinned %"PRIu32" recycled %"PRIu64"\n",
+               i, st.nrbufs, st.nrbufs_peak, st.rbuf_size, st.nspare, st.npinned, st.nrecycled);
+      }
+      guard->v = tnow.v + DDS_NSECS_IN_SEC;
     }
-    else
+  }
+}
+
+static void recv_thread_posted (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const struct recv_thread_arg *recv_thread_arg)
+{
+  /* The transport receives directly into the payloads of messages posted
+     in advance, one per pool (so that, as in do_packet_batch, a pool never
+     has more than one uncommitted message), the buffer id is the index of
+     the pool.  A received message is processed, committed and immediately
+     replaced by a new one. */
+  struct nn_rbufpool * const * const rbpools = recv_thread_arg->rbpools;
+  const uint32_t nrbpools = recv_thread_arg->nrbpools;
+  struct nn_rmsg *rmsgs[DDSI_MAX_RECV_BATCH_SIZE];
+  struct ddsi_tran_readbuf bufs[DDSI_MAX_RECV_BATCH_SIZE];
+  uint32_t nposted = 0;
+  ddsrt_mtime_t next_thread_cputime = { 0 };
+  ddsrt_mtime_t next_rbufpool_stats = { 0 };
+
+  assert (nrbpools <= DDSI_MAX_RECV_BATCH_SIZE);
+  for (uint32_t i = 0; i < nrbpools; i++)
+  {
+    if ((rmsgs[i] = nn_rmsg_new (rbpools[i])) == NULL)
+      continue;
+    if (ddsi_conn_post_readbuf (conn, i, (unsigned char *) NN_RMSG_PAYLOAD (rmsgs[i]), gv->config.rmsg_chunk_size) != DDS_RETCODE_OK)
     {
-      hdr->guid_prefix = nn_ntoh_guid_prefix (hdr->guid_prefix);
+      /* nothing posted yet if the first one fails: not supported */
+      nn_rmsg_commit (rmsgs[i]);
+      rmsgs[i] = NULL;
+      if (nposted == 0)
+        return;
+      break;
+    }
+    nposted++;
+  }
 
-      if (gv->logconfig.c.mask & DDS_LC_TRACE)
-      {
-        char addrstr[DDSI_LOCSTRLEN];
-        ddsi_locator_to_string(addrstr, sizeof(addrstr), &srcloc);
-        GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu from %s\n",
-                 PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, addrstr);
-      }
-      nn_rtps_msg_state_t res = decode_rtps_message (ts1, gv, &rmsg, &hdr, &buff, &sz, rbpool, conn->m_stream);
-      if (res != NN_RTPS_MSG_STATE_ERROR)
+  while (nposted > 0 && ddsrt_atomic_ld32 (&gv->rtps_keepgoing))
+  {
+    int n;
+    LOG_THREAD_CPUTIME (&gv->logconfig, next_thread_cputime);
+    log_rbufpool_stats (gv, recv_thread_arg, &next_rbufpool_stats);
+    if ((n = ddsi_conn_read_posted (conn, nposted, bufs)) < 0)
+      break;
+    for (int i = 0; i < n; i++)
+    {
+      const uint32_t id = bufs[i].id;
+      assert (id < nrbpools && rmsgs[id] != NULL);
+      if (bufs[i].len > 0 && !gv->deaf)
       {
-        handle_submsg_sequence (ts1, gv, conn, &srcloc, ddsrt_time_wallclock (), ddsrt_time_elapsed (), &hdr->guid_prefix, guidprefix, buff, (size_t) sz, buff + RTPS_MESSAGE_HEADER_SIZE, rmsg, res == NN_RTPS_MSG_STATE_ENCODED);
+        const unsigned char *payload = (const unsigned char *) NN_RMSG_PAYLOAD (rmsgs[id]);
+        nn_rmsg_setsize (rmsgs[id], (uint32_t) (bufs[i].buf - payload) + (uint32_t) bufs[i].len);
+        handle_rtps_datagrams (ts1, gv, conn, NULL, rbpools[id], &rmsgs[id], &bufs[i]);
       }
-      else
+      nn_rmsg_commit (rmsgs[id]);
+      if ((rmsgs[id] = nn_rmsg_new (rbpools[id])) == NULL ||
+          ddsi_conn_post_readbuf (conn, id, (unsigned char *) NN_RMSG_PAYLOAD (rmsgs[id]), gv->config.rmsg_chunk_size) != DDS_RETCODE_OK)
       {
-        /* drop message */
-        sz = 1;
+        if (rmsgs[id])
+          nn_rmsg_commit (rmsgs[id]);
+        rmsgs[id] = NULL;
+        nposted--;
       }
     }
   }
-  nn_rmsg_commit (rmsg);
-  return (sz > 0);
+
+  ddsi_conn_cancel_posted (conn);
+  for (uint32_t i = 0; i < nrbpools; i++)
+    if (rmsgs[i])
+      nn_rmsg_commit (rmsgs[i]);
 }
 
 struct local_participant_desc
@@ -3473,7 +3912,7 @@ void trigger_recv_threads (const struct ddsi_domaingv *gv)
     {
       case RTM_SINGLE: {
         char buf[DDSI_LOCSTRLEN];
-        char dummy = 0;
+        char dummy = (char) gv->recv_threads[i].arg.u.single.shard;
         const ddsi_locator_t *dst = gv->recv_threads[i].arg.u.single.loc;
         ddsrt_iovec_t iov;
         iov.iov_base = &dummy;
@@ -3492,23 +3931,79 @@ void trigger_recv_threads (const struct ddsi_domaingv *gv)
   }
 }
 
+/* Busy polling: spin for at most ReceiveBusyPoll on a non-blocking check for
+   data before falling back to blocking, trading CPU time for not having to
+   wait for the thread to be woken up */
+static bool recv_thread_sock_readable (ddsrt_socket_t sock)
+{
+  /* poll rather than select: no limit on the socket number and nothing to
+     set up on every call */
+#if defined _WIN32
+  WSAPOLLFD pfd = { .fd = sock, .events = POLLRDNORM, .revents = 0 };
+  return WSAPoll (&pfd, 1, 0) > 0;
+#elif LWIP_SOCKET
+  /* lwIP socket numbers are always below FD_SETSIZE */
+  fd_set rdset;
+  int32_t ready;
+  FD_ZERO (&rdset);
+  FD_SET (sock, &rdset);
+  return ddsrt_select ((int32_t) sock + 1, &rdset, NULL, NULL, 0, &ready) == DDS_RETCODE_OK && ready > 0;
+#else
+  struct pollfd pfd = { .fd = sock, .events = POLLIN, .revents = 0 };
+  return poll (&pfd, 1, 0) > 0;
+#endif
+}
+
+static bool recv_thread_busy_poll_single (struct ddsi_domaingv *gv, ddsi_tran_conn_t conn)
+{
+  const ddsrt_socket_t sock = ddsi_conn_handle (conn);
+  if (sock == DDSRT_INVALID_SOCKET)
+    return false;
+  const ddsrt_mtime_t tend = ddsrt_mtime_add_duration (ddsrt_time_monotonic (), gv->config.recv_busy_poll);
+  do {
+    if (recv_thread_sock_readable (sock))
+      return true;
+  } while (ddsrt_atomic_ld32 (&gv->rtps_keepgoing) && ddsrt_time_monotonic ().v < tend.v);
+  return false;
+}
+
+static os_sockWaitsetCtx recv_thread_busy_poll_many (struct ddsi_domaingv *gv, os_sockWaitset waitset)
+{
+  const ddsrt_mtime_t tend = ddsrt_mtime_add_duration (ddsrt_time_monotonic (), gv->config.recv_busy_poll);
+  os_sockWaitsetCtx ctx;
+  do {
+    if ((ctx = os_sockWaitsetPoll (waitset)) != NULL)
+      return ctx;
+  } while (ddsrt_atomic_ld32 (&gv->rtps_keepgoing) && ddsrt_time_monotonic ().v < tend.v);
+  return os_sockWaitsetWait (waitset);
+}
+
 uint32_t recv_thread (void *vrecv_thread_arg)
 {
   struct thread_state1 * const ts1 = lookup_thread_state ();
   struct recv_thread_arg *recv_thread_arg = vrecv_thread_arg;
   struct ddsi_domaingv * const gv = recv_thread_arg->gv;
-  struct nn_rbufpool *rbpool = recv_thread_arg->rbpool;
   os_sockWaitset waitset = recv_thread_arg->mode == RTM_MANY ? recv_thread_arg->u.many.ws : NULL;
   ddsrt_mtime_t next_thread_cputime = { 0 };
+  ddsrt_mtime_t next_rbufpool_stats = { 0 };
+  uint32_t nbatch = 1;
 
-  nn_rbufpool_setowner (rbpool, ddsrt_thread_self ());
+  for (uint32_t i = 0; i < recv_thread_arg->nrbpools; i++)
+    nn_rbufpool_setowner (recv_thread_arg->rbpools[i], ddsrt_thread_self ());
   if (waitset == NULL)
   {
     struct ddsi_tran_conn *conn = recv_thread_arg->u.single.conn;
+    /* returns on termination, or if something goes wrong, in which case
+       the regular path takes over */
+    if (ddsi_conn_supports_posted_read (conn))
+      recv_thread_posted (ts1, gv, conn, recv_thread_arg);
     while (ddsrt_atomic_ld32 (&gv->rtps_keepgoing))
     {
       LOG_THREAD_CPUTIME (&gv->logconfig, next_thread_cputime);
-      (void) do_packet (ts1, gv, conn, NULL, rbpool);
+      log_rbufpool_stats (gv, recv_thread_arg, &next_rbufpool_stats);
+      if (gv->config.recv_busy_poll > 0)
+        (void) recv_thread_busy_poll_single (gv, conn);
+      (void) do_packets (ts1, gv, conn, NULL, recv_thread_arg, &nbatch);
     }
   }
   else
@@ -3539,6 +4034,7 @@ uint32_t recv_thread (void *vrecv_thread_arg)
     {
       int rebuildws = 0;
       LOG_THREAD_CPUTIME (&gv->logconfig, next_thread_cputime);
+      log_rbufpool_stats (gv, recv_thread_arg, &next_rbufpool_stats);
       if (gv->config.many_sockets_mode != DDSI_MSM_MANY_UNICAST)
       {
         /* no other sockets to check */
@@ -3561,7 +4057,11 @@ uint32_t recv_thread (void *vrecv_thread_arg)
         }
       }
 
-      if ((ctx = os_sockWaitsetWait (waitset)) != NULL)
+      if (gv->config.recv_busy_poll > 0)
+        ctx = recv_thread_busy_poll_many (gv, waitset);
+      else
+        ctx = os_sockWaitsetWait (waitset);
+      if (ctx != NULL)
       {
         int idx;
         ddsi_tran_conn_t conn;
@@ -3573,7 +4073,7 @@ uint32_t recv_thread (void *vrecv_thread_arg)
           else
             guid_prefix = &lps.ps[(unsigned)idx - num_fixed].guid_prefix;
           /* Process message and clean out connection if failed or closed */
-          if (!do_packet (ts1, gv, conn, guid_prefix, rbpool) && !conn->m_connless)
+          if (!do_packets (ts1, gv, conn, guid_prefix, recv_thread_arg, &nbatch) && !conn->m_connless)
             ddsi_conn_free (conn);
         }
       }
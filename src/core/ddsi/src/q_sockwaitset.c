@@ -27,11 +27,14 @@
 #define MODE_KQUEUE 1
 #define MODE_SELECT 2
 #define MODE_WFMEVS 3
+#define MODE_EPOLL 4
 
 #if defined __APPLE__
 #define MODE_SEL MODE_KQUEUE
 #elif defined WINCE
 #define MODE_SEL MODE_WFMEVS
+#elif defined __linux && !LWIP_SOCKET
+#define MODE_SEL MODE_EPOLL
 #else
 #define MODE_SEL MODE_SELECT
 #endif
@@ -232,7 +235,7 @@ void os_sockWaitsetRemove (os_sockWaitset ws, ddsi_tran_conn_t conn)
   ddsrt_mutex_unlock (&ws->lock);
 }
 
-os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws)
+static os_sockWaitsetCtx os_sockWaitsetWaitInt (os_sockWaitset ws, bool block)
 {
   /* if the array of events is smaller than the number of file descriptors in the
      kqueue, things will still work fine, as the kernel will just return what can
@@ -244,7 +247,8 @@ os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws)
     ws->ctx.evs_sz = ws_sz;
     ws->ctx.evs = ddsrt_realloc (ws->ctx.evs, ws_sz * sizeof(*ws->ctx.evs));
   }
-  nevs = kevent (ws->kqueue, NULL, 0, ws->ctx.evs, (int)ws->ctx.evs_sz, NULL);
+  const struct timespec zero = { 0, 0 };
+  nevs = kevent (ws->kqueue, NULL, 0, ws->ctx.evs, (int)ws->ctx.evs_sz, block ? NULL : &zero);
   if (nevs < 0)
   {
     if (errno == EINTR)
@@ -255,6 +259,8 @@ os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws)
       return NULL;
     }
   }
+  if (nevs == 0 && !block)
+    return NULL;
   ws->ctx.nevs = (uint32_t)nevs;
   ws->ctx.index = 0;
   return &ws->ctx;
@@ -281,6 +287,306 @@ int os_sockWaitsetNextEvent (os_sockWaitsetCtx ctx, ddsi_tran_conn_t *conn)
   return -1;
 }
 
+#elif MODE_SEL == MODE_EPOLL
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/* Level-triggered: the receive thread reads a single message from a socket
+   for each event, so edge-triggered notifications would require draining
+   the sockets (and thus non-blocking sockets) */
+
+struct entry {
+  uint32_t index;
+  int fd;
+  ddsi_tran_conn_t conn;
+};
+
+struct os_sockWaitsetCtx
+{
+  os_sockWaitset ws;
+  struct epoll_event *evs;
+  struct entry *snap; /* entries for evs, copied when epoll_wait returns */
+  uint32_t snap_gen; /* os_sockWaitset::gen at the time of copying */
+  uint32_t nevs;
+  uint32_t evs_sz;
+  uint32_t index; /* cursor for enumerating */
+};
+
+struct os_sockWaitset
+{
+  int epoll;
+  int evfd; /* eventfd used for triggering */
+  ddsrt_atomic_uint32_t sz;
+  ddsrt_atomic_uint32_t gen; /* incremented whenever entries are removed */
+  struct entry *entries;
+  struct os_sockWaitsetCtx ctx; /* set of descriptors being handled */
+  ddsrt_mutex_t lock; /* for add/delete */
+};
+
+static int epoll_add_entry (int epfd, const struct entry *entries, uint32_t idx)
+{
+  /* position in entries rather than a pointer, as entries may get reallocated */
+  struct epoll_event ev;
+  memset (&ev, 0, sizeof (ev));
+  ev.events = EPOLLIN;
+  ev.data.u32 = idx;
+  return epoll_ctl (epfd, EPOLL_CTL_ADD, entries[idx].fd, &ev);
+}
+
+static void epoll_del_entry (int epfd, int fd, const char *caller)
+{
+  /* the socket may already have been closed, and thereby removed from the
+     epoll set, that's fine but anything else is worth mentioning */
+  if (epoll_ctl (epfd, EPOLL_CTL_DEL, fd, NULL) == -1 && errno != ENOENT && errno != EBADF)
+    DDS_WARNING("%s: epoll_ctl failed, errno = %d\n", caller, errno);
+}
+
+static int add_entry_locked (os_sockWaitset ws, ddsi_tran_conn_t conn, int fd)
+{
+  uint32_t idx, fidx, sz, n;
+  assert (fd >= 0);
+  sz = ddsrt_atomic_ld32 (&ws->sz);
+  for (idx = 0, fidx = UINT32_MAX, n = 0; idx < sz; idx++)
+  {
+    if (ws->entries[idx].fd == -1)
+      fidx = (idx < fidx) ? idx : fidx;
+    else if (ws->entries[idx].conn == conn)
+      return 0;
+    else
+      n++;
+  }
+
+  if (fidx == UINT32_MAX)
+  {
+    const uint32_t newsz = sz + WAITSET_DELTA;
+    ws->entries = ddsrt_realloc (ws->entries, newsz * sizeof (*ws->entries));
+    for (idx = sz; idx < newsz; idx++)
+      ws->entries[idx].fd = -1;
+    ddsrt_atomic_st32 (&ws->sz, newsz);
+    fidx = sz;
+  }
+  ws->entries[fidx].conn = conn;
+  ws->entries[fidx].fd = fd;
+  ws->entries[fidx].index = n;
+  if (epoll_add_entry (ws->epoll, ws->entries, fidx) == -1)
+  {
+    ws->entries[fidx].fd = -1;
+    return -1;
+  }
+  return 1;
+}
+
+os_sockWaitset os_sockWaitsetNew (void)
+{
+  const uint32_t sz = WAITSET_DELTA;
+  os_sockWaitset ws;
+  uint32_t i;
+  if ((ws = ddsrt_malloc (sizeof (*ws))) == NULL)
+    goto fail_waitset;
+  ddsrt_atomic_st32 (&ws->sz, sz);
+  ddsrt_atomic_st32 (&ws->gen, 0);
+  if ((ws->entries = ddsrt_malloc (sz * sizeof (*ws->entries))) == NULL)
+    goto fail_entries;
+  for (i = 0; i < sz; i++)
+    ws->entries[i].fd = -1;
+  ws->ctx.ws = ws;
+  ws->ctx.nevs = 0;
+  ws->ctx.index = 0;
+  ws->ctx.evs_sz = sz;
+  if ((ws->ctx.evs = ddsrt_malloc (ws->ctx.evs_sz * sizeof (*ws->ctx.evs))) == NULL)
+    goto fail_ctx_evs;
+  if ((ws->ctx.snap = ddsrt_malloc (ws->ctx.evs_sz * sizeof (*ws->ctx.snap))) == NULL)
+    goto fail_ctx_snap;
+  if ((ws->epoll = epoll_create1 (EPOLL_CLOEXEC)) == -1)
+    goto fail_epoll;
+  if ((ws->evfd = eventfd (0, EFD_CLOEXEC)) == -1)
+    goto fail_eventfd;
+  if (add_entry_locked (ws, NULL, ws->evfd) < 0)
+    goto fail_add_trigger;
+  assert (ws->entries[0].fd == ws->evfd);
+  ddsrt_mutex_init (&ws->lock);
+  return ws;
+
+fail_add_trigger:
+  close (ws->evfd);
+fail_eventfd:
+  close (ws->epoll);
+fail_epoll:
+  ddsrt_free (ws->ctx.snap);
+fail_ctx_snap:
+  ddsrt_free (ws->ctx.evs);
+fail_ctx_evs:
+  ddsrt_free (ws->entries);
+fail_entries:
+  ddsrt_free (ws);
+fail_waitset:
+  return NULL;
+}
+
+void os_sockWaitsetFree (os_sockWaitset ws)
+{
+  ddsrt_mutex_destroy (&ws->lock);
+  close (ws->evfd);
+  close (ws->epoll);
+  ddsrt_free (ws->entries);
+  ddsrt_free (ws->ctx.evs);
+  ddsrt_free (ws->ctx.snap);
+  ddsrt_free (ws);
+}
+
+void os_sockWaitsetTrigger (os_sockWaitset ws)
+{
+  const uint64_t one = 1;
+  if (write (ws->evfd, &one, sizeof (one)) != (ssize_t) sizeof (one))
+  {
+    DDS_WARNING("os_sockWaitsetTrigger: write failed on trigger eventfd, errno = %d\n", errno);
+  }
+}
+
+int os_sockWaitsetAdd (os_sockWaitset ws, ddsi_tran_conn_t conn)
+{
+  int ret;
+  ddsrt_mutex_lock (&ws->lock);
+  ret = add_entry_locked (ws, conn, ddsi_conn_handle (conn));
+  ddsrt_mutex_unlock (&ws->lock);
+  return ret;
+}
+
+void os_sockWaitsetPurge (os_sockWaitset ws, unsigned index)
+{
+  /* Sockets may have been closed by the time Purge is called, closed sockets
+     are automatically removed from the epoll set and the file descriptors may
+     be reused in the meantime.  Like for kqueue, replace the epoll set rather
+     than delete entries, unless a new one can't be created */
+  uint32_t i, sz;
+  int epfd;
+  ddsrt_mutex_lock (&ws->lock);
+  sz = ddsrt_atomic_ld32 (&ws->sz);
+  if ((epfd = epoll_create1 (EPOLL_CLOEXEC)) == -1)
+  {
+    DDS_WARNING("os_sockWaitsetPurge: epoll_create1 failed, errno = %d\n", errno);
+    for (i = index + 1; i < sz; i++)
+      if (ws->entries[i].fd != -1)
+        epoll_del_entry (ws->epoll, ws->entries[i].fd, "os_sockWaitsetPurge");
+  }
+  else
+  {
+    close (ws->epoll);
+    ws->epoll = epfd;
+    for (i = 0; i <= index; i++)
+    {
+      assert (ws->entries[i].fd >= 0);
+      if (epoll_add_entry (ws->epoll, ws->entries, i) == -1)
+        DDS_WARNING("os_sockWaitsetPurge: epoll_ctl failed, errno = %d\n", errno);
+    }
+  }
+  for (i = index + 1; i < sz; i++)
+  {
+    ws->entries[i].conn = NULL;
+    ws->entries[i].fd = -1;
+  }
+  ddsrt_atomic_inc32 (&ws->gen);
+  ddsrt_mutex_unlock (&ws->lock);
+}
+
+void os_sockWaitsetRemove (os_sockWaitset ws, ddsi_tran_conn_t conn)
+{
+  const int fd = ddsi_conn_handle (conn);
+  uint32_t i, sz;
+  assert (fd >= 0);
+  ddsrt_mutex_lock (&ws->lock);
+  sz = ddsrt_atomic_ld32 (&ws->sz);
+  for (i = 1; i < sz; i++)
+    if (ws->entries[i].fd == fd)
+      break;
+  if (i < sz)
+  {
+    epoll_del_entry (ws->epoll, ws->entries[i].fd, "os_sockWaitsetRemove");
+    ws->entries[i].fd = -1;
+    ddsrt_atomic_inc32 (&ws->gen);
+  }
+  ddsrt_mutex_unlock (&ws->lock);
+}
+
+static os_sockWaitsetCtx os_sockWaitsetWaitInt (os_sockWaitset ws, bool block)
+{
+  /* if the array of events is smaller than the number of file descriptors in the
+     epoll set, things will still work fine, as the kernel will just return what can
+     be stored, and the set will be grown on the next call */
+  uint32_t ws_sz = ddsrt_atomic_ld32 (&ws->sz);
+  int nevs;
+  if (ws->ctx.evs_sz < ws_sz)
+  {
+    ws->ctx.evs_sz = ws_sz;
+    ws->ctx.evs = ddsrt_realloc (ws->ctx.evs, ws_sz * sizeof(*ws->ctx.evs));
+    ws->ctx.snap = ddsrt_realloc (ws->ctx.snap, ws_sz * sizeof(*ws->ctx.snap));
+  }
+  nevs = epoll_wait (ws->epoll, ws->ctx.evs, (int)ws->ctx.evs_sz, block ? -1 : 0);
+  if (nevs < 0)
+  {
+    if (errno == EINTR)
+      nevs = 0;
+    else
+    {
+      DDS_WARNING("os_sockWaitsetWait: epoll_wait failed, errno = %d\n", errno);
+      return NULL;
+    }
+  }
+  if (nevs == 0 && !block)
+    return NULL;
+  ws->ctx.nevs = (uint32_t)nevs;
+  ws->ctx.index = 0;
+  if (nevs > 0)
+  {
+    /* entries may be reallocated or removed concurrently, copying them all
+       at once means the lock needn't be taken for each event */
+    ddsrt_mutex_lock (&ws->lock);
+    ws->ctx.snap_gen = ddsrt_atomic_ld32 (&ws->gen);
+    for (uint32_t i = 0; i < ws->ctx.nevs; i++)
+      ws->ctx.snap[i] = ws->entries[ws->ctx.evs[i].data.u32];
+    ddsrt_mutex_unlock (&ws->lock);
+  }
+  return &ws->ctx;
+}
+
+int os_sockWaitsetNextEvent (os_sockWaitsetCtx ctx, ddsi_tran_conn_t *conn)
+{
+  os_sockWaitset ws = ctx->ws;
+  while (ctx->index < ctx->nevs)
+  {
+    const uint32_t idx = ctx->index++;
+    struct entry entry;
+    /* the copy is still valid unless an entry has been removed since, in which
+       case this one may be gone by now */
+    if (ddsrt_atomic_ld32 (&ws->gen) == ctx->snap_gen)
+      entry = ctx->snap[idx];
+    else
+    {
+      ddsrt_mutex_lock (&ws->lock);
+      entry = ws->entries[ctx->evs[idx].data.u32];
+      ddsrt_mutex_unlock (&ws->lock);
+    }
+    if (entry.fd == -1)
+      continue;
+    else if (entry.index > 0)
+    {
+      *conn = entry.conn;
+      return (int)(entry.index - 1);
+    }
+    else
+    {
+      /* trigger eventfd, read & try again */
+      uint64_t dummy;
+      if (read (entry.fd, &dummy, sizeof (dummy)) != (ssize_t) sizeof (dummy))
+        DDS_WARNING("os_sockWaitsetNextEvent: read failed on trigger eventfd, errno = %d\n", errno);
+    }
+  }
+  return -1;
+}
+
 #elif MODE_SEL == MODE_WFMEVS
 
 struct os_sockWaitsetCtx
@@ -405,7 +711,7 @@ int os_sockWaitsetAdd (os_sockWaitset ws, ddsi_tran_conn_t conn)
   return ret;
 }
 
-os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws)
+static os_sockWaitsetCtx os_sockWaitsetWaitInt (os_sockWaitset ws, bool block)
 {
   unsigned idx;
 
@@ -415,11 +721,13 @@ os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws)
   ws->ctx0 = ws->ctx;
   ddsrt_mutex_unlock (&ws->mutex);
 
-  if ((idx = WSAWaitForMultipleEvents (ws->ctx0.n, ws->ctx0.events, FALSE, WSA_INFINITE, FALSE)) == WSA_WAIT_FAILED)
+  if ((idx = WSAWaitForMultipleEvents (ws->ctx0.n, ws->ctx0.events, FALSE, block ? WSA_INFINITE : 0, FALSE)) == WSA_WAIT_FAILED)
   {
     DDS_WARNING("os_sockWaitsetWait: WSAWaitForMultipleEvents(%d,...,0,0,0) failed, error %d\n", ws->ctx0.n, os_getErrno ());
     return NULL;
   }
+  if (idx == WSA_WAIT_TIMEOUT)
+    return NULL;
 
 #ifndef WAIT_IO_COMPLETION /* curious omission in the WinCE headers */
 #define TEMP_DEF_WAIT_IO_COMPLETION
@@ -811,7 +1119,7 @@ void os_sockWaitsetRemove (os_sockWaitset ws, ddsi_tran_conn_t conn)
   ddsrt_mutex_unlock (&ws->mutex);
 }
 
-os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws)
+static os_sockWaitsetCtx os_sockWaitsetWaitInt (os_sockWaitset ws, bool block)
 {
   int32_t n = -1;
   unsigned u;
@@ -861,8 +1169,8 @@ os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws)
 
   do
   {
-    dds_return_t rc = ddsrt_select (fdmax, rdset, NULL, NULL, DDS_INFINITY, &n);
-    if (rc != DDS_RETCODE_OK && rc != DDS_RETCODE_INTERRUPTED && rc != DDS_RETCODE_TRY_AGAIN)
+    dds_return_t rc = ddsrt_select (fdmax, rdset, NULL, NULL, block ? DDS_INFINITY : 0, &n);
+    if (rc != DDS_RETCODE_OK && rc != DDS_RETCODE_INTERRUPTED && rc != DDS_RETCODE_TRY_AGAIN && rc != DDS_RETCODE_TIMEOUT)
     {
       DDS_WARNING("os_sockWaitsetWait: select failed, retcode = %"PRId32, rc);
       break;
@@ -927,3 +1235,13 @@ DDSRT_WARNING_GNUC_ON(sign-conversion)
 #else
 #error "no mode selected"
 #endif
+
+os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws)
+{
+  return os_sockWaitsetWaitInt (ws, true);
+}
+
+os_sockWaitsetCtx os_sockWaitsetPoll (os_sockWaitset ws)
+{
+  return os_sockWaitsetWaitInt (ws, false);
+}
@@ -295,10 +295,12 @@ static dds_return_t create_thread_int (struct thread_state1 **ts1_out, const str
     tattr.schedClass = tprops->sched_class; /* explicit default value in the enum */
     if (!tprops->stack_size.isdefault)
       tattr.stackSize = tprops->stack_size.value;
+    tattr.ncpus = tprops->affinity.n;
+    tattr.cpus = tprops->affinity.cpus;
   }
   if (gv)
   {
-    GVTRACE ("create_thread: %s: class %d priority %"PRId32" stack %"PRIu32"\n", name, (int) tattr.schedClass, tattr.schedPriority, tattr.stackSize);
+    GVTRACE ("create_thread: %s: class %d priority %"PRId32" stack %"PRIu32" cpus %"PRIu32"\n", name, (int) tattr.schedClass, tattr.schedPriority, tattr.stackSize, tattr.ncpus);
   }
 
   if (ddsrt_thread_create (&ts1->tid, name, &tattr, &create_thread_wrapper, ts1) != DDS_RETCODE_OK)
@@ -36,6 +36,7 @@
 #include "dds/ddsi/q_lease.h"
 #include "dds/ddsi/ddsi_tkmap.h"
 #include "dds/ddsi/ddsi_serdata.h"
+#include "dds/ddsi/ddsi_tran.h"
 #include "dds/ddsi/ddsi_sertype.h"
 #include "dds/ddsi/ddsi_security_omg.h"
 
@@ -753,6 +754,13 @@ static int must_skip_frag (const char *frags_to_skip, unsigned frag)
 }
 #endif
 
+static uint32_t writer_xmit_flags (const struct writer *wr)
+{
+  /* Only a TCP send queue ever drops best-effort data; elsewhere the flag
+     would only stop data from being packed together with other messages */
+  return (!wr->reliable && wr->e.gv->config.tcp_send_queue_size > 0) ? DDSI_TRAN_BEST_EFFORT : 0;
+}
+
 static void transmit_sample_lgmsg_unlocks_wr (struct nn_xpack *xp, struct writer *wr, seqno_t seq, const struct ddsi_plist *plist, struct ddsi_serdata *serdata, struct proxy_reader *prd, int isnew, uint32_t nfrags, uint32_t nfrags_lim)
 {
 #if 0
@@ -760,6 +768,7 @@ static void transmit_sample_lgmsg_unlocks_wr (struct nn_xpack *xp, struct writer
 #endif
   assert(xp);
   assert(0 < nfrags_lim && nfrags_lim <= nfrags);
+  const uint32_t xmit_flags = writer_xmit_flags (wr);
   uint32_t nf_in_submsg = isnew ? (wr->e.gv->config.max_msg_size / wr->e.gv->config.fragment_size) : 1;
   if (nf_in_submsg == 0)
     nf_in_submsg = 1;
@@ -790,8 +799,8 @@ static void transmit_sample_lgmsg_unlocks_wr (struct nn_xpack *xp, struct writer
     }
     ddsrt_mutex_unlock (&wr->e.lock);
 
-    if(fmsg) nn_xpack_addmsg (xp, fmsg, 0);
-    if(hmsg) nn_xpack_addmsg (xp, hmsg, 0);
+    if(fmsg) nn_xpack_addmsg (xp, fmsg, xmit_flags);
+    if(hmsg) nn_xpack_addmsg (xp, hmsg, xmit_flags);
 
     ddsrt_mutex_lock (&wr->e.lock);
   }
@@ -808,7 +817,8 @@ static void transmit_sample_unlocks_wr (struct nn_xpack *xp, struct writer *wr,
   assert((wr->heartbeat_xevent != NULL) == (whcst != NULL));
 
   sz = ddsi_serdata_size (serdata);
-  if (sz > gv->config.fragment_size || !isnew || plist != NULL || prd != NULL || q_omg_writer_is_submessage_protected(wr))
+  const bool fragmented = (sz > gv->config.fragment_size);
+  if (fragmented || !isnew || plist != NULL || prd != NULL || q_omg_writer_is_submessage_protected(wr))
   {
     assert (wr->init_burst_size_limit <= UINT32_MAX - UINT16_MAX);
     assert (wr->rexmit_burst_size_limit <= UINT32_MAX - UINT16_MAX);
@@ -826,7 +836,7 @@ static void transmit_sample_unlocks_wr (struct nn_xpack *xp, struct writer *wr,
   {
     struct nn_xmsg *fmsg;
     if (create_fragment_message_simple (wr, seq, serdata, &fmsg) >= 0)
-      nn_xpack_addmsg (xp, fmsg, 0);
+      nn_xpack_addmsg (xp, fmsg, writer_xmit_flags (wr));
   }
 
   if (wr->heartbeat_xevent)
@@ -837,6 +847,12 @@ static void transmit_sample_unlocks_wr (struct nn_xpack *xp, struct writer *wr,
     nn_xpack_addmsg (xp, hmsg, 0);
   if (hbansreq >= 2)
     nn_xpack_send (xp, true);
+  else if (fragmented)
+  {
+    /* don't hold on to the fragments staged for segmentation offload beyond
+       the transmission of this sample, only the last one remains queued */
+    nn_xpack_send_staged (xp);
+  }
 }
 
 void enqueue_spdp_sample_wrlock_held (struct writer *wr, seqno_t seq, struct ddsi_serdata *serdata, struct proxy_reader *prd)
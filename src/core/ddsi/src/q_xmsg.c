@@ -136,6 +136,18 @@ struct nn_xmsg_chain {
   struct nn_xmsg_chain_elem *latest;
 };
 
+/* Packets sent without the kernel copying the data: the xmsgs they were
+   built from and the RTPS header (which lives in the xpack) must remain
+   untouched until the transport reports completion */
+#define NN_XPACK_MAX_ZEROCOPY 16
+
+struct nn_xpack_zerocopy {
+  ddsi_tran_conn_t conn;
+  uint32_t seq;
+  Header_t hdr;
+  struct nn_xmsg_chain msgs;
+};
+
 #ifdef DDS_HAS_BANDWIDTH_LIMITING
 #define NN_BW_UNLIMITED (0)
 
@@ -180,6 +192,29 @@ struct nn_xpack
   bool includes_rexmit;
   struct nn_xmsg_chain included_msgs;
 
+  /* Packets to a single destination staged for sending with segmentation
+     offload: nsegs packets of segsize bytes, but the last may be shorter.
+     Only used if SendSegmentationOffload is enabled (buf != NULL).  Packets
+     that overflow get staged rather than sent, so they are held until the
+     run ends, the buffer is full, nn_xpack_send or nn_xpack_send_staged;
+     the transmit path calls the latter after each fragmented sample */
+  struct {
+    ddsi_xlocator_t dst;
+    uint32_t segsize;
+    uint32_t nsegs;
+    size_t len;
+    unsigned char *buf;
+  } gso;
+
+  /* Zero-copy sends awaiting completion, oldest first, in a ring of
+     NN_XPACK_MAX_ZEROCOPY entries, emptied by nn_xpack_send.  Only used if
+     SendZeroCopyThreshold is set (pending != NULL) */
+  struct {
+    uint32_t first;
+    uint32_t n;
+    struct nn_xpack_zerocopy *pending;
+  } zerocopy;
+
 #ifdef DDS_HAS_BANDWIDTH_LIMITING
   struct nn_bw_limiter limiter;
 #endif
@@ -1001,16 +1036,14 @@ int nn_xmsg_addpar_sentinel_ifparam (struct nn_xmsg * m)
    pointer we compute the address of the xmsg from the address of the
    chain element, &c. */
 
-static void nn_xmsg_chain_release (struct ddsi_domaingv *gv, struct nn_xmsg_chain *chain)
+static void nn_xmsg_chain_update_seq_xmit (struct ddsi_domaingv *gv, const struct nn_xmsg_chain *chain)
 {
   ddsi_guid_t wrguid;
   memset (&wrguid, 0, sizeof (wrguid));
 
-  while (chain->latest)
+  for (const struct nn_xmsg_chain_elem *ce = chain->latest; ce; ce = ce->older)
   {
-    struct nn_xmsg_chain_elem *ce = chain->latest;
-    struct nn_xmsg *m = (struct nn_xmsg *) ((char *) ce - offsetof (struct nn_xmsg, link));
-    chain->latest = ce->older;
+    const struct nn_xmsg *m = (const struct nn_xmsg *) ((const char *) ce - offsetof (struct nn_xmsg, link));
 
     /* If this xmsg was written by a writer different from wrguid,
        update wr->xmit_seq.  There isn't necessarily a writer, and
@@ -1036,11 +1069,26 @@ static void nn_xmsg_chain_release (struct ddsi_domaingv *gv, struct nn_xmsg_chai
           writer_update_seq_xmit (wr, m->kindspecific.data.wrseq);
       }
     }
+  }
+}
 
+static void nn_xmsg_chain_free (struct nn_xmsg_chain *chain)
+{
+  while (chain->latest)
+  {
+    struct nn_xmsg_chain_elem *ce = chain->latest;
+    struct nn_xmsg *m = (struct nn_xmsg *) ((char *) ce - offsetof (struct nn_xmsg, link));
+    chain->latest = ce->older;
     nn_xmsg_free (m);
   }
 }
 
+static void nn_xmsg_chain_release (struct ddsi_domaingv *gv, struct nn_xmsg_chain *chain)
+{
+  nn_xmsg_chain_update_seq_xmit (gv, chain);
+  nn_xmsg_chain_free (chain);
+}
+
 static void nn_xmsg_chain_add (struct nn_xmsg_chain *chain, struct nn_xmsg *m)
 {
   m->link.older = chain->latest;
@@ -1144,6 +1192,12 @@ struct nn_xpack * nn_xpack_new (struct ddsi_domaingv *gv, uint32_t bw_limit, boo
   xp->async_mode = async_mode;
   xp->iov = NULL;
   xp->gv = gv;
+  /* async mode sends copies of the xpack, staging packets for segmentation
+     offload requires them to persist */
+  xp->gso.buf = (gv->config.send_gso && !async_mode) ? ddsrt_malloc (DDSI_TRAN_MAX_GSO_BYTES) : NULL;
+  /* same for zero-copy sends, the messages must persist until completion */
+  if (gv->config.send_zerocopy_threshold > 0 && !async_mode)
+    xp->zerocopy.pending = ddsrt_malloc (NN_XPACK_MAX_ZEROCOPY * sizeof (*xp->zerocopy.pending));
 
   /* Fixed header fields, initialized just once */
   xp->hdr.protocol.id[0] = 'R';
@@ -1170,10 +1224,31 @@ struct nn_xpack * nn_xpack_new (struct ddsi_domaingv *gv, uint32_t bw_limit, boo
   return xp;
 }
 
+static void nn_xpack_zerocopy_reap (struct nn_xpack *xp, bool wait)
+{
+  while (xp->zerocopy.n > 0)
+  {
+    struct nn_xpack_zerocopy * const zc = &xp->zerocopy.pending[xp->zerocopy.first];
+    if (!ddsi_conn_zerocopy_done (zc->conn, zc->seq, wait))
+      break;
+    nn_xmsg_chain_free (&zc->msgs);
+    xp->zerocopy.first = (xp->zerocopy.first + 1) % NN_XPACK_MAX_ZEROCOPY;
+    xp->zerocopy.n--;
+  }
+}
+
 void nn_xpack_free (struct nn_xpack *xp)
 {
   assert (xp->niov == 0);
   assert (xp->included_msgs.latest == NULL);
+  assert (xp->gso.nsegs == 0);
+  if (xp->zerocopy.pending)
+  {
+    nn_xpack_zerocopy_reap (xp, true);
+    assert (xp->zerocopy.n == 0);
+    ddsrt_free (xp->zerocopy.pending);
+  }
+  ddsrt_free (xp->gso.buf);
   ddsrt_free (xp->iov);
   ddsrt_free (xp);
 }
@@ -1277,9 +1352,236 @@ static void nn_xpack_send1v (const ddsi_xlocator_t *loc, void * varg)
   (void) nn_xpack_send1 (loc, varg);
 }
 
+static void nn_xpack_gso_flush (struct nn_xpack *xp)
+{
+  ddsrt_iovec_t iov;
+  ssize_t nbytes = -1;
+  if (xp->gso.nsegs == 0)
+    return;
+  iov.iov_base = xp->gso.buf;
+  iov.iov_len = (ddsrt_iov_len_t) xp->gso.len;
+  if (xp->gso.nsegs > 1)
+    nbytes = ddsi_conn_write_gso (xp->gso.dst.conn, &xp->gso.dst.c, 1, &iov, xp->gso.segsize, 0);
+  if (nbytes < 0)
+  {
+    /* Single packet or offload failed: send them one-by-one */
+    nbytes = 0;
+    for (size_t off = 0; off < xp->gso.len; off += xp->gso.segsize)
+    {
+      ssize_t n;
+      iov.iov_base = xp->gso.buf + off;
+      iov.iov_len = (ddsrt_iov_len_t) ((xp->gso.len - off < xp->gso.segsize) ? xp->gso.len - off : xp->gso.segsize);
+      if ((n = ddsi_conn_write (xp->gso.dst.conn, &xp->gso.dst.c, 1, &iov, 0)) > 0)
+        nbytes += n;
+    }
+  }
+#ifdef DDS_HAS_BANDWIDTH_LIMITING
+  if (nbytes > 0)
+  {
+    nn_bw_limit_sleep_if_needed (xp->gv, &xp->limiter, nbytes);
+  }
+#else
+  (void) nbytes;
+#endif
+  xp->gso.nsegs = 0;
+  xp->gso.len = 0;
+}
+
+static bool nn_xpack_gso_stage (struct nn_xpack *xp, const ddsi_xlocator_t *dst)
+{
+  /* Copies the packet to the staging buffer if possible, flushing the staged
+     ones first if they can't be combined with this one; returns false if the
+     packet must be sent normally */
+  struct ddsi_domaingv const * const gv = xp->gv;
+  const uint32_t sz = xp->msg_len.length;
+  if (xp->gso.buf == NULL || !ddsi_conn_supports_write_gso (dst->conn) ||
+      gv->mute || gv->config.xmit_lossiness > 0 || (xp->call_flags & DDSI_TRAN_ON_CONNECT) || sz > DDSI_TRAN_MAX_GSO_BYTES)
+    return false;
+#ifdef DDS_HAS_SECURITY
+  if (xp->sec_info.use_rtps_encoding)
+    return false;
+#endif
+#ifdef DDS_HAS_SHM
+  if (dst->c.kind == NN_LOCATOR_KIND_SHEM)
+    return false;
+#endif
+  if (xp->gso.nsegs > 0 &&
+      (memcmp (&xp->gso.dst, dst, sizeof (xp->gso.dst)) != 0 || sz > xp->gso.segsize ||
+       xp->gso.len + sz > DDSI_TRAN_MAX_GSO_BYTES || xp->gso.nsegs == DDSI_TRAN_MAX_GSO_SEGMENTS))
+  {
+    nn_xpack_gso_flush (xp);
+  }
+  if (xp->gso.nsegs == 0)
+  {
+    xp->gso.dst = *dst;
+    xp->gso.segsize = sz;
+  }
+  for (size_t i = 0; i < xp->niov; i++)
+  {
+    memcpy (xp->gso.buf + xp->gso.len, xp->iov[i].iov_base, xp->iov[i].iov_len);
+    xp->gso.len += xp->iov[i].iov_len;
+  }
+  xp->gso.nsegs++;
+  /* only the last segment may be shorter */
+  if (sz < xp->gso.segsize)
+    nn_xpack_gso_flush (xp);
+  return true;
+}
+
+static bool nn_xpack_gso_stage_traced (struct nn_xpack *xp, const ddsi_xlocator_t *dst)
+{
+  struct ddsi_domaingv const * const gv = xp->gv;
+  if (!nn_xpack_gso_stage (xp, dst))
+    return false;
+  if (gv->logconfig.c.mask & DDS_LC_TRACE)
+  {
+    char buf[DDSI_LOCSTRLEN];
+    GVTRACE (" %s(staged)", ddsi_xlocator_to_string (buf, sizeof(buf), dst));
+  }
+  return true;
+}
+
+static bool nn_xpack_send_zerocopy (struct nn_xpack *xp, const ddsi_xlocator_t *dst)
+{
+  /* Sends the packet without copying if possible, moving the messages it
+     was built from to the pending list; returns false if the packet must
+     be sent normally */
+  struct ddsi_domaingv * const gv = xp->gv;
+  if (xp->zerocopy.pending == NULL || xp->msg_len.length < gv->config.send_zerocopy_threshold ||
+      !ddsi_conn_supports_write_zerocopy (dst->conn) || gv->mute || gv->config.xmit_lossiness > 0)
+    return false;
+#ifdef DDS_HAS_SECURITY
+  if (xp->sec_info.use_rtps_encoding)
+    return false;
+#endif
+#ifdef DDS_HAS_SHM
+  if (dst->c.kind == NN_LOCATOR_KIND_SHEM)
+    return false;
+#endif
+
+  nn_xpack_gso_flush (xp);
+  nn_xpack_zerocopy_reap (xp, false);
+  if (xp->zerocopy.n == NN_XPACK_MAX_ZEROCOPY)
+  {
+    /* wait for the oldest rather than holding on to ever more messages */
+    struct nn_xpack_zerocopy * const zc = &xp->zerocopy.pending[xp->zerocopy.first];
+    (void) ddsi_conn_zerocopy_done (zc->conn, zc->seq, true);
+    nn_xpack_zerocopy_reap (xp, false);
+  }
+
+  /* the header gets overwritten by the next packet, so send a copy */
+  struct nn_xpack_zerocopy * const zc = &xp->zerocopy.pending[(xp->zerocopy.first + xp->zerocopy.n) % NN_XPACK_MAX_ZEROCOPY];
+  const ddsrt_iovec_t iov0 = xp->iov[0];
+  ssize_t nbytes;
+  assert (iov0.iov_base == (void *) &xp->hdr && iov0.iov_len == sizeof (xp->hdr));
+  zc->hdr = xp->hdr;
+  xp->iov[0].iov_base = (void *) &zc->hdr;
+  nbytes = ddsi_conn_write_zerocopy (dst->conn, &dst->c, xp->niov, xp->iov, xp->call_flags, &zc->seq);
+  xp->iov[0] = iov0;
+  if (nbytes < 0)
+    return false;
+
+  if (gv->logconfig.c.mask & DDS_LC_TRACE)
+  {
+    char buf[DDSI_LOCSTRLEN];
+    GVTRACE (" %s(zerocopy)", ddsi_xlocator_to_string (buf, sizeof(buf), dst));
+  }
+  xp->call_flags = 0;
+  zc->conn = dst->conn;
+  nn_xmsg_chain_update_seq_xmit (gv, &xp->included_msgs);
+  zc->msgs = xp->included_msgs;
+  xp->included_msgs.latest = NULL;
+  xp->zerocopy.n++;
+#ifdef DDS_HAS_BANDWIDTH_LIMITING
+  nn_bw_limit_sleep_if_needed (gv, &xp->limiter, nbytes);
+#endif
+  return true;
+}
+
+static bool nn_xpack_single_dst (const struct nn_xpack *xp, ddsi_xlocator_t *dst)
+{
+  /* A single destination is the typical case for the fragments of a large
+     sample sent to a single reader (or a multicast group), that makes it a
+     candidate for segmentation offload and zero-copy sends */
+  if ((xp->gso.buf == NULL && xp->zerocopy.pending == NULL) || xp->dstmode != NN_XMSG_DST_ALL)
+    return false;
+  if (xp->dstaddr.all.as == NULL || xp->dstaddr.all.as_group != NULL || addrset_count (xp->dstaddr.all.as) != 1)
+    return false;
+  return addrset_any_uc (xp->dstaddr.all.as, dst) || addrset_any_mc (xp->dstaddr.all.as, dst);
+}
+
+struct nn_xpack_send_multi_arg {
+  struct nn_xpack *xp;
+  ddsi_tran_conn_t conn;
+  size_t ndst;
+  ddsi_locator_t dst[DDSI_TRAN_MAX_WRITE_MULTI];
+};
+
+static bool nn_xpack_can_send_multi (const struct nn_xpack *xp)
+{
+  /* Everything that nn_xpack_send1 does differently for each destination
+     requires sending them one-by-one */
+  struct ddsi_domaingv const * const gv = xp->gv;
+  if (gv->mute || gv->config.xmit_lossiness > 0 || (xp->call_flags & DDSI_TRAN_ON_CONNECT))
+    return false;
+#ifdef DDS_HAS_SECURITY
+  if (xp->sec_info.use_rtps_encoding)
+    return false;
+#endif
+  return true;
+}
+
+static void nn_xpack_send_multi_flush (struct nn_xpack_send_multi_arg *arg)
+{
+  if (arg->ndst > 0)
+  {
+    struct nn_xpack * const xp = arg->xp;
+    const int nsent = ddsi_conn_write_multi (arg->conn, arg->ndst, arg->dst, xp->niov, xp->iov, xp->call_flags);
+#ifdef DDS_HAS_BANDWIDTH_LIMITING
+    if (nsent > 0)
+    {
+      nn_bw_limit_sleep_if_needed (xp->gv, &xp->limiter, (ssize_t) nsent * (ssize_t) xp->msg_len.length);
+    }
+#else
+    (void) nsent;
+#endif
+    arg->ndst = 0;
+  }
+}
+
+static void nn_xpack_send_multi1 (const ddsi_xlocator_t *loc, void *varg)
+{
+  /* Collects consecutive destinations that use the same connection, so they
+     can be sent with a single call to ddsi_conn_write_multi */
+  struct nn_xpack_send_multi_arg * const arg = varg;
+#ifdef DDS_HAS_SHM
+  if (!ddsi_conn_supports_write_multi (loc->conn) || loc->c.kind == NN_LOCATOR_KIND_SHEM)
+#else
+  if (!ddsi_conn_supports_write_multi (loc->conn))
+#endif
+  {
+    nn_xpack_send_multi_flush (arg);
+    (void) nn_xpack_send1 (loc, arg->xp);
+    return;
+  }
+  if (arg->conn != loc->conn || arg->ndst == DDSI_TRAN_MAX_WRITE_MULTI)
+  {
+    nn_xpack_send_multi_flush (arg);
+    arg->conn = loc->conn;
+  }
+  if (arg->xp->gv->logconfig.c.mask & DDS_LC_TRACE)
+  {
+    struct ddsi_domaingv const * const gv = arg->xp->gv;
+    char buf[DDSI_LOCSTRLEN];
+    GVTRACE (" %s", ddsi_xlocator_to_string (buf, sizeof(buf), loc));
+  }
+  arg->dst[arg->ndst++] = loc->c;
+}
+
 static void nn_xpack_send_real (struct nn_xpack *xp)
 {
   struct ddsi_domaingv const * const gv = xp->gv;
+  ddsi_xlocator_t gsodst;
   size_t calls;
 
   assert (xp->niov <= NN_XMSG_MAX_MESSAGE_IOVECS);
@@ -1305,17 +1607,34 @@ static void nn_xpack_send_real (struct nn_xpack *xp)
   if (xp->dstmode == NN_XMSG_DST_ONE)
   {
     calls = 1;
-    (void) nn_xpack_send1 (&xp->dstaddr.loc, xp);
+    if (!nn_xpack_send_zerocopy (xp, &xp->dstaddr.loc) && !nn_xpack_gso_stage_traced (xp, &xp->dstaddr.loc))
+    {
+      nn_xpack_gso_flush (xp);
+      (void) nn_xpack_send1 (&xp->dstaddr.loc, xp);
+    }
+  }
+  else if (nn_xpack_single_dst (xp, &gsodst) && (nn_xpack_send_zerocopy (xp, &gsodst) || nn_xpack_gso_stage_traced (xp, &gsodst)))
+  {
+    calls = 1;
+    unref_addrset (xp->dstaddr.all.as);
   }
   else
   {
+    nn_xpack_gso_flush (xp);
     /* Send to all addresses in as - as ultimately references the writer's
        address set, which is currently replaced rather than changed whenever
        it is updated, but that might not be something we want to guarantee */
     calls = 0;
     if (xp->dstaddr.all.as)
     {
-      calls = addrset_forall_count (xp->dstaddr.all.as, nn_xpack_send1v, xp);
+      if (!nn_xpack_can_send_multi (xp))
+        calls = addrset_forall_count (xp->dstaddr.all.as, nn_xpack_send1v, xp);
+      else
+      {
+        struct nn_xpack_send_multi_arg arg = { .xp = xp, .conn = NULL, .ndst = 0 };
+        calls = addrset_forall_count (xp->dstaddr.all.as, nn_xpack_send_multi1, &arg);
+        nn_xpack_send_multi_flush (&arg);
+      }
       unref_addrset (xp->dstaddr.all.as);
     }
 
@@ -1407,7 +1726,7 @@ void nn_xpack_sendq_fini (struct ddsi_domaingv *gv)
   ddsrt_mutex_destroy (&gv->sendq_lock);
 }
 
-void nn_xpack_send (struct nn_xpack *xp, bool immediately)
+static void nn_xpack_send_packet (struct nn_xpack *xp, bool immediately)
 {
   if (!xp->async_mode)
   {
@@ -1444,6 +1763,21 @@ void nn_xpack_send (struct nn_xpack *xp, bool immediately)
   }
 }
 
+void nn_xpack_send (struct nn_xpack *xp, bool immediately)
+{
+  nn_xpack_send_packet (xp, immediately);
+  nn_xpack_gso_flush (xp);
+  /* wait for the zero-copy sends to complete: the xpack may not be used
+     again for a long time, and the messages (and thereby the samples) must
+     not be kept alive until then */
+  nn_xpack_zerocopy_reap (xp, true);
+}
+
+void nn_xpack_send_staged (struct nn_xpack *xp)
+{
+  nn_xpack_gso_flush (xp);
+}
+
 static void copy_addressing_info (struct nn_xpack *xp, const struct nn_xmsg *m)
 {
   xp->dstmode = m->dstmode;
@@ -1520,9 +1854,10 @@ static int nn_xpack_mayaddmsg (const struct nn_xpack *xp, const struct nn_xmsg *
     return 0;
   }
 
-  /* Check if different call semantics */
+  /* Check if different call semantics; best-effort and other data can
+     share a packet, it just means it will not be dropped */
 
-  if (xp->call_flags != flags)
+  if ((xp->call_flags ^ flags) & ~(uint32_t) DDSI_TRAN_BEST_EFFORT)
   {
     return 0;
   }
@@ -1569,7 +1904,7 @@ int nn_xpack_addmsg (struct nn_xpack *xp, struct nn_xmsg *m, const uint32_t flag
   if (!nn_xpack_mayaddmsg (xp, m, flags))
   {
     assert (xp->niov > 0);
-    nn_xpack_send (xp, false);
+    nn_xpack_send_packet (xp, false);
     assert (nn_xpack_mayaddmsg (xp, m, flags));
     result = 1;
   }
@@ -1722,12 +2057,13 @@ int nn_xpack_addmsg (struct nn_xpack *xp, struct nn_xmsg *m, const uint32_t flag
              (int) niov, sz, max_msg_size, (int) xpo_niov, xpo_sz);
     xp->msg_len.length = xpo_sz;
     xp->niov = xpo_niov;
-    nn_xpack_send (xp, false);
+    nn_xpack_send_packet (xp, false);
     result = nn_xpack_addmsg (xp, m, flags); /* Retry on emptied xp */
   }
   else
   {
-    xp->call_flags = flags;
+    /* a packet may be dropped only if all of its contents may be */
+    xp->call_flags = (xpo_niov == 0) ? flags : (xp->call_flags & flags);
     if (nn_xmsg_is_rexmit (m))
       xp->includes_rexmit = true;
     nn_xmsg_chain_add (&xp->included_msgs, m);
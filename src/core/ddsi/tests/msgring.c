@@ -0,0 +1,212 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "dds/ddsrt/heap.h"
+#include "ddsi_msgring.h"
+#include "CUnit/Test.h"
+
+#define SLOT_SIZE 128u
+#define NSLOTS 4u
+
+/* the slot header is private to ddsi_msgring.c, the test needs to know
+   where the length is to play the part of a hostile peer */
+#define SLOT_HEADER_SIZE 16u
+#define SLOT_LEN_OFFSET 4u
+
+static struct ddsi_msgring_ref ref;
+static int fds[2];
+
+static void msgring_init (void)
+{
+  CU_ASSERT_FATAL (pipe (fds) == 0);
+  for (int i = 0; i < 2; i++)
+  {
+    const int flags = fcntl (fds[i], F_GETFL);
+    CU_ASSERT_FATAL (flags >= 0 && fcntl (fds[i], F_SETFL, flags | O_NONBLOCK) == 0);
+  }
+  ddsi_msgring_init (&ref, ddsrt_malloc (ddsi_msgring_size (NSLOTS, SLOT_SIZE)), NSLOTS, SLOT_SIZE);
+}
+
+static void msgring_fini (void)
+{
+  ddsrt_free (ref.ring);
+  close (fds[0]);
+  close (fds[1]);
+}
+
+static bool push_msg (uint32_t seq, size_t len)
+{
+  unsigned char buf[SLOT_SIZE];
+  ddsrt_iovec_t iov[2];
+  /* split over two iovecs to check they get concatenated */
+  memset (buf, (int) (seq & 0xff), sizeof (buf));
+  iov[0].iov_base = buf;
+  iov[0].iov_len = (ddsrt_iov_len_t) (len / 2);
+  iov[1].iov_base = buf + len / 2;
+  iov[1].iov_len = (ddsrt_iov_len_t) (len - len / 2);
+  return ddsi_msgring_push (&ref, fds[1], seq, 2, iov, len);
+}
+
+static void check_msg (uint32_t *head, uint32_t seq, size_t len)
+{
+  unsigned char buf[SLOT_SIZE];
+  uint32_t srcport;
+  ssize_t n = ddsi_msgring_read (&ref, head, fds[0], false, buf, sizeof (buf), &srcport);
+  CU_ASSERT_FATAL (n == (ssize_t) len);
+  CU_ASSERT_EQUAL_FATAL (srcport, seq);
+  for (size_t i = 0; i < len; i++)
+    CU_ASSERT_EQUAL_FATAL (buf[i], (unsigned char) (seq & 0xff));
+}
+
+static size_t pending_wakeups (void)
+{
+  char buf[16];
+  ssize_t n = read (fds[0], buf, sizeof (buf));
+  return (n > 0) ? (size_t) n : 0;
+}
+
+CU_Test (ddsi_msgring, nslots)
+{
+  CU_ASSERT_EQUAL (ddsi_msgring_nslots (0, SLOT_SIZE), 2);
+  CU_ASSERT_EQUAL (ddsi_msgring_nslots (3 * SLOT_SIZE, SLOT_SIZE), 2);
+  CU_ASSERT_EQUAL (ddsi_msgring_nslots (4 * SLOT_SIZE, SLOT_SIZE), 4);
+  CU_ASSERT_EQUAL (ddsi_msgring_nslots (7 * SLOT_SIZE + 1, SLOT_SIZE), 4);
+}
+
+CU_Test (ddsi_msgring, wraparound, .init = msgring_init, .fini = msgring_fini)
+{
+  uint32_t head = 0, seq = 0;
+  /* one, two and three messages in the ring at a time, for many laps */
+  for (uint32_t lap = 0; lap < 10 * NSLOTS; lap++)
+  {
+    const uint32_t k = 1 + lap % 3;
+    for (uint32_t i = 0; i < k; i++)
+      CU_ASSERT_FATAL (push_msg (seq + i, 1 + (seq + i) % 100));
+    for (uint32_t i = 0; i < k; i++)
+      check_msg (&head, seq + i, 1 + (seq + i) % 100);
+    seq += k;
+    CU_ASSERT_FATAL (!ddsi_msgring_pending (&ref, head));
+  }
+  CU_ASSERT_EQUAL (head, seq);
+}
+
+CU_Test (ddsi_msgring, full, .init = msgring_init, .fini = msgring_fini)
+{
+  uint32_t head = 0;
+  for (uint32_t i = 0; i < NSLOTS; i++)
+    CU_ASSERT_FATAL (push_msg (i, 10));
+  CU_ASSERT_FATAL (!push_msg (NSLOTS, 10));
+  CU_ASSERT_FATAL (ddsi_msgring_pending (&ref, head));
+
+  /* taking one message frees exactly one slot, the rejected message is
+     gone */
+  check_msg (&head, 0, 10);
+  CU_ASSERT_FATAL (push_msg (NSLOTS + 1, 10));
+  CU_ASSERT_FATAL (!push_msg (NSLOTS + 2, 10));
+  for (uint32_t i = 1; i < NSLOTS; i++)
+    check_msg (&head, i, 10);
+  check_msg (&head, NSLOTS + 1, 10);
+  CU_ASSERT_FATAL (!ddsi_msgring_pending (&ref, head));
+}
+
+CU_Test (ddsi_msgring, length, .init = msgring_init, .fini = msgring_fini)
+{
+  const size_t maxlen = ddsi_msgring_maxlen (&ref);
+  uint32_t head = 0;
+  CU_ASSERT_EQUAL_FATAL (maxlen, SLOT_SIZE - SLOT_HEADER_SIZE);
+  CU_ASSERT_FATAL (!push_msg (0, maxlen + 1));
+  CU_ASSERT_FATAL (push_msg (1, maxlen));
+  CU_ASSERT_FATAL (push_msg (2, 0));
+  check_msg (&head, 1, maxlen);
+  check_msg (&head, 2, 0);
+
+  /* a message that doesn't fit in the buffer is truncated */
+  unsigned char buf[SLOT_SIZE];
+  uint32_t srcport;
+  CU_ASSERT_FATAL (push_msg (3, 50));
+  CU_ASSERT_EQUAL_FATAL (ddsi_msgring_read (&ref, &head, fds[0], false, buf, 20, &srcport), 20);
+  CU_ASSERT_EQUAL (srcport, 3);
+}
+
+CU_Test (ddsi_msgring, invalid_length, .init = msgring_init, .fini = msgring_fini)
+{
+  uint32_t head = 0;
+  CU_ASSERT_FATAL (push_msg (0, 10));
+  CU_ASSERT_FATAL (push_msg (1, 10));
+  CU_ASSERT_FATAL (push_msg (2, 10));
+
+  /* overwrite the lengths of the first two messages like a misbehaving
+     producer in another process could, the consumer must drop them
+     rather than copy beyond the slot */
+  unsigned char * const slots = (unsigned char *) ref.ring + sizeof (*ref.ring);
+  const uint32_t badlen[] = { SLOT_SIZE - SLOT_HEADER_SIZE + 1, UINT32_MAX };
+  for (uint32_t i = 0; i < 2; i++)
+    memcpy (slots + i * SLOT_SIZE + SLOT_LEN_OFFSET, &badlen[i], sizeof (badlen[i]));
+  check_msg (&head, 2, 10);
+  CU_ASSERT_EQUAL (head, 3);
+
+  /* the slots of the dropped messages are free again */
+  for (uint32_t i = 3; i < 3 + NSLOTS; i++)
+    CU_ASSERT_FATAL (push_msg (i, 10));
+  for (uint32_t i = 3; i < 3 + NSLOTS; i++)
+    check_msg (&head, i, 10);
+}
+
+CU_Test (ddsi_msgring, attach, .init = msgring_init, .fini = msgring_fini)
+{
+  struct ddsi_msgring_ref ref1;
+  const size_t size = ddsi_msgring_size (NSLOTS, SLOT_SIZE);
+  CU_ASSERT_FATAL (ddsi_msgring_attach (&ref1, ref.ring, size));
+  CU_ASSERT_EQUAL (ref1.nslots, NSLOTS);
+  CU_ASSERT_EQUAL (ref1.slot_size, SLOT_SIZE);
+  CU_ASSERT_FATAL (!ddsi_msgring_attach (&ref1, ref.ring, size - 1));
+
+  /* geometry in the shared header is not to be trusted */
+  ref.ring->nslots = 3;
+  CU_ASSERT_FATAL (!ddsi_msgring_attach (&ref1, ref.ring, size));
+  ref.ring->nslots = 2 * NSLOTS;
+  CU_ASSERT_FATAL (!ddsi_msgring_attach (&ref1, ref.ring, size));
+  ref.ring->nslots = NSLOTS;
+  ref.ring->slot_size = 8;
+  CU_ASSERT_FATAL (!ddsi_msgring_attach (&ref1, ref.ring, size));
+  ref.ring->slot_size = UINT32_MAX & ~3u;
+  CU_ASSERT_FATAL (!ddsi_msgring_attach (&ref1, ref.ring, size));
+
+  /* while the private copies keep the ring usable */
+  uint32_t head = 0;
+  CU_ASSERT_FATAL (push_msg (0, 10));
+  check_msg (&head, 0, 10);
+}
+
+CU_Test (ddsi_msgring, wakeup, .init = msgring_init, .fini = msgring_fini)
+{
+  unsigned char buf[SLOT_SIZE];
+  uint32_t head = 0, srcport;
+
+  /* a new ring is armed, so the first message rings the doorbell, the next
+     ones don't until the consumer finds the ring empty */
+  CU_ASSERT_FATAL (push_msg (0, 10));
+  CU_ASSERT_FATAL (push_msg (1, 10));
+  CU_ASSERT_EQUAL (pending_wakeups (), 1);
+  check_msg (&head, 0, 10);
+  CU_ASSERT_FATAL (push_msg (2, 10));
+  CU_ASSERT_EQUAL (pending_wakeups (), 0);
+  check_msg (&head, 1, 10);
+  check_msg (&head, 2, 10);
+  CU_ASSERT_EQUAL (ddsi_msgring_read (&ref, &head, fds[0], false, buf, sizeof (buf), &srcport), 0);
+  CU_ASSERT_FATAL (push_msg (3, 10));
+  CU_ASSERT_EQUAL (pending_wakeups (), 1);
+  check_msg (&head, 3, 10);
+}
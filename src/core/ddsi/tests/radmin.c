@@ -0,0 +1,626 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "dds/ddsrt/log.h"
+#include "dds/ddsrt/random.h"
+#include "dds/ddsi/q_radmin.h"
+#include "dds/ddsi/q_bitset.h"
+#include "dds/ddsi/q_protocol.h"
+#include "dds/ddsi/q_misc.h"
+#include "CUnit/Test.h"
+
+#define FRAGSIZE 100u
+#define NFRAGS 70u
+#define SAMPLE_SIZE (NFRAGS * FRAGSIZE - 37u)
+
+/* The defragmenter tracks the fragments of a sample in a bitmap allocated
+   in the receive buffer if it is small enough relative to the maximum
+   message size, and otherwise falls back to the interval tree.  The tiny
+   maximum message size of the second pool forces the latter, so feeding
+   both the same fragments allows comparing the two.  Both are also
+   checked against a simple model of the received fragments. */
+#define MAX_RMSG_SIZE_FRAGMAP 65536u
+#define MAX_RMSG_SIZE_TREE 128u
+
+enum impl { FRAGMAP, TREE };
+#define NIMPL 2
+
+static struct ddsrt_log_cfg logcfg;
+static struct nn_rbufpool *rbp[NIMPL];
+static struct nn_defrag *defrag[NIMPL];
+static bool received[NFRAGS];
+static uint32_t maxrecv;
+
+static void radmin_init (void)
+{
+  dds_log_cfg_init (&logcfg, 0, DDS_LC_ERROR, stderr, stderr);
+  rbp[FRAGMAP] = nn_rbufpool_new (&logcfg, 1048576, MAX_RMSG_SIZE_FRAGMAP);
+  rbp[TREE] = nn_rbufpool_new (&logcfg, 1048576, MAX_RMSG_SIZE_TREE);
+  for (int i = 0; i < NIMPL; i++)
+  {
+    CU_ASSERT_FATAL (rbp[i] != NULL);
+    defrag[i] = nn_defrag_new (&logcfg, NN_DEFRAG_DROP_OLDEST, 4, 0, 0);
+    CU_ASSERT_FATAL (defrag[i] != NULL);
+  }
+  memset (received, 0, sizeof (received));
+  maxrecv = 0;
+}
+
+static void radmin_fini (void)
+{
+  /* freeing the pools verifies all references to the messages are gone */
+  for (int i = 0; i < NIMPL; i++)
+  {
+    nn_defrag_free (defrag[i]);
+    nn_rbufpool_free (rbp[i]);
+  }
+}
+
+static struct nn_rsample *add_fragment (enum impl impl, seqno_t seq, uint32_t min, uint32_t maxp1)
+{
+  struct nn_rmsg *rmsg = nn_rmsg_new (rbp[impl]);
+  CU_ASSERT_FATAL (rmsg != NULL);
+  struct nn_rdata *rdata = nn_rdata_new (rmsg, min, maxp1, 0, 0, 0);
+  CU_ASSERT_FATAL (rdata != NULL);
+  struct nn_rsample_info si;
+  memset (&si, 0, sizeof (si));
+  si.seq = seq;
+  si.size = SAMPLE_SIZE;
+  si.fragsize = FRAGSIZE;
+  struct nn_rsample *sample = nn_defrag_rsample (defrag[impl], rdata, &si);
+  nn_rmsg_commit (rmsg);
+  return sample;
+}
+
+static void check_and_release_sample (struct nn_rsample *sample)
+{
+  /* fragments must be in order of their first byte and cover the sample
+     without holes, but may overlap */
+  struct nn_rdata *fragchain = nn_rsample_fragchain (sample);
+  uint32_t covered = 0;
+  for (struct nn_rdata *frag = fragchain; frag; frag = frag->nextfrag)
+  {
+    CU_ASSERT_FATAL (frag->min <= covered);
+    CU_ASSERT_FATAL (frag->min < frag->maxp1);
+    if (frag->maxp1 > covered)
+      covered = frag->maxp1;
+  }
+  CU_ASSERT_EQUAL_FATAL (covered, SAMPLE_SIZE);
+  nn_fragchain_adjust_refcount (fragchain, 0);
+}
+
+static void check_nackmap (enum impl impl, seqno_t seq, uint32_t maxfragnum, uint32_t maxsz)
+{
+  struct nn_fragment_number_set_header map;
+  uint32_t mapbits[NN_FRAGMENT_NUMBER_SET_MAX_BITS / 32];
+  const enum nn_defrag_nackmap_result res = nn_defrag_nackmap (defrag[impl], seq, maxfragnum, &map, mapbits, maxsz);
+
+  uint32_t base, end;
+  if (maxfragnum >= NFRAGS)
+    maxfragnum = NFRAGS - 1;
+  for (base = 0; base <= maxfragnum && received[base]; base++)
+    ;
+  if (base > maxfragnum)
+  {
+    CU_ASSERT_EQUAL_FATAL (res, DEFRAG_NACKMAP_ALL_ADVERTISED_FRAGMENTS_KNOWN);
+    return;
+  }
+  for (end = maxfragnum; received[end]; end--)
+    ;
+  CU_ASSERT_EQUAL_FATAL (res, DEFRAG_NACKMAP_FRAGMENTS_MISSING);
+  CU_ASSERT_EQUAL_FATAL (map.bitmap_base, base);
+  CU_ASSERT_EQUAL_FATAL (map.numbits, (end - base + 1 > maxsz) ? maxsz : end - base + 1);
+  for (uint32_t i = 0; i < map.numbits; i++)
+    CU_ASSERT_FATAL (!nn_bitset_isset (map.numbits, mapbits, i) == received[base + i]);
+}
+
+static void check_nackmaps (seqno_t seq)
+{
+  /* maxfragnum is the highest fragment known to exist, the receiver learns
+     of it from the fragments it receives or from a HEARTBEAT_FRAG */
+  const uint32_t maxfragnums[] = { maxrecv, maxrecv + (NFRAGS - maxrecv) / 2, NFRAGS - 1, UINT32_MAX };
+  const uint32_t maxszs[] = { NN_FRAGMENT_NUMBER_SET_MAX_BITS, 16 };
+  for (int i = 0; i < NIMPL; i++)
+    for (size_t j = 0; j < sizeof (maxfragnums) / sizeof (maxfragnums[0]); j++)
+      for (size_t k = 0; k < sizeof (maxszs) / sizeof (maxszs[0]); k++)
+        check_nackmap ((enum impl) i, seq, maxfragnums[j], maxszs[k]);
+}
+
+static bool add_fragments (seqno_t seq, uint32_t fmin, uint32_t fmaxp1)
+{
+  /* adds fragments [fmin,fmaxp1) to both defragmenters, checking that they
+     complete the sample at the same time as expected, and returns whether
+     it was complete */
+  const uint32_t min = fmin * FRAGSIZE, maxp1 = (fmaxp1 == NFRAGS) ? SAMPLE_SIZE : fmaxp1 * FRAGSIZE;
+  bool complete = true;
+  for (uint32_t f = fmin; f < fmaxp1; f++)
+    received[f] = true;
+  for (uint32_t f = 0; f < NFRAGS; f++)
+    complete = complete && received[f];
+  if (fmaxp1 - 1 > maxrecv)
+    maxrecv = fmaxp1 - 1;
+  for (int i = 0; i < NIMPL; i++)
+  {
+    struct nn_rsample *sample = add_fragment ((enum impl) i, seq, min, maxp1);
+    CU_ASSERT_FATAL ((sample != NULL) == complete);
+    if (sample)
+      check_and_release_sample (sample);
+  }
+  if (!complete)
+    check_nackmaps (seq);
+  return complete;
+}
+
+CU_Test (ddsi_radmin, defrag_in_order, .init = radmin_init, .fini = radmin_fini)
+{
+  for (uint32_t f = 0; f < NFRAGS; f++)
+    CU_ASSERT_FATAL (add_fragments (1, f, f + 1) == (f == NFRAGS - 1));
+}
+
+CU_Test (ddsi_radmin, defrag_out_of_order, .init = radmin_init, .fini = radmin_fini)
+{
+  /* last fragment first, then the odd ones and finally the even ones in
+     reverse order, so there are many holes and no fragment is appended to
+     the preceding one */
+  CU_ASSERT_FATAL (!add_fragments (1, NFRAGS - 1, NFRAGS));
+  for (uint32_t f = 1; f < NFRAGS - 1; f += 2)
+    CU_ASSERT_FATAL (!add_fragments (1, f, f + 1));
+  for (uint32_t f = NFRAGS - 2; f > 0; f -= 2)
+    CU_ASSERT_FATAL (!add_fragments (1, f, f + 1));
+  CU_ASSERT_FATAL (add_fragments (1, 0, 1));
+}
+
+CU_Test (ddsi_radmin, defrag_duplicate, .init = radmin_init, .fini = radmin_fini)
+{
+  uint64_t discarded[NIMPL];
+  for (uint32_t f = 0; f < NFRAGS - 1; f++)
+  {
+    CU_ASSERT_FATAL (!add_fragments (1, f, f + 1));
+    CU_ASSERT_FATAL (!add_fragments (1, f, f + 1));
+  }
+  for (int i = 0; i < NIMPL; i++)
+  {
+    nn_defrag_stats (defrag[i], &discarded[i]);
+    CU_ASSERT_EQUAL (discarded[i], (NFRAGS - 1) * FRAGSIZE);
+  }
+  CU_ASSERT_FATAL (add_fragments (1, NFRAGS - 1, NFRAGS));
+}
+
+CU_Test (ddsi_radmin, defrag_overlapping, .init = radmin_init, .fini = radmin_fini)
+{
+  /* as if the sender changed the number of fragments per DATAFRAG when
+     retransmitting, ranges partially and completely covering others */
+  static const struct { uint32_t fmin, fmaxp1; } ranges[] = {
+    { 2, 5 }, { 4, 8 }, { 3, 6 }, { 20, 40 }, { 10, 25 }, { 38, 41 }, { 5, 9 },
+    { 60, 70 }, { 0, 3 }, { 30, 35 }, { 41, 60 }, { 8, 12 }
+  };
+  for (size_t i = 0; i < sizeof (ranges) / sizeof (ranges[0]); i++)
+    CU_ASSERT_FATAL (add_fragments (1, ranges[i].fmin, ranges[i].fmaxp1) == (i == sizeof (ranges) / sizeof (ranges[0]) - 1));
+}
+
+CU_Test (ddsi_radmin, defrag_random, .init = radmin_init, .fini = radmin_fini)
+{
+  /* random ranges of up to 4 fragments, including duplicates, each
+     sample with a different sequence number so the defragmenter is
+     reused */
+  for (uint32_t seed = 1; seed <= 50; seed++)
+  {
+    const seqno_t seq = (seqno_t) seed;
+    ddsrt_prng_t prng;
+    ddsrt_prng_init_simple (&prng, seed);
+    memset (received, 0, sizeof (received));
+    maxrecv = 0;
+    uint32_t fmin;
+    do {
+      fmin = ddsrt_prng_random (&prng) % NFRAGS;
+    } while (!add_fragments (seq, fmin, fmin + 1 + ddsrt_prng_random (&prng) % ((NFRAGS - fmin < 4) ? NFRAGS - fmin : 4)));
+  }
+}
+
+CU_Test (ddsi_radmin, defrag_unknown_sample, .init = radmin_init, .fini = radmin_fini)
+{
+  struct nn_fragment_number_set_header map;
+  uint32_t mapbits[NN_FRAGMENT_NUMBER_SET_MAX_BITS / 32];
+  CU_ASSERT_FATAL (!add_fragments (1, 1, 2));
+  for (int i = 0; i < NIMPL; i++)
+  {
+    CU_ASSERT_EQUAL (nn_defrag_nackmap (defrag[i], 2, UINT32_MAX, &map, mapbits, NN_FRAGMENT_NUMBER_SET_MAX_BITS), DEFRAG_NACKMAP_UNKNOWN_SAMPLE);
+    /* a gap covering a partially received sample forgets it */
+    nn_defrag_notegap (defrag[i], 1, 2);
+    CU_ASSERT_EQUAL (nn_defrag_nackmap (defrag[i], 1, UINT32_MAX, &map, mapbits, NN_FRAGMENT_NUMBER_SET_MAX_BITS), DEFRAG_NACKMAP_UNKNOWN_SAMPLE);
+  }
+}
+
+static void contig_init (void)
+{
+  dds_log_cfg_init (&logcfg, 0, DDS_LC_ERROR, stderr, stderr);
+  rbp[FRAGMAP] = nn_rbufpool_new (&logcfg, 1048576, MAX_RMSG_SIZE_FRAGMAP);
+  CU_ASSERT_FATAL (rbp[FRAGMAP] != NULL);
+  defrag[FRAGMAP] = nn_defrag_new (&logcfg, NN_DEFRAG_DROP_OLDEST, 4, 1, SAMPLE_SIZE);
+  CU_ASSERT_FATAL (defrag[FRAGMAP] != NULL);
+}
+
+CU_Test (ddsi_radmin, contig_outlives_pool, .init = contig_init)
+{
+  /* A sample reassembled in a contiguous buffer may be kept by whoever
+     claimed it (e.g., a serdata constructed in place) after the receive
+     thread's pool and the domain are gone, releasing it must not touch
+     the pool */
+  struct nn_rsample *sample = NULL;
+  for (uint32_t f = 0; f < NFRAGS; f++)
+  {
+    sample = add_fragment (FRAGMAP, 1, f * FRAGSIZE, (f + 1 == NFRAGS) ? SAMPLE_SIZE : (f + 1) * FRAGSIZE);
+    CU_ASSERT_FATAL ((sample != NULL) == (f + 1 == NFRAGS));
+  }
+  struct nn_rdata *fragchain = nn_rsample_fragchain (sample);
+  const struct nn_rdata *contig = nn_fragchain_claim_contig (fragchain);
+  CU_ASSERT_FATAL (contig != NULL);
+  CU_ASSERT_EQUAL_FATAL (contig->maxp1, SAMPLE_SIZE);
+  nn_fragchain_adjust_refcount (fragchain, 0);
+  nn_defrag_free (defrag[FRAGMAP]);
+  nn_rbufpool_free (rbp[FRAGMAP]);
+  nn_rdata_contig_release (contig);
+}
+
+/* The reorder admin stores out-of-order samples close to next_seq in a
+   window and the others in an interval tree, these tests check it against
+   a model of the samples and gaps it should contain, so that samples end
+   up in the window, the tree and moving from one to the other without it
+   making a difference.  Samples are unfragmented, and so go through the
+   defragmenter unchanged. */
+#define REORDER_MAXSEQ 3000
+#define REORDER_WINDOW 256
+
+enum seqstate { SS_NONE, SS_SAMPLE, SS_GAP };
+
+static struct nn_reorder *reorder;
+static enum seqstate seqstate[REORDER_MAXSEQ];
+static seqno_t next_seq;
+
+static void reorder_init_common (uint32_t max_samples)
+{
+  dds_log_cfg_init (&logcfg, 0, DDS_LC_ERROR, stderr, stderr);
+  rbp[0] = nn_rbufpool_new (&logcfg, 1048576, MAX_RMSG_SIZE_FRAGMAP);
+  CU_ASSERT_FATAL (rbp[0] != NULL);
+  defrag[0] = nn_defrag_new (&logcfg, NN_DEFRAG_DROP_OLDEST, 4, 0, 0);
+  CU_ASSERT_FATAL (defrag[0] != NULL);
+  reorder = nn_reorder_new (&logcfg, NN_REORDER_MODE_NORMAL, max_samples, false);
+  CU_ASSERT_FATAL (reorder != NULL);
+  memset (seqstate, 0, sizeof (seqstate));
+  next_seq = 1;
+}
+
+static void reorder_init (void)
+{
+  reorder_init_common (REORDER_MAXSEQ);
+}
+
+static void reorder_init_small (void)
+{
+  reorder_init_common (4);
+}
+
+static void reorder_fini (void)
+{
+  nn_reorder_free (reorder);
+  nn_defrag_free (defrag[0]);
+  nn_rbufpool_free (rbp[0]);
+}
+
+static void deliver (nn_reorder_result_t res, struct nn_rsample_chain *sc, seqno_t old_next_seq)
+{
+  /* checks the delivered samples are the ones the model says were
+     stored in [old_next_seq,next_seq) and are in order */
+  seqno_t expected = old_next_seq;
+  int32_t n = 0;
+  CU_ASSERT_EQUAL_FATAL (nn_reorder_next_seq (reorder), next_seq);
+  for (struct nn_rsample_chain_elem *e = sc->first, *e1; e; e = e1)
+  {
+    e1 = e->next;
+    if (e->sampleinfo)
+    {
+      while (expected < next_seq && seqstate[expected] != SS_SAMPLE)
+        expected++;
+      CU_ASSERT_EQUAL_FATAL (e->sampleinfo->seq, expected);
+      expected++;
+    }
+    nn_fragchain_unref (e->fragchain);
+    n++;
+  }
+  CU_ASSERT_EQUAL_FATAL (res, n);
+  while (expected < next_seq && seqstate[expected] != SS_SAMPLE)
+    expected++;
+  CU_ASSERT_EQUAL_FATAL (expected, next_seq);
+}
+
+static void model_advance (void)
+{
+  while (next_seq < REORDER_MAXSEQ && seqstate[next_seq] != SS_NONE)
+    next_seq++;
+}
+
+static nn_reorder_result_t reorder_sample (seqno_t seq, struct nn_rsample_chain *sc)
+{
+  struct nn_rmsg *rmsg = nn_rmsg_new (rbp[0]);
+  CU_ASSERT_FATAL (rmsg != NULL);
+  struct nn_rdata *rdata = nn_rdata_new (rmsg, 0, 4, 0, 0, 0);
+  CU_ASSERT_FATAL (rdata != NULL);
+  struct nn_rsample_info si;
+  memset (&si, 0, sizeof (si));
+  si.seq = seq;
+  si.size = 4;
+  struct nn_rsample *rsample = nn_defrag_rsample (defrag[0], rdata, &si);
+  CU_ASSERT_FATAL (rsample != NULL);
+  struct nn_rdata *fragchain = nn_rsample_fragchain (rsample);
+  int refc_adjust = 0;
+  const nn_reorder_result_t res = nn_reorder_rsample (sc, reorder, rsample, &refc_adjust, 0);
+  nn_fragchain_adjust_refcount (fragchain, refc_adjust);
+  nn_rmsg_commit (rmsg);
+  return res;
+}
+
+static nn_reorder_result_t add_sample (seqno_t seq)
+{
+  struct nn_rsample_chain sc;
+  const nn_reorder_result_t res = reorder_sample (seq, &sc);
+  const seqno_t old_next_seq = next_seq;
+  if (seq < next_seq)
+  {
+    CU_ASSERT_EQUAL_FATAL (res, NN_REORDER_TOO_OLD);
+  }
+  else if (seqstate[seq] != SS_NONE)
+  {
+    CU_ASSERT_EQUAL_FATAL (res, NN_REORDER_REJECT);
+  }
+  else
+  {
+    seqstate[seq] = SS_SAMPLE;
+    model_advance ();
+    if (seq == old_next_seq)
+      deliver (res, &sc, old_next_seq);
+    else
+    {
+      CU_ASSERT_EQUAL_FATAL (res, NN_REORDER_ACCEPT);
+    }
+  }
+  return res;
+}
+
+static nn_reorder_result_t reorder_gap (seqno_t min, seqno_t maxp1, struct nn_rsample_chain *sc)
+{
+  struct nn_rmsg *rmsg = nn_rmsg_new (rbp[0]);
+  CU_ASSERT_FATAL (rmsg != NULL);
+  struct nn_rdata *gap = nn_rdata_newgap (rmsg);
+  CU_ASSERT_FATAL (gap != NULL);
+  int refc_adjust = 0;
+  const nn_reorder_result_t res = nn_reorder_gap (sc, reorder, gap, min, maxp1, &refc_adjust);
+  nn_fragchain_adjust_refcount (gap, refc_adjust);
+  nn_rmsg_commit (rmsg);
+  return res;
+}
+
+static nn_reorder_result_t add_gap (seqno_t min, seqno_t maxp1)
+{
+  struct nn_rsample_chain sc;
+  const nn_reorder_result_t res = reorder_gap (min, maxp1, &sc);
+
+  const seqno_t old_next_seq = next_seq;
+  bool valuable = false;
+  for (seqno_t seq = (min > next_seq) ? min : next_seq; seq < maxp1; seq++)
+  {
+    if (seqstate[seq] == SS_NONE)
+    {
+      seqstate[seq] = SS_GAP;
+      valuable = true;
+    }
+  }
+  if (maxp1 <= next_seq)
+  {
+    CU_ASSERT_EQUAL_FATAL (res, NN_REORDER_TOO_OLD);
+  }
+  else if (min <= next_seq)
+  {
+    model_advance ();
+    if (res > 0)
+      deliver (res, &sc, old_next_seq);
+    else
+    {
+      /* nothing was stored following the gap */
+      CU_ASSERT_EQUAL_FATAL (res, NN_REORDER_ACCEPT);
+      CU_ASSERT_EQUAL_FATAL (nn_reorder_next_seq (reorder), next_seq);
+      CU_ASSERT_EQUAL_FATAL (next_seq, maxp1);
+    }
+  }
+  else
+  {
+    CU_ASSERT_EQUAL_FATAL (res, valuable ? NN_REORDER_ACCEPT : NN_REORDER_REJECT);
+  }
+  return res;
+}
+
+static void check_reorder_nackmap (seqno_t maxseq, uint32_t maxsz, int notail)
+{
+  struct nn_sequence_number_set_header map;
+  uint32_t mapbits[NN_SEQUENCE_NUMBER_SET_MAX_BITS / 32];
+  const uint32_t numbits = nn_reorder_nackmap (reorder, next_seq, maxseq, &map, mapbits, maxsz, notail);
+  CU_ASSERT_EQUAL_FATAL (fromSN (map.bitmap_base), next_seq);
+  CU_ASSERT_EQUAL_FATAL (numbits, map.numbits);
+
+  seqno_t end = maxseq + 1;
+  if (end - next_seq > (seqno_t) maxsz)
+    end = next_seq + maxsz;
+  if (notail)
+  {
+    seqno_t last = next_seq - 1;
+    for (seqno_t seq = next_seq; seq < REORDER_MAXSEQ; seq++)
+      if (seqstate[seq] != SS_NONE)
+        last = seq;
+    if (end > last + 1)
+      end = last + 1;
+  }
+  CU_ASSERT_EQUAL_FATAL (map.numbits, (uint32_t) (end - next_seq));
+  for (uint32_t i = 0; i < map.numbits; i++)
+    CU_ASSERT_FATAL (!nn_bitset_isset (map.numbits, mapbits, i) == (seqstate[next_seq + i] != SS_NONE));
+}
+
+static void check_reorder_nackmaps (void)
+{
+  const seqno_t maxseqs[] = { next_seq - 1, next_seq + 10, next_seq + 100, next_seq + 300 };
+  for (size_t i = 0; i < sizeof (maxseqs) / sizeof (maxseqs[0]); i++)
+  {
+    check_reorder_nackmap (maxseqs[i], NN_SEQUENCE_NUMBER_SET_MAX_BITS, 0);
+    check_reorder_nackmap (maxseqs[i], NN_SEQUENCE_NUMBER_SET_MAX_BITS, 1);
+    check_reorder_nackmap (maxseqs[i], 40, 1);
+  }
+}
+
+CU_Test (ddsi_radmin, reorder_in_order, .init = reorder_init, .fini = reorder_fini)
+{
+  for (seqno_t seq = 1; seq <= 1000; seq++)
+  {
+    CU_ASSERT_FATAL (add_sample (seq) == 1);
+    check_reorder_nackmaps ();
+  }
+}
+
+CU_Test (ddsi_radmin, reorder_in_window, .init = reorder_init, .fini = reorder_fini)
+{
+  /* a few lost samples, retransmitted in reverse order, with the window
+     wrapping around several times */
+  for (seqno_t base = 1; base < 2000; base += 100)
+  {
+    for (seqno_t seq = base + 5; seq < base + 100; seq++)
+      CU_ASSERT_FATAL (add_sample (seq) == NN_REORDER_ACCEPT);
+    check_reorder_nackmaps ();
+    for (seqno_t seq = base + 4; seq > base; seq--)
+    {
+      CU_ASSERT_FATAL (add_sample (seq) == NN_REORDER_ACCEPT);
+      CU_ASSERT_FATAL (add_sample (seq) == NN_REORDER_REJECT);
+      check_reorder_nackmaps ();
+    }
+    CU_ASSERT_FATAL (add_sample (base + 50) == NN_REORDER_REJECT);
+    CU_ASSERT_FATAL (add_sample (base) == 100);
+    CU_ASSERT_FATAL (add_sample (base) == NN_REORDER_TOO_OLD);
+  }
+}
+
+CU_Test (ddsi_radmin, reorder_out_of_window, .init = reorder_init, .fini = reorder_fini)
+{
+  /* samples beyond the window go into the tree, those in the window must
+     precede all of them, and the window's limit moves with next_seq */
+  CU_ASSERT_FATAL (add_sample (REORDER_WINDOW + 10) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (add_sample (REORDER_WINDOW) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (add_sample (REORDER_WINDOW - 1) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (add_sample (REORDER_WINDOW + 1) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (add_sample (5) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (add_sample (REORDER_WINDOW + 5) == NN_REORDER_ACCEPT);
+  check_reorder_nackmaps ();
+  for (seqno_t seq = 2; seq < 5; seq++)
+    CU_ASSERT_FATAL (add_sample (seq) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (add_sample (1) == 5);
+  check_reorder_nackmaps ();
+  for (seqno_t seq = 6; seq < REORDER_WINDOW - 1; seq++)
+  {
+    CU_ASSERT_FATAL (add_sample (seq) > 0);
+    check_reorder_nackmaps ();
+  }
+  CU_ASSERT_EQUAL_FATAL (nn_reorder_next_seq (reorder), REORDER_WINDOW + 2);
+  for (seqno_t seq = REORDER_WINDOW + 11; seq < 2 * REORDER_WINDOW + 20; seq++)
+    CU_ASSERT_FATAL (add_sample (seq) == NN_REORDER_ACCEPT);
+  check_reorder_nackmaps ();
+  for (seqno_t seq = REORDER_WINDOW + 2; seq < REORDER_WINDOW + 10; seq++)
+    (void) add_sample (seq);
+  CU_ASSERT_EQUAL_FATAL (nn_reorder_next_seq (reorder), 2 * REORDER_WINDOW + 20);
+}
+
+CU_Test (ddsi_radmin, reorder_gap, .init = reorder_init, .fini = reorder_fini)
+{
+  /* a gap flushes the window into the tree, it then must continue to work
+     with everything in the tree */
+  for (seqno_t seq = 3; seq < 20; seq += 2)
+    CU_ASSERT_FATAL (add_sample (seq) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (add_gap (10, 13) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (add_gap (11, 12) == NN_REORDER_REJECT);
+  CU_ASSERT_FATAL (add_gap (30, 35) == NN_REORDER_ACCEPT);
+  check_reorder_nackmaps ();
+  CU_ASSERT_FATAL (add_sample (14) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (add_sample (8) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (add_sample (2) == NN_REORDER_ACCEPT);
+  check_reorder_nackmaps ();
+  CU_ASSERT_FATAL (add_gap (1, 2) > 0);
+  check_reorder_nackmaps ();
+  CU_ASSERT_FATAL (add_gap (1, 7) > 0);
+  check_reorder_nackmaps ();
+  CU_ASSERT_FATAL (add_gap (20, 30) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (add_gap (5, 8) == NN_REORDER_TOO_OLD);
+  CU_ASSERT_FATAL (add_gap (5, 40) > 0);
+  CU_ASSERT_EQUAL_FATAL (nn_reorder_next_seq (reorder), 40);
+  CU_ASSERT_FATAL (add_gap (41, 42) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (add_gap (40, 41) > 0);
+  CU_ASSERT_FATAL (add_gap (42, 50) == NN_REORDER_ACCEPT);
+  CU_ASSERT_EQUAL_FATAL (nn_reorder_next_seq (reorder), 50);
+}
+
+CU_Test (ddsi_radmin, reorder_max_samples, .init = reorder_init_small, .fini = reorder_fini)
+{
+  /* when full, samples at the end are rejected and others push out the
+     last one, whether that is in the window or in the tree; the model
+     doesn't know about that, so only the raw results are checked */
+  struct nn_rsample_chain sc;
+  for (seqno_t seq = 3; seq < 7; seq++)
+    CU_ASSERT_FATAL (reorder_sample (seq, &sc) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (reorder_sample (7, &sc) == NN_REORDER_REJECT);
+  CU_ASSERT_FATAL (reorder_sample (REORDER_WINDOW + 10, &sc) == NN_REORDER_REJECT);
+  CU_ASSERT_FATAL (reorder_sample (2, &sc) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (nn_reorder_wantsample (reorder, 6));
+  for (seqno_t seq = 1; seq < 6; seq++)
+    seqstate[seq] = SS_SAMPLE;
+  next_seq = 6;
+  deliver (reorder_sample (1, &sc), &sc, 1);
+
+  for (seqno_t seq = REORDER_WINDOW + 10; seq < REORDER_WINDOW + 14; seq++)
+    CU_ASSERT_FATAL (reorder_sample (seq, &sc) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (reorder_sample (REORDER_WINDOW + 14, &sc) == NN_REORDER_REJECT);
+  CU_ASSERT_FATAL (reorder_sample (REORDER_WINDOW + 8, &sc) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (nn_reorder_wantsample (reorder, REORDER_WINDOW + 13));
+  CU_ASSERT_FATAL (reorder_sample (10, &sc) == NN_REORDER_ACCEPT);
+  CU_ASSERT_FATAL (nn_reorder_wantsample (reorder, REORDER_WINDOW + 12));
+  CU_ASSERT_FATAL (!nn_reorder_wantsample (reorder, REORDER_WINDOW + 11));
+  CU_ASSERT_FATAL (!nn_reorder_wantsample (reorder, 10));
+  seqstate[10] = SS_SAMPLE;
+  next_seq = 11;
+  deliver (reorder_gap (6, 10, &sc), &sc, 6);
+}
+
+CU_Test (ddsi_radmin, reorder_random, .init = reorder_init, .fini = reorder_fini)
+{
+  ddsrt_prng_t prng;
+  ddsrt_prng_init_simple (&prng, 1);
+  while (next_seq < REORDER_MAXSEQ - 2 * REORDER_WINDOW)
+  {
+    const uint32_t r = ddsrt_prng_random (&prng) % 100;
+    if (r < 5)
+    {
+      const seqno_t min = next_seq - 3 + (seqno_t) (ddsrt_prng_random (&prng) % 300);
+      (void) add_gap ((min < 1) ? 1 : min, min + 1 + (seqno_t) (ddsrt_prng_random (&prng) % 5));
+    }
+    else if (r < 20)
+      (void) add_sample (next_seq);
+    else if (r < 90)
+      (void) add_sample (next_seq + (seqno_t) (ddsrt_prng_random (&prng) % 40));
+    else
+      (void) add_sample (next_seq - 3 + (seqno_t) (ddsrt_prng_random (&prng) % (REORDER_WINDOW + 100)));
+    check_reorder_nackmaps ();
+  }
+}
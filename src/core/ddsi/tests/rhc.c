@@ -0,0 +1,87 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <string.h>
+
+#include "dds/ddsi/ddsi_rhc.h"
+#include "CUnit/Test.h"
+
+/* An RHC that only implements the operations that existed before store_many
+   was added, and that rejects the sample at index "reject" */
+struct test_rhc {
+  struct ddsi_rhc common;
+  uint32_t nstore;
+  uint32_t nstore_many;
+  uint32_t reject;
+};
+
+static bool test_rhc_store (struct ddsi_rhc * __restrict rhc_common, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk)
+{
+  struct test_rhc * const rhc = (struct test_rhc *) rhc_common;
+  (void) wrinfo; (void) sample; (void) tk;
+  return rhc->nstore++ != rhc->reject;
+}
+
+static uint32_t test_rhc_store_many (struct ddsi_rhc * __restrict rhc_common, uint32_t n, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * const * __restrict samples, struct ddsi_tkmap_instance * const * __restrict tks)
+{
+  struct test_rhc * const rhc = (struct test_rhc *) rhc_common;
+  (void) wrinfo; (void) samples; (void) tks;
+  rhc->nstore_many++;
+  return n;
+}
+
+static void test_rhc_unregister_wr (struct ddsi_rhc * __restrict rhc, const struct ddsi_writer_info * __restrict wrinfo) { (void) rhc; (void) wrinfo; }
+static void test_rhc_relinquish_ownership (struct ddsi_rhc * __restrict rhc, const uint64_t wr_iid) { (void) rhc; (void) wr_iid; }
+static void test_rhc_set_qos (struct ddsi_rhc *rhc, const struct dds_qos *qos) { (void) rhc; (void) qos; }
+static void test_rhc_free (struct ddsi_rhc *rhc) { (void) rhc; }
+
+/* positional, as an implementation written against the old definition
+   could have done it */
+static const struct ddsi_rhc_ops test_rhc_ops_without_store_many = {
+  test_rhc_store, test_rhc_unregister_wr, test_rhc_relinquish_ownership, test_rhc_set_qos, test_rhc_free
+};
+
+static const struct ddsi_rhc_ops test_rhc_ops_with_store_many = {
+  test_rhc_store, test_rhc_unregister_wr, test_rhc_relinquish_ownership, test_rhc_set_qos, test_rhc_free, test_rhc_store_many
+};
+
+CU_Test (ddsi_rhc, store_many_fallback)
+{
+  struct ddsi_writer_info wrinfo[5];
+  struct ddsi_serdata *samples[5] = { NULL };
+  struct ddsi_tkmap_instance *tks[5] = { NULL };
+  memset (wrinfo, 0, sizeof (wrinfo));
+
+  struct test_rhc rhc = { .common = { .ops = &test_rhc_ops_without_store_many }, .reject = UINT32_MAX };
+  CU_ASSERT_PTR_NULL_FATAL (rhc.common.ops->store_many);
+  CU_ASSERT_EQUAL (ddsi_rhc_store_many (&rhc.common, 5, wrinfo, samples, tks), 5);
+  CU_ASSERT_EQUAL (rhc.nstore, 5);
+
+  /* stops at the first rejected sample, like store_many is defined to do */
+  rhc.nstore = 0;
+  rhc.reject = 2;
+  CU_ASSERT_EQUAL (ddsi_rhc_store_many (&rhc.common, 5, wrinfo, samples, tks), 2);
+  CU_ASSERT_EQUAL (rhc.nstore, 3);
+  CU_ASSERT_EQUAL (rhc.nstore_many, 0);
+}
+
+CU_Test (ddsi_rhc, store_many)
+{
+  struct ddsi_writer_info wrinfo[5];
+  struct ddsi_serdata *samples[5] = { NULL };
+  struct ddsi_tkmap_instance *tks[5] = { NULL };
+  memset (wrinfo, 0, sizeof (wrinfo));
+
+  struct test_rhc rhc = { .common = { .ops = &test_rhc_ops_with_store_many }, .reject = UINT32_MAX };
+  CU_ASSERT_EQUAL (ddsi_rhc_store_many (&rhc.common, 5, wrinfo, samples, tks), 5);
+  CU_ASSERT_EQUAL (rhc.nstore, 0);
+  CU_ASSERT_EQUAL (rhc.nstore_many, 1);
+}
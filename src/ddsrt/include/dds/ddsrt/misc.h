@@ -92,6 +92,15 @@ extern "C" {
   DDSRT_WARNING_GNUC_ON(deprecated-declarations) \
   DDSRT_WARNING_MSVC_ON(4996)
 
+/**
+ * @brief Macro hinting that the memory at addr will be read soon
+ */
+#if defined(__GNUC__) || defined(__clang__)
+# define DDSRT_PREFETCH(addr) __builtin_prefetch (addr)
+#else
+# define DDSRT_PREFETCH(addr) ((void) (addr))
+#endif
+
 #if defined (__cplusplus)
 }
 #endif
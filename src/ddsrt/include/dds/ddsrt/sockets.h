@@ -109,6 +109,62 @@ ddsrt_recvmsg(
   int flags,
   ssize_t *rcvd);
 
+#if DDSRT_HAVE_MMSG
+/**
+ * @brief Message header for batched sends and receives, layout compatible
+ *        with the platform's struct mmsghdr.
+ */
+typedef struct ddsrt_mmsghdr {
+  ddsrt_msghdr_t msg_hdr;
+  unsigned int msg_len;
+} ddsrt_mmsghdr_t;
+
+/**
+ * @brief Receive up to vlen messages on a socket in a single call.
+ *
+ * Blocks (on a blocking socket) until at least one message is available and
+ * then returns all messages that are available immediately, up to vlen.
+ *
+ * @param[in]     sock    Socket to receive from.
+ * @param[in,out] msgvec  Message headers, msg_len is set for each message
+ *                        received.
+ * @param[in]     vlen    Number of entries in msgvec.
+ * @param[in]     flags   Flags passed to the operating system.
+ * @param[out]    rcvd    Number of messages received.
+ *
+ * @returns A dds_return_t indicating success or failure.
+ */
+DDS_EXPORT dds_return_t
+ddsrt_recvmmsg(
+  ddsrt_socket_t sock,
+  ddsrt_mmsghdr_t *msgvec,
+  unsigned int vlen,
+  int flags,
+  int *rcvd);
+
+/**
+ * @brief Send up to vlen messages on a socket in a single call.
+ *
+ * @param[in]     sock    Socket to send on.
+ * @param[in,out] msgvec  Message headers, msg_len is set for each message
+ *                        sent.
+ * @param[in]     vlen    Number of entries in msgvec.
+ * @param[in]     flags   Flags passed to the operating system.
+ * @param[out]    sent    Number of messages sent, which may be less than
+ *                        vlen.
+ *
+ * @returns A dds_return_t indicating success or failure, failure is only
+ *          reported if the first message could not be sent.
+ */
+DDS_EXPORT dds_return_t
+ddsrt_sendmmsg(
+  ddsrt_socket_t sock,
+  ddsrt_mmsghdr_t *msgvec,
+  unsigned int vlen,
+  int flags,
+  int *sent);
+#endif /* DDSRT_HAVE_MMSG */
+
 DDS_EXPORT dds_return_t
 ddsrt_getsockopt(
   ddsrt_socket_t sock,
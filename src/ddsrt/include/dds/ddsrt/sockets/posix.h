@@ -76,6 +76,61 @@ typedef struct msghdr ddsrt_msghdr_t;
 # define DDSRT_MSGHDR_FLAGS 1
 #endif
 
+#if defined(__linux) && !LWIP_SOCKET
+# define DDSRT_HAVE_MMSG 1
+#else
+# define DDSRT_HAVE_MMSG 0
+#endif
+
+/* UDP generic segmentation/receive offload (Linux 4.18/5.0 and later, the
+   kernel may still lack support, which shows up as an error setting the
+   option) */
+#if defined(__linux) && !LWIP_SOCKET
+# define DDSRT_HAVE_UDP_GSO 1
+# include <netinet/udp.h>
+# ifndef SOL_UDP
+#  define SOL_UDP 17
+# endif
+# ifndef UDP_SEGMENT
+#  define UDP_SEGMENT 103
+# endif
+# ifndef UDP_GRO
+#  define UDP_GRO 104
+# endif
+#else
+# define DDSRT_HAVE_UDP_GSO 0
+#endif
+
+/* Load-balancing of a port over multiple sockets with SO_REUSEPORT, with a
+   classic BPF program for selecting the socket (Linux 4.5 and later) */
+#if defined(__linux) && !LWIP_SOCKET
+# define DDSRT_HAVE_REUSEPORT 1
+# ifndef SO_ATTACH_REUSEPORT_CBPF
+#  define SO_ATTACH_REUSEPORT_CBPF 51
+# endif
+#else
+# define DDSRT_HAVE_REUSEPORT 0
+#endif
+
+/* Zero-copy transmit with MSG_ZEROCOPY and completion notifications on the
+   error queue (Linux 4.14 and later for TCP, 5.0 for UDP, the kernel may
+   still lack support, which shows up as an error setting SO_ZEROCOPY) */
+#if defined(__linux) && !LWIP_SOCKET
+# define DDSRT_HAVE_ZEROCOPY 1
+# include <linux/errqueue.h>
+# ifndef SO_ZEROCOPY
+#  define SO_ZEROCOPY 60
+# endif
+# ifndef MSG_ZEROCOPY
+#  define MSG_ZEROCOPY 0x4000000
+# endif
+# ifndef SO_EE_ORIGIN_ZEROCOPY
+#  define SO_EE_ORIGIN_ZEROCOPY 5
+# endif
+#else
+# define DDSRT_HAVE_ZEROCOPY 0
+#endif
+
 #if defined(__cplusplus)
 }
 #endif
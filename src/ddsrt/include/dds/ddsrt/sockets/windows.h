@@ -49,6 +49,10 @@ typedef struct ddsrt_msghdr {
 } ddsrt_msghdr_t;
 
 #define DDSRT_MSGHDR_FLAGS 1
+#define DDSRT_HAVE_MMSG 0
+#define DDSRT_HAVE_UDP_GSO 0
+#define DDSRT_HAVE_REUSEPORT 0
+#define DDSRT_HAVE_ZEROCOPY 0
 
 #if defined(__cplusplus)
 }
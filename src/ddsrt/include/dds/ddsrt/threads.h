@@ -70,6 +70,11 @@ typedef struct {
   int32_t schedPriority;
   /** Specifies the thread stack size */
   uint32_t stackSize;
+  /** Number of CPUs in cpus, 0 for no restriction */
+  uint32_t ncpus;
+  /** CPUs the thread may run on (not supported on all platforms, the array
+      must remain valid until the thread has been created) */
+  const uint32_t *cpus;
 } ddsrt_threadattr_t;
 
 /**
@@ -15,6 +15,7 @@
 #include "dds/ddsrt/attributes.h"
 #include "dds/ddsrt/atomics.h"
 #include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/misc.h"
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/hopscotch.h"
 
@@ -404,6 +405,16 @@ void *ddsrt_chh_lookup (struct ddsrt_chh * __restrict rt, const void * __restric
     return ddsrt_chh_lookup_internal (bsary, rt->equals, bucket, template);
 }
 
+void ddsrt_chh_prefetch (struct ddsrt_chh * __restrict rt, const void * __restrict template)
+{
+    /* Only hints at the bucket a lookup of template will start with, the
+       data itself can't be prefetched without doing the lookup */
+    struct ddsrt_chh_bucket_array const * const bsary = ddsrt_atomic_ldvoidp (&rt->buckets);
+    const uint32_t hash = rt->hash (template);
+    const uint32_t idxmask = bsary->size - 1;
+    DDSRT_PREFETCH (&bsary->bs[hash & idxmask]);
+}
+
 static uint32_t ddsrt_chh_find_closer_free_bucket (struct ddsrt_chh *rt, uint32_t free_bucket, uint32_t *free_distance)
 {
     struct ddsrt_chh_bucket_array * const bsary = ddsrt_atomic_ldvoidp (&rt->buckets);
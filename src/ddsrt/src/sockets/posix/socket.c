@@ -9,12 +9,17 @@
  *
  * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
  */
+#if defined(__linux)
+#define _GNU_SOURCE /* Required for recvmmsg, sendmmsg and struct mmsghdr. */
+#endif
 #include <assert.h>
+#include <stddef.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "dds/ddsrt/log.h"
 #include "dds/ddsrt/misc.h"
+#include "dds/ddsrt/static_assert.h"
 #include "dds/ddsrt/sockets_priv.h"
 
 #if !LWIP_SOCKET
@@ -461,6 +466,30 @@ ddsrt_recvmsg(
   return recv_error_to_retcode(errno);
 }
 
+#if DDSRT_HAVE_MMSG
+DDSRT_STATIC_ASSERT(sizeof(ddsrt_mmsghdr_t) == sizeof(struct mmsghdr));
+DDSRT_STATIC_ASSERT(offsetof(ddsrt_mmsghdr_t, msg_len) == offsetof(struct mmsghdr, msg_len));
+
+dds_return_t
+ddsrt_recvmmsg(
+  ddsrt_socket_t sock,
+  ddsrt_mmsghdr_t *msgvec,
+  unsigned int vlen,
+  int flags,
+  int *rcvd)
+{
+  int n;
+
+  if ((n = recvmmsg(sock, (struct mmsghdr *)msgvec, vlen, flags | MSG_WAITFORONE, NULL)) != -1) {
+    assert(n >= 0);
+    *rcvd = n;
+    return DDS_RETCODE_OK;
+  }
+
+  return recv_error_to_retcode(errno);
+}
+#endif /* DDSRT_HAVE_MMSG */
+
 static inline dds_return_t
 send_error_to_retcode(int errnum)
 {
@@ -541,6 +570,27 @@ ddsrt_sendmsg(
   return send_error_to_retcode(errno);
 }
 
+#if DDSRT_HAVE_MMSG
+dds_return_t
+ddsrt_sendmmsg(
+  ddsrt_socket_t sock,
+  ddsrt_mmsghdr_t *msgvec,
+  unsigned int vlen,
+  int flags,
+  int *sent)
+{
+  int n;
+
+  if ((n = sendmmsg(sock, (struct mmsghdr *)msgvec, vlen, flags)) != -1) {
+    assert(n >= 0);
+    *sent = n;
+    return DDS_RETCODE_OK;
+  }
+
+  return send_error_to_retcode(errno);
+}
+#endif /* DDSRT_HAVE_MMSG */
+
 dds_return_t
 ddsrt_select(
   int32_t nfds,
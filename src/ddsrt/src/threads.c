@@ -21,4 +21,6 @@ ddsrt_threadattr_init (
   tattr->schedClass = DDSRT_SCHED_DEFAULT;
   tattr->schedPriority = 0;
   tattr->stackSize = 0;
+  tattr->ncpus = 0;
+  tattr->cpus = NULL;
 }
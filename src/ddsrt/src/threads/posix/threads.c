@@ -296,6 +296,24 @@ ddsrt_thread_create (
     }
   }
 
+  if (tattr.ncpus > 0)
+  {
+#if defined __linux && defined __GLIBC__
+    cpu_set_t cpuset;
+    CPU_ZERO (&cpuset);
+    for (uint32_t i = 0; i < tattr.ncpus; i++)
+      if (tattr.cpus[i] < CPU_SETSIZE)
+        CPU_SET (tattr.cpus[i], &cpuset);
+    if ((result = pthread_attr_setaffinity_np (&attr, sizeof (cpuset), &cpuset)) != 0)
+    {
+      DDS_ERROR("ddsrt_thread_create(%s): pthread_attr_setaffinity_np failed with error %d\n", name, result);
+      goto err;
+    }
+#else
+    DDS_WARNING("ddsrt_thread_create(%s): CPU affinity not supported on this platform\n", name);
+#endif
+  }
+
   /* Construct context structure & start thread */
   ctx = ddsrt_malloc (sizeof (thread_context_t));
   ctx->name = ddsrt_strdup(name);
@@ -164,6 +164,18 @@ ddsrt_thread_create(
     DDS_WARNING("SetThreadPriority failed with %i\n", GetLastError());
   }
 
+  if (attr->ncpus > 0) {
+    /* only the first processor group is supported */
+    DWORD_PTR mask = 0;
+    for (uint32_t i = 0; i < attr->ncpus; i++) {
+      if (attr->cpus[i] < 8 * sizeof(mask))
+        mask |= (DWORD_PTR)1 << attr->cpus[i];
+    }
+    if (mask == 0 || SetThreadAffinityMask(thr.handle, mask) == 0) {
+      DDS_WARNING("SetThreadAffinityMask failed with %i\n", GetLastError());
+    }
+  }
+
   return DDS_RETCODE_OK;
 }
 
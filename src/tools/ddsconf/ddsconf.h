@@ -39,6 +39,7 @@ void gendef_pf_memsize16 (FILE *fp, void *parent, struct cfgelem const * const c
 void gendef_pf_networkAddress (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 void gendef_pf_allow_multicast(FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 void gendef_pf_maybe_memsize (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
+void gendef_pf_cpu_set (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 void gendef_pf_int (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 void gendef_pf_uint (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 void gendef_pf_duration (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
@@ -51,6 +52,8 @@ void gendef_pf_retransmit_merging (FILE *fp, void *parent, struct cfgelem const
 void gendef_pf_sched_class (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 void gendef_pf_transport_selector (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 void gendef_pf_many_sockets_mode (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
+void gendef_pf_recv_shard_steering (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
+void gendef_pf_io_uring (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 void gendef_pf_standards_conformance (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 void gendef_pf_shm_loglevel (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 
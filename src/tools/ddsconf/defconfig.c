@@ -142,6 +142,18 @@ void gendef_pf_allow_multicast(FILE *out, void *parent, struct cfgelem const * c
 void gendef_pf_maybe_memsize (FILE *out, void *parent, struct cfgelem const * const cfgelem) {
   gendef_pf_maybe_uint32 (out, parent, cfgelem);
 }
+void gendef_pf_cpu_set (FILE *out, void *parent, struct cfgelem const * const cfgelem) {
+  struct ddsi_config_cpu_set const * const p = cfg_address (parent, cfgelem);
+  if (p->n != 0)
+  {
+    fprintf (out, "  static uint32_t %s_init_[] = {", cfgelem->membername);
+    for (uint32_t i = 0; i < p->n; i++)
+      fprintf (out, "%s%"PRIu32, (i == 0) ? " " : ", ", p->cpus[i]);
+    fprintf (out, " };\n");
+    fprintf (out, "  cfg->%s.n = %"PRIu32";\n", cfgelem->membername, p->n);
+    fprintf (out, "  cfg->%s.cpus = %s_init_;\n", cfgelem->membername, cfgelem->membername);
+  }
+}
 void gendef_pf_int (FILE *out, void *parent, struct cfgelem const * const cfgelem) {
   DDSRT_STATIC_ASSERT (sizeof (int) == sizeof (int32_t));
   gendef_pf_int32 (out, parent, cfgelem);
@@ -181,6 +193,12 @@ void gendef_pf_transport_selector (FILE *out, void *parent, struct cfgelem const
 void gendef_pf_many_sockets_mode (FILE *out, void *parent, struct cfgelem const * const cfgelem) {
   gendef_pf_int (out, parent, cfgelem);
 }
+void gendef_pf_recv_shard_steering (FILE *out, void *parent, struct cfgelem const * const cfgelem) {
+  gendef_pf_int (out, parent, cfgelem);
+}
+void gendef_pf_io_uring (FILE *out, void *parent, struct cfgelem const * const cfgelem) {
+  gendef_pf_int (out, parent, cfgelem);
+}
 void gendef_pf_standards_conformance (FILE *out, void *parent, struct cfgelem const * const cfgelem) {
   gendef_pf_int (out, parent, cfgelem);
 }